@@ -16,12 +16,169 @@
 
 #include "common/common_pch.h"
 
+#include <mutex>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define MTX_HAVE_X86_CLMUL_CRC 1
+# include <immintrin.h>
+#endif
+
 #include "common/bswap.h"
 #include "common/checksums/crc.h"
 #include "common/endian.h"
 
 namespace mtx { namespace checksum {
 
+namespace {
+
+// Number of bytes from which on the carry-less multiplication is used.
+// Shorter buffers are handled with slicing-by-8.
+size_t const s_clmul_min_size = 64;
+
+inline uint32_t
+load_uint32_le(unsigned char const *buffer) {
+  return  static_cast<uint32_t>(buffer[0])
+       | (static_cast<uint32_t>(buffer[1]) <<  8)
+       | (static_cast<uint32_t>(buffer[2]) << 16)
+       | (static_cast<uint32_t>(buffer[3]) << 24);
+}
+
+#if defined(MTX_HAVE_X86_CLMUL_CRC)
+
+struct clmul_constants_t {
+  uint64_t m_fold_by_4[2], m_fold_by_1[2];
+};
+
+// x^exponent mod P for the CRC-32 polynomial in its normal form.
+uint64_t
+x_pow_mod_p(unsigned int exponent) {
+  uint64_t const poly = 0x104c11db7ull;
+  uint64_t result     = 1;
+
+  while (exponent--) {
+    result <<= 1;
+    if (result & 0x100000000ull)
+      result ^= poly;
+  }
+
+  return result;
+}
+
+uint64_t
+reflect_64(uint64_t value) {
+  auto result = uint64_t{};
+
+  for (auto bit = 0; bit < 64; ++bit)
+    if (value & (1ull << bit))
+      result |= 1ull << (63 - bit);
+
+  return result;
+}
+
+// Folding a 128 bit block A = A_hi * x^64 + A_lo forward by n bits
+// means calculating A_hi * (x^(n+64) mod P) + A_lo * (x^n mod P). In
+// the bit-reflected domain the low quadword holds A_hi, and the
+// product of two reflected values is off by one bit, which is
+// compensated for by using one power of x less.
+clmul_constants_t
+calculate_clmul_constants(bool reflected) {
+  auto constants = clmul_constants_t{};
+
+  if (reflected) {
+    constants.m_fold_by_4[0] = reflect_64(x_pow_mod_p(512 + 63));
+    constants.m_fold_by_4[1] = reflect_64(x_pow_mod_p(512 - 1));
+    constants.m_fold_by_1[0] = reflect_64(x_pow_mod_p(128 + 63));
+    constants.m_fold_by_1[1] = reflect_64(x_pow_mod_p(128 - 1));
+
+  } else {
+    constants.m_fold_by_4[0] = x_pow_mod_p(512);
+    constants.m_fold_by_4[1] = x_pow_mod_p(512 + 64);
+    constants.m_fold_by_1[0] = x_pow_mod_p(128);
+    constants.m_fold_by_1[1] = x_pow_mod_p(128 + 64);
+  }
+
+  return constants;
+}
+
+// The bit-reflected CRCs are processed in memory order; the others
+// with the bytes of each block reversed.
+__attribute__((target("pclmul,ssse3")))
+inline __m128i
+load_block(unsigned char const *source,
+           __m128i order) {
+  return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(source)), order);
+}
+
+__attribute__((target("pclmul,ssse3")))
+inline __m128i
+fold_block(__m128i block,
+           __m128i constants,
+           __m128i next_block) {
+  return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(block, constants, 0x00), _mm_clmulepi64_si128(block, constants, 0x11)), next_block);
+}
+
+/* Folds 'size' bytes (a multiple of 16, at least 64) into a single
+   16 byte block with the same remainder modulo the polynomial. The
+   CRC of the whole buffer is the CRC of that block calculated with an
+   initial value of 0. */
+__attribute__((target("pclmul,ssse3")))
+void
+fold_clmul(unsigned char const *buffer,
+           size_t size,
+           uint32_t crc,
+           bool reflected,
+           unsigned char *result) {
+  static auto const s_constants = std::vector<clmul_constants_t>{ calculate_clmul_constants(false), calculate_clmul_constants(true) };
+
+  auto const &constants = s_constants[reflected ? 1 : 0];
+  auto fold_by_4        = _mm_set_epi64x(constants.m_fold_by_4[1], constants.m_fold_by_4[0]);
+  auto fold_by_1        = _mm_set_epi64x(constants.m_fold_by_1[1], constants.m_fold_by_1[0]);
+  auto order            = reflected ? _mm_set_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0) : _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+  // The CRC register corresponds to the first four message bytes.
+  auto first = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer)), _mm_cvtsi32_si128(crc));
+  __m128i blocks[4];
+
+  blocks[0] = _mm_shuffle_epi8(first, order);
+  blocks[1] = load_block(buffer + 16, order);
+  blocks[2] = load_block(buffer + 32, order);
+  blocks[3] = load_block(buffer + 48, order);
+
+  auto position = size_t{64};
+
+  for (; (position + 64) <= size; position += 64)
+    for (auto idx = 0; idx < 4; ++idx)
+      blocks[idx] = fold_block(blocks[idx], fold_by_4, load_block(buffer + position + idx * 16, order));
+
+  auto block = fold_block(fold_block(fold_block(blocks[0], fold_by_1, blocks[1]), fold_by_1, blocks[2]), fold_by_1, blocks[3]);
+
+  for (; position < size; position += 16)
+    block = fold_block(block, fold_by_1, load_block(buffer + position, order));
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(result), _mm_shuffle_epi8(block, order));
+}
+
+bool
+cpu_supports_clmul() {
+  static auto s_supported = []() -> bool {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+  }();
+
+  return s_supported;
+}
+
+#else  // defined(MTX_HAVE_X86_CLMUL_CRC)
+
+bool
+cpu_supports_clmul() {
+  return false;
+}
+
+#endif  // defined(MTX_HAVE_X86_CLMUL_CRC)
+
+}
+
 crc_base_c::table_parameters_t const crc_base_c::ms_table_parameters[5] = {
   { 0,  8,       0x07 },
   { 0, 16,     0x8005 },
@@ -37,9 +194,19 @@ crc_base_c::crc_base_c(type_e type,
   , m_table(table)              // No initializer-list syntax here due to gcc bug 50025.
   , m_crc{crc}
   , m_xor_result{}
+  , m_implementation{implementation_e::slicing_by_8}
 {
-  if (m_table.empty())
-    init_table();
+  // Readers running on their own threads create CRC workers concurrently.
+  static std::mutex s_table_mutex;
+
+  {
+    std::lock_guard<std::mutex> lock{s_table_mutex};
+    if (m_table.empty())
+      init_table();
+  }
+
+  if (is_implementation_supported(implementation_e::clmul))
+    m_implementation = implementation_e::clmul;
 }
 
 crc_base_c::~crc_base_c() {
@@ -56,7 +223,9 @@ crc_base_c::init_table() {
   if ((parameters.bits < 8) || (parameters.bits > 32) || (parameters.poly >= (1LL<<parameters.bits)))
     throw std::domain_error{"Invalid CRC parameters"};
 
-  m_table.resize(256);
+  // Eight tables for slicing-by-8: entry i of table k is the CRC
+  // register after processing byte i followed by k zero bytes.
+  m_table.resize(8 * 256);
 
   for (auto i = 0u; i < 256u; i++) {
     if (parameters.le) {
@@ -73,6 +242,12 @@ crc_base_c::init_table() {
     }
   }
 
+  for (auto k = 1u; k < 8u; k++)
+    for (auto i = 0u; i < 256u; i++) {
+      auto previous        = m_table[(k - 1) * 256 + i];
+      m_table[k * 256 + i] = (previous >> 8) ^ m_table[previous & 0xff];
+    }
+
   // for (auto row = 0u; row < (265u / 4); ++row)
   //   mxinfo(boost::format("0x%|1$08x| 0x%|2$08x| 0x%|3$08x| 0x%|4$08x|\n")
   //          % m_table[row * 4 + 0] % m_table[row * 4 + 1] % m_table[row * 4 + 2] % m_table[row * 4 + 3]);
@@ -111,9 +286,63 @@ crc_base_c::set_xor_result(uint64_t xor_result) {
   m_xor_result = xor_result;
 }
 
+crc_base_c::implementation_e
+crc_base_c::get_implementation()
+  const {
+  return m_implementation;
+}
+
+/** \brief Select how the CRC is calculated
+
+   All implementations yield the same results. The constructor selects
+   the fastest one the CPU supports. Meant for testing and
+   benchmarking.
+*/
+void
+crc_base_c::set_implementation(implementation_e implementation) {
+  if (!is_implementation_supported(implementation))
+    throw std::domain_error{"Unsupported CRC implementation"};
+
+  m_implementation = implementation;
+}
+
+/** \brief Whether or not an implementation can be used
+
+   The carry-less multiplication requires the PCLMULQDQ instruction and
+   is only available for the 32-bit CRCs.
+*/
+bool
+crc_base_c::is_implementation_supported(implementation_e implementation)
+  const {
+  if (implementation_e::clmul != implementation)
+    return true;
+
+  return (32 == ms_table_parameters[m_type].bits) && cpu_supports_clmul();
+}
+
+std::string
+crc_base_c::get_implementation_name(implementation_e implementation) {
+  return implementation_e::clmul        == implementation ? "PCLMULQDQ"
+       : implementation_e::slicing_by_8 == implementation ? "slicing-by-8"
+       :                                                    "byte-wise";
+}
+
 void
 crc_base_c::add_impl(unsigned char const *buffer,
                      size_t size) {
+  if (implementation_e::clmul == m_implementation)
+    add_clmul(buffer, size);
+
+  else if (implementation_e::slicing_by_8 == m_implementation)
+    add_slicing_by_8(buffer, size);
+
+  else
+    add_byte_wise(buffer, size);
+}
+
+void
+crc_base_c::add_byte_wise(unsigned char const *buffer,
+                          size_t size) {
   auto end = buffer + size;
 
   while (buffer < end) {
@@ -122,6 +351,52 @@ crc_base_c::add_impl(unsigned char const *buffer,
   }
 }
 
+void
+crc_base_c::add_slicing_by_8(unsigned char const *buffer,
+                             size_t size) {
+  auto table = m_table.data();
+  auto crc   = m_crc;
+
+  for (; 8 <= size; buffer += 8, size -= 8) {
+    auto one = crc ^ load_uint32_le(buffer);
+    auto two = load_uint32_le(buffer + 4);
+
+    crc = table[7 * 256 + ( one        & 0xff)]
+        ^ table[6 * 256 + ((one >>  8) & 0xff)]
+        ^ table[5 * 256 + ((one >> 16) & 0xff)]
+        ^ table[4 * 256 + ( one >> 24        )]
+        ^ table[3 * 256 + ( two        & 0xff)]
+        ^ table[2 * 256 + ((two >>  8) & 0xff)]
+        ^ table[1 * 256 + ((two >> 16) & 0xff)]
+        ^ table[            two >> 24         ];
+  }
+
+  m_crc = crc;
+
+  add_byte_wise(buffer, size);
+}
+
+void
+crc_base_c::add_clmul(unsigned char const *buffer,
+                      size_t size) {
+#if defined(MTX_HAVE_X86_CLMUL_CRC)
+  if (s_clmul_min_size <= size) {
+    auto folded_size = size & ~static_cast<size_t>(15);
+    unsigned char folded[16];
+
+    fold_clmul(buffer, folded_size, m_crc, !!ms_table_parameters[m_type].le, folded);
+
+    m_crc   = 0;
+    buffer += folded_size;
+    size   -= folded_size;
+
+    add_slicing_by_8(folded, 16);
+  }
+#endif
+
+  add_slicing_by_8(buffer, size);
+}
+
 // ----------------------------------------------------------------------
 
 crc_base_c::table_t crc8_atm_c::ms_table;
@@ -21,6 +21,13 @@
 namespace mtx { namespace checksum {
 
 class crc_base_c: public base_c, public uint_result_c, public set_initial_value_c {
+public:
+  enum class implementation_e {
+      byte_wise
+    , slicing_by_8
+    , clmul
+  };
+
 protected:
   enum type_e {
     crc_8_atm      = 0,
@@ -45,6 +52,7 @@ protected:
   table_t &m_table;
   uint32_t m_crc;
   uint64_t m_xor_result;
+  implementation_e m_implementation;
 
 protected:
   crc_base_c(type_e type, table_t &table, uint32_t crc);
@@ -59,9 +67,18 @@ public:
 
   virtual void set_xor_result(uint64_t xor_result);
 
+  implementation_e get_implementation() const;
+  void set_implementation(implementation_e implementation);
+  bool is_implementation_supported(implementation_e implementation) const;
+  static std::string get_implementation_name(implementation_e implementation);
+
 protected:
   virtual void add_impl(unsigned char const *buffer, size_t size);
 
+  void add_byte_wise(unsigned char const *buffer, size_t size);
+  void add_slicing_by_8(unsigned char const *buffer, size_t size);
+  void add_clmul(unsigned char const *buffer, size_t size);
+
   virtual void set_initial_value_impl(uint64_t initial_value) ;
   virtual void set_initial_value_impl(unsigned char const *buffer, size_t size);
 };
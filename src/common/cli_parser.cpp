@@ -178,6 +178,8 @@ cli_parser_c::add_common_options() {
   OPT("command-line-charset=<charset>", YT("Charset for strings on the command line"));
   OPT("output-charset=<cset>",          YT("Output messages in this charset"));
   OPT("r|redirect-output=<file>",       YT("Redirects all messages into this file."));
+  OPT("profile",                        YT("Outputs the time spent in and the amount of data processed by each stage at the end."));
+  OPT("profile-json=<file>",            YT("Writes the same information to 'file' in JSON format."));
   OPT("@file",                          YT("Reads additional command line options from the specified file (see man page)."));
   OPT("h|help",                         YT("Show this help."));
   OPT("V|version",                      YT("Show version information."));
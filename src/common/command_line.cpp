@@ -23,6 +23,7 @@
 #include "common/hacks.h"
 #include "common/mm_io_x.h"
 #include "common/mm_write_buffer_io.h"
+#include "common/profiling.h"
 #include "common/strings/editing.h"
 #include "common/strings/utf8.h"
 #include "common/translation.h"
@@ -206,6 +207,17 @@ handle_common_cli_args(std::vector<std::string> &args,
       g_gui_mode = true;
       args.erase(args.begin() + i, args.begin() + i + 1);
 
+    } else if (args[i] == "--profile") {
+      profiling_c::enable();
+      args.erase(args.begin() + i, args.begin() + i + 1);
+
+    } else if (args[i] == "--profile-json") {
+      if ((i + 1) == args.size())
+        mxerror(Y("'--profile-json' lacks the file name.\n"));
+
+      profiling_c::enable(args[i + 1]);
+      args.erase(args.begin() + i, args.begin() + i + 2);
+
     } else
       ++i;
   }
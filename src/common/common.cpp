@@ -28,6 +28,8 @@
 
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
+#include "common/memory_pool.h"
+#include "common/profiling.h"
 #include "common/random.h"
 #include "common/stereo_mode.h"
 #include "common/strings/editing.h"
@@ -81,6 +83,8 @@ static std::string s_program_name;
 
 static void
 mtx_common_cleanup() {
+  profiling_c::report();
+
   // Make sure g_mm_stdio is closed before the global destruction
   // kicks in. If it's redirected to a file then this is an instance
   // of a buffered file. If it's only collected via global destruction
@@ -94,6 +98,7 @@ mtx_common_cleanup() {
 
   random_c::cleanup();
   mm_file_io_c::cleanup();
+  memory_pool_c::cleanup();
 
   matroska_done();
 }
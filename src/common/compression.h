@@ -81,6 +81,12 @@ public:
 
   virtual void set_track_headers(KaxContentEncoding &c_encoding);
 
+  // Whether or not compress() may be called from several threads at
+  // the same time.
+  virtual bool supports_parallel_compression() const {
+    return true;
+  }
+
   static compressor_ptr create(compression_method_e method);
   static compressor_ptr create(const char *method);
   static compressor_ptr create_from_file_name(std::string const &file_name);
@@ -49,6 +49,10 @@ public:
   virtual memory_cptr do_compress(memory_cptr const &buffer);
 
   virtual void set_track_headers(KaxContentEncoding &c_encoding);
+
+  virtual bool supports_parallel_compression() const {
+    return false;
+  }
 };
 
 class mpeg4_p2_compressor_c: public header_removal_compressor_c {
@@ -13,6 +13,7 @@
 
 #include "common/common_pch.h"
 
+#include <mutex>
 #include <sstream>
 
 #include <ebml/EbmlDate.h>
@@ -137,23 +138,31 @@ debugging_c::hexdump(const void *buffer_to_dump,
 
 // ------------------------------------------------------------
 
-std::vector<debugging_option_c::option_c> debugging_option_c::ms_registered_options;
+std::deque<debugging_option_c::option_c> debugging_option_c::ms_registered_options;
 
-size_t
+// Registration may happen on several threads (e.g. mkvmerge's reader
+// threads). The entries never move as they're kept in a deque.
+static std::mutex s_registered_options_mutex;
+
+debugging_option_c::option_c *
 debugging_option_c::register_option(std::string const &option) {
+  std::lock_guard<std::mutex> lock{s_registered_options_mutex};
+
   auto itr = brng::find_if(ms_registered_options, [&option](option_c const &opt) { return opt.m_option == option; });
   if (itr != ms_registered_options.end())
-    return std::distance(ms_registered_options.begin(), itr);
+    return &*itr;
 
   ms_registered_options.emplace_back(option);
 
-  return ms_registered_options.size() - 1;
+  return &ms_registered_options.back();
 }
 
 void
 debugging_option_c::invalidate_cache() {
+  std::lock_guard<std::mutex> lock{s_registered_options_mutex};
+
   for (auto &opt : ms_registered_options)
-    opt.m_requested = boost::logic::indeterminate;
+    opt.m_requested.store(-1, std::memory_order_release);
 }
 
 // ------------------------------------------------------------
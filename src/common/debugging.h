@@ -16,6 +16,8 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
+#include <deque>
 #include <sstream>
 #include <unordered_map>
 
@@ -41,48 +43,70 @@ public:
   static void init();
 };
 
+/* Options are looked up on every debug statement and from several
+   threads. Each option caches a pointer to its registered entry whose
+   state is kept in an atomic so that only the registration needs to
+   take a lock. */
 class debugging_option_c {
   struct option_c {
-    boost::tribool m_requested;
+    std::atomic<int> m_requested; // -1 if not determined yet
     std::string m_option;
 
     option_c(std::string const &option)
-      : m_requested{boost::logic::indeterminate}
+      : m_requested{-1}
       , m_option{option}
     {
     }
 
     bool get() {
-      if (boost::logic::indeterminate(m_requested))
-        m_requested = debugging_c::requested(m_option);
+      auto requested = m_requested.load(std::memory_order_acquire);
+      if (-1 == requested) {
+        requested = debugging_c::requested(m_option) ? 1 : 0;
+        m_requested.store(requested, std::memory_order_release);
+      }
 
-      return m_requested;
+      return 1 == requested;
     }
   };
 
 protected:
-  mutable size_t m_registered_idx;
+  mutable std::atomic<option_c *> m_registered_option;
   std::string m_option;
 
 private:
-  static std::vector<option_c> ms_registered_options;
+  static std::deque<option_c> ms_registered_options;
 
 public:
   debugging_option_c(std::string const &option)
-    : m_registered_idx{std::numeric_limits<size_t>::max()}
+    : m_registered_option{nullptr}
     , m_option{option}
   {
   }
 
+  debugging_option_c(debugging_option_c const &other)
+    : m_registered_option{other.m_registered_option.load(std::memory_order_acquire)}
+    , m_option{other.m_option}
+  {
+  }
+
+  debugging_option_c &operator =(debugging_option_c const &other) {
+    m_registered_option.store(other.m_registered_option.load(std::memory_order_acquire), std::memory_order_release);
+    m_option = other.m_option;
+    return *this;
+  }
+
   operator bool() const {
-    if (m_registered_idx == std::numeric_limits<size_t>::max())
-      m_registered_idx = register_option(m_option);
+    auto option = m_registered_option.load(std::memory_order_acquire);
+    if (!option) {
+      option = register_option(m_option);
+      m_registered_option.store(option, std::memory_order_release);
+    }
 
-    return ms_registered_options.at(m_registered_idx).get();
+    return option->get();
   }
 
 public:
-  static size_t register_option(std::string const &option);
+  static option_c *register_option(std::string const &option);
   static void invalidate_cache();
 };
 
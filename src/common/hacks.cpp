@@ -41,6 +41,7 @@ static const struct {
   { ENGAGE_NO_CUE_RELATIVE_POSITION,     "no_cue_relative_position"     },
   { ENGAGE_NO_DELAY_FOR_GARBAGE_IN_AVI,  "no_delay_for_garbage_in_avi"  },
   { ENGAGE_KEEP_LAST_CHAPTER_IN_MPLS,    "keep_last_chapter_in_mpls"    },
+  { ENGAGE_DIRECT_CLUSTER_RENDERING,     "direct_cluster_rendering"     },
   { 0,                                   nullptr },
 };
 static std::vector<bool> s_engaged_hacks(ENGAGE_MAX_IDX + 1, false);
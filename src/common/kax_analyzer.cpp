@@ -66,6 +66,9 @@ kax_analyzer_c::kax_analyzer_c(std::string file_name)
   , m_file(nullptr)
   , m_close_file(true)
   , m_stream(nullptr)
+  , m_parse_mode(parse_mode_full)
+  , m_max_bytes_to_read(1024 * 1024)
+  , m_bytes_read(0)
   , m_debugging_requested{"kax_analyzer"}
 {
 }
@@ -75,6 +78,9 @@ kax_analyzer_c::kax_analyzer_c(mm_file_io_c *file)
   , m_file(file)
   , m_close_file(false)
   , m_stream(nullptr)
+  , m_parse_mode(parse_mode_full)
+  , m_max_bytes_to_read(1024 * 1024)
+  , m_bytes_read(0)
   , m_debugging_requested{"kax_analyzer"}
 {
 }
@@ -215,10 +221,53 @@ kax_analyzer_c::process(kax_analyzer_c::parse_mode_e parse_mode,
   }
 }
 
+/** \brief Limits the number of bytes read in the meta seek parse mode
+
+   The limit covers everything the analysis reads: the EBML head, the
+   heads of all level 1 elements and the meta seek elements. If it is
+   exceeded then the analysis is aborted with an exception.
+*/
+void
+kax_analyzer_c::set_max_bytes_to_read(uint64_t max_bytes_to_read) {
+  m_max_bytes_to_read = max_bytes_to_read;
+}
+
+void
+kax_analyzer_c::account_for_bytes_read(uint64_t num_bytes) {
+  m_bytes_read += num_bytes;
+
+  if ((parse_mode_meta_seek == m_parse_mode) && (m_bytes_read > m_max_bytes_to_read))
+    throw mtx::kax_analyzer_x(boost::format(Y("More than %1% bytes would have to be read for analyzing the file with the meta seek parse mode")) % m_max_bytes_to_read);
+}
+
+/** \brief Analyzes the file's level 1 elements
+
+   In the full parse mode all level 1 elements are found by walking
+   over the whole segment.
+
+   The fast mode walks over the level 1 elements until both a cluster
+   and a meta seek element have been found, which may mean walking over
+   all clusters, and adds the elements referenced by the meta seek
+   elements. Their sizes are assumed to reach up to the next known
+   element.
+
+   The meta seek mode is strictly bounded: it stops at the first
+   cluster, requires a meta seek element before it, reads the heads of
+   the referenced elements in order to determine their actual sizes and
+   never reads more than \c m_max_bytes_to_read bytes. The ranges that
+   haven't been looked at are recorded as clusters so that they are
+   never treated as free space. An exception is thrown whenever the
+   file's structure doesn't allow proceeding safely.
+*/
 bool
 kax_analyzer_c::process_internal(kax_analyzer_c::parse_mode_e parse_mode,
                                  const open_mode mode) {
-  bool parse_fully = parse_mode_full == parse_mode;
+  bool parse_fully    = parse_mode_full      == parse_mode;
+  bool bounded        = parse_mode_meta_seek == parse_mode;
+  uint64_t max_search = bounded ? m_max_bytes_to_read : 0xFFFFFFFFL;
+
+  m_parse_mode = parse_mode;
+  m_bytes_read = 0;
 
   reopen_file(mode);
 
@@ -232,7 +281,7 @@ kax_analyzer_c::process_internal(kax_analyzer_c::parse_mode_e parse_mode,
   m_stream = new EbmlStream(*m_file);
 
   // Find the EbmlHead element. Must be the first one.
-  EbmlElement *l0 = m_stream->FindNextID(EBML_INFO(EbmlHead), 0xFFFFFFFFL);
+  EbmlElement *l0 = m_stream->FindNextID(EBML_INFO(EbmlHead), max_search);
   if (!l0)
     throw mtx::kax_analyzer_x(Y("Not a valid Matroska file (no EBML head found)"));
 
@@ -242,7 +291,7 @@ kax_analyzer_c::process_internal(kax_analyzer_c::parse_mode_e parse_mode,
 
   while (1) {
     // Next element must be a segment
-    l0 = m_stream->FindNextID(EBML_INFO(KaxSegment), 0xFFFFFFFFFFFFFFFFLL);
+    l0 = m_stream->FindNextID(EBML_INFO(KaxSegment), bounded ? max_search : 0xFFFFFFFFFFFFFFFFLL);
     if (!l0)
       throw mtx::kax_analyzer_x(Y("Not a valid Matroska file (no segment/level 0 element found)"));
 
@@ -259,16 +308,39 @@ kax_analyzer_c::process_internal(kax_analyzer_c::parse_mode_e parse_mode,
   bool cluster_found   = false;
   bool meta_seek_found = false;
   auto segment_end     = m_segment->IsFiniteSize() ? m_segment->GetElementPosition() + m_segment->HeadSize() + m_segment->GetSize() : m_file->get_size();
+  auto expected_pos    = m_file->getFilePointer();
   EbmlElement *l1      = nullptr;
 
+  // Everything up to the segment's data has been read or searched.
+  account_for_bytes_read(expected_pos);
+
   // We've got our segment, so let's find all level 1 elements.
   while (m_file->getFilePointer() < segment_end) {
     if (!l1)
-      l1 = m_stream->FindNextElement(EBML_CONTEXT(l0), upper_lvl_el, 0xFFFFFFFFL, true, 1);
+      l1 = m_stream->FindNextElement(EBML_CONTEXT(l0), upper_lvl_el, max_search, true, 1);
 
     if (!l1 || (0 < upper_lvl_el))
       break;
 
+    if (bounded) {
+      // Any gap means that data had to be skipped in order to find the
+      // element.
+      if ((l1->GetElementPosition() != expected_pos) || (!Is<KaxCluster>(l1) && !l1->IsFiniteSize())) {
+        delete l1;
+        throw mtx::kax_analyzer_x(boost::format(Y("The level 1 element at position %1% is damaged or not located where it was expected")) % expected_pos);
+      }
+
+      // The clusters are covered by read_element_sizes() which doesn't
+      // rely on their sizes.
+      if (Is<KaxCluster>(l1)) {
+        cluster_found = true;
+        break;
+      }
+
+      account_for_bytes_read(l1->HeadSize());
+      expected_pos = l1->GetElementPosition() + l1->ElementSize(true);
+    }
+
     m_data.push_back(kax_analyzer_data_c::create(EbmlId(*l1), l1->GetElementPosition(), l1->ElementSize(true)));
 
     cluster_found   |= Is<KaxCluster>(l1);
@@ -288,13 +360,19 @@ kax_analyzer_c::process_internal(kax_analyzer_c::parse_mode_e parse_mode,
   if (l1)
     delete l1;
 
+  if (!aborted && bounded && cluster_found && !meta_seek_found)
+    throw mtx::kax_analyzer_x(Y("The file does not contain a meta seek element in front of the first cluster. Use a different parse mode"));
+
   if (!aborted && !parse_fully)
     read_all_meta_seeks();
 
   show_progress_done();
 
   if (!aborted) {
-    if (parse_mode_full != parse_mode)
+    if (bounded)
+      read_element_sizes(file_size);
+
+    else if (parse_mode_full != parse_mode)
       fix_element_sizes(file_size);
 
     return true;
@@ -1074,7 +1152,7 @@ kax_analyzer_c::read_meta_seek(uint64_t pos,
   m_file->setFilePointer(pos, seek_beginning);
 
   int upper_lvl_el = 0;
-  EbmlElement *l1  = m_stream->FindNextElement(EBML_CONTEXT(m_segment), upper_lvl_el, 0xFFFFFFFFL, true, 1);
+  EbmlElement *l1  = m_stream->FindNextElement(EBML_CONTEXT(m_segment), upper_lvl_el, parse_mode_meta_seek == m_parse_mode ? 16 : 0xFFFFFFFFL, true, 1);
 
   if (!l1)
     return;
@@ -1084,6 +1162,13 @@ kax_analyzer_c::read_meta_seek(uint64_t pos,
     return;
   }
 
+  try {
+    account_for_bytes_read(l1->ElementSize(true));
+  } catch (...) {
+    delete l1;
+    throw;
+  }
+
   EbmlElement *l2    = nullptr;
   EbmlMaster *master = static_cast<EbmlMaster *>(l1);
   master->Read(*m_stream, EBML_CONTEXT(l1), upper_lvl_el, l2, true);
@@ -1104,6 +1189,12 @@ kax_analyzer_c::read_meta_seek(uint64_t pos,
       continue;
 
     EbmlId the_id(seek_id->GetBuffer(), seek_id->GetSize());
+
+    // The clusters aren't needed for editing the other elements and
+    // would only eat into the limit of bytes to read.
+    if ((parse_mode_meta_seek == m_parse_mode) && Is<KaxCluster>(the_id))
+      continue;
+
     m_data.push_back(kax_analyzer_data_c::create(the_id, seek_pos, -1));
     positions_found[seek_pos] = true;
 
@@ -1122,6 +1213,47 @@ kax_analyzer_c::fix_element_sizes(uint64_t file_size) {
       m_data[i]->m_size = ((i + 1) < m_data.size() ? m_data[i + 1]->m_pos : file_size) - m_data[i]->m_pos;
 }
 
+/** \brief Determines the actual sizes of the elements found via meta seeks
+
+   Used by the meta seek parse mode instead of \c fix_element_sizes().
+   The head of each element is read and must match the meta seek
+   entry. Afterwards the ranges between the known elements and after
+   the last one are recorded as clusters. That way the functions
+   creating EbmlVoid elements never cover data they don't know about,
+   and the file is never truncated in front of such data.
+*/
+void
+kax_analyzer_c::read_element_sizes(uint64_t file_size) {
+  for (auto &data : m_data) {
+    if (-1 != data->m_size)
+      continue;
+
+    m_file->setFilePointer(data->m_pos);
+
+    int upper_lvl_el = 0;
+    ebml_element_cptr l1{m_stream->FindNextElement(EBML_CONTEXT(m_segment), upper_lvl_el, 16, true, 1)};
+
+    if (!l1 || (l1->GetElementPosition() != data->m_pos) || (EbmlId(*l1) != data->m_id) || !l1->IsFiniteSize())
+      throw mtx::kax_analyzer_x(boost::format(Y("The meta seek entry for position %1% does not point to a valid element of the expected type")) % data->m_pos);
+
+    account_for_bytes_read(l1->HeadSize());
+    data->m_size = l1->ElementSize(true);
+  }
+
+  for (auto idx = 0u; m_data.size() > idx; ++idx) {
+    auto end_pos  = m_data[idx]->m_pos + m_data[idx]->m_size;
+    auto next_pos = (idx + 1) < m_data.size() ? m_data[idx + 1]->m_pos : file_size;
+
+    if (end_pos > next_pos)
+      throw mtx::kax_analyzer_x(boost::format(Y("The level 1 elements at positions %1% and %2% overlap")) % m_data[idx]->m_pos % next_pos);
+
+    if (end_pos < next_pos) {
+      m_data.insert(m_data.begin() + idx + 1, kax_analyzer_data_c::create(EBML_ID(KaxCluster), end_pos, next_pos - end_pos));
+      ++idx;
+    }
+  }
+}
+
 kax_analyzer_c::placement_strategy_e
 kax_analyzer_c::get_placement_strategy_for(EbmlElement *e) {
   return Is<KaxTags>(e) ? ps_end : ps_anywhere;
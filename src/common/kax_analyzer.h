@@ -80,6 +80,7 @@ public:
   enum parse_mode_e {
     parse_mode_fast,
     parse_mode_full,
+    parse_mode_meta_seek,
   };
 
   enum placement_strategy_e {
@@ -97,6 +98,8 @@ private:
   std::shared_ptr<KaxSegment> m_segment;
   std::map<int64_t, bool> m_meta_seeks_by_position;
   EbmlStream *m_stream;
+  parse_mode_e m_parse_mode;
+  uint64_t m_max_bytes_to_read, m_bytes_read;
   debugging_option_c m_debugging_requested;
 
 public:                         // Static functions
@@ -136,6 +139,7 @@ public:
   virtual uint64_t get_segment_data_start_pos() const;
 
   virtual bool process(parse_mode_e parse_mode = parse_mode_full, const open_mode mode = MODE_WRITE, bool throw_on_error = false);
+  virtual void set_max_bytes_to_read(uint64_t max_bytes_to_read);
 
   virtual void show_progress_start(int64_t /* size */) {
   }
@@ -187,6 +191,8 @@ protected:
   virtual void read_all_meta_seeks();
   virtual void read_meta_seek(uint64_t pos, std::map<int64_t, bool> &positions_found);
   virtual void fix_element_sizes(uint64_t file_size);
+  virtual void read_element_sizes(uint64_t file_size);
+  virtual void account_for_bytes_read(uint64_t num_bytes);
 
 protected:
   virtual bool process_internal(parse_mode_e parse_mode, const open_mode mode);
@@ -0,0 +1,637 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the persistent Matroska cluster index
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/checksums/base.h"
+#include "common/kax_cluster_index.h"
+#include "common/mm_io_x.h"
+#include "common/strings/formatting.h"
+#include "common/vint.h"
+
+namespace {
+
+// The index only needs a handful of elements. Parsing them directly
+// avoids instantiating libmatroska's element tree for every cluster.
+uint32_t const s_id_ebml_head           = 0x1a45dfa3;
+uint32_t const s_id_segment             = 0x18538067;
+uint32_t const s_id_seek_head           = 0x114d9b74;
+uint32_t const s_id_seek                = 0x4dbb;
+uint32_t const s_id_seek_id             = 0x53ab;
+uint32_t const s_id_seek_position       = 0x53ac;
+uint32_t const s_id_info                = 0x1549a966;
+uint32_t const s_id_timecode_scale      = 0x2ad7b1;
+uint32_t const s_id_tracks              = 0x1654ae6b;
+uint32_t const s_id_cues                = 0x1c53bb6b;
+uint32_t const s_id_cue_point           = 0xbb;
+uint32_t const s_id_cue_time            = 0xb3;
+uint32_t const s_id_cue_track_positions = 0xb7;
+uint32_t const s_id_cue_track           = 0xf7;
+uint32_t const s_id_cue_cluster_pos     = 0xf1;
+uint32_t const s_id_cluster             = 0x1f43b675;
+uint32_t const s_id_cluster_timecode    = 0xe7;
+uint32_t const s_id_simple_block        = 0xa3;
+uint32_t const s_id_block_group         = 0xa0;
+uint32_t const s_id_block               = 0xa1;
+uint32_t const s_id_reference_block     = 0xfb;
+uint32_t const s_id_attachments         = 0x1941a469;
+uint32_t const s_id_chapters            = 0x1043a770;
+uint32_t const s_id_tags                = 0x1254c367;
+
+char const s_magic[]                    = "mtxcidx1";
+size_t const s_magic_size               = 8;
+
+struct element_header_t {
+  uint64_t m_position, m_data_start;
+  vint_c m_id, m_size;
+
+  bool
+  is_valid() {
+    return m_id.is_valid() && m_size.is_valid();
+  }
+
+  uint64_t
+  get_data_end() {
+    return m_data_start + m_size.m_value;
+  }
+};
+
+element_header_t
+read_element_header(mm_io_c &in) {
+  auto header         = element_header_t{};
+  header.m_position   = in.getFilePointer();
+  header.m_id         = vint_c::read_ebml_id(&in);
+  header.m_size       = vint_c::read(&in);
+  header.m_data_start = in.getFilePointer();
+
+  return header;
+}
+
+uint64_t
+read_uint(mm_io_c &in,
+          vint_c const &size) {
+  if (8 < size.m_value)
+    throw mtx::mm_io::end_of_file_x{};
+
+  auto value = uint64_t{};
+  for (auto idx = 0; idx < size.m_value; ++idx)
+    value = (value << 8) | in.read_uint8();
+
+  return value;
+}
+
+bool
+is_level1_id(int64_t id) {
+  return (s_id_seek_head   == id)
+      || (s_id_info        == id)
+      || (s_id_tracks      == id)
+      || (s_id_cues        == id)
+      || (s_id_cluster     == id)
+      || (s_id_attachments == id)
+      || (s_id_chapters    == id)
+      || (s_id_tags        == id);
+}
+
+}
+
+kax_cluster_index_c::kax_cluster_index_c()
+  : m_file_size{}
+  , m_file_time{}
+  , m_from_cues{}
+  , m_debug{"cluster_index"}
+{
+}
+
+void
+kax_cluster_index_c::set_file_properties(uint64_t file_size,
+                                         int64_t file_time) {
+  m_file_size = file_size;
+  m_file_time = file_time;
+}
+
+bool
+kax_cluster_index_c::empty()
+  const {
+  return m_clusters.empty();
+}
+
+bool
+kax_cluster_index_c::is_from_cues()
+  const {
+  return m_from_cues;
+}
+
+std::vector<kax_cluster_index_c::cluster_t> const &
+kax_cluster_index_c::get_clusters()
+  const {
+  return m_clusters;
+}
+
+std::vector<kax_cluster_index_c::keyframe_t> const &
+kax_cluster_index_c::get_keyframes(uint64_t track_number)
+  const {
+  static std::vector<keyframe_t> s_no_keyframes;
+
+  auto itr = m_keyframes.find(track_number);
+  return itr != m_keyframes.end() ? itr->second : s_no_keyframes;
+}
+
+/** \brief Find the cluster to start reading at for a given timecode
+
+   For each of the given tracks the last key frame whose timecode is
+   less than or equal to \c timecode is looked up. The earliest of the
+   clusters containing those key frames is returned.
+
+   \return Nothing if one of the tracks doesn't have such a key frame,
+     meaning that reading has to start at the beginning.
+*/
+boost::optional<uint64_t>
+kax_cluster_index_c::find_cluster_position(int64_t timecode,
+                                           std::vector<uint64_t> const &track_numbers)
+  const {
+  auto result = boost::optional<uint64_t>{};
+
+  for (auto track_number : track_numbers) {
+    auto &keyframes = get_keyframes(track_number);
+    auto itr        = std::upper_bound(keyframes.begin(), keyframes.end(), timecode, [](int64_t tc, keyframe_t const &keyframe) { return tc < keyframe.m_timecode; });
+
+    if (keyframes.begin() == itr)
+      return boost::optional<uint64_t>{};
+
+    auto position = (itr - 1)->m_cluster_position;
+    result        = result ? std::min(*result, position) : position;
+  }
+
+  return result;
+}
+
+void
+kax_cluster_index_c::add_keyframe(uint64_t track_number,
+                                  int64_t timecode,
+                                  uint64_t cluster_position) {
+  m_keyframes[track_number].push_back(keyframe_t{ timecode, cluster_position });
+}
+
+void
+kax_cluster_index_c::sort_keyframes() {
+  for (auto &track : m_keyframes) {
+    auto &keyframes = track.second;
+
+    std::stable_sort(keyframes.begin(), keyframes.end(), [](keyframe_t const &a, keyframe_t const &b) { return a.m_timecode < b.m_timecode; });
+
+    // Only the first key frame of each cluster is needed for seeking.
+    keyframes.erase(std::unique(keyframes.begin(), keyframes.end(), [](keyframe_t const &a, keyframe_t const &b) { return a.m_cluster_position == b.m_cluster_position; }),
+                    keyframes.end());
+  }
+}
+
+bool
+kax_cluster_index_c::build(mm_io_c &in) {
+  m_clusters.clear();
+  m_keyframes.clear();
+  m_from_cues = false;
+
+  auto file_size = static_cast<uint64_t>(in.get_size());
+
+  try {
+    in.setFilePointer(0, seek_beginning);
+
+    auto header = read_element_header(in);
+    if (!header.is_valid() || (s_id_ebml_head != header.m_id.m_value) || header.m_size.is_unknown())
+      return false;
+
+    in.setFilePointer(header.get_data_end(), seek_beginning);
+
+    while (true) {
+      header = read_element_header(in);
+      if (!header.is_valid())
+        return false;
+
+      if (s_id_segment == header.m_id.m_value)
+        break;
+
+      if (header.m_size.is_unknown())
+        return false;
+
+      in.setFilePointer(header.get_data_end(), seek_beginning);
+    }
+
+    auto segment_end = header.m_size.is_unknown() ? file_size : std::min(header.get_data_end(), file_size);
+    parse_segment(in, header.m_data_start, segment_end);
+
+  } catch (mtx::mm_io::exception &) {
+    // Use whatever has been found before the file ended or the
+    // structure became unreadable.
+    mxdebug_if(m_debug, boost::format("build: I/O exception after %1% clusters\n") % m_clusters.size());
+  }
+
+  sort_keyframes();
+
+  mxdebug_if(m_debug, boost::format("build: %1% clusters, %2% tracks with key frames, from cues: %3%\n") % m_clusters.size() % m_keyframes.size() % m_from_cues);
+
+  return !m_clusters.empty();
+}
+
+bool
+kax_cluster_index_c::parse_segment(mm_io_c &in,
+                                   uint64_t segment_data_start,
+                                   uint64_t segment_end) {
+  auto timecode_scale = int64_t{TIMECODE_SCALE};
+  auto cues_position  = uint64_t{};
+  auto first_cluster  = true;
+  auto scan_blocks    = false;
+
+  while (in.getFilePointer() < segment_end) {
+    auto header = read_element_header(in);
+    if (!header.is_valid())
+      break;
+
+    if (s_id_cluster == header.m_id.m_value) {
+      // Key frames are only read from the blocks if the file doesn't
+      // contain cues. Their position is known at this point if the
+      // cues precede the clusters or if the seek head lists them.
+      if (first_cluster)
+        scan_blocks = !cues_position;
+      first_cluster = false;
+
+      auto size_known = !header.m_size.is_unknown();
+      auto end        = size_known ? std::min(header.get_data_end(), segment_end) : segment_end;
+
+      in.setFilePointer(parse_cluster(in, header.m_position, end, size_known, timecode_scale, scan_blocks), seek_beginning);
+      continue;
+    }
+
+    if (header.m_size.is_unknown())
+      break;
+
+    if (s_id_info == header.m_id.m_value) {
+      while (in.getFilePointer() < header.get_data_end()) {
+        auto child = read_element_header(in);
+        if (!child.is_valid())
+          break;
+
+        if (s_id_timecode_scale == child.m_id.m_value)
+          timecode_scale = read_uint(in, child.m_size);
+
+        in.setFilePointer(child.get_data_end(), seek_beginning);
+      }
+
+    } else if (s_id_seek_head == header.m_id.m_value)
+      parse_seek_head(in, header.get_data_end(), segment_data_start, cues_position);
+
+    else if (s_id_cues == header.m_id.m_value)
+      cues_position = header.m_position;
+
+    in.setFilePointer(header.get_data_end(), seek_beginning);
+  }
+
+  if (!m_keyframes.empty() || !cues_position)
+    return true;
+
+  in.setFilePointer(cues_position, seek_beginning);
+  auto header = read_element_header(in);
+  if (!header.is_valid() || (s_id_cues != header.m_id.m_value) || header.m_size.is_unknown())
+    return false;
+
+  parse_cues(in, std::min(header.get_data_end(), segment_end), segment_data_start, timecode_scale);
+  m_from_cues = true;
+
+  return true;
+}
+
+void
+kax_cluster_index_c::parse_seek_head(mm_io_c &in,
+                                     uint64_t end,
+                                     uint64_t segment_data_start,
+                                     uint64_t &cues_position) {
+  while (in.getFilePointer() < end) {
+    auto seek = read_element_header(in);
+    if (!seek.is_valid() || seek.m_size.is_unknown())
+      return;
+
+    if (s_id_seek == seek.m_id.m_value) {
+      auto id       = uint64_t{};
+      auto position = uint64_t{};
+
+      while (in.getFilePointer() < seek.get_data_end()) {
+        auto child = read_element_header(in);
+        if (!child.is_valid())
+          return;
+
+        if (s_id_seek_id == child.m_id.m_value)
+          id = read_uint(in, child.m_size);
+        else if (s_id_seek_position == child.m_id.m_value)
+          position = read_uint(in, child.m_size);
+
+        in.setFilePointer(child.get_data_end(), seek_beginning);
+      }
+
+      if ((s_id_cues == id) && position)
+        cues_position = segment_data_start + position;
+    }
+
+    in.setFilePointer(seek.get_data_end(), seek_beginning);
+  }
+}
+
+void
+kax_cluster_index_c::parse_cues(mm_io_c &in,
+                                uint64_t end,
+                                uint64_t segment_data_start,
+                                int64_t timecode_scale) {
+  while (in.getFilePointer() < end) {
+    auto cue_point = read_element_header(in);
+    if (!cue_point.is_valid() || cue_point.m_size.is_unknown())
+      return;
+
+    if (s_id_cue_point == cue_point.m_id.m_value) {
+      auto timecode  = int64_t{-1};
+      auto positions = std::vector<std::pair<uint64_t, uint64_t>>{};
+
+      while (in.getFilePointer() < cue_point.get_data_end()) {
+        auto child = read_element_header(in);
+        if (!child.is_valid())
+          return;
+
+        if (s_id_cue_time == child.m_id.m_value)
+          timecode = read_uint(in, child.m_size) * timecode_scale;
+
+        else if (s_id_cue_track_positions == child.m_id.m_value) {
+          auto track    = uint64_t{};
+          auto position = uint64_t{};
+
+          while (in.getFilePointer() < child.get_data_end()) {
+            auto grandchild = read_element_header(in);
+            if (!grandchild.is_valid())
+              return;
+
+            if (s_id_cue_track == grandchild.m_id.m_value)
+              track = read_uint(in, grandchild.m_size);
+            else if (s_id_cue_cluster_pos == grandchild.m_id.m_value)
+              position = read_uint(in, grandchild.m_size);
+
+            in.setFilePointer(grandchild.get_data_end(), seek_beginning);
+          }
+
+          if (track)
+            positions.emplace_back(track, segment_data_start + position);
+        }
+
+        in.setFilePointer(child.get_data_end(), seek_beginning);
+      }
+
+      if (0 <= timecode)
+        for (auto const &position : positions)
+          add_keyframe(position.first, timecode, position.second);
+    }
+
+    in.setFilePointer(cue_point.get_data_end(), seek_beginning);
+  }
+}
+
+/** \brief Record one cluster and optionally the key frames in it
+
+   \c in must be positioned at the start of the cluster's data.
+
+   \return The position at which the next level 1 element starts. For
+     clusters of unknown size this is the first level 1 element found
+     inside.
+*/
+uint64_t
+kax_cluster_index_c::parse_cluster(mm_io_c &in,
+                                   uint64_t position,
+                                   uint64_t end,
+                                   bool size_known,
+                                   int64_t timecode_scale,
+                                   bool scan_blocks) {
+  m_clusters.push_back(cluster_t{ position, 0 });
+
+  auto cluster_timecode = int64_t{};
+  auto tracks_seen      = std::set<uint64_t>{};
+
+  while (in.getFilePointer() < end) {
+    auto child = read_element_header(in);
+    if (!child.is_valid())
+      return end;
+
+    if (!size_known && is_level1_id(child.m_id.m_value))
+      return child.m_position;
+
+    if (child.m_size.is_unknown())
+      return end;
+
+    if (s_id_cluster_timecode == child.m_id.m_value) {
+      cluster_timecode             = read_uint(in, child.m_size);
+      m_clusters.back().m_timecode = cluster_timecode * timecode_scale;
+
+      if (!scan_blocks && size_known)
+        break;
+
+    } else if (scan_blocks && (s_id_simple_block == child.m_id.m_value)) {
+      auto track    = vint_c::read(&in);
+      auto relative = static_cast<int16_t>(in.read_uint16_be());
+      auto flags    = in.read_uint8();
+
+      if ((flags & 0x80) && track.is_valid() && tracks_seen.insert(track.m_value).second)
+        add_keyframe(track.m_value, (cluster_timecode + relative) * timecode_scale, position);
+
+    } else if (scan_blocks && (s_id_block_group == child.m_id.m_value)) {
+      auto block_position = uint64_t{};
+      auto has_references = false;
+
+      while (in.getFilePointer() < child.get_data_end()) {
+        auto grandchild = read_element_header(in);
+        if (!grandchild.is_valid())
+          break;
+
+        if (s_id_block == grandchild.m_id.m_value)
+          block_position = grandchild.m_data_start;
+        else if (s_id_reference_block == grandchild.m_id.m_value)
+          has_references = true;
+
+        in.setFilePointer(grandchild.get_data_end(), seek_beginning);
+      }
+
+      if (block_position && !has_references) {
+        in.setFilePointer(block_position, seek_beginning);
+
+        auto track    = vint_c::read(&in);
+        auto relative = static_cast<int16_t>(in.read_uint16_be());
+
+        if (track.is_valid() && tracks_seen.insert(track.m_value).second)
+          add_keyframe(track.m_value, (cluster_timecode + relative) * timecode_scale, position);
+      }
+    }
+
+    in.setFilePointer(child.get_data_end(), seek_beginning);
+  }
+
+  return end;
+}
+
+bool
+kax_cluster_index_c::save(std::string const &index_file_name)
+  const {
+  try {
+    mm_file_io_c out{index_file_name, MODE_CREATE};
+
+    out.write(s_magic, s_magic_size);
+    out.write_uint64_be(m_file_size);
+    out.write_uint64_be(m_file_time);
+    out.write_uint8(m_from_cues ? 1 : 0);
+
+    out.write_uint64_be(m_clusters.size());
+    for (auto const &cluster : m_clusters) {
+      out.write_uint64_be(cluster.m_position);
+      out.write_uint64_be(cluster.m_timecode);
+    }
+
+    out.write_uint64_be(m_keyframes.size());
+    for (auto const &track : m_keyframes) {
+      out.write_uint64_be(track.first);
+      out.write_uint64_be(track.second.size());
+
+      for (auto const &keyframe : track.second) {
+        out.write_uint64_be(keyframe.m_timecode);
+        out.write_uint64_be(keyframe.m_cluster_position);
+      }
+    }
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxdebug_if(m_debug, boost::format("save: writing %1% failed: %2%\n") % index_file_name % ex);
+    return false;
+  }
+
+  return true;
+}
+
+/** \brief Read an index written by save()
+
+   The index is only accepted if it was created for a file with the
+   given size and modification time.
+*/
+bool
+kax_cluster_index_c::load(std::string const &index_file_name,
+                          uint64_t file_size,
+                          int64_t file_time) {
+  m_clusters.clear();
+  m_keyframes.clear();
+
+  try {
+    mm_file_io_c in{index_file_name};
+
+    auto index_size = static_cast<uint64_t>(in.get_size());
+    auto magic      = in.read(s_magic_size);
+
+    if (std::string{reinterpret_cast<char const *>(magic->get_buffer()), s_magic_size} != std::string{s_magic, s_magic_size})
+      return false;
+
+    m_file_size = in.read_uint64_be();
+    m_file_time = in.read_uint64_be();
+    m_from_cues = !!in.read_uint8();
+
+    if ((m_file_size != file_size) || (m_file_time != file_time)) {
+      mxdebug_if(m_debug, boost::format("load: %1% is outdated\n") % index_file_name);
+      return false;
+    }
+
+    auto num_clusters = in.read_uint64_be();
+    if (num_clusters > (index_size / 16))
+      return false;
+
+    m_clusters.resize(num_clusters);
+    for (auto &cluster : m_clusters) {
+      cluster.m_position = in.read_uint64_be();
+      cluster.m_timecode = in.read_uint64_be();
+    }
+
+    auto num_tracks = in.read_uint64_be();
+    for (auto track_idx = 0u; track_idx < num_tracks; ++track_idx) {
+      auto track_number  = in.read_uint64_be();
+      auto num_keyframes = in.read_uint64_be();
+      if (num_keyframes > (index_size / 16))
+        return false;
+
+      auto &keyframes = m_keyframes[track_number];
+      keyframes.resize(num_keyframes);
+
+      for (auto &keyframe : keyframes) {
+        keyframe.m_timecode         = in.read_uint64_be();
+        keyframe.m_cluster_position = in.read_uint64_be();
+      }
+    }
+
+  } catch (mtx::mm_io::exception &) {
+    m_clusters.clear();
+    m_keyframes.clear();
+    return false;
+  }
+
+  mxdebug_if(m_debug, boost::format("load: %1% clusters from %2%\n") % m_clusters.size() % index_file_name);
+
+  return !m_clusters.empty();
+}
+
+/** \brief Where the index for a file is stored
+
+   Without a cache directory the index is stored next to the file
+   itself. Otherwise the name contains a hash of the file's absolute
+   path so that files with the same name in different directories
+   don't share an index.
+*/
+std::string
+kax_cluster_index_c::get_index_file_name(std::string const &file_name,
+                                         std::string const &cache_dir) {
+  if (cache_dir.empty())
+    return file_name + ".mtxcidx";
+
+  auto absolute_name = bfs::system_complete(bfs::path{file_name}).string();
+  auto hash          = to_hex(mtx::checksum::calculate(mtx::checksum::algorithm_e::md5, absolute_name.c_str(), absolute_name.length()), true);
+
+  return (bfs::path{cache_dir} / (bfs::path{file_name}.filename().string() + "." + hash.substr(0, 16) + ".mtxcidx")).string();
+}
+
+kax_cluster_index_cptr
+kax_cluster_index_c::load_or_build(std::string const &file_name,
+                                   mm_io_c &in,
+                                   std::string const &cache_dir) {
+  auto index           = std::make_shared<kax_cluster_index_c>();
+  auto index_file_name = get_index_file_name(file_name, cache_dir);
+  auto file_size       = static_cast<uint64_t>(in.get_size());
+  auto file_time       = int64_t{};
+
+  boost::system::error_code ec;
+  file_time = bfs::last_write_time(bfs::path{file_name}, ec);
+  if (ec)
+    file_time = 0;
+
+  if (index->load(index_file_name, file_size, file_time))
+    return index;
+
+  in.save_pos();
+  auto ok = index->build(in);
+  in.restore_pos();
+
+  if (!ok)
+    return kax_cluster_index_cptr{};
+
+  index->set_file_properties(file_size, file_time);
+
+  if (!cache_dir.empty() && !bfs::is_directory(cache_dir))
+    bfs::create_directories(bfs::path{cache_dir}, ec);
+
+  if (!index->save(index_file_name))
+    mxwarn(boost::format(Y("The cluster index could not be written to '%1%'.\n")) % index_file_name);
+
+  return index;
+}
@@ -0,0 +1,85 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the persistent Matroska cluster index
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_KAX_CLUSTER_INDEX_H
+#define MTX_COMMON_KAX_CLUSTER_INDEX_H
+
+#include "common/common_pch.h"
+
+#include <boost/optional.hpp>
+
+#include "common/mm_io.h"
+
+class kax_cluster_index_c;
+using kax_cluster_index_cptr = std::shared_ptr<kax_cluster_index_c>;
+
+/* A compact index of all clusters in a Matroska file together with the
+   key frames of each track. It is built either from the file's cues or,
+   if there are none, from a single scan over the clusters' block
+   headers, and it can be stored in a small sidecar file so that later
+   runs can seek to a position without parsing the file again.
+
+   All positions are absolute file positions of the cluster elements;
+   all timecodes are in nanoseconds.
+*/
+class kax_cluster_index_c {
+public:
+  struct cluster_t {
+    uint64_t m_position;
+    int64_t m_timecode;
+  };
+
+  struct keyframe_t {
+    int64_t m_timecode;
+    uint64_t m_cluster_position;
+  };
+
+protected:
+  std::vector<cluster_t> m_clusters;
+  std::map<uint64_t, std::vector<keyframe_t>> m_keyframes;
+  uint64_t m_file_size;
+  int64_t m_file_time;
+  bool m_from_cues;
+
+  debugging_option_c m_debug;
+
+public:
+  kax_cluster_index_c();
+
+  bool build(mm_io_c &in);
+  bool load(std::string const &index_file_name, uint64_t file_size, int64_t file_time);
+  bool save(std::string const &index_file_name) const;
+
+  void set_file_properties(uint64_t file_size, int64_t file_time);
+
+  bool empty() const;
+  bool is_from_cues() const;
+  std::vector<cluster_t> const &get_clusters() const;
+  std::vector<keyframe_t> const &get_keyframes(uint64_t track_number) const;
+
+  boost::optional<uint64_t> find_cluster_position(int64_t timecode, std::vector<uint64_t> const &track_numbers) const;
+
+public:                         // static functions
+  static std::string get_index_file_name(std::string const &file_name, std::string const &cache_dir);
+  static kax_cluster_index_cptr load_or_build(std::string const &file_name, mm_io_c &in, std::string const &cache_dir);
+
+protected:
+  bool parse_segment(mm_io_c &in, uint64_t segment_data_start, uint64_t segment_end);
+  void parse_seek_head(mm_io_c &in, uint64_t end, uint64_t segment_data_start, uint64_t &cues_position);
+  void parse_cues(mm_io_c &in, uint64_t end, uint64_t segment_data_start, int64_t timecode_scale);
+  uint64_t parse_cluster(mm_io_c &in, uint64_t position, uint64_t end, bool size_known, int64_t timecode_scale, bool scan_blocks);
+  void add_keyframe(uint64_t track_number, int64_t timecode, uint64_t cluster_position);
+  void sort_keyframes();
+};
+
+#endif  // MTX_COMMON_KAX_CLUSTER_INDEX_H
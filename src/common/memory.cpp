@@ -24,15 +24,22 @@ memory_c::resize(size_t new_size)
     its_counter = new counter(nullptr, 0, false);
 
   if (its_counter->is_free) {
-    its_counter->ptr  = (unsigned char *)saferealloc(its_counter->ptr, new_size + its_counter->offset);
+    if ((new_size + its_counter->offset) > its_counter->capacity) {
+      its_counter->ptr      = (unsigned char *)saferealloc(its_counter->ptr, new_size + its_counter->offset);
+      its_counter->capacity = 0;
+    }
     its_counter->size = new_size + its_counter->offset;
 
   } else {
-    auto tmp = (unsigned char *)safemalloc(new_size);
+    size_t capacity;
+    auto tmp = memory_pool_c::allocate(new_size, capacity);
     memcpy(tmp, its_counter->ptr + its_counter->offset, std::min(new_size, its_counter->size - its_counter->offset));
-    its_counter->ptr     = tmp;
-    its_counter->is_free = true;
-    its_counter->size    = new_size;
+    its_counter->ptr      = tmp;
+    its_counter->is_free  = true;
+    its_counter->size     = new_size;
+    its_counter->offset   = 0;
+    its_counter->capacity = capacity;
+    its_counter->owner.reset();
   }
 }
 
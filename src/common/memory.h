@@ -16,8 +16,11 @@
 
 #include "common/common_pch.h"
 
+#include <atomic>
 #include <deque>
 
+#include "common/memory_pool.h"
+
 namespace mtx {
   namespace mem {
     class exception: public mtx::exception {
@@ -93,8 +96,9 @@ public:
   }
 
   explicit memory_c(size_t s)
-    : its_counter(new counter(static_cast<unsigned char *>(safemalloc(s)), s, true))
+    : its_counter(new counter(nullptr, s, true))
   {
+    its_counter->ptr = memory_pool_c::allocate(s, its_counter->capacity);
   }
 
   ~memory_c() {
@@ -133,7 +137,7 @@ public:
   }
 
   bool is_unique() const throw() {
-    return its_counter ? its_counter->count == 1 : true;
+    return its_counter ? its_counter->count.load(std::memory_order_acquire) == 1 : true;
   }
 
   bool is_allocated() const throw() {
@@ -149,18 +153,25 @@ public:
   }
 
   void grab() {
-    if (!its_counter || its_counter->is_free)
+    // Views keep the buffer they reference alive; see view().
+    if (!its_counter || its_counter->is_free || its_counter->owner)
       return;
 
     its_counter->ptr      = static_cast<unsigned char *>(safememdup(get_buffer(), get_size()));
     its_counter->is_free  = true;
     its_counter->size    -= its_counter->offset;
     its_counter->offset   = 0;
+    its_counter->capacity = 0;
+    its_counter->owner.reset();
   }
 
   void lock() {
-    if (its_counter)
-      its_counter->is_free = false;
+    if (!its_counter)
+      return;
+
+    // Whoever takes over the buffer will free() it.
+    its_counter->is_free  = false;
+    its_counter->capacity = 0;
   }
 
   void resize(size_t new_size) throw();
@@ -198,13 +209,16 @@ public:
 public:
   static memory_cptr
   alloc(size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safemalloc(size)), size, true));
+    return std::make_shared<memory_c>(size);
   };
 
   static inline memory_cptr
   clone(const void *buffer,
         size_t size) {
-    return memory_cptr(new memory_c(static_cast<unsigned char *>(safememdup(buffer, size)), size, true));
+    auto mem = std::make_shared<memory_c>(size);
+    if (size)
+      memcpy(mem->get_buffer(), buffer, size);
+    return mem;
   }
 
   static inline memory_cptr
@@ -217,13 +231,31 @@ public:
     return std::make_shared<memory_c>(reinterpret_cast<unsigned char *>(&buffer[0]), buffer.length(), false);
   }
 
+  // References a buffer owned by someone else without copying it. The
+  // owner is kept alive for as long as the buffer is referenced. It
+  // must not modify the buffer anymore as grab() doesn't copy views.
+  static inline memory_cptr
+  view(unsigned char *buffer,
+       size_t size,
+       std::shared_ptr<void> const &owner) {
+    auto mem                = std::make_shared<memory_c>(buffer, size, false);
+    mem->its_counter->owner = owner;
+    return mem;
+  }
+
 private:
+  // Only the reference count is thread-safe. Copies of a memory_c may be
+  // released on different threads (e.g. by the compression workers),
+  // but the buffer itself must not be modified concurrently; grab() it
+  // before handing it over.
   struct counter {
     unsigned char *ptr;
     size_t size;
     bool is_free;
-    unsigned count;
+    std::atomic<unsigned> count;
     size_t offset;
+    size_t capacity;            // size of the pooled buffer; 0 if not allocated from the pool
+    std::shared_ptr<void> owner;
 
     counter(unsigned char *p = nullptr,
             size_t s = 0,
@@ -234,20 +266,30 @@ private:
       , is_free(f)
       , count(c)
       , offset(0)
+      , capacity(0)
     { }
+
+    static void *operator new(size_t size) {
+      size_t capacity;
+      return memory_pool_c::allocate(size, capacity);
+    }
+
+    static void operator delete(void *p, size_t size) {
+      memory_pool_c::release(static_cast<unsigned char *>(p), size);
+    }
   } *its_counter;
 
   void acquire(counter *c) throw() { // increment the count
     its_counter = c;
     if (c)
-      ++c->count;
+      c->count.fetch_add(1, std::memory_order_relaxed);
   }
 
   void release() { // decrement the count, delete if it is 0
     if (its_counter) {
-      if (--its_counter->count == 0) {
+      if (its_counter->count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
         if (its_counter->is_free)
-          free(its_counter->ptr);
+          memory_pool_c::release(its_counter->ptr, its_counter->capacity);
         delete its_counter;
       }
       its_counter = 0;
@@ -0,0 +1,129 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   pooled memory allocator
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <mutex>
+
+#include "common/memory_pool.h"
+#include "common/profiling.h"
+
+namespace {
+
+// Size classes from 32 bytes up to 1 MB.
+size_t const s_min_shift               = 5;
+size_t const s_max_shift               = 20;
+size_t const s_num_classes             = s_max_shift - s_min_shift + 1;
+size_t const s_max_cached_bytes        = 8 * 1024 * 1024;
+
+struct size_class_t {
+  std::mutex m_mutex;
+  std::vector<unsigned char *> m_free_blocks;
+  uint64_t m_num_hits{}, m_num_misses{}, m_num_recycled{}, m_num_freed{};
+};
+
+// Intentionally never destroyed: buffers may still be released during
+// the destruction of other global objects.
+size_class_t *
+get_size_classes() {
+  static auto s_size_classes = new size_class_t[s_num_classes];
+  return s_size_classes;
+}
+
+size_t
+get_class_index(size_t size) {
+  auto shift = s_min_shift;
+  while ((static_cast<size_t>(1) << shift) < size)
+    ++shift;
+
+  return shift - s_min_shift;
+}
+
+}
+
+unsigned char *
+memory_pool_c::allocate(size_t size,
+                        size_t &capacity) {
+  profiling_c::count_allocation(size);
+
+  if (size > (static_cast<size_t>(1) << s_max_shift)) {
+    capacity = 0;
+    return safemalloc(size);
+  }
+
+  auto idx        = get_class_index(size);
+  auto &the_class = get_size_classes()[idx];
+  capacity        = static_cast<size_t>(1) << (idx + s_min_shift);
+
+  {
+    std::lock_guard<std::mutex> lock{the_class.m_mutex};
+
+    if (!the_class.m_free_blocks.empty()) {
+      auto buffer = the_class.m_free_blocks.back();
+      the_class.m_free_blocks.pop_back();
+      ++the_class.m_num_hits;
+
+      return buffer;
+    }
+
+    ++the_class.m_num_misses;
+  }
+
+  return safemalloc(capacity);
+}
+
+void
+memory_pool_c::release(unsigned char *buffer,
+                       size_t capacity) {
+  if (!buffer)
+    return;
+
+  if (!capacity || (capacity > (static_cast<size_t>(1) << s_max_shift))) {
+    free(buffer);
+    return;
+  }
+
+  auto &the_class = get_size_classes()[get_class_index(capacity)];
+
+  {
+    std::lock_guard<std::mutex> lock{the_class.m_mutex};
+
+    if (((the_class.m_free_blocks.size() + 1) * capacity) <= s_max_cached_bytes) {
+      the_class.m_free_blocks.push_back(buffer);
+      ++the_class.m_num_recycled;
+      return;
+    }
+
+    ++the_class.m_num_freed;
+  }
+
+  free(buffer);
+}
+
+void
+memory_pool_c::cleanup() {
+  static debugging_option_c s_debug{"memory_pool"};
+
+  for (auto idx = 0u; idx < s_num_classes; ++idx) {
+    auto &the_class = get_size_classes()[idx];
+    std::lock_guard<std::mutex> lock{the_class.m_mutex};
+
+    if (s_debug && (the_class.m_num_hits || the_class.m_num_misses))
+      mxdebug(boost::format("memory_pool: class %1% bytes: hits %2% misses %3% recycled %4% freed %5% cached %6%\n")
+              % (static_cast<size_t>(1) << (idx + s_min_shift)) % the_class.m_num_hits % the_class.m_num_misses % the_class.m_num_recycled % the_class.m_num_freed % the_class.m_free_blocks.size());
+
+    for (auto buffer : the_class.m_free_blocks)
+      free(buffer);
+    the_class.m_free_blocks.clear();
+  }
+}
@@ -0,0 +1,35 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the pooled memory allocator
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MEMORY_POOL_H
+#define MTX_COMMON_MEMORY_POOL_H
+
+#include "common/common_pch.h"
+
+/* Caches released buffers in power-of-two size classes for reuse by
+   later allocations of similar sizes.
+
+   All blocks are obtained from malloc() with their full class size, so
+   a pooled buffer may still be handed to free() or realloc() by code
+   taking ownership of it; it is simply not recycled then. Requests
+   larger than the largest size class bypass the pool; their capacity
+   is reported as 0. The pool is thread-safe. */
+class memory_pool_c {
+public:
+  static unsigned char *allocate(size_t size, size_t &capacity);
+  static void release(unsigned char *buffer, size_t capacity);
+
+  static void cleanup();
+};
+
+#endif  // MTX_COMMON_MEMORY_POOL_H
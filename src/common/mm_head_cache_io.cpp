@@ -0,0 +1,89 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class implementation
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_head_cache_io.h"
+#include "common/mm_io_x.h"
+
+mm_head_cache_io_c::mm_head_cache_io_c(mm_io_c *in,
+                                       size_t head_size,
+                                       bool delete_in)
+  : mm_proxy_io_c(in, delete_in)
+  , m_pos(0)
+  , m_size(in->get_size())
+  , m_eof(false)
+{
+  in->setFilePointer(0, seek_beginning);
+  m_head = in->read(std::min<int64_t>(head_size, m_size));
+}
+
+uint64
+mm_head_cache_io_c::getFilePointer() {
+  return m_pos;
+}
+
+void
+mm_head_cache_io_c::setFilePointer(int64 offset,
+                                   seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_size + offset // offsets from the end are negative already
+    :                          m_pos  + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{mtx::mm_io::make_error_code()};
+
+  // Seeking beyond the end is clamped like mm_read_buffer_io_c does so
+  // that probing short files simply fails to find what it's looking for.
+  m_pos = std::min(new_pos, m_size);
+  m_eof = false;
+}
+
+int64_t
+mm_head_cache_io_c::get_size() {
+  return m_size;
+}
+
+uint32
+mm_head_cache_io_c::_read(void *buffer,
+                          size_t size) {
+  auto head_size = static_cast<int64_t>(m_head->get_size());
+  auto num_read  = size_t{};
+
+  if (m_pos < head_size) {
+    num_read = std::min<int64_t>(size, head_size - m_pos);
+    memcpy(buffer, m_head->get_buffer() + m_pos, num_read);
+    m_pos += num_read;
+  }
+
+  if (num_read < size) {
+    // The underlying file's position isn't kept in sync with ours.
+    m_proxy_io->setFilePointer(m_pos, seek_beginning);
+    auto num_read_from_file  = m_proxy_io->read(static_cast<unsigned char *>(buffer) + num_read, size - num_read);
+    m_pos                   += num_read_from_file;
+    num_read                += num_read_from_file;
+  }
+
+  if (num_read < size)
+    m_eof = true;
+
+  return num_read;
+}
+
+size_t
+mm_head_cache_io_c::_write(const void *,
+                           size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
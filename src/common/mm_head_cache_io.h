@@ -0,0 +1,55 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_HEAD_CACHE_IO_H
+#define MTX_COMMON_MM_HEAD_CACHE_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Reads the first bytes of a file once and serves all further reads
+   from that range from memory. Meant for code seeking back to the start
+   of the file over and over again, e.g. when probing for the file
+   type. */
+class mm_head_cache_io_c: public mm_proxy_io_c {
+protected:
+  memory_cptr m_head;
+  int64_t m_pos, m_size;
+  bool m_eof;
+
+public:
+  mm_head_cache_io_c(mm_io_c *in, size_t head_size, bool delete_in = true);
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual int64_t get_size();
+  virtual bool eof() {
+    return m_eof;
+  }
+  virtual void clear_eof() {
+    m_eof = false;
+  }
+
+  memory_c const &get_head() const {
+    return *m_head;
+  }
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+};
+
+using mm_head_cache_io_cptr = std::shared_ptr<mm_head_cache_io_c>;
+
+#endif // MTX_COMMON_MM_HEAD_CACHE_IO_H
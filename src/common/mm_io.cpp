@@ -22,12 +22,17 @@
 #endif
 #include <sys/stat.h>
 #include <sys/types.h>
+#if !defined(SYS_WINDOWS)
+# include <climits>
+# include <sys/uio.h>
+#endif
 
 #include "common/endian.h"
 #include "common/error.h"
 #include "common/fs_sys_helpers.h"
 #include "common/mm_io.h"
 #include "common/mm_io_x.h"
+#include "common/profiling.h"
 #include "common/strings/editing.h"
 #include "common/strings/parsing.h"
 
@@ -101,6 +106,64 @@ mm_file_io_c::_write(const void *buffer,
   return bwritten;
 }
 
+/** \brief Write all spans with as few system calls as possible
+
+   The stream's own buffer is flushed first. The spans are then written
+   with \c writev() straight from the caller's memory.
+*/
+size_t
+mm_file_io_c::_write_spans(std::vector<span_t> const &spans) {
+  if (fflush((FILE *)m_file) != 0)
+    throw mtx::mm_io::read_write_x{mtx::mm_io::make_error_code()};
+
+  auto iovecs = std::vector<iovec>{};
+  for (auto const &span : spans)
+    if (span.second)
+      iovecs.push_back(iovec{ const_cast<void *>(span.first), span.second });
+
+  auto fd      = fileno((FILE *)m_file);
+  auto idx     = size_t{};
+  auto written = size_t{};
+
+  while (idx < iovecs.size()) {
+    auto result = ::writev(fd, &iovecs[idx], std::min<size_t>(iovecs.size() - idx, IOV_MAX));
+
+    if ((0 > result) && (EINTR == errno))
+      continue;
+
+    if (0 > result)
+      throw mtx::mm_io::read_write_x{mtx::mm_io::make_error_code()};
+
+    if (0 == result)
+      break;
+
+    written        += result;
+    auto remaining  = static_cast<size_t>(result);
+
+    while (remaining && (idx < iovecs.size())) {
+      auto &current = iovecs[idx];
+
+      if (remaining < current.iov_len) {
+        current.iov_base  = static_cast<unsigned char *>(current.iov_base) + remaining;
+        current.iov_len  -= remaining;
+        break;
+      }
+
+      remaining -= current.iov_len;
+      ++idx;
+    }
+  }
+
+  m_current_position += written;
+  m_cached_size       = -1;
+
+  // The stream doesn't know about the data written to its descriptor.
+  if (fseeko((FILE *)m_file, m_current_position, SEEK_SET) != 0)
+    throw mtx::mm_io::seek_x{mtx::mm_io::make_error_code()};
+
+  return written;
+}
+
 uint32
 mm_file_io_c::_read(void *buffer,
                     size_t size) {
@@ -275,7 +338,12 @@ mm_io_c::read(size_t size) {
 uint32_t
 mm_io_c::read(void *buffer,
               size_t size) {
-  return _read(buffer, size);
+  profiling_timer_c timer{profiling_c::stage_io_reading};
+
+  auto num_read = _read(buffer, size);
+  timer.add_bytes(num_read);
+
+  return num_read;
 }
 
 uint32_t
@@ -501,7 +569,12 @@ mm_io_c::write(std::string const &buffer) {
 size_t
 mm_io_c::write(const void *buffer,
                size_t size) {
-  return _write(buffer, size);
+  profiling_timer_c timer{profiling_c::stage_io_writing};
+
+  auto num_written = _write(buffer, size);
+  timer.add_bytes(num_written);
+
+  return num_written;
 }
 
 size_t
@@ -515,6 +588,39 @@ mm_io_c::write(const memory_cptr &buffer,
   return size;
 }
 
+/** \brief Write several buffers in one go
+
+   Classes that can pass the buffers on without copying them first,
+   e.g. with \c writev(), override \c _write_spans(). The others
+   write one span after the other.
+
+   \return The total number of bytes written.
+*/
+size_t
+mm_io_c::write_spans(std::vector<span_t> const &spans) {
+  profiling_timer_c timer{profiling_c::stage_io_writing};
+
+  auto num_written = _write_spans(spans);
+  timer.add_bytes(num_written);
+
+  return num_written;
+}
+
+size_t
+mm_io_c::_write_spans(std::vector<span_t> const &spans) {
+  auto written = size_t{};
+
+  for (auto const &span : spans) {
+    auto num_written  = _write(span.first, span.second);
+    written          += num_written;
+
+    if (num_written != span.second)
+      break;
+  }
+
+  return written;
+}
+
 void
 mm_io_c::skip(int64 num_bytes) {
   uint64_t pos = getFilePointer();
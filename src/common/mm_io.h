@@ -29,6 +29,15 @@ class charset_converter_c;
 using charset_converter_cptr = std::shared_ptr<charset_converter_c>;
 
 class mm_io_c: public IOCallback {
+public:
+  enum access_pattern_e {
+    access_normal,
+    access_sequential,
+    access_random,
+  };
+
+  using span_t = std::pair<void const *, size_t>;
+
 protected:
   bool m_dos_style_newlines, m_bom_written;
   std::stack<int64_t> m_positions;
@@ -76,6 +85,7 @@ public:
   virtual size_t write(const void *buffer, size_t size);
   virtual size_t write(std::string const &buffer);
   virtual size_t write(const memory_cptr &buffer, size_t size = UINT_MAX, size_t offset = 0);
+  virtual size_t write_spans(std::vector<span_t> const &spans);
   virtual bool eof() = 0;
   virtual void clear_eof() { }
   virtual void flush() {
@@ -114,9 +124,13 @@ public:
   virtual void enable_buffering(bool /* enable */) {
   }
 
+  virtual void set_access_pattern(access_pattern_e /* pattern */) {
+  }
+
 protected:
   virtual uint32 _read(void *buffer, size_t size) = 0;
   virtual size_t _write(const void *buffer, size_t size) = 0;
+  virtual size_t _write_spans(std::vector<span_t> const &spans);
 };
 
 class mm_file_io_c: public mm_io_c {
@@ -157,6 +171,9 @@ public:
 protected:
   virtual uint32 _read(void *buffer, size_t size);
   virtual size_t _write(const void *buffer, size_t size);
+#if !defined(SYS_WINDOWS)
+  virtual size_t _write_spans(std::vector<span_t> const &spans);
+#endif
 };
 
 using mm_file_io_cptr = std::shared_ptr<mm_file_io_c>;
@@ -195,6 +212,9 @@ public:
   virtual mm_io_c *get_proxied() const {
     return m_proxy_io;
   }
+  virtual void set_access_pattern(access_pattern_e pattern) {
+    m_proxy_io->set_access_pattern(pattern);
+  }
 
 protected:
   virtual uint32 _read(void *buffer, size_t size);
@@ -0,0 +1,167 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class implementation for memory-mapped files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+#include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
+
+mm_mmap_io_c::mm_mmap_io_c(std::string const &path)
+  : m_file_name{path}
+  , m_size{}
+  , m_eof{}
+{
+#if defined(SYS_WINDOWS)
+  throw mtx::mm_io::open_x{};
+
+#else  // defined(SYS_WINDOWS)
+  auto local_path = g_cc_local_utf8->native(path);
+  auto fd         = ::open(local_path.c_str(), O_RDONLY);
+
+  if (-1 == fd)
+    throw mtx::mm_io::open_x{mtx::mm_io::make_error_code()};
+
+  struct stat st;
+  if ((0 != fstat(fd, &st)) || !S_ISREG(st.st_mode) || !st.st_size || (static_cast<uint64_t>(st.st_size) > std::numeric_limits<size_t>::max())) {
+    ::close(fd);
+    throw mtx::mm_io::open_x{};
+  }
+
+  m_size = st.st_size;
+
+  // A private, writable mapping so that users of the buffers returned by
+  // read(size_t) can modify them in place without touching the file.
+  auto address = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (MAP_FAILED == address)
+    throw mtx::mm_io::open_x{mtx::mm_io::make_error_code()};
+
+  auto size = m_size;
+  m_mapping = std::shared_ptr<unsigned char>{static_cast<unsigned char *>(address), [size](unsigned char *p) { munmap(p, size); }};
+#endif  // defined(SYS_WINDOWS)
+}
+
+mm_mmap_io_c::~mm_mmap_io_c() {
+  close();
+}
+
+mm_io_cptr
+mm_mmap_io_c::open(std::string const &path) {
+  return mm_io_cptr{new mm_mmap_io_c{path}};
+}
+
+uint64
+mm_mmap_io_c::getFilePointer() {
+  return m_current_position;
+}
+
+void
+mm_mmap_io_c::setFilePointer(int64 offset,
+                             seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? static_cast<int64_t>(m_size) + offset // offsets from the end are negative already
+    :                          m_current_position + offset;
+
+  // Seeking beyond the end is allowed just like with fseek().
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{};
+
+  m_current_position = new_pos;
+}
+
+int64_t
+mm_mmap_io_c::get_size() {
+  return m_size;
+}
+
+uint32
+mm_mmap_io_c::_read(void *buffer,
+                    size_t size) {
+  auto position = std::min<uint64_t>(m_current_position, m_size);
+  auto num_read = std::min<uint64_t>(size, m_size - position);
+
+  if (num_read)
+    memcpy(buffer, m_mapping.get() + position, num_read);
+
+  m_current_position += num_read;
+  if (num_read < size)
+    m_eof = true;
+
+  return num_read;
+}
+
+memory_cptr
+mm_mmap_io_c::read(size_t size) {
+  if (!m_mapping)
+    throw mtx::mm_io::end_of_file_x{};
+
+  auto position = std::min<uint64_t>(m_current_position, m_size);
+
+  if ((position + size) > m_size) {
+    m_current_position = std::max<uint64_t>(m_current_position, m_size);
+    m_eof              = true;
+    throw mtx::mm_io::end_of_file_x{};
+  }
+
+  m_current_position += size;
+
+  return memory_c::view(m_mapping.get() + position, size, m_mapping);
+}
+
+size_t
+mm_mmap_io_c::_write(const void *,
+                     size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+}
+
+void
+mm_mmap_io_c::close() {
+  // Buffers handed out by read(size_t) keep the mapping alive.
+  m_mapping.reset();
+  m_size             = 0;
+  m_current_position = 0;
+}
+
+bool
+mm_mmap_io_c::eof() {
+  return m_eof;
+}
+
+void
+mm_mmap_io_c::clear_eof() {
+  m_eof = false;
+}
+
+void
+mm_mmap_io_c::set_access_pattern(access_pattern_e pattern) {
+#if !defined(SYS_WINDOWS)
+  if (!m_mapping)
+    return;
+
+  auto advice = access_sequential == pattern ? POSIX_MADV_SEQUENTIAL
+              : access_random     == pattern ? POSIX_MADV_RANDOM
+              :                                POSIX_MADV_NORMAL;
+
+  posix_madvise(m_mapping.get(), m_size, advice);
+#endif  // !defined(SYS_WINDOWS)
+}
@@ -0,0 +1,64 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions for memory-mapped files
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_MMAP_IO_H
+#define MTX_COMMON_MM_MMAP_IO_H
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+
+/* Read-only access to a file mapped into memory as a whole.
+
+   read(size_t) does not copy the data: the memory_c objects returned
+   reference the mapped region directly and keep the mapping alive
+   even after the file has been closed. The mapping is private, so
+   modifying such a buffer does not alter the file.
+
+   Opening fails with mtx::mm_io::open_x if the file cannot be mapped
+   (e.g. on Windows, for empty files or for non-regular files). Callers
+   are expected to fall back to mm_file_io_c then. */
+class mm_mmap_io_c: public mm_io_c {
+protected:
+  std::string m_file_name;
+  std::shared_ptr<unsigned char> m_mapping;
+  uint64_t m_size;
+  bool m_eof;
+
+public:
+  mm_mmap_io_c(std::string const &path);
+  virtual ~mm_mmap_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual memory_cptr read(size_t size);
+  virtual int64_t get_size();
+  virtual void close();
+  virtual bool eof();
+  virtual void clear_eof();
+  virtual void set_access_pattern(access_pattern_e pattern);
+
+  virtual std::string get_file_name() const {
+    return m_file_name;
+  }
+
+  static mm_io_cptr open(std::string const &path);
+
+  using mm_io_c::read;
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+};
+
+#endif // MTX_COMMON_MM_MMAP_IO_H
@@ -0,0 +1,238 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io_x.h"
+#include "common/mm_readahead_io.h"
+
+mm_readahead_io_c::mm_readahead_io_c(mm_io_c *in,
+                                     size_t readahead_size,
+                                     bool delete_in)
+  : mm_proxy_io_c(in, delete_in)
+  , m_pos(in->getFilePointer())
+  , m_size(in->get_size())
+  , m_eof(false)
+  , m_max_blocks{std::max<size_t>((readahead_size + ms_block_size - 1) / ms_block_size, 1)}
+  , m_cursor{}
+  , m_debug{"readahead_io"}
+  , m_fetch_pos{m_pos}
+  , m_generation{}
+  , m_seek_requested{}
+  , m_fetch_eof{}
+  , m_reader_stop{}
+{
+  m_reader = std::thread{[this]() { run_reader(); }};
+}
+
+mm_readahead_io_c::~mm_readahead_io_c() {
+  close();
+}
+
+void
+mm_readahead_io_c::close() {
+  stop_reader();
+  mm_proxy_io_c::close();
+}
+
+uint64
+mm_readahead_io_c::getFilePointer() {
+  return m_pos;
+}
+
+int64_t
+mm_readahead_io_c::get_size() {
+  return m_size;
+}
+
+void
+mm_readahead_io_c::setFilePointer(int64 offset,
+                                  seek_mode mode) {
+  int64_t new_pos
+    = seek_beginning == mode ? offset
+    : seek_end       == mode ? m_size + offset // offsets from the end are negative already
+    :                          m_pos  + offset;
+
+  if (0 > new_pos)
+    throw mtx::mm_io::seek_x{mtx::mm_io::make_error_code()};
+
+  m_eof = false;
+
+  if (new_pos == m_pos)
+    return;
+
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  if (!m_seek_requested && (new_pos > m_pos) && (new_pos <= m_fetch_pos)) {
+    skip_buffered(new_pos - m_pos);
+    return;
+  }
+
+  mxdebug_if(m_debug, boost::format("seek from %1% to %2%; discarding %3% blocks\n") % m_pos % new_pos % m_blocks.size());
+
+  m_blocks.clear();
+  m_cursor           = 0;
+  m_pos              = new_pos;
+  m_fetch_pos        = new_pos;
+  m_seek_requested   = true;
+  m_fetch_eof        = false;
+  m_reader_exception = nullptr;
+  ++m_generation;
+
+  m_cond.notify_all();
+}
+
+// Must be called with the mutex locked.
+void
+mm_readahead_io_c::skip_buffered(int64_t num_bytes) {
+  m_pos += num_bytes;
+
+  while (num_bytes && !m_blocks.empty()) {
+    auto avail  = std::min<int64_t>(num_bytes, m_blocks.front().second - m_cursor);
+    num_bytes  -= avail;
+    m_cursor   += avail;
+
+    if (m_cursor == m_blocks.front().second) {
+      m_blocks.pop_front();
+      m_cursor = 0;
+    }
+  }
+
+  m_cond.notify_all();
+}
+
+uint32
+mm_readahead_io_c::_read(void *buffer,
+                         size_t size) {
+  auto dest     = static_cast<unsigned char *>(buffer);
+  auto num_read = size_t{};
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  while (num_read < size) {
+    if (m_blocks.empty()) {
+      if (m_reader_exception) {
+        auto exception     = m_reader_exception;
+        m_reader_exception = nullptr;
+        std::rethrow_exception(exception);
+      }
+
+      if (m_fetch_eof) {
+        m_eof = true;
+        break;
+      }
+
+      m_cond.wait(lock, [this]() { return !m_blocks.empty() || m_fetch_eof; });
+      continue;
+    }
+
+    auto &block  = m_blocks.front();
+    auto avail   = std::min(size - num_read, block.second - m_cursor);
+
+    memcpy(dest + num_read, block.first->get_buffer() + m_cursor, avail);
+
+    num_read    += avail;
+    m_cursor    += avail;
+    m_pos       += avail;
+
+    if (m_cursor == block.second) {
+      m_blocks.pop_front();
+      m_cursor = 0;
+      m_cond.notify_all();
+    }
+  }
+
+  return num_read;
+}
+
+size_t
+mm_readahead_io_c::_write(const void *,
+                          size_t) {
+  throw mtx::mm_io::wrong_read_write_access_x();
+  return 0;
+}
+
+void
+mm_readahead_io_c::stop_reader() {
+  if (!m_reader.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_reader_stop = true;
+  }
+
+  m_cond.notify_all();
+  m_reader.join();
+}
+
+/* The proxied file is accessed without holding the mutex so that the
+   caller can consume the blocks already read in the meantime. Blocks
+   read across a seek request are dropped as the generation counter has
+   changed in that case. */
+void
+mm_readahead_io_c::run_reader() {
+  std::unique_lock<std::mutex> lock{m_mutex};
+
+  while (true) {
+    m_cond.wait(lock, [this]() { return m_reader_stop || m_seek_requested || (!m_fetch_eof && (m_blocks.size() < m_max_blocks)); });
+
+    if (m_reader_stop)
+      return;
+
+    auto seek        = m_seek_requested;
+    auto generation  = m_generation;
+    auto fetch_pos   = m_fetch_pos;
+    auto to_read     = std::min<int64_t>(ms_block_size, m_size - fetch_pos);
+    m_seek_requested = false;
+
+    lock.unlock();
+
+    auto block     = memory_cptr{};
+    auto num_read  = size_t{};
+    auto exception = std::exception_ptr{};
+
+    try {
+      if (0 < to_read) {
+        if (seek)
+          m_proxy_io->setFilePointer(fetch_pos, seek_beginning);
+
+        block    = memory_c::alloc(to_read);
+        num_read = m_proxy_io->read(block->get_buffer(), to_read);
+      }
+
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    lock.lock();
+
+    if (generation != m_generation)
+      continue;
+
+    if (num_read) {
+      m_blocks.emplace_back(block, num_read);
+      m_fetch_pos += num_read;
+    }
+
+    if (exception)
+      m_reader_exception = exception;
+
+    if (exception || (0 >= to_read) || (num_read < static_cast<size_t>(to_read))) {
+      mxdebug_if(m_debug, boost::format("reading stopped at %1%%2%\n") % m_fetch_pos % (exception ? " due to an error" : ""));
+      m_fetch_eof = true;
+    }
+
+    m_cond.notify_all();
+  }
+}
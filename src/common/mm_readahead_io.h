@@ -0,0 +1,81 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   IO callback class definitions
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MM_READAHEAD_IO_H
+#define MTX_COMMON_MM_READAHEAD_IO_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "common/mm_io.h"
+
+/* A background thread reads the data following the current position
+   from the proxied file in blocks and keeps up to a fixed amount of it
+   ready. Reads are served from these blocks. Seeking forward within
+   them only drops the skipped data; any other seek discards them, and
+   the thread continues reading from the new position.
+
+   The proxied file is only ever accessed by the background thread,
+   which is why its size is determined once on construction. Proxying
+   an mm_multi_file_io_c lets the thread continue with the next file
+   on its own. */
+class mm_readahead_io_c: public mm_proxy_io_c {
+protected:
+  static size_t const ms_block_size = 1024 * 1024;
+
+  int64_t m_pos, m_size;
+  bool m_eof;
+  size_t m_max_blocks, m_cursor;
+  debugging_option_c m_debug;
+
+  std::thread m_reader;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<std::pair<memory_cptr, size_t>> m_blocks;
+  int64_t m_fetch_pos;
+  unsigned int m_generation;
+  bool m_seek_requested, m_fetch_eof, m_reader_stop;
+  std::exception_ptr m_reader_exception;
+
+public:
+  mm_readahead_io_c(mm_io_c *in, size_t readahead_size, bool delete_in = true);
+  virtual ~mm_readahead_io_c();
+
+  virtual uint64 getFilePointer();
+  virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
+  virtual int64_t get_size();
+  virtual void close();
+  virtual bool eof() {
+    return m_eof;
+  }
+  virtual void clear_eof() {
+    m_eof = false;
+  }
+
+protected:
+  virtual uint32 _read(void *buffer, size_t size);
+  virtual size_t _write(const void *buffer, size_t size);
+
+  void skip_buffered(int64_t num_bytes);
+  void stop_reader();
+  void run_reader();
+};
+
+using mm_readahead_io_cptr = std::shared_ptr<mm_readahead_io_c>;
+
+#endif // MTX_COMMON_MM_READAHEAD_IO_H
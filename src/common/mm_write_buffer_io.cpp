@@ -14,12 +14,15 @@
 
 #include "common/common_pch.h"
 
+#include <chrono>
+
 #include "common/mm_io_x.h"
 #include "common/mm_write_buffer_io.h"
 
 mm_write_buffer_io_c::mm_write_buffer_io_c(mm_io_c *out,
                                            size_t buffer_size,
-                                           bool delete_out)
+                                           bool delete_out,
+                                           size_t num_buffers)
   : mm_proxy_io_c(out, delete_out)
   , m_af_buffer(memory_c::alloc(buffer_size))
   , m_buffer(m_af_buffer->get_buffer())
@@ -27,7 +30,21 @@ mm_write_buffer_io_c::mm_write_buffer_io_c(mm_io_c *out,
   , m_size(buffer_size)
   , m_debug_seek{ "write_buffer_io|write_buffer_io_read"}
   , m_debug_write{"write_buffer_io|write_buffer_io_write"}
+  , m_num_buffers{std::max<size_t>(num_buffers, 1)}
+  , m_buffer_pos{}
+  , m_writer_busy{}
+  , m_writer_stop{}
+  , m_blocked_time{timecode_c::ns(0)}
 {
+  if (!is_asynchronous())
+    return;
+
+  m_buffer_pos = mm_proxy_io_c::getFilePointer();
+
+  for (auto idx = 1u; idx < m_num_buffers; ++idx)
+    m_free_buffers.push_back(memory_c::alloc(m_size));
+
+  m_writer = std::thread{[this]() { run_writer(); }};
 }
 
 mm_write_buffer_io_c::~mm_write_buffer_io_c() {
@@ -36,18 +53,24 @@ mm_write_buffer_io_c::~mm_write_buffer_io_c() {
 
 mm_io_cptr
 mm_write_buffer_io_c::open(const std::string &file_name,
-                           size_t buffer_size) {
-  return mm_io_cptr(new mm_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size));
+                           size_t buffer_size,
+                           size_t num_buffers) {
+  return mm_io_cptr(new mm_write_buffer_io_c(new mm_file_io_c(file_name, MODE_CREATE), buffer_size, true, num_buffers));
 }
 
 uint64
 mm_write_buffer_io_c::getFilePointer() {
-  return mm_proxy_io_c::getFilePointer() + m_fill;
+  return (is_asynchronous() ? m_buffer_pos : mm_proxy_io_c::getFilePointer()) + m_fill;
 }
 
 void
 mm_write_buffer_io_c::setFilePointer(int64 offset,
                                      seek_mode mode) {
+  // The proxied file's size is only accurate once all queued buffers
+  // have been written.
+  if (seek_end == mode)
+    wait_for_writer();
+
   int64_t new_pos
     = seek_beginning == mode ? offset
     : seek_end       == mode ? m_proxy_io->get_size() + offset // offsets from the end are negative already
@@ -64,6 +87,7 @@ mm_write_buffer_io_c::setFilePointer(int64 offset,
   }
 
   mm_proxy_io_c::setFilePointer(offset, mode);
+  m_buffer_pos = mm_proxy_io_c::getFilePointer();
 }
 
 void
@@ -75,14 +99,25 @@ mm_write_buffer_io_c::flush() {
 void
 mm_write_buffer_io_c::close() {
   flush_buffer();
+  stop_writer();
   mm_proxy_io_c::close();
 }
 
+int
+mm_write_buffer_io_c::truncate(int64_t pos) {
+  flush_buffer();
+  return m_proxy_io->truncate(pos);
+}
+
 uint32
 mm_write_buffer_io_c::_read(void *buffer,
                             size_t size) {
   flush_buffer();
-  return mm_proxy_io_c::_read(buffer, size);
+
+  auto num_read = mm_proxy_io_c::_read(buffer, size);
+  m_buffer_pos  = mm_proxy_io_c::getFilePointer();
+
+  return num_read;
 }
 
 size_t
@@ -92,6 +127,28 @@ mm_write_buffer_io_c::_write(const void *buffer,
   const char *buf = static_cast<const char *>(buffer);
   size_t remain   = size;
 
+  if (is_asynchronous()) {
+    // The writer thread owns the proxied file, therefore all data has
+    // to go through the buffers.
+    while (remain) {
+      avail = std::min(m_size - m_fill, remain);
+      memcpy(m_buffer + m_fill, buf, avail);
+      m_fill += avail;
+      remain -= avail;
+      buf    += avail;
+
+      if (m_fill == m_size)
+        queue_buffer();
+    }
+
+    return size;
+  }
+
+  if (size >= ms_min_direct_write_size) {
+    write_directly({ span_t{ m_buffer, m_fill }, span_t{ buffer, size } });
+    return size;
+  }
+
   // whole blocks
   while (remain >= (avail = m_size - m_fill)) {
     if (m_fill) {
@@ -122,8 +179,67 @@ mm_write_buffer_io_c::_write(const void *buffer,
   return size;
 }
 
+/** \brief Write spans, passing large ones on without copying them
+
+   Small spans such as element headers are collected in the buffer. A
+   run of large spans is written together with the buffer's current
+   content in a single call to the proxied file.
+*/
+size_t
+mm_write_buffer_io_c::_write_spans(std::vector<span_t> const &spans) {
+  if (is_asynchronous())
+    return mm_io_c::_write_spans(spans);
+
+  auto direct  = std::vector<span_t>{};
+  auto written = size_t{};
+
+  for (auto const &span : spans) {
+    written += span.second;
+
+    if (span.second >= ms_min_direct_write_size) {
+      if (direct.empty())
+        direct.emplace_back(m_buffer, m_fill);
+      direct.push_back(span);
+      continue;
+    }
+
+    if (!direct.empty()) {
+      write_directly(direct);
+      direct.clear();
+    }
+
+    _write(span.first, span.second);
+  }
+
+  if (!direct.empty())
+    write_directly(direct);
+
+  return written;
+}
+
+// The first span must be the buffer's content.
+void
+mm_write_buffer_io_c::write_directly(std::vector<span_t> const &spans) {
+  auto size = boost::accumulate(spans, size_t{}, [](size_t sum, span_t const &span) { return sum + span.second; });
+
+  m_fill       = 0;
+  auto written = m_proxy_io->write_spans(spans);
+
+  mxdebug_if(m_debug_write, boost::format("write_directly() at %1% for %2% in %3% spans written %4%\n") % (mm_proxy_io_c::getFilePointer() - written) % size % spans.size() % written);
+
+  if (written != size)
+    throw mtx::mm_io::insufficient_space_x();
+}
+
 void
 mm_write_buffer_io_c::flush_buffer() {
+  if (is_asynchronous()) {
+    if (m_fill)
+      queue_buffer();
+    wait_for_writer();
+    return;
+  }
+
   if (!m_fill)
     return;
 
@@ -140,4 +256,124 @@ mm_write_buffer_io_c::flush_buffer() {
 void
 mm_write_buffer_io_c::discard_buffer() {
   m_fill = 0;
+
+  if (!is_asynchronous())
+    return;
+
+  std::unique_lock<std::mutex> lock{m_writer_mutex};
+
+  for (auto const &queued : m_queued_buffers)
+    m_free_buffers.push_back(queued.first);
+  m_queued_buffers.clear();
+
+  m_writer_cond.wait(lock, [this]() { return !m_writer_busy; });
+  m_writer_exception = nullptr;
+}
+
+void
+mm_write_buffer_io_c::queue_buffer() {
+  std::unique_lock<std::mutex> lock{m_writer_mutex};
+
+  if (m_writer_exception) {
+    auto exception     = m_writer_exception;
+    m_writer_exception = nullptr;
+    std::rethrow_exception(exception);
+  }
+
+  m_queued_buffers.emplace_back(m_af_buffer, m_fill);
+  m_buffer_pos += m_fill;
+  m_fill        = 0;
+
+  m_writer_cond.notify_all();
+
+  if (m_free_buffers.empty()) {
+    auto start = std::chrono::steady_clock::now();
+    m_writer_cond.wait(lock, [this]() { return !m_free_buffers.empty(); });
+    m_blocked_time += timecode_c::ns(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  m_af_buffer = m_free_buffers.back();
+  m_buffer    = m_af_buffer->get_buffer();
+  m_free_buffers.pop_back();
+}
+
+void
+mm_write_buffer_io_c::wait_for_writer() {
+  if (!is_asynchronous())
+    return;
+
+  std::unique_lock<std::mutex> lock{m_writer_mutex};
+
+  if (!m_queued_buffers.empty() || m_writer_busy) {
+    auto start = std::chrono::steady_clock::now();
+    m_writer_cond.wait(lock, [this]() { return m_queued_buffers.empty() && !m_writer_busy; });
+    m_blocked_time += timecode_c::ns(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  if (m_writer_exception) {
+    auto exception     = m_writer_exception;
+    m_writer_exception = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+void
+mm_write_buffer_io_c::stop_writer() {
+  if (!m_writer.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock{m_writer_mutex};
+    m_writer_stop = true;
+  }
+
+  m_writer_cond.notify_all();
+  m_writer.join();
+}
+
+void
+mm_write_buffer_io_c::run_writer() {
+  std::unique_lock<std::mutex> lock{m_writer_mutex};
+
+  while (true) {
+    m_writer_cond.wait(lock, [this]() { return m_writer_stop || !m_queued_buffers.empty(); });
+
+    if (m_queued_buffers.empty())
+      return;
+
+    auto buffer   = m_queued_buffers.front();
+    m_writer_busy = true;
+    m_queued_buffers.pop_front();
+
+    lock.unlock();
+
+    auto exception = std::exception_ptr{};
+
+    try {
+      size_t written = mm_proxy_io_c::_write(buffer.first->get_buffer(), buffer.second);
+
+      mxdebug_if(m_debug_write, boost::format("flush_buffer() asynchronously at %1% for %2% written %3%\n") % (mm_proxy_io_c::getFilePointer() - written) % buffer.second % written);
+
+      if (written != buffer.second)
+        throw mtx::mm_io::insufficient_space_x();
+
+    } catch (...) {
+      exception = std::current_exception();
+    }
+
+    lock.lock();
+
+    m_writer_busy = false;
+    m_free_buffers.push_back(buffer.first);
+
+    // Once writing has failed nothing else must be written.
+    if (exception) {
+      m_writer_exception = exception;
+      for (auto const &queued : m_queued_buffers)
+        m_free_buffers.push_back(queued.first);
+      m_queued_buffers.clear();
+    }
+
+    m_writer_cond.notify_all();
+  }
 }
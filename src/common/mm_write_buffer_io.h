@@ -17,32 +17,79 @@
 
 #include "common/common_pch.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #include "common/mm_io.h"
+#include "common/timecode.h"
+
+/* With more than one buffer the writer works asynchronously: full
+   buffers are handed over to a background thread that writes them to
+   the proxied file while the caller continues filling the next
+   one. Everything that needs to know the proxied file's actual state
+   (seeking, reading, truncating, flushing) waits for all queued buffers
+   to be written first.
 
+   In synchronous mode large writes aren't copied into the buffer. The
+   buffer's content and the caller's data are handed over to the
+   proxied file together as spans instead. */
 class mm_write_buffer_io_c: public mm_proxy_io_c {
 protected:
+  static size_t const ms_min_direct_write_size = 64 * 1024;
+
   memory_cptr m_af_buffer;
   unsigned char *m_buffer;
   size_t m_fill;
   const size_t m_size;
   debugging_option_c m_debug_seek, m_debug_write;
 
+  // Asynchronous mode only
+  size_t m_num_buffers;
+  uint64_t m_buffer_pos;
+  std::thread m_writer;
+  std::mutex m_writer_mutex;
+  std::condition_variable m_writer_cond;
+  std::deque<std::pair<memory_cptr, size_t>> m_queued_buffers;
+  std::vector<memory_cptr> m_free_buffers;
+  bool m_writer_busy, m_writer_stop;
+  std::exception_ptr m_writer_exception;
+  timecode_c m_blocked_time;
+
 public:
-  mm_write_buffer_io_c(mm_io_c *out, size_t buffer_size, bool delete_out = true);
+  mm_write_buffer_io_c(mm_io_c *out, size_t buffer_size, bool delete_out = true, size_t num_buffers = 1);
   virtual ~mm_write_buffer_io_c();
 
   virtual uint64 getFilePointer();
   virtual void setFilePointer(int64 offset, seek_mode mode = seek_beginning);
   virtual void flush();
   virtual void close();
+  virtual int truncate(int64_t pos);
   virtual void discard_buffer();
 
-  static mm_io_cptr open(const std::string &file_name, size_t buffer_size);
+  bool is_asynchronous() const {
+    return 1 < m_num_buffers;
+  }
+  timecode_c get_blocked_time() const {
+    return m_blocked_time;
+  }
+
+  static mm_io_cptr open(const std::string &file_name, size_t buffer_size, size_t num_buffers = 1);
 
 protected:
   virtual uint32 _read(void *buffer, size_t size);
   virtual size_t _write(const void *buffer, size_t size);
+  virtual size_t _write_spans(std::vector<span_t> const &spans);
   virtual void flush_buffer();
+
+  void write_directly(std::vector<span_t> const &spans);
+
+  void queue_buffer();
+  void wait_for_writer();
+  void stop_writer();
+  void run_writer();
 };
 using mm_write_buffer_io_cptr = std::shared_ptr<mm_write_buffer_io_c>;
 
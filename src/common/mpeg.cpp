@@ -0,0 +1,179 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   helper functions shared by the MPEG-style elementary stream parsers
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define MTX_HAVE_X86_START_CODE_SCANNERS 1
+# include <immintrin.h>
+#endif
+
+#include "common/mpeg.h"
+
+namespace mtx { namespace mpeg {
+
+namespace {
+
+using scanner_function_t = size_t (*)(unsigned char const *buffer, size_t size);
+
+size_t
+find_next_start_code_scalar(unsigned char const *buffer,
+                            size_t size,
+                            size_t position) {
+  // Only every third byte has to be looked at as long as they're
+  // neither 0x00 nor 0x01: such a byte cannot be part of a start code.
+  auto idx = position + 2;
+
+  while (idx < size) {
+    if (1 < buffer[idx])
+      idx += 3;
+
+    else if (0 == buffer[idx])
+      ++idx;
+
+    else if (!buffer[idx - 1] && !buffer[idx - 2])
+      return idx - 2;
+
+    else
+      idx += 3;
+  }
+
+  return size;
+}
+
+size_t
+find_next_start_code_scalar(unsigned char const *buffer,
+                            size_t size) {
+  return find_next_start_code_scalar(buffer, size, 0);
+}
+
+#if defined(MTX_HAVE_X86_START_CODE_SCANNERS)
+
+// Each vector compares the bytes at offsets 0, 1 and 2 of all
+// candidate positions at once. A match requires all three loads to be
+// inside the buffer; the rest is handled by the scalar code.
+
+__attribute__((target("sse2")))
+size_t
+find_next_start_code_sse2(unsigned char const *buffer,
+                          size_t size) {
+  auto zero     = _mm_setzero_si128();
+  auto one      = _mm_set1_epi8(1);
+  auto position = size_t{};
+
+  for (; (position + 16 + 2) <= size; position += 16) {
+    auto bytes0  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer + position));
+    auto bytes1  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer + position + 1));
+    auto bytes2  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(buffer + position + 2));
+    auto matches = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(bytes0, zero), _mm_cmpeq_epi8(bytes1, zero)), _mm_cmpeq_epi8(bytes2, one));
+    auto mask    = static_cast<unsigned int>(_mm_movemask_epi8(matches));
+
+    if (mask)
+      return position + __builtin_ctz(mask);
+  }
+
+  return find_next_start_code_scalar(buffer, size, position);
+}
+
+__attribute__((target("avx2")))
+size_t
+find_next_start_code_avx2(unsigned char const *buffer,
+                          size_t size) {
+  auto zero     = _mm256_setzero_si256();
+  auto one      = _mm256_set1_epi8(1);
+  auto position = size_t{};
+
+  for (; (position + 32 + 2) <= size; position += 32) {
+    auto bytes0  = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(buffer + position));
+    auto bytes1  = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(buffer + position + 1));
+    auto bytes2  = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(buffer + position + 2));
+    auto matches = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(bytes0, zero), _mm256_cmpeq_epi8(bytes1, zero)), _mm256_cmpeq_epi8(bytes2, one));
+    auto mask    = static_cast<unsigned int>(_mm256_movemask_epi8(matches));
+
+    if (mask)
+      return position + __builtin_ctz(mask);
+  }
+
+  return find_next_start_code_scalar(buffer, size, position);
+}
+
+#endif  // defined(MTX_HAVE_X86_START_CODE_SCANNERS)
+
+scanner_function_t
+get_scanner_function(scanner_e scanner) {
+#if defined(MTX_HAVE_X86_START_CODE_SCANNERS)
+  if (scanner_e::avx2 == scanner)
+    return find_next_start_code_avx2;
+
+  if (scanner_e::sse2 == scanner)
+    return find_next_start_code_sse2;
+#endif
+
+  return find_next_start_code_scalar;
+}
+
+}
+
+/** \brief The fastest scanner the CPU the program runs on supports */
+scanner_e
+get_best_scanner() {
+#if defined(MTX_HAVE_X86_START_CODE_SCANNERS)
+  static auto s_best_scanner = []() -> scanner_e {
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2") ? scanner_e::avx2
+         : __builtin_cpu_supports("sse2") ? scanner_e::sse2
+         :                                  scanner_e::scalar;
+  }();
+
+  return s_best_scanner;
+
+#else
+  return scanner_e::scalar;
+#endif
+}
+
+std::string
+get_scanner_name(scanner_e scanner) {
+  return scanner_e::avx2 == scanner ? "AVX2"
+       : scanner_e::sse2 == scanner ? "SSE2"
+       :                              "scalar";
+}
+
+/** \brief Find the next three byte start code 0x00 0x00 0x01
+
+   \return The offset of the start code's first byte. All three bytes
+     are inside the buffer. \c size is returned if there's no start code.
+*/
+size_t
+find_next_start_code(unsigned char const *buffer,
+                     size_t size) {
+  static auto s_scanner_function = get_scanner_function(get_best_scanner());
+
+  return s_scanner_function(buffer, size);
+}
+
+/** \brief Find the next start code with a specific implementation
+
+   Meant for testing and benchmarking. The caller must make sure that
+   the CPU supports the scanner, e.g. by only using ones up to
+   get_best_scanner().
+*/
+size_t
+find_next_start_code(unsigned char const *buffer,
+                     size_t size,
+                     scanner_e scanner) {
+  return get_scanner_function(scanner)(buffer, size);
+}
+
+}}
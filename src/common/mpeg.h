@@ -0,0 +1,34 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   helper functions shared by the MPEG-style elementary stream parsers
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_MPEG_H
+#define MTX_COMMON_MPEG_H
+
+#include "common/common_pch.h"
+
+namespace mtx { namespace mpeg {
+
+enum class scanner_e {
+    scalar
+  , sse2
+  , avx2
+};
+
+size_t find_next_start_code(unsigned char const *buffer, size_t size);
+size_t find_next_start_code(unsigned char const *buffer, size_t size, scanner_e scanner);
+scanner_e get_best_scanner();
+std::string get_scanner_name(scanner_e scanner);
+
+}}
+
+#endif  // MTX_COMMON_MPEG_H
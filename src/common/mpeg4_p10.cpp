@@ -28,6 +28,7 @@
 #include "common/endian.h"
 #include "common/hacks.h"
 #include "common/mm_io.h"
+#include "common/mpeg.h"
 #include "common/mpeg4_p10.h"
 #include "common/strings/formatting.h"
 
@@ -1019,48 +1020,53 @@ mpeg4::p10::avc_es_parser_c::remove_trailing_zero_bytes(memory_c &memory) {
 void
 mpeg4::p10::avc_es_parser_c::add_bytes(unsigned char *buffer,
                                        size_t size) {
-  memory_slice_cursor_c cursor;
-  int marker_size              = 0;
-  int previous_marker_size     = 0;
-  int previous_pos             = -1;
   uint64_t previous_parsed_pos = m_parsed_position;
+  size_t unparsed_size         = m_unparsed_buffer ? m_unparsed_buffer->get_size() : 0;
+
+  if (unparsed_size)
+    m_unparsed_buffer->add(buffer, size);
+  else
+    m_unparsed_buffer = memory_c::clone(buffer, size);
+
+  auto data                 = m_unparsed_buffer->get_buffer();
+  auto data_size            = m_unparsed_buffer->get_size();
+  auto previous_pos         = int64_t{-1};
+  auto previous_marker_size = 0;
+
+  // The unparsed data starts with the last start code found, and it
+  // doesn't contain another one. Only the new bytes and the two bytes
+  // before them have to be searched.
+  auto scan_pos = unparsed_size > 2 ? unparsed_size - 2 : 0;
+
+  if ((3 <= data_size) && (NALU_START_CODE == get_uint24_be(data))) {
+    previous_pos         = 0;
+    previous_marker_size = 3;
+    scan_pos             = std::max<size_t>(scan_pos, 1);
+
+  } else if ((4 <= data_size) && (NALU_START_CODE == get_uint32_be(data))) {
+    previous_pos         = 0;
+    previous_marker_size = 4;
+    scan_pos             = std::max<size_t>(scan_pos, 2);
+  }
 
-  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
+  while (scan_pos < data_size) {
+    auto pos = scan_pos + mtx::mpeg::find_next_start_code(data + scan_pos, data_size - scan_pos);
+    if (pos >= data_size)
+      break;
 
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker =                               1 << 24
-                    | (unsigned int)cursor.get_char() << 16
-                    | (unsigned int)cursor.get_char() <<  8
-                    | (unsigned int)cursor.get_char();
+    int marker_size = (pos && !data[pos - 1]) ? 4 : 3;
+    auto marker_pos = pos + 3 - marker_size;
 
-    while (1) {
-      if (NALU_START_CODE == marker)
-        marker_size = 4;
-      else if (NALU_START_CODE == (marker & 0x00ffffff))
-        marker_size = 3;
-
-      if (0 != marker_size) {
-        if (-1 != previous_pos) {
-          int new_size = cursor.get_position() - marker_size - previous_pos - previous_marker_size;
-          memory_cptr nalu(new memory_c(safemalloc(new_size), new_size, true));
-          cursor.copy(nalu->get_buffer(), previous_pos + previous_marker_size, new_size);
-          m_parsed_position = previous_parsed_pos + previous_pos;
-          remove_trailing_zero_bytes(*nalu);
-          handle_nalu(nalu);
-        }
-        previous_pos         = cursor.get_position() - marker_size;
-        previous_marker_size = marker_size;
-        marker_size          = 0;
-      }
-
-      if (!cursor.char_available())
-        break;
-
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
+    if (-1 != previous_pos) {
+      auto nalu         = memory_c::clone(data + previous_pos + previous_marker_size, marker_pos - previous_pos - previous_marker_size);
+      m_parsed_position = previous_parsed_pos + previous_pos;
+      remove_trailing_zero_bytes(*nalu);
+      handle_nalu(nalu);
     }
+
+    previous_pos         = marker_pos;
+    previous_marker_size = marker_size;
+    scan_pos             = pos + 3;
   }
 
   if (-1 == previous_pos)
@@ -1069,13 +1075,14 @@ mpeg4::p10::avc_es_parser_c::add_bytes(unsigned char *buffer,
   m_stream_position += size;
   m_parsed_position  = previous_parsed_pos + previous_pos;
 
-  int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    m_unparsed_buffer = memory_cptr(new memory_c(safemalloc(new_size), new_size, true));
-    cursor.copy(m_unparsed_buffer->get_buffer(), previous_pos, new_size);
-
-  } else
+  size_t new_size = data_size - previous_pos;
+  if (!new_size)
     m_unparsed_buffer.reset();
+
+  else if (previous_pos) {
+    memmove(data, data + previous_pos, new_size);
+    m_unparsed_buffer->set_size(new_size);
+  }
 }
 
 void
@@ -13,6 +13,7 @@
 
 #include "common/common_pch.h"
 
+#include <mutex>
 #include <sstream>
 
 #include "common/ebml.h"
@@ -58,14 +59,30 @@ set_mxmsg_handler(unsigned int level,
     assert(false);
 }
 
+mxmsg_handler_t
+get_mxmsg_handler(unsigned int level) {
+  if (MXMSG_INFO == level)
+    return s_mxmsg_info_handler;
+  else if (MXMSG_WARNING == level)
+    return s_mxmsg_warning_handler;
+  else if (MXMSG_ERROR == level)
+    return s_mxmsg_error_handler;
+
+  assert(false);
+  return mxmsg_handler_t{};
+}
+
 void
 mxmsg(unsigned int level,
       std::string message) {
   static bool s_saw_cr_after_nl = false;
+  static std::mutex s_mutex;
 
   if (g_suppress_info && (MXMSG_INFO == level))
     return;
 
+  std::lock_guard<std::mutex> lock{s_mutex};
+
   if ('\n' == message[0]) {
     message.erase(0, 1);
     g_mm_stdio->puts("\n");
@@ -0,0 +1,252 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   timers and counters for the processing stages
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <mutex>
+
+#include "common/mm_io_x.h"
+#include "common/profiling.h"
+
+bool profiling_c::ms_enabled = false;
+std::string profiling_c::ms_json_file_name;
+std::chrono::steady_clock::time_point profiling_c::ms_start;
+
+namespace {
+
+// Only the thread owning a set of counters modifies them. The atomics
+// merely make reading them for the report well-defined.
+struct stage_counters_t {
+  std::atomic<int64_t> m_self_ns, m_total_ns;
+  std::atomic<uint64_t> m_num_calls, m_num_bytes, m_num_packets, m_num_allocations, m_allocated_bytes;
+
+  stage_counters_t()
+    : m_self_ns{}
+    , m_total_ns{}
+    , m_num_calls{}
+    , m_num_bytes{}
+    , m_num_packets{}
+    , m_num_allocations{}
+    , m_allocated_bytes{}
+  {
+  }
+};
+
+struct stage_totals_t {
+  int64_t m_self_ns, m_total_ns;
+  uint64_t m_num_calls, m_num_bytes, m_num_packets, m_num_allocations, m_allocated_bytes;
+};
+
+using thread_counters_t    = std::array<stage_counters_t, profiling_c::stage_max>;
+using thread_counters_cptr = std::shared_ptr<thread_counters_t>;
+
+std::mutex s_mutex;
+std::vector<thread_counters_cptr> s_all_counters;
+
+thread_local thread_counters_t *tl_counters      = nullptr;
+thread_local profiling_timer_c *tl_current_timer = nullptr;
+
+void
+add(std::atomic<int64_t> &counter,
+    int64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void
+add(std::atomic<uint64_t> &counter,
+    uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// The counters outlive their thread so that threads that have already
+// finished are included in the report.
+thread_counters_t &
+get_thread_counters() {
+  if (!tl_counters) {
+    auto counters = std::make_shared<thread_counters_t>();
+    tl_counters   = counters.get();
+
+    std::lock_guard<std::mutex> lock{s_mutex};
+    s_all_counters.push_back(counters);
+  }
+
+  return *tl_counters;
+}
+
+std::vector<stage_totals_t>
+sum_up_counters() {
+  auto totals = std::vector<stage_totals_t>(profiling_c::stage_max, stage_totals_t{});
+
+  std::lock_guard<std::mutex> lock{s_mutex};
+
+  for (auto const &counters : s_all_counters)
+    for (auto idx = 0u; idx < profiling_c::stage_max; ++idx) {
+      auto &stage             = (*counters)[idx];
+      auto &total             = totals[idx];
+
+      total.m_self_ns         += stage.m_self_ns.load(std::memory_order_relaxed);
+      total.m_total_ns        += stage.m_total_ns.load(std::memory_order_relaxed);
+      total.m_num_calls       += stage.m_num_calls.load(std::memory_order_relaxed);
+      total.m_num_bytes       += stage.m_num_bytes.load(std::memory_order_relaxed);
+      total.m_num_packets     += stage.m_num_packets.load(std::memory_order_relaxed);
+      total.m_num_allocations += stage.m_num_allocations.load(std::memory_order_relaxed);
+      total.m_allocated_bytes += stage.m_allocated_bytes.load(std::memory_order_relaxed);
+    }
+
+  return totals;
+}
+
+int64_t
+get_wall_clock_ns(std::chrono::steady_clock::time_point const &start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+/** \brief Enable collecting the timers and counters
+
+   \param json_file_name If given then the report is written to this
+     file in JSON format instead of being output as a table.
+*/
+void
+profiling_c::enable(std::string const &json_file_name) {
+  ms_enabled        = true;
+  ms_json_file_name = json_file_name;
+  ms_start          = std::chrono::steady_clock::now();
+}
+
+std::string
+profiling_c::get_stage_name(stage_e stage) {
+  return stage_reading     == stage ? "reading"
+       : stage_packetizing == stage ? "packetizing"
+       : stage_compression == stage ? "compression"
+       : stage_rendering   == stage ? "rendering"
+       : stage_cues        == stage ? "cues"
+       : stage_io_reading  == stage ? "io_reading"
+       : stage_io_writing  == stage ? "io_writing"
+       :                              "other";
+}
+
+/** \brief Account for a memory allocation
+
+   The allocation is attributed to the stage the calling thread is
+   currently in.
+*/
+void
+profiling_c::count_allocation(size_t size) {
+  if (!ms_enabled)
+    return;
+
+  auto &stage = get_thread_counters()[profiling_timer_c::get_current_stage()];
+
+  add(stage.m_num_allocations, 1);
+  add(stage.m_allocated_bytes, static_cast<uint64_t>(size));
+}
+
+void
+profiling_c::report() {
+  if (!ms_enabled)
+    return;
+
+  ms_enabled = false;
+
+  if (ms_json_file_name.empty())
+    report_as_text();
+  else
+    report_as_json();
+}
+
+void
+profiling_c::report_as_text() {
+  auto totals    = sum_up_counters();
+  auto wall_time = get_wall_clock_ns(ms_start);
+
+  mxinfo(boost::format("Profile (wall clock time: %|1$.3f|s; times are summed over all threads):\n") % (wall_time / 1000000000.0));
+  mxinfo(boost::format("%|1$-12s| %|2$10s| %|3$10s| %|4$10s| %|5$10s| %|6$14s| %|7$10s| %|8$12s|\n")
+         % "stage" % "self (s)" % "total (s)" % "calls" % "packets" % "bytes" % "MB/s" % "allocations");
+
+  for (auto idx = 0u; idx < stage_max; ++idx) {
+    auto &total = totals[idx];
+    auto mbps   = 0 < total.m_total_ns ? total.m_num_bytes * 1000000000.0 / total.m_total_ns / 1048576.0 : 0.0;
+
+    if (!total.m_num_calls && !total.m_num_allocations)
+      continue;
+
+    mxinfo(boost::format("%|1$-12s| %|2$10.3f| %|3$10.3f| %|4$10d| %|5$10d| %|6$14d| %|7$10.1f| %|8$12d|\n")
+           % get_stage_name(static_cast<stage_e>(idx)) % (total.m_self_ns / 1000000000.0) % (total.m_total_ns / 1000000000.0)
+           % total.m_num_calls % total.m_num_packets % total.m_num_bytes % mbps % total.m_num_allocations);
+  }
+}
+
+void
+profiling_c::report_as_json() {
+  auto totals = sum_up_counters();
+  auto json   = (boost::format("{\n  \"wall_clock_ns\": %1%,\n  \"stages\": [") % get_wall_clock_ns(ms_start)).str();
+
+  for (auto idx = 0u; idx < stage_max; ++idx) {
+    auto &total = totals[idx];
+
+    json += (boost::format("%1%\n    { \"name\": \"%2%\", \"self_ns\": %3%, \"total_ns\": %4%, \"calls\": %5%, \"packets\": %6%, \"bytes\": %7%, \"allocations\": %8%, \"allocated_bytes\": %9% }")
+             % (idx ? "," : "") % get_stage_name(static_cast<stage_e>(idx)) % total.m_self_ns % total.m_total_ns
+             % total.m_num_calls % total.m_num_packets % total.m_num_bytes % total.m_num_allocations % total.m_allocated_bytes).str();
+  }
+
+  json += "\n  ]\n}\n";
+
+  try {
+    mm_file_io_c out{ms_json_file_name, MODE_CREATE};
+    out.write(json);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxwarn(boost::format(Y("The profiling report could not be written to '%1%': %2%\n")) % ms_json_file_name % ex);
+  }
+}
+
+// ----------------------------------------------------------------------
+
+profiling_c::stage_e
+profiling_timer_c::get_current_stage() {
+  return tl_current_timer ? tl_current_timer->m_stage : profiling_c::stage_other;
+}
+
+/* Timers can be nested. The time spent in nested timers of other
+   stages is subtracted from the outer timer's self time. Nested timers
+   of the same stage, e.g. a proxy I/O class reading from the file it
+   proxies, are ignored so that nothing is counted twice. */
+void
+profiling_timer_c::start() {
+  if (tl_current_timer && (tl_current_timer->m_stage == m_stage))
+    return;
+
+  m_active         = true;
+  m_parent         = tl_current_timer;
+  tl_current_timer = this;
+  m_start          = std::chrono::steady_clock::now();
+}
+
+void
+profiling_timer_c::stop() {
+  auto duration    = get_wall_clock_ns(m_start);
+  auto &stage      = get_thread_counters()[m_stage];
+  tl_current_timer = m_parent;
+
+  if (m_parent)
+    m_parent->m_child_ns += duration;
+
+  add(stage.m_self_ns,     duration - m_child_ns);
+  add(stage.m_total_ns,    duration);
+  add(stage.m_num_calls,   1);
+  add(stage.m_num_bytes,   m_num_bytes);
+  add(stage.m_num_packets, m_num_packets);
+}
@@ -0,0 +1,99 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   timers and counters for the processing stages
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_PROFILING_H
+#define MTX_COMMON_PROFILING_H
+
+#include "common/common_pch.h"
+
+#include <chrono>
+
+/* The counters are kept per thread and only summed up for the report
+   that's output when the program exits. If profiling is disabled then
+   a timer costs a single test of a flag. */
+class profiling_c {
+public:
+  enum stage_e {
+    stage_reading = 0,
+    stage_packetizing,
+    stage_compression,
+    stage_rendering,
+    stage_cues,
+    stage_io_reading,
+    stage_io_writing,
+    stage_other,
+    stage_max,
+  };
+
+protected:
+  static bool ms_enabled;
+  static std::string ms_json_file_name;
+  static std::chrono::steady_clock::time_point ms_start;
+
+public:
+  static void enable(std::string const &json_file_name = "");
+  static bool enabled() {
+    return ms_enabled;
+  }
+
+  static void count_allocation(size_t size);
+  static void report();
+
+  static std::string get_stage_name(stage_e stage);
+
+protected:
+  static void report_as_text();
+  static void report_as_json();
+};
+
+class profiling_timer_c {
+protected:
+  profiling_c::stage_e m_stage;
+  bool m_active;
+  std::chrono::steady_clock::time_point m_start;
+  int64_t m_child_ns;
+  uint64_t m_num_bytes, m_num_packets;
+  profiling_timer_c *m_parent;
+
+public:
+  profiling_timer_c(profiling_c::stage_e stage,
+                    uint64_t num_bytes = 0,
+                    uint64_t num_packets = 0)
+    : m_stage{stage}
+    , m_active{}
+    , m_child_ns{}
+    , m_num_bytes{num_bytes}
+    , m_num_packets{num_packets}
+    , m_parent{}
+  {
+    if (profiling_c::enabled())
+      start();
+  }
+
+  ~profiling_timer_c() {
+    if (m_active)
+      stop();
+  }
+
+  void add_bytes(uint64_t num_bytes) {
+    m_num_bytes += num_bytes;
+  }
+
+  static profiling_c::stage_e get_current_stage();
+
+protected:
+  void start();
+  void stop();
+};
+
+#endif  // MTX_COMMON_PROFILING_H
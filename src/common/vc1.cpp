@@ -16,6 +16,7 @@
 
 #include "common/bit_cursor.h"
 #include "common/endian.h"
+#include "common/mpeg.h"
 #include "common/strings/formatting.h"
 #include "common/vc1.h"
 
@@ -299,52 +300,53 @@ vc1::es_parser_c::~es_parser_c() {
 void
 vc1::es_parser_c::add_bytes(unsigned char *buffer,
                             int size) {
-  memory_slice_cursor_c cursor;
-
-  int previous_pos            = -1;
   int64_t previous_stream_pos = m_stream_pos;
+  size_t unparsed_size        = m_unparsed_buffer ? m_unparsed_buffer->get_size() : 0;
 
-  if (m_unparsed_buffer && (0 != m_unparsed_buffer->get_size()))
-    cursor.add_slice(m_unparsed_buffer);
-  cursor.add_slice(buffer, size);
-
-  if (3 <= cursor.get_remaining_size()) {
-    uint32_t marker = (1 << 24) | ((unsigned int)cursor.get_char() << 16) | ((unsigned int)cursor.get_char() << 8) | (unsigned int)cursor.get_char();
+  if (unparsed_size)
+    m_unparsed_buffer->add(buffer, size);
+  else
+    m_unparsed_buffer = memory_c::clone(buffer, size);
 
-    while (1) {
-      if (vc1::is_marker(marker)) {
-        if (-1 != previous_pos) {
-          int new_size = cursor.get_position() - 4 - previous_pos;
+  auto data         = m_unparsed_buffer->get_buffer();
+  auto data_size    = m_unparsed_buffer->get_size();
+  auto previous_pos = int64_t{-1};
 
-          memory_cptr packet(new memory_c(safemalloc(new_size), new_size, true));
-          cursor.copy(packet->get_buffer(), previous_pos, new_size);
+  // The unparsed data starts with the last marker found, and it doesn't
+  // contain another complete one. Only the new bytes and the three
+  // bytes before them have to be searched.
+  auto scan_pos = unparsed_size > 3 ? unparsed_size - 3 : 0;
 
-          handle_packet(packet);
-        }
+  if ((4 <= data_size) && vc1::is_marker(get_uint32_be(data))) {
+    previous_pos = 0;
+    m_stream_pos = previous_stream_pos;
+    scan_pos     = std::max<size_t>(scan_pos, 1);
+  }
 
-        previous_pos = cursor.get_position() - 4;
-        m_stream_pos = previous_stream_pos + previous_pos;
-      }
+  while (scan_pos < data_size) {
+    auto pos = scan_pos + mtx::mpeg::find_next_start_code(data + scan_pos, data_size - scan_pos);
+    if ((pos + 3) >= data_size)
+      break;
 
-      if (!cursor.char_available())
-        break;
+    if (-1 != previous_pos)
+      handle_packet(memory_c::clone(data + previous_pos, pos - previous_pos));
 
-      marker <<= 8;
-      marker  |= (unsigned int)cursor.get_char();
-    }
+    previous_pos = pos;
+    m_stream_pos = previous_stream_pos + previous_pos;
+    scan_pos     = pos + 3;
   }
 
   if (-1 == previous_pos)
     previous_pos = 0;
 
-  int new_size = cursor.get_size() - previous_pos;
-  if (0 != new_size) {
-    memory_cptr new_unparsed_buffer = memory_c::alloc(new_size);
-    cursor.copy(new_unparsed_buffer->get_buffer(), previous_pos, new_size);
-    m_unparsed_buffer = new_unparsed_buffer;
-
-  } else
+  size_t new_size = data_size - previous_pos;
+  if (!new_size)
     m_unparsed_buffer.reset();
+
+  else if (previous_pos) {
+    memmove(data, data + previous_pos, new_size);
+    m_unparsed_buffer->set_size(new_size);
+  }
 }
 
 void
@@ -0,0 +1,62 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   a pool of worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/worker_pool.h"
+
+worker_pool_c::worker_pool_c(size_t num_threads)
+  : m_stop{}
+{
+  for (auto idx = 0u; idx < std::max<size_t>(num_threads, 1); ++idx)
+    m_threads.emplace_back([this]() { run(); });
+}
+
+worker_pool_c::~worker_pool_c() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+
+  m_job_available.notify_all();
+
+  for (auto &thread : m_threads)
+    thread.join();
+}
+
+size_t
+worker_pool_c::get_num_threads()
+  const {
+  return m_threads.size();
+}
+
+void
+worker_pool_c::run() {
+  while (true) {
+    std::function<void()> job;
+
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_job_available.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+
+      if (m_jobs.empty())
+        return;
+
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    // Exceptions are stored in the job's future by std::packaged_task.
+    job();
+  }
+}
@@ -0,0 +1,66 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for a pool of worker threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_COMMON_WORKER_POOL_H
+#define MTX_COMMON_WORKER_POOL_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+/* Runs jobs on a fixed number of threads in the order they've been
+   submitted. Results and exceptions are passed back via the future
+   returned by submit(). The destructor finishes all queued jobs before
+   joining the threads. */
+class worker_pool_c {
+protected:
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_job_available;
+  std::deque<std::function<void()>> m_jobs;
+  bool m_stop;
+
+public:
+  worker_pool_c(size_t num_threads);
+  virtual ~worker_pool_c();
+
+  template<typename Tfunc>
+  auto
+  submit(Tfunc func)
+    -> std::future<decltype(func())> {
+    auto task   = std::make_shared<std::packaged_task<decltype(func())()>>(std::move(func));
+    auto result = task->get_future();
+
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_jobs.emplace_back([task]() { (*task)(); });
+    }
+
+    m_job_available.notify_one();
+
+    return result;
+  }
+
+  size_t get_num_threads() const;
+
+protected:
+  void run();
+};
+using worker_pool_cptr = std::shared_ptr<worker_pool_c>;
+
+#endif  // MTX_COMMON_WORKER_POOL_H
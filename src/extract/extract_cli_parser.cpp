@@ -59,6 +59,7 @@ extract_cli_parser_c::init_parser() {
 
   add_section_header(YT("Global options"));
   OPT("f|parse-fully",    set_parse_fully,      YT("Parse the whole file instead of relying on the index."));
+  OPT("cluster-index-dir=directory", set_cluster_index_dir, YT("Store the cluster index files used for seeking in this directory instead of next to the source files."));
 
   add_common_options();
 
@@ -69,6 +70,10 @@ extract_cli_parser_c::init_parser() {
   OPT("blockadd=level", set_blockadd, YT("Keep only the BlockAdditions up to this level (default: keep all levels)"));
   OPT("raw",            set_raw,      YT("Extract the data to a raw file."));
   OPT("fullraw",        set_fullraw,  YT("Extract the data to a raw file including the CodecPrivate as a header."));
+  OPT("write-buffers=n",     set_write_buffers,     YT("Use n buffers for writing each output file. With more than one buffer they are written by a separate thread."));
+  OPT("write-buffer-size=n", set_write_buffer_size, YT("Use write buffers of n KB each (default: 5120)."));
+  OPT("frame-queue-size=n",  set_frame_queue_size,  YT("Process the frames of each output file on a separate thread queuing up to n KB of frames for it (default: 0 = process them on the reading thread)."));
+  OPT("start-at=timecode",   set_start_at,          YT("Start extracting at the last key frame before or at this timecode. Uses a cluster index that is created on first use."));
   add_informational_option("TID:out", YT("Write track with the ID TID to the file 'out'."));
 
   add_section_header(YT("Example"));
@@ -145,6 +150,45 @@ extract_cli_parser_c::set_parse_fully() {
   m_options.m_parse_mode = kax_analyzer_c::parse_mode_full;
 }
 
+void
+extract_cli_parser_c::set_cluster_index_dir() {
+  m_options.m_cluster_index_dir = m_next_arg;
+}
+
+void
+extract_cli_parser_c::set_write_buffers() {
+  assert_mode(options_c::em_tracks);
+  if (!parse_number(m_next_arg, m_options.m_num_write_buffers) || !m_options.m_num_write_buffers || (256 < m_options.m_num_write_buffers))
+    mxerror(boost::format(Y("Invalid number of write buffers in argument '%1%'.\n")) % m_next_arg);
+}
+
+void
+extract_cli_parser_c::set_write_buffer_size() {
+  assert_mode(options_c::em_tracks);
+  size_t size_in_kb = 0;
+  if (!parse_number(m_next_arg, size_in_kb) || (4 > size_in_kb) || ((1024 * 1024) < size_in_kb))
+    mxerror(boost::format(Y("Invalid write buffer size in argument '%1%'.\n")) % m_next_arg);
+
+  m_options.m_write_buffer_size = size_in_kb * 1024;
+}
+
+void
+extract_cli_parser_c::set_frame_queue_size() {
+  assert_mode(options_c::em_tracks);
+  size_t size_in_kb = 0;
+  if (!parse_number(m_next_arg, size_in_kb) || ((1024 * 1024) < size_in_kb))
+    mxerror(boost::format(Y("Invalid frame queue size in argument '%1%'.\n")) % m_next_arg);
+
+  m_options.m_frame_queue_size = size_in_kb * 1024;
+}
+
+void
+extract_cli_parser_c::set_start_at() {
+  assert_mode(options_c::em_tracks);
+  if (!parse_timecode(m_next_arg, m_options.m_start_at))
+    mxerror(boost::format(Y("Invalid time for '--start-at' in '--start-at %1%'. Additional error message: %2%.\n")) % m_next_arg % timecode_parser_error);
+}
+
 void
 extract_cli_parser_c::set_charset() {
   assert_mode(options_c::em_tracks);
@@ -275,5 +319,14 @@ extract_cli_parser_c::run() {
 
   parse_args();
 
+  // The write buffer and frame queue options are global and apply to
+  // all extraction specs no matter where they were given.
+  for (auto &track : m_options.m_tracks) {
+    track.num_write_buffers = m_options.m_num_write_buffers;
+    track.frame_queue_size  = m_options.m_frame_queue_size;
+    if (m_options.m_write_buffer_size)
+      track.write_buffer_size = m_options.m_write_buffer_size;
+  }
+
   return m_options;
 }
@@ -43,6 +43,11 @@ protected:
   void assert_mode(options_c::extraction_mode_e mode);
 
   void set_parse_fully();
+  void set_cluster_index_dir();
+  void set_write_buffers();
+  void set_write_buffer_size();
+  void set_frame_queue_size();
+  void set_start_at();
   void set_charset();
   void set_cuesheet();
   void set_blockadd();
@@ -0,0 +1,79 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   queues handing frames to extractor threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "extract/frame_queue.h"
+
+frame_queue_c::frame_queue_c(size_t max_queued_bytes)
+  : m_max_queued_bytes{max_queued_bytes}
+  , m_queued_bytes{}
+  , m_worker{1}
+{
+}
+
+void
+frame_queue_c::submit(std::function<void()> job,
+                      size_t num_bytes) {
+  collect_results(false);
+
+  {
+    // A single job larger than the limit is accepted once the queue is
+    // empty.
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_space_available.wait(lock, [this, num_bytes]() { return !m_queued_bytes || ((m_queued_bytes + num_bytes) <= m_max_queued_bytes); });
+    m_queued_bytes += num_bytes;
+  }
+
+  m_results.emplace_back(m_worker.submit([this, job, num_bytes]() {
+    try {
+      job();
+    } catch (...) {
+      release(num_bytes);
+      throw;
+    }
+
+    release(num_bytes);
+  }));
+}
+
+void
+frame_queue_c::release(size_t num_bytes) {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_queued_bytes -= num_bytes;
+  }
+
+  m_space_available.notify_all();
+}
+
+/** \brief Waits for all queued jobs to finish
+
+   Re-throws the first exception a job has thrown.
+*/
+void
+frame_queue_c::finish() {
+  collect_results(true);
+}
+
+void
+frame_queue_c::collect_results(bool wait) {
+  while (!m_results.empty()) {
+    auto &result = m_results.front();
+    if (!wait && (std::future_status::ready != result.wait_for(std::chrono::seconds(0))))
+      return;
+
+    auto finished_result = std::move(result);
+    m_results.pop_front();
+    finished_result.get();
+  }
+}
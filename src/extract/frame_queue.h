@@ -0,0 +1,50 @@
+/*
+   mkvextract -- extract tracks from Matroska files into other files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the queues handing frames to extractor threads
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_EXTRACT_FRAME_QUEUE_H
+#define MTX_EXTRACT_FRAME_QUEUE_H
+
+#include "common/common_pch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+
+#include "common/worker_pool.h"
+
+/* Runs the jobs for one output file on a thread of its own in the order
+   they've been submitted. submit() blocks while the data of the queued
+   jobs exceeds the limit. Exceptions thrown by a job are re-thrown by
+   the next call to submit() or finish(). */
+class frame_queue_c {
+protected:
+  std::mutex m_mutex;
+  std::condition_variable m_space_available;
+  std::deque<std::future<void>> m_results;
+  size_t m_max_queued_bytes, m_queued_bytes;
+  // Must be destroyed first as its destructor runs the remaining jobs.
+  worker_pool_c m_worker;
+
+public:
+  frame_queue_c(size_t max_queued_bytes);
+
+  void submit(std::function<void()> job, size_t num_bytes);
+  void finish();
+
+protected:
+  void release(size_t num_bytes);
+  void collect_results(bool wait);
+};
+using frame_queue_cptr = std::shared_ptr<frame_queue_c>;
+
+#endif  // MTX_EXTRACT_FRAME_QUEUE_H
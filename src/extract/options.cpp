@@ -18,6 +18,10 @@
 options_c::options_c()
   : m_simple_chapter_format(false)
   , m_parse_mode(kax_analyzer_c::parse_mode_fast)
+  , m_write_buffer_size(0)
+  , m_num_write_buffers(1)
+  , m_frame_queue_size(0)
+  , m_start_at(-1)
   , m_extraction_mode(options_c::em_unknown)
 {
 }
@@ -29,6 +29,9 @@ public:
   std::string m_file_name;
   bool m_simple_chapter_format;
   kax_analyzer_c::parse_mode_e m_parse_mode;
+  size_t m_write_buffer_size, m_num_write_buffers, m_frame_queue_size;
+  int64_t m_start_at;
+  std::string m_cluster_index_dir;
   extraction_mode_e m_extraction_mode;
 
   std::vector<track_spec_t> m_tracks;
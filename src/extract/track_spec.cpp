@@ -20,6 +20,9 @@ track_spec_t::track_spec_t()
   , extract_cuesheet(false)
   , target_mode(track_spec_t::tm_normal)
   , extract_blockadd_level(-1)
+  , write_buffer_size(5 * 1024 * 1024)
+  , num_write_buffers(1)
+  , frame_queue_size(0)
   , done(false)
 {
 }
@@ -30,6 +30,7 @@ struct track_spec_t {
 
   target_mode_e target_mode;
   int extract_blockadd_level;
+  size_t write_buffer_size, num_write_buffers, frame_queue_size;
 
   bool done;
 
@@ -33,15 +33,19 @@
 #include <matroska/KaxTrackVideo.h>
 
 #include "common/ebml.h"
+#include "common/kax_cluster_index.h"
 #include "common/kax_file.h"
 #include "common/mm_io_x.h"
 #include "common/mm_write_buffer_io.h"
+#include "common/strings/formatting.h"
+#include "extract/frame_queue.h"
 #include "extract/mkvextract.h"
 #include "extract/xtr_base.h"
 
 using namespace libmatroska;
 
 static std::vector<xtr_base_c *> extractors;
+static std::map<xtr_base_c *, frame_queue_cptr> frame_queues;
 
 // ------------------------------------------------------------------------
 
@@ -108,6 +112,15 @@ create_extractors(KaxTracks &kax_tracks,
     // Let the extractor create the file.
     extractor->create_file(master, track);
 
+    // Extractors writing to the same file share the master's queue as
+    // they share its state.
+    if (master) {
+      if (frame_queues.count(master))
+        frame_queues[extractor] = frame_queues[master];
+
+    } else if (tspec->frame_queue_size && extractor->supports_frame_queue())
+      frame_queues[extractor] = std::make_shared<frame_queue_c>(tspec->frame_queue_size);
+
     // We're done.
     extractors.push_back(extractor);
 
@@ -120,6 +133,44 @@ create_extractors(KaxTracks &kax_tracks,
     extractors[i]->headers_done();
 }
 
+static void
+decode_and_handle_frame(xtr_base_c &extractor,
+                        xtr_frame_t &f) {
+  auto queue = frame_queues.find(&extractor);
+  if (queue == frame_queues.end()) {
+    extractor.decode_and_handle_frame(f);
+    return;
+  }
+
+  // The frame's data and the block additions belong to the cluster
+  // which is gone by the time the queued job runs.
+  auto frame     = f.frame->clone();
+  auto additions = f.additions ? clone(*f.additions) : std::shared_ptr<KaxBlockAdditions>{};
+  auto size      = frame->get_size();
+
+  queue->second->submit([&extractor, frame, additions, f]() mutable {
+    auto queued_f = xtr_frame_t{frame, additions.get(), f.timecode, f.duration, f.bref, f.fref, f.keyframe, f.discardable, f.references_valid, f.discard_duration};
+    extractor.decode_and_handle_frame(queued_f);
+  }, size);
+}
+
+static void
+handle_codec_state(xtr_base_c &extractor,
+                   KaxCodecState &kcstate) {
+  auto queue = frame_queues.find(&extractor);
+  if (queue == frame_queues.end()) {
+    memory_cptr codec_state(new memory_c(kcstate.GetBuffer(), kcstate.GetSize(), false));
+    extractor.handle_codec_state(codec_state);
+    return;
+  }
+
+  auto codec_state = memory_c::clone(kcstate.GetBuffer(), kcstate.GetSize());
+
+  queue->second->submit([&extractor, codec_state]() mutable {
+    extractor.handle_codec_state(codec_state);
+  }, codec_state->get_size());
+}
+
 static int64_t
 handle_blockgroup(KaxBlockGroup &blockgroup,
                   KaxCluster &cluster,
@@ -166,10 +217,8 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
     duration = extractor->m_default_duration * block->NumberFrames();
 
   KaxCodecState *kcstate = FindChild<KaxCodecState>(&blockgroup);
-  if (kcstate) {
-    memory_cptr codec_state(new memory_c(kcstate->GetBuffer(), kcstate->GetSize(), false));
-    extractor->handle_codec_state(codec_state);
-  }
+  if (kcstate)
+    handle_codec_state(*extractor, *kcstate);
 
   for (i = 0; i < block->NumberFrames(); i++) {
     int64_t this_timecode, this_duration;
@@ -191,7 +240,7 @@ handle_blockgroup(KaxBlockGroup &blockgroup,
     auto &data = block->GetBuffer(i);
     auto frame = std::make_shared<memory_c>(data.Buffer(), data.Size(), false);
     auto f     = xtr_frame_t{frame, kadditions, this_timecode, this_duration, bref, fref, false, false, true, discard_padding};
-    extractor->decode_and_handle_frame(f);
+    decode_and_handle_frame(*extractor, f);
 
     max_timecode = std::max(max_timecode, this_timecode);
   }
@@ -236,7 +285,7 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
     auto &data = simpleblock.GetBuffer(i);
     auto frame = std::make_shared<memory_c>(data.Buffer(), data.Size(), false);
     auto f     = xtr_frame_t{frame, nullptr, this_timecode, this_duration, -1, -1, simpleblock.IsKeyframe(), simpleblock.IsDiscardable(), false, timecode_c::ns(0)};
-    extractor->decode_and_handle_frame(f);
+    decode_and_handle_frame(*extractor, f);
 
     max_timecode = std::max(max_timecode, this_timecode);
   }
@@ -247,6 +296,12 @@ handle_simpleblock(KaxSimpleBlock &simpleblock,
 static void
 close_extractors() {
   size_t i;
+  auto blocked_time = timecode_c::ns(0);
+  auto asynchronous = false;
+
+  for (auto &queue : frame_queues)
+    queue.second->finish();
+  frame_queues.clear();
 
   for (i = 0; i < extractors.size(); i++)
     extractors[i]->finish_track();
@@ -256,12 +311,24 @@ close_extractors() {
       extractors[i]->finish_file();
 
   for (i = 0; i < extractors.size(); i++) {
-    if (!extractors[i]->m_master)
+    if (!extractors[i]->m_master) {
       extractors[i]->finish_file();
+
+      auto wb_out = dynamic_cast<mm_write_buffer_io_c *>(extractors[i]->m_out.get());
+      if (wb_out && wb_out->is_asynchronous()) {
+        wb_out->flush();
+        blocked_time += wb_out->get_blocked_time();
+        asynchronous  = true;
+      }
+    }
+
     delete extractors[i];
   }
 
   extractors.clear();
+
+  if (asynchronous)
+    mxinfo(boost::format(Y("Time spent waiting for the output files to be written: %1%.\n")) % format_timecode(blocked_time, 3));
 }
 
 static void
@@ -341,10 +408,38 @@ handle_segment_info(EbmlMaster *info,
   file->set_timecode_scale(tc_scale);
 }
 
+static boost::optional<uint64_t>
+find_start_position(std::string const &file_name,
+                    mm_io_c &in,
+                    int64_t start_at,
+                    std::string const &cluster_index_dir) {
+  auto index = kax_cluster_index_c::load_or_build(file_name, in, cluster_index_dir);
+  if (!index) {
+    mxwarn(boost::format(Y("The cluster index for '%1%' could not be created. Extraction will start at the beginning of the file.\n")) % file_name);
+    return boost::optional<uint64_t>{};
+  }
+
+  // Seek to a key frame of the video tracks being extracted. Without
+  // video use the audio tracks and only then all other tracks.
+  std::vector<uint64_t> track_numbers;
+  for (auto const &prefix : std::vector<std::string>{ "V_", "A_", "" }) {
+    for (auto extractor : extractors)
+      if (balg::starts_with(extractor->m_codec_id, prefix))
+        track_numbers.push_back(extractor->m_track_num);
+
+    if (!track_numbers.empty())
+      break;
+  }
+
+  return index->find_cluster_position(start_at, track_numbers);
+}
+
 bool
 extract_tracks(const std::string &file_name,
                std::vector<track_spec_t> &tspecs,
-               kax_analyzer_c::parse_mode_e parse_mode) {
+               kax_analyzer_c::parse_mode_e parse_mode,
+               int64_t start_at,
+               std::string const &cluster_index_dir) {
   if (tspecs.empty())
     mxerror(Y("Nothing to do.\n"));
 
@@ -433,6 +528,17 @@ extract_tracks(const std::string &file_name,
         create_extractors(*dynamic_cast<KaxTracks *>(l1), tspecs);
 
       } else if (Is<KaxCluster>(l1)) {
+        if (-1 != start_at) {
+          auto position = find_start_position(file_name, *in, start_at, cluster_index_dir);
+          start_at      = -1;
+
+          if (position && (*position > l1->GetElementPosition())) {
+            delete l1;
+            in->setFilePointer(*position);
+            continue;
+          }
+        }
+
         show_element(l1, 1, Y("Cluster"));
         KaxCluster *cluster = static_cast<KaxCluster *>(l1);
 
@@ -52,6 +52,8 @@ xtr_base_c::xtr_base_c(const std::string &codec_id,
   , m_track_num(-1)
   , m_default_duration(0)
   , m_bytes_written(0)
+  , m_write_buffer_size(tspec.write_buffer_size)
+  , m_num_write_buffers(tspec.num_write_buffers)
   , m_content_decoder_initialized(false)
   , m_debug{}
 {
@@ -72,7 +74,7 @@ xtr_base_c::create_file(xtr_base_c *master,
 
   try {
     init_content_decoder(track);
-    m_out = mm_write_buffer_io_c::open(actual_file_name, 5 * 1024 * 1024);
+    m_out = mm_write_buffer_io_c::open(actual_file_name, m_write_buffer_size, m_num_write_buffers);
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("Failed to create the file '%1%': %2% (%3%)\n")) % actual_file_name % errno % ex);
   }
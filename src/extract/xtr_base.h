@@ -41,6 +41,7 @@ public:
   int64_t m_default_duration;
 
   int64_t m_bytes_written;
+  size_t m_write_buffer_size, m_num_write_buffers;
 
   content_decoder_c m_content_decoder;
   bool m_content_decoder_initialized;
@@ -62,6 +63,13 @@ public:
 
   virtual void headers_done();
 
+  // Whether or not the frames may be handled on a separate thread. Not
+  // the case if state shared with extractors writing to other files is
+  // used.
+  virtual bool supports_frame_queue() const {
+    return true;
+  }
+
   virtual bfs::path get_file_name() const {
     return m_file_name;
   }
@@ -30,6 +30,11 @@ public:
   virtual void create_file(xtr_base_c *master, KaxTrackEntry &track);
   virtual void handle_frame(xtr_frame_t &f);
 
+  // The charset converters are shared between all tracks.
+  virtual bool supports_frame_queue() const {
+    return false;
+  }
+
   virtual const char *get_container_name() {
     return "SRT text subtitles";
   };
@@ -67,6 +72,10 @@ public:
   virtual void handle_frame(xtr_frame_t &f);
   virtual void finish_file();
 
+  virtual bool supports_frame_queue() const {
+    return false;
+  }
+
   virtual const char *get_container_name() {
     return "SSA/ASS text subtitles";
   };
@@ -38,7 +38,7 @@ void
 xtr_tta_c::create_file(xtr_base_c *,
                        KaxTrackEntry &track) {
   try {
-    m_out = mm_write_buffer_io_c::open(m_temp_file_name, 5 * 1024 * 1024);
+    m_out = mm_write_buffer_io_c::open(m_temp_file_name, m_write_buffer_size, m_num_write_buffers);
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("Failed to create the temporary file '%1%': %2%\n")) % m_temp_file_name % ex);
   }
@@ -69,7 +69,7 @@ xtr_tta_c::finish_file() {
   }
 
   try {
-    m_out = mm_write_buffer_io_c::open(m_file_name, 5 * 1024 * 1024);
+    m_out = mm_write_buffer_io_c::open(m_file_name, m_write_buffer_size, m_num_write_buffers);
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("The file '%1%' could not be opened for writing: %2%.\n")) % m_file_name % ex);
   }
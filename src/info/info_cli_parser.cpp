@@ -41,6 +41,7 @@ info_cli_parser_c::init_parser() {
   OPT("C|check-mode",   set_check_mode,   YT("Calculate and display checksums and use verbosity level 4."));
   OPT("s|summary",      set_summary,      YT("Only show summaries of the contents, not each element."));
   OPT("t|track-info",   set_track_info,   YT("Show statistics for each track in verbose mode."));
+  OPT("f|fast-summary", set_fast_summary, YT("Show the headers and estimated statistics for each track without reading all clusters."));
   OPT("x|hexdump",      set_hexdump,      YT("Show the first 16 bytes of each frame as a hex dump."));
   OPT("X|full-hexdump", set_full_hexdump, YT("Show all bytes of each frame as a hex dump."));
   OPT("z|size",         set_size,         YT("Show the size of each element including its header."));
@@ -101,6 +102,11 @@ info_cli_parser_c::set_track_info() {
     verbose = 1;
 }
 
+void
+info_cli_parser_c::set_fast_summary() {
+  m_options.m_fast_summary = true;
+}
+
 void
 info_cli_parser_c::set_file_name() {
   if (!m_options.m_file_name.empty())
@@ -15,6 +15,7 @@
 #include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <set>
 #include <typeinfo>
 
 #include <ebml/EbmlHead.h>
@@ -68,6 +69,7 @@
 #include "common/strings/formatting.h"
 #include "common/translation.h"
 #include "common/version.h"
+#include "common/vint.h"
 #include "common/xml/ebml_chapters_converter.h"
 #include "common/xml/ebml_tags_converter.h"
 #include "info/mkvinfo.h"
@@ -130,6 +132,17 @@ static uint64_t s_tc_scale = TIMECODE_SCALE;
 std::vector<boost::format> g_common_boost_formats;
 size_t s_mkvmerge_track_id = 0;
 
+// Fast summary mode only
+static size_t const s_max_sampled_clusters = 20;
+static int64_t s_segment_data_start        = 0;
+static int64_t s_segment_duration          = -1;
+static int64_t s_sampled_duration          = 0;
+static size_t s_num_sampled_clusters       = 0;
+std::vector<std::pair<uint32_t, int64_t>> s_seek_head_entries;
+std::set<int64_t> s_handled_positions;
+std::map<int64_t, int64_t> s_cue_cluster_timecodes;
+std::map<unsigned int, track_info_t> s_sampled_track_info;
+
 #define BF_DO(n)                             g_common_boost_formats[n]
 #define BF_ADD(s)                            g_common_boost_formats.push_back(boost::format(s))
 #define BF_SHOW_UNKNOWN_ELEMENT              BF_DO( 0)
@@ -478,6 +491,7 @@ handle_info(EbmlStream *&es,
 
     } else if (Is<KaxDuration>(l2)) {
       KaxDuration &duration = *static_cast<KaxDuration *>(l2);
+      s_segment_duration    = duration.GetValue() * s_tc_scale;
       show_element(l2, 2,
                    boost::format(Y("Duration: %|1$.3f|s (%2%)"))
                    % (duration.GetValue() * s_tc_scale / 1000000000.0)
@@ -949,18 +963,35 @@ void
 handle_seek_head(EbmlStream *&es,
                  int &upper_lvl_el,
                  EbmlElement *&l1) {
-  if ((g_options.m_verbose < 2) && !g_options.m_use_gui) {
+  auto show_entries = (g_options.m_verbose >= 2) || g_options.m_use_gui;
+
+  if (!show_entries) {
     show_element(l1, 1, Y("Seek head (subentries will be skipped)"));
-    return;
-  }
+    if (!g_options.m_fast_summary)
+      return;
 
-  show_element(l1, 1, Y("Seek head"));
+  } else
+    show_element(l1, 1, Y("Seek head"));
 
   upper_lvl_el               = 0;
   EbmlElement *element_found = nullptr;
   auto m1                    = static_cast<EbmlMaster *>(l1);
   read_master(m1, es, EBML_CONTEXT(l1), upper_lvl_el, element_found);
 
+  // Remember where the other level 1 elements are so that the fast
+  // summary mode can jump over the clusters.
+  if (g_options.m_fast_summary)
+    for (auto l2 : *m1) {
+      auto seek_id       = Is<KaxSeek>(l2) ? FindChild<KaxSeekID>(l2)       : nullptr;
+      auto seek_position = Is<KaxSeek>(l2) ? FindChild<KaxSeekPosition>(l2) : nullptr;
+
+      if (seek_id && seek_position)
+        s_seek_head_entries.emplace_back(EBML_ID_VALUE(EbmlId(seek_id->GetBuffer(), seek_id->GetSize())), s_segment_data_start + seek_position->GetValue());
+    }
+
+  if (!show_entries)
+    return;
+
   for (auto l2 : *m1)
     if (Is<KaxSeek>(l2)) {
       show_element(l2, 2, Y("Seek entry"));
@@ -997,18 +1028,47 @@ void
 handle_cues(EbmlStream *&es,
             int &upper_lvl_el,
             EbmlElement *&l1) {
-  if (g_options.m_verbose < 2) {
+  auto show_entries = g_options.m_verbose >= 2;
+
+  if (!show_entries) {
     show_element(l1, 1, Y("Cues (subentries will be skipped)"));
-    return;
-  }
+    if (!g_options.m_fast_summary)
+      return;
 
-  show_element(l1, 1, "Cues");
+  } else
+    show_element(l1, 1, "Cues");
 
   upper_lvl_el               = 0;
   EbmlElement *element_found = nullptr;
   auto m1                    = static_cast<EbmlMaster *>(l1);
   read_master(m1, es, EBML_CONTEXT(l1), upper_lvl_el, element_found);
 
+  // The clusters referenced by the cues are the ones sampled by the
+  // fast summary mode.
+  if (g_options.m_fast_summary)
+    for (auto l2 : *m1) {
+      if (!Is<KaxCuePoint>(l2))
+        continue;
+
+      auto cue_point = static_cast<KaxCuePoint *>(l2);
+      auto timecode  = static_cast<int64_t>(FindChildValue<KaxCueTime>(cue_point) * s_tc_scale);
+
+      for (auto l3 : *cue_point) {
+        auto cluster_position = Is<KaxCueTrackPositions>(l3) ? FindChild<KaxCueClusterPosition>(l3) : nullptr;
+        if (!cluster_position)
+          continue;
+
+        auto position = s_segment_data_start + static_cast<int64_t>(cluster_position->GetValue());
+        auto itr      = s_cue_cluster_timecodes.find(position);
+
+        if ((s_cue_cluster_timecodes.end() == itr) || (itr->second > timecode))
+          s_cue_cluster_timecodes[position] = timecode;
+      }
+    }
+
+  if (!show_entries)
+    return;
+
   for (auto l2 : *m1)
     if (Is<KaxCuePoint>(l2)) {
       show_element(l2, 2, Y("Cue point"));
@@ -1560,6 +1620,185 @@ handle_ebml_head(EbmlElement *l0,
   }
 }
 
+void
+handle_level1_element(EbmlStream *&es,
+                      int &upper_lvl_el,
+                      EbmlElement *&l1) {
+  if (Is<KaxInfo>(l1))
+    handle_info(es, upper_lvl_el, l1);
+
+  else if (Is<KaxTracks>(l1))
+    handle_tracks(es, upper_lvl_el, l1);
+
+  else if (Is<KaxSeekHead>(l1))
+    handle_seek_head(es, upper_lvl_el, l1);
+
+  else if (Is<KaxCues>(l1))
+    handle_cues(es, upper_lvl_el, l1);
+
+  // Weee! Attachments!
+  else if (Is<KaxAttachments>(l1))
+    handle_attachments(es, upper_lvl_el, l1);
+
+  else if (Is<KaxChapters>(l1))
+    handle_chapters(es, upper_lvl_el, l1);
+
+  // Let's handle some TAGS.
+  else if (Is<KaxTags>(l1))
+    handle_tags(es, upper_lvl_el, l1);
+
+  else if (!is_global(es, l1, 1))
+    show_unknown_element(l1, 1);
+}
+
+/* Jumps to the level 1 elements behind the clusters that the seek
+   heads point to, e.g. the cues, chapters and tags, instead of reading
+   all clusters in between. Seek heads found that way are processed as
+   well. */
+void
+handle_elements_after_clusters(EbmlStream *&es,
+                               int &upper_lvl_el,
+                               mm_io_cptr &in,
+                               kax_file_c &kax_file) {
+  while (true) {
+    auto position = int64_t{-1};
+
+    for (auto const &entry : s_seek_head_entries)
+      if (   (EBML_ID_VALUE(EBML_ID(KaxCluster)) != entry.first)
+          && !s_handled_positions.count(entry.second)
+          && ((-1 == position) || (entry.second < position)))
+        position = entry.second;
+
+    if (-1 == position)
+      return;
+
+    s_handled_positions.insert(position);
+
+    if (!in->setFilePointer2(position))
+      continue;
+
+    auto l1 = kax_file.read_next_level1_element();
+    if (!l1)
+      continue;
+
+    std::shared_ptr<EbmlElement> af_l1(l1);
+
+    if (static_cast<int64_t>(l1->GetElementPosition()) == position)
+      handle_level1_element(es, upper_lvl_el, l1);
+  }
+}
+
+/* Reads only the timecode of the cluster at the given position. It is
+   usually the cluster's first child. */
+int64_t
+read_cluster_timecode(mm_io_cptr &in,
+                      int64_t position) {
+  try {
+    in->setFilePointer(position);
+    if (vint_c::read_ebml_id(in).m_value != EBML_ID_VALUE(EBML_ID(KaxCluster)))
+      return -1;
+
+    vint_c::read(in);
+
+    for (auto idx = 0; idx < 3; ++idx) {
+      auto id   = vint_c::read_ebml_id(in);
+      auto size = vint_c::read(in);
+
+      if (!id.is_valid() || !size.is_valid() || size.is_unknown())
+        return -1;
+
+      if (id.m_value != EBML_ID_VALUE(EBML_ID(KaxClusterTimecode))) {
+        in->skip(size.m_value);
+        continue;
+      }
+
+      if (8 < size.m_value)
+        return -1;
+
+      auto timecode = uint64_t{};
+      for (auto byte_idx = 0; byte_idx < size.m_value; ++byte_idx)
+        timecode = (timecode << 8) | in->read_uint8();
+
+      return timecode * s_tc_scale;
+    }
+
+  } catch (mtx::mm_io::exception &) {
+  }
+
+  return -1;
+}
+
+/* Reads a limited number of clusters spread evenly over the file and
+   accumulates the number of frames and their sizes for each track. The
+   clusters referenced by the cues are used if there are any. Otherwise
+   the clusters at the start of the file are read. */
+void
+sample_clusters(mm_io_cptr &in,
+                kax_file_c &kax_file,
+                int64_t first_cluster_position) {
+  auto cue_positions = std::vector<int64_t>{};
+  auto positions     = std::vector<int64_t>{};
+
+  for (auto const &cluster : s_cue_cluster_timecodes)
+    cue_positions.push_back(cluster.first);
+
+  auto num_samples = std::min(cue_positions.size(), s_max_sampled_clusters);
+  for (auto idx = 0u; idx < num_samples; ++idx)
+    positions.push_back(cue_positions[idx * cue_positions.size() / num_samples]);
+
+  if (positions.empty())
+    positions.push_back(first_cluster_position);
+
+  for (auto idx = 0u; idx < positions.size(); ++idx) {
+    if (g_options.m_use_gui)
+      ui_show_progress(100 * idx / positions.size(), Y("Sampling clusters"));
+
+    if (!in->setFilePointer2(positions[idx]))
+      continue;
+
+    auto l1 = kax_file.read_next_level1_element();
+    if (!l1)
+      continue;
+
+    std::shared_ptr<EbmlElement> af_l1(l1);
+
+    if (!Is<KaxCluster>(l1) || (static_cast<int64_t>(l1->GetElementPosition()) != positions[idx]))
+      continue;
+
+    auto cluster       = static_cast<KaxCluster *>(l1);
+    auto timecode      = static_cast<int64_t>(FindChildValue<KaxClusterTimecode>(cluster) * s_tc_scale);
+    auto next_position = static_cast<int64_t>(l1->GetElementPosition() + kax_file.get_element_size(l1));
+    auto next_timecode = read_cluster_timecode(in, next_position);
+
+    if (s_cue_cluster_timecodes.empty() && (-1 != next_timecode) && (positions.size() < s_max_sampled_clusters))
+      positions.push_back(next_position);
+
+    // The last cluster lasts until the end of the segment.
+    if (-1 == next_timecode)
+      next_timecode = s_segment_duration;
+
+    if (next_timecode <= timecode)
+      continue;
+
+    s_sampled_duration += next_timecode - timecode;
+    ++s_num_sampled_clusters;
+
+    for (auto l2 : *cluster) {
+      auto block = Is<KaxSimpleBlock>(l2) ? static_cast<KaxInternalBlock *>(static_cast<KaxSimpleBlock *>(l2))
+                 : Is<KaxBlockGroup>(l2)  ? static_cast<KaxInternalBlock *>(FindChild<KaxBlock>(l2))
+                 :                          nullptr;
+      if (!block)
+        continue;
+
+      auto &tinfo     = s_sampled_track_info[block->TrackNum()];
+      tinfo.m_blocks += block->NumberFrames();
+
+      for (auto frame_idx = 0u; frame_idx < block->NumberFrames(); ++frame_idx)
+        tinfo.m_size += block->GetBuffer(frame_idx).Size();
+    }
+  }
+}
+
 void
 handle_segment(EbmlElement *l0,
                mm_io_cptr &in,
@@ -1571,6 +1810,8 @@ handle_segment(EbmlElement *l0,
 
   kax_file->set_segment_end(*l0);
 
+  s_segment_data_start = l0->GetElementPosition() + l0->HeadSize();
+
   if (!l0->IsFiniteSize())
     show_element(l0, 0, Y("Segment, size unknown"));
   else
@@ -1582,37 +1823,23 @@ handle_segment(EbmlElement *l0,
   while ((l1 = kax_file->read_next_level1_element())) {
     std::shared_ptr<EbmlElement> af_l1(l1);
 
-    if (Is<KaxInfo>(l1))
-      handle_info(es, upper_lvl_el, l1);
+    s_handled_positions.insert(l1->GetElementPosition());
 
-    else if (Is<KaxTracks>(l1))
-      handle_tracks(es, upper_lvl_el, l1);
+    if (Is<KaxCluster>(l1)) {
+      show_element(l1, 1, Y("Cluster"));
 
-    else if (Is<KaxSeekHead>(l1))
-      handle_seek_head(es, upper_lvl_el, l1);
+      if (g_options.m_fast_summary) {
+        handle_elements_after_clusters(es, upper_lvl_el, in, *kax_file);
+        sample_clusters(in, *kax_file, l1->GetElementPosition());
+        return;
+      }
 
-    else if (Is<KaxCluster>(l1)) {
-      show_element(l1, 1, Y("Cluster"));
       if ((g_options.m_verbose == 0) && !g_options.m_show_summary)
         return;
       handle_cluster(es, upper_lvl_el, l1, file_size);
 
-    } else if (Is<KaxCues>(l1))
-      handle_cues(es, upper_lvl_el, l1);
-
-    // Weee! Attachments!
-    else if (Is<KaxAttachments>(l1))
-      handle_attachments(es, upper_lvl_el, l1);
-
-    else if (Is<KaxChapters>(l1))
-      handle_chapters(es, upper_lvl_el, l1);
-
-    // Let's handle some TAGS.
-    else if (Is<KaxTags>(l1))
-      handle_tags(es, upper_lvl_el, l1);
-
-    else if (!is_global(es, l1, 1))
-      show_unknown_element(l1, 1);
+    } else
+      handle_level1_element(es, upper_lvl_el, l1);
 
     if (!in->setFilePointer2(l1->GetElementPosition() + kax_file->get_element_size(l1)))
       break;
@@ -1646,6 +1873,31 @@ display_track_info() {
   }
 }
 
+/* The statistics are extrapolated from the sampled clusters to the
+   duration of the segment, or to the last cue point's timecode if the
+   duration isn't known. */
+void
+display_estimated_track_info() {
+  auto duration = s_segment_duration;
+  if ((0 > duration) && !s_cue_cluster_timecodes.empty())
+    duration = boost::accumulate(s_cue_cluster_timecodes | badap::map_values, int64_t{}, [](int64_t max, int64_t timecode) { return std::max(max, timecode); });
+  if (0 > duration)
+    duration = s_sampled_duration;
+
+  for (auto &track : s_tracks) {
+    auto &sample = s_sampled_track_info[track->tnum];
+    auto factor  = s_sampled_duration ? static_cast<double>(duration) / s_sampled_duration : 0.0;
+
+    mxinfo(boost::format(Y("Estimated statistics for track number %1% (sampled %2% clusters): number of blocks: %3%; size in bytes: %4%; duration in seconds: %5%; approximate bitrate in bits/second: %6%\n"))
+           % track->tnum
+           % s_num_sampled_clusters
+           % static_cast<int64_t>(sample.m_blocks * factor)
+           % static_cast<int64_t>(sample.m_size   * factor)
+           % (duration / 1000000000.0)
+           % static_cast<uint64_t>(s_sampled_duration ? sample.m_size * 8000000000.0 / s_sampled_duration : 0));
+  }
+}
+
 bool
 process_file(const std::string &file_name) {
   // Elements for different levels
@@ -1655,6 +1907,15 @@ process_file(const std::string &file_name) {
   s_tracks_by_number.clear();
   s_track_info.clear();
 
+  s_segment_data_start   = 0;
+  s_segment_duration     = -1;
+  s_sampled_duration     = 0;
+  s_num_sampled_clusters = 0;
+  s_seek_head_entries.clear();
+  s_handled_positions.clear();
+  s_cue_cluster_timecodes.clear();
+  s_sampled_track_info.clear();
+
   // open input file
   mm_io_cptr in;
   try {
@@ -1699,7 +1960,10 @@ process_file(const std::string &file_name) {
         break;
     }
 
-    if (!g_options.m_use_gui && g_options.m_show_track_info)
+    if (!g_options.m_use_gui && g_options.m_fast_summary)
+      display_estimated_track_info();
+
+    else if (!g_options.m_use_gui && g_options.m_show_track_info)
       display_track_info();
 
     return true;
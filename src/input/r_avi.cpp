@@ -15,6 +15,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <numeric>
 
 #include "avilib.h"
 #include "common/aac.h"
@@ -86,9 +87,12 @@ avi_reader_c::avi_reader_c(const track_info_c &ti,
   , m_max_video_frames(0)
   , m_dropped_video_frames(0)
   , m_avc_nal_size_size(-1)
-  , m_bytes_to_process(0)
-  , m_bytes_processed(0)
+  , m_chunk_idx(0)
+  , m_read_in_file_order(true)
+  , m_pending_video_frame_number(0)
+  , m_pending_video_key(false)
   , m_video_track_ok(false)
+  , m_debug_chunk_index{"avi_reader|avi_chunk_index"}
 {
 }
 
@@ -104,12 +108,12 @@ avi_reader_c::read_headers() {
 
   show_demuxer_info();
 
-  if (!(m_avi = AVI_open_input_file(m_in.get(), 1)))
+  if (!(m_avi = AVI_open_input_file(m_in.get(), 0)))
     throw mtx::input::invalid_format_x();
 
-  m_fps              = AVI_frame_rate(m_avi);
-  m_max_video_frames = AVI_video_frames(m_avi);
+  m_fps = AVI_frame_rate(m_avi);
 
+  build_chunk_index();
   verify_video_track();
   parse_subtitle_chunks();
 
@@ -134,20 +138,15 @@ void
 avi_reader_c::parse_subtitle_chunks() {
   int i;
   for (i = 0; AVI_text_tracks(m_avi) > i; ++i) {
-    AVI_set_text_track(m_avi, i);
-
-    if (AVI_text_chunks(m_avi) == 0)
+    auto idx = find_chunk(1 + m_avi->anum + i);
+    if (idx >= m_chunk_index.size())
       continue;
 
-    int chunk_size = AVI_read_text_chunk(m_avi, nullptr);
-    if (0 >= chunk_size)
+    auto chunk = read_chunk(idx);
+    if (!chunk)
       continue;
 
-    memory_cptr chunk(memory_c::alloc(chunk_size));
-    chunk_size = AVI_read_text_chunk(m_avi, reinterpret_cast<char *>(chunk->get_buffer()));
-
-    if (0 >= chunk_size)
-      continue;
+    int chunk_size = chunk->get_size();
 
     avi_subs_demuxer_t demuxer;
 
@@ -202,14 +201,12 @@ avi_reader_c::create_packetizer(int64_t tid) {
 
 void
 avi_reader_c::create_video_packetizer() {
-  size_t i;
+  auto frame_number = 0u;
 
   mxverb_tid(4, m_ti.m_fname, 0, "frame sizes:\n");
 
-  for (i = 0; i < m_max_video_frames; i++) {
-    m_bytes_to_process += AVI_frame_size(m_avi, i);
-    mxverb(4, boost::format("  %1%: %2%\n") % i % AVI_frame_size(m_avi, i));
-  }
+  for (auto idx = find_chunk(0); idx < m_chunk_index.size(); idx = find_chunk(0, idx + 1))
+    mxverb(4, boost::format("  %1%: %2%\n") % frame_number++ % m_chunk_index.get_size(idx));
 
   if (m_avi->bitmap_info_header) {
     m_ti.m_private_data = memory_c::clone(m_avi->bitmap_info_header, sizeof(alBITMAPINFOHEADER) + m_avi->extradata_size);
@@ -259,29 +256,21 @@ avi_reader_c::create_mpeg1_2_packetizer() {
 
   unsigned int frame_number = 0;
   unsigned int state        = m2v_parser->GetState();
-  while ((frame_number < std::min(m_max_video_frames, 100u)) && (MPV_PARSER_STATE_FRAME != state)) {
+  for (auto idx = find_chunk(0); (idx < m_chunk_index.size()) && (100 > frame_number) && (MPV_PARSER_STATE_FRAME != state); idx = find_chunk(0, idx + 1)) {
     ++frame_number;
 
-    int size = AVI_frame_size(m_avi, frame_number - 1);
-    if (0 == size)
+    if (0 == m_chunk_index.get_size(idx))
       continue;
 
-    AVI_set_video_position(m_avi, frame_number - 1);
-
-    memory_cptr buffer = memory_c::alloc(size);
-    int key      = 0;
-    int num_read = AVI_read_frame(m_avi, reinterpret_cast<char *>(buffer->get_buffer()), &key);
-
-    if (0 >= num_read)
+    auto buffer = read_chunk(idx);
+    if (!buffer)
       continue;
 
-    m2v_parser->WriteData(buffer->get_buffer(), num_read);
+    m2v_parser->WriteData(buffer->get_buffer(), buffer->get_size());
 
     state = m2v_parser->GetState();
   }
 
-  AVI_set_video_position(m_avi, 0);
-
   if (MPV_PARSER_STATE_FRAME != state)
     mxerror_tid(m_ti.m_fname, 0, Y("Could not extract the sequence header from this MPEG-1/2 track.\n"));
 
@@ -367,6 +356,432 @@ avi_reader_c::create_packetizers() {
 
   for (i = 0; static_cast<int>(m_subtitle_demuxers.size()) > i; ++i)
     create_subs_packetizer(i);
+
+  select_chunks();
+}
+
+void
+avi_chunk_index_c::add(int64_t position,
+                       uint32_t size,
+                       unsigned int track,
+                       bool keyframe) {
+  if (   m_block_starts.empty()
+      || ((m_sizes.size() - m_block_starts.back()) >= ms_max_block_entries)
+      || (position < m_block_positions.back())
+      || ((position - m_block_positions.back()) > std::numeric_limits<uint32_t>::max())) {
+    m_block_positions.push_back(position);
+    m_block_starts.push_back(m_sizes.size());
+  }
+
+  m_offsets.push_back(position - m_block_positions.back());
+  m_sizes.push_back(size);
+  m_tracks.push_back(track | (keyframe ? ms_keyframe_flag : 0));
+}
+
+void
+avi_chunk_index_c::sort() {
+  auto num_entries = size();
+  auto is_sorted   = true;
+
+  for (auto idx = 1u; is_sorted && (idx < num_entries); ++idx)
+    is_sorted = get_position(idx - 1) <= get_position(idx);
+
+  if (is_sorted)
+    return;
+
+  auto order = std::vector<size_t>(num_entries);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return get_position(a) < get_position(b); });
+
+  avi_chunk_index_c sorted;
+  for (auto idx : order)
+    sorted.add(get_position(idx), get_size(idx), get_track(idx), is_keyframe(idx));
+
+  *this = std::move(sorted);
+}
+
+void
+avi_chunk_index_c::clear() {
+  *this = avi_chunk_index_c{};
+}
+
+void
+avi_chunk_index_c::shrink_to_fit() {
+  m_block_positions.shrink_to_fit();
+  m_block_starts.shrink_to_fit();
+  m_offsets.shrink_to_fit();
+  m_sizes.shrink_to_fit();
+  m_tracks.shrink_to_fit();
+}
+
+int64_t
+avi_chunk_index_c::get_position(size_t idx)
+  const {
+  auto block = std::upper_bound(m_block_starts.begin(), m_block_starts.end(), idx) - m_block_starts.begin() - 1;
+  return m_block_positions[block] + m_offsets[idx];
+}
+
+/* Reads the positions and sizes of all chunks from the file's index
+   without letting avilib build its per-frame indexes. OpenDML files
+   are read from their standard index chunks, other files from their
+   'idx1' chunk. Files without a usable index are scanned. Track 0 is
+   the video track, the audio tracks are numbered from 1 and the text
+   tracks follow them. */
+void
+avi_reader_c::build_chunk_index() {
+  auto ok = m_avi->is_opendml && add_chunks_from_odml_index();
+  if (!ok)
+    ok = add_chunks_from_idx1();
+  if (!ok)
+    add_chunks_by_scanning();
+
+  // avilib reads the raw 'idx1' chunk while parsing the headers.
+  free(m_avi->idx);
+  m_avi->idx     = nullptr;
+  m_avi->n_idx   = 0;
+  m_avi->max_idx = 0;
+
+  m_chunk_index.sort();
+  m_chunk_index.shrink_to_fit();
+
+  m_max_video_frames = 0;
+  for (auto idx = 0u; idx < m_chunk_index.size(); ++idx)
+    if (0 == m_chunk_index.get_track(idx))
+      ++m_max_video_frames;
+
+  mxdebug_if(m_debug_chunk_index, boost::format("chunk index: %1% entries; %2% video frames\n") % m_chunk_index.size() % m_max_video_frames);
+}
+
+/* OpenDML files contain one standard index chunk per track and RIFF
+   list. The chunks of all tracks are merged while the standard index
+   chunks are read one after the other so that only one of them per
+   track is held in memory at a time. */
+bool
+avi_reader_c::add_chunks_from_odml_index() {
+  struct source_t {
+    avisuperindex_chunk const *m_superindex;
+    unsigned int m_track;
+    uint32_t m_next_std_index;
+    memory_cptr m_entries;
+    size_t m_idx, m_num_entries, m_entry_size;
+    uint64_t m_base_offset;
+
+    unsigned char const *get_entry() const {
+      return m_entries->get_buffer() + m_idx * m_entry_size;
+    }
+
+    int64_t get_position() const {
+      return m_base_offset + get_uint32_le(get_entry());
+    }
+  };
+
+  auto load_next_std_index = [this](source_t &source) -> bool {
+    source.m_idx         = 0;
+    source.m_num_entries = 0;
+
+    while (source.m_next_std_index < source.m_superindex->nEntriesInUse) {
+      auto &super_entry = source.m_superindex->aIndex[source.m_next_std_index++];
+      unsigned char header[32];
+
+      try {
+        m_in->setFilePointer(super_entry.qwOffset);
+        if (m_in->read(header, 32) != 32)
+          continue;
+
+        source.m_entry_size  = std::max<unsigned int>(get_uint16_le(&header[8]), 2) * 4;
+        source.m_base_offset = get_uint64_le(&header[20]);
+        auto num_entries     = std::min<uint64_t>(get_uint32_le(&header[12]), m_size / source.m_entry_size);
+
+        if (!num_entries)
+          continue;
+
+        source.m_entries     = memory_c::alloc(num_entries * source.m_entry_size);
+        source.m_num_entries = m_in->read(source.m_entries->get_buffer(), source.m_entries->get_size()) / source.m_entry_size;
+
+      } catch (mtx::mm_io::exception &) {
+      }
+
+      if (source.m_num_entries)
+        return true;
+    }
+
+    return false;
+  };
+
+  auto sources    = std::vector<source_t>{};
+  auto add_source = [&sources, &load_next_std_index](avisuperindex_chunk const *superindex, unsigned int track) {
+    if (!superindex)
+      return;
+
+    sources.push_back(source_t{ superindex, track, 0, memory_cptr{}, 0, 0, 8, 0 });
+    if (!load_next_std_index(sources.back()))
+      sources.pop_back();
+  };
+
+  add_source(m_avi->video_superindex, 0);
+
+  for (auto aid = 0; aid < m_avi->anum; ++aid)
+    add_source(m_avi->track[aid].audio_superindex, aid + 1);
+
+  for (auto tid = 0; tid < m_avi->tnum; ++tid)
+    add_source(m_avi->ttrack[tid].audio_superindex, 1 + m_avi->anum + tid);
+
+  auto num_video_chunks = 0u;
+
+  while (true) {
+    source_t *next = nullptr;
+    for (auto &source : sources)
+      if ((source.m_idx < source.m_num_entries) && (!next || (source.get_position() < next->get_position())))
+        next = &source;
+
+    if (!next)
+      break;
+
+    auto offset = get_uint32_le(next->get_entry());
+    auto value  = get_uint32_le(next->get_entry() + 4);
+    auto size   = value & 0x7fffffff;
+
+    // Entries without an offset and a size don't refer to any chunk.
+    if (offset || size) {
+      add_chunk(next->m_base_offset + offset, size, next->m_track, !(value & 0x80000000));
+      if (0 == next->m_track)
+        ++num_video_chunks;
+    }
+
+    if (++next->m_idx >= next->m_num_entries)
+      load_next_std_index(*next);
+  }
+
+  if (num_video_chunks)
+    return true;
+
+  m_chunk_index.clear();
+  return false;
+}
+
+/* The offsets in the 'idx1' chunk are relative to either the start of
+   the file or the start of the 'movi' list. Which one applies is
+   determined by looking for the first video chunk's header at both
+   positions. */
+bool
+avi_reader_c::add_chunks_from_idx1() {
+  if (!m_avi->idx)
+    return false;
+
+  auto num_entries = static_cast<size_t>(std::max<long>(m_avi->n_idx, 0));
+  auto first_video = 0u;
+
+  while ((first_video < num_entries) && (0 != get_track_by_tag(m_avi->idx[first_video])))
+    ++first_video;
+
+  if (first_video >= num_entries)
+    return false;
+
+  auto entry         = m_avi->idx[first_video];
+  int64_t position   = get_uint32_le(&entry[8]);
+  auto size          = get_uint32_le(&entry[12]);
+  auto has_header_at = [this, entry, size](int64_t header_position) -> bool {
+    unsigned char header[8];
+
+    try {
+      m_in->setFilePointer(header_position);
+      return (m_in->read(header, 8) == 8) && !strncasecmp(reinterpret_cast<char *>(header), reinterpret_cast<char const *>(entry), 4) && (get_uint32_le(&header[4]) == size);
+
+    } catch (mtx::mm_io::exception &) {
+      return false;
+    }
+  };
+
+  int64_t offset = has_header_at(position)                          ? 8
+                 : has_header_at(position + m_avi->movi_start - 4) ? m_avi->movi_start + 4
+                 :                                                   -1;
+
+  if (-1 == offset)
+    return false;
+
+  for (auto idx = 0u; idx < num_entries; ++idx) {
+    auto track = get_track_by_tag(m_avi->idx[idx]);
+    if (-1 != track)
+      add_chunk(get_uint32_le(&m_avi->idx[idx][8]) + offset, get_uint32_le(&m_avi->idx[idx][12]), track, get_uint32_le(&m_avi->idx[idx][4]) & 0x10);
+  }
+
+  return true;
+}
+
+/* Without a usable index the chunks are found by walking through the
+   'movi' lists of all RIFF lists. */
+void
+avi_reader_c::add_chunks_by_scanning() {
+  auto position = m_avi->movi_start;
+  unsigned char header[8];
+
+  try {
+    while (true) {
+      m_in->setFilePointer(position);
+      if (m_in->read(header, 8) != 8)
+        break;
+
+      auto tag   = reinterpret_cast<char const *>(header);
+      auto size  = get_uint32_le(&header[4]);
+      position  += 8;
+
+      // Descend into 'rec ' lists and into the following RIFF lists
+      // of OpenDML files.
+      if (!strncasecmp(tag, "LIST", 4) || !strncasecmp(tag, "RIFF", 4)) {
+        position += 4;
+        continue;
+      }
+
+      if (!strncasecmp(tag + 2, "db", 2) || !strncasecmp(tag + 2, "dc", 2) || !strncasecmp(tag + 2, "wb", 2)) {
+        auto track = get_track_by_tag(header);
+        if (-1 != track)
+          add_chunk(position, size, track, false);
+      }
+
+      position += size + (size & 1);
+    }
+
+  } catch (mtx::mm_io::exception &) {
+  }
+}
+
+/* Like avilib only the stream number is compared for the video
+   track. */
+int
+avi_reader_c::get_track_by_tag(unsigned char const *tag) {
+  auto chars = reinterpret_cast<char const *>(tag);
+
+  if (!strncasecmp(chars, m_avi->video_tag, 2))
+    return 0;
+
+  for (auto aid = 0; aid < m_avi->anum; ++aid)
+    if (!strncasecmp(chars, m_avi->track[aid].audio_tag, 4))
+      return aid + 1;
+
+  return -1;
+}
+
+void
+avi_reader_c::add_chunk(int64_t position,
+                        uint32_t size,
+                        unsigned int track,
+                        bool keyframe) {
+  // Empty video chunks are dropped frames. Empty audio and text chunks
+  // are skipped officially. Also ignore audio chunks with obviously
+  // wrong size information (> 10 MB).
+  if (   (0 != track)
+      && (   (0 == size)
+          || ((static_cast<int>(track) <= m_avi->anum) && (AVI_MAX_AUDIO_CHUNK_SIZE < size))))
+    return;
+
+  m_chunk_index.add(position, size, track, keyframe);
+}
+
+/* Only the chunks of the tracks that are actually muxed are kept.
+   Afterwards the audio tracks are numbered from 1 in the order of
+   m_audio_demuxers. */
+void
+avi_reader_c::select_chunks() {
+  auto track_map = std::vector<int>(1 + 2 * AVI_MAX_TRACKS, -1);
+
+  if (-1 != m_vptzr)
+    track_map[0] = 0;
+
+  for (auto idx = 0u; idx < m_audio_demuxers.size(); ++idx)
+    track_map[m_audio_demuxers[idx].m_aid + 1] = idx + 1;
+
+  avi_chunk_index_c selected;
+
+  for (auto idx = 0u; idx < m_chunk_index.size(); ++idx) {
+    auto track = track_map[m_chunk_index.get_track(idx)];
+    if (-1 != track)
+      selected.add(m_chunk_index.get_position(idx), m_chunk_index.get_size(idx), track, m_chunk_index.is_keyframe(idx));
+  }
+
+  mxdebug_if(m_debug_chunk_index, boost::format("chunk index: %1% of %2% entries selected\n") % selected.size() % m_chunk_index.size());
+
+  selected.shrink_to_fit();
+  m_chunk_index = std::move(selected);
+
+  determine_interleaving();
+}
+
+size_t
+avi_reader_c::find_chunk(unsigned int track,
+                         size_t start_idx) {
+  auto idx = start_idx;
+  while ((idx < m_chunk_index.size()) && (m_chunk_index.get_track(idx) != track))
+    ++idx;
+
+  return idx;
+}
+
+memory_cptr
+avi_reader_c::read_chunk(size_t idx) {
+  auto size  = m_chunk_index.get_size(idx);
+  auto chunk = memory_c::alloc(size);
+
+  try {
+    m_in->setFilePointer(m_chunk_index.get_position(idx));
+    if (m_in->read(chunk->get_buffer(), size) == size)
+      return chunk;
+
+  } catch (mtx::mm_io::exception &) {
+  }
+
+  return memory_cptr{};
+}
+
+/* Reading the chunks in file order only works well if the chunks of
+   all tracks with similar timestamps are stored close to each other.
+   Otherwise the chunks of one track have to be queued until those of
+   the other tracks with the same timestamps are found, e.g. all of the
+   video if the audio is stored after it.
+
+   The timestamps are approximated by the share of a track's frames
+   (video) or bytes (audio) preceding a chunk. If the tracks reach the
+   same share too far apart in the file then each track is read on its
+   own from its own position in the index. */
+void
+avi_reader_c::determine_interleaving() {
+  auto num_tracks = m_audio_demuxers.size() + 1;
+  auto totals     = std::vector<uint64_t>(num_tracks, 0);
+  auto amounts    = std::vector<uint64_t>(num_tracks, 0);
+
+  m_track_chunk_idx.assign(num_tracks, 0);
+  m_read_in_file_order = true;
+
+  for (auto idx = 0u; idx < m_chunk_index.size(); ++idx) {
+    auto track      = m_chunk_index.get_track(idx);
+    totals[track]  += track ? m_chunk_index.get_size(idx) : 1;
+  }
+
+  if (2 > brng::count_if(totals, [](uint64_t total) { return 0 != total; }))
+    return;
+
+  auto file_range   = m_chunk_index.get_position(m_chunk_index.size() - 1) - m_chunk_index.get_position(0);
+  auto max_distance = 0.0;
+
+  for (auto idx = 0u; idx < m_chunk_index.size(); ++idx) {
+    auto track      = m_chunk_index.get_track(idx);
+    amounts[track] += track ? m_chunk_index.get_size(idx) : 1;
+
+    auto min_share = 1.0, max_share = 0.0;
+    for (auto track_idx = 0u; track_idx < num_tracks; ++track_idx) {
+      if (!totals[track_idx])
+        continue;
+
+      auto share = static_cast<double>(amounts[track_idx]) / totals[track_idx];
+      min_share  = std::min(min_share, share);
+      max_share  = std::max(max_share, share);
+    }
+
+    max_distance = std::max(max_distance, (max_share - min_share) * file_range);
+  }
+
+  m_read_in_file_order = max_distance <= ms_max_interleaving_distance;
+
+  mxdebug_if(m_debug_chunk_index, boost::format("interleaving: maximum distance %1% bytes; reading %2%\n") % static_cast<int64_t>(max_distance) % (m_read_in_file_order ? "in file order" : "each track on its own"));
 }
 
 void
@@ -432,12 +847,13 @@ avi_reader_c::add_audio_demuxer(int aid) {
     if (demuxer.m_aid == aid) // Demuxer already added?
       return;
 
-  AVI_set_audio_track(m_avi, aid);
-  if (AVI_read_audio_chunk(m_avi, nullptr) < 0) {
-    mxwarn(boost::format(Y("Could not find an index for audio track %1% (avilib error message: %2%). Skipping track.\n")) % (aid + 1) % AVI_strerror());
+  if (find_chunk(aid + 1) >= m_chunk_index.size()) {
+    mxwarn(boost::format(Y("Could not find an index for audio track %1%. Skipping track.\n")) % (aid + 1));
     return;
   }
 
+  AVI_set_audio_track(m_avi, aid);
+
   avi_demuxer_t demuxer;
   generic_packetizer_c *packetizer = nullptr;
   alWAVEFORMATEX *wfe              = m_avi->wave_format_ex[aid];
@@ -491,13 +907,6 @@ avi_reader_c::add_audio_demuxer(int aid) {
   demuxer.m_ptzr = add_packetizer(packetizer);
 
   m_audio_demuxers.push_back(demuxer);
-
-  int i, maxchunks = AVI_audio_chunks(m_avi);
-  for (i = 0; i < maxchunks; i++) {
-    auto size = AVI_audio_size(m_avi, i);
-    if (size < AVI_MAX_AUDIO_CHUNK_SIZE)
-      m_bytes_to_process += size;
-  }
 }
 
 generic_packetizer_c *
@@ -549,23 +958,19 @@ avi_reader_c::create_aac_packetizer(int aid,
 generic_packetizer_c *
 avi_reader_c::create_dts_packetizer(int aid) {
   try {
-    AVI_set_audio_track(m_avi, aid);
-
-    long audio_position   = AVI_get_audio_position_index(m_avi);
+    auto chunk_idx        = find_chunk(aid + 1);
     unsigned int num_read = 0;
     int dts_position      = -1;
     byte_buffer_c buffer;
     mtx::dts::header_t dtsheader;
 
     while ((-1 == dts_position) && (10 > num_read)) {
-      int chunk_size = AVI_read_audio_chunk(m_avi, nullptr);
-
-      if (0 < chunk_size) {
-        memory_cptr chunk = memory_c::alloc(chunk_size);
-        AVI_read_audio_chunk(m_avi, reinterpret_cast<char *>(chunk->get_buffer()));
+      auto chunk = chunk_idx < m_chunk_index.size() ? read_chunk(chunk_idx) : memory_cptr{};
 
+      if (chunk) {
         buffer.add(chunk);
         dts_position = mtx::dts::find_header(buffer.get_buffer(), buffer.get_size(), dtsheader);
+        chunk_idx    = find_chunk(aid + 1, chunk_idx + 1);
 
       } else {
         dts_position = mtx::dts::find_header(buffer.get_buffer(), buffer.get_size(), dtsheader, true);
@@ -576,8 +981,6 @@ avi_reader_c::create_dts_packetizer(int aid) {
     if (-1 == dts_position)
       throw false;
 
-    AVI_set_audio_position_index(m_avi, audio_position);
-
     return new dts_packetizer_c(this, m_ti, dtsheader);
 
   } catch (...) {
@@ -640,139 +1043,136 @@ void
 avi_reader_c::set_avc_nal_size_size(mpeg4_p10_es_video_packetizer_c *ptzr) {
   m_avc_nal_size_size = ptzr->get_nalu_size_length();
 
-  for (size_t i = 0; i < m_max_video_frames; ++i) {
-    int size = AVI_frame_size(m_avi, i);
-    if (0 == size)
+  for (auto idx = find_chunk(0); idx < m_chunk_index.size(); idx = find_chunk(0, idx + 1)) {
+    if (0 == m_chunk_index.get_size(idx))
       continue;
 
-    memory_cptr buffer = memory_c::alloc(size);
-
-    AVI_set_video_position(m_avi, i);
-    int key = 0;
-    size    = AVI_read_frame(m_avi, reinterpret_cast<char *>(buffer->get_buffer()), &key);
+    auto buffer = read_chunk(idx);
 
-    if (   (4 <= size)
+    if (   buffer
+        && (4 <= buffer->get_size())
         && (   (get_uint32_be(buffer->get_buffer()) == NALU_START_CODE)
             || (get_uint24_be(buffer->get_buffer()) == NALU_START_CODE)))
       m_avc_nal_size_size = -1;
 
     break;
   }
-
-  AVI_set_video_position(m_avi, 0);
 }
 
-file_status_e
-avi_reader_c::read_video() {
-  if (m_video_frames_read >= m_max_video_frames)
-    return flush_packetizer(m_vptzr);
-
-  memory_cptr chunk;
-  int key                   = 0;
-  int old_video_frames_read = m_video_frames_read;
-
-  int size, num_read;
-
-  int dropped_frames_here   = 0;
+/* Dropped frames are stored as empty chunks. They aren't output but
+   extend the duration of the frame preceding them. Therefore a frame is
+   only delivered once the next non-empty frame has been found or the
+   end of the file has been reached. */
+void
+avi_reader_c::deliver_pending_video_frame(unsigned int next_frame_number) {
+  if (!m_pending_video_frame)
+    return;
 
-  do {
-    size  = AVI_frame_size(m_avi, m_video_frames_read);
-    chunk = memory_c::alloc(size);
-    num_read = AVI_read_frame(m_avi, reinterpret_cast<char *>(chunk->get_buffer()), &key);
+  process_video_frame(m_pending_video_frame, m_pending_video_key, m_pending_video_frame_number, next_frame_number - m_pending_video_frame_number);
 
-    ++m_video_frames_read;
+  m_pending_video_frame.reset();
+  m_pending_video_frame_number = next_frame_number;
+}
 
-    if (0 > num_read) {
-      // Error reading the frame: abort
-      m_video_frames_read = m_max_video_frames;
-      return flush_packetizer(m_vptzr);
+void
+avi_reader_c::process_video_frame(memory_cptr const &frame,
+                                  bool key,
+                                  unsigned int frame_number,
+                                  unsigned int num_frames) {
+  int64_t timestamp = static_cast<int64_t>(static_cast<int64_t>(frame_number) * 1000000000ll / m_fps);
+  int64_t duration  = static_cast<int64_t>(static_cast<int64_t>(num_frames)   * 1000000000ll / m_fps);
 
-    } else if (0 == num_read)
-      ++dropped_frames_here;
+  // AVC with framed packets (without NALU start codes but with length fields)
+  // or non-AVC video track?
+  if (0 >= m_avc_nal_size_size) {
+    PTZR(m_vptzr)->process(new packet_t(frame, timestamp, duration, key ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
+    return;
+  }
 
-  } while ((0 == num_read) && (m_video_frames_read < m_max_video_frames));
+  // AVC video track without NALU start codes. Re-frame with NALU start codes.
+  int offset = 0, size = frame->get_size();
 
-  if (0 == num_read)
-    // This is only the case if the AVI contains dropped frames only.
-    return flush_packetizer(m_vptzr);
+  while ((offset + m_avc_nal_size_size) < size) {
+    int nalu_size  = get_uint_be(frame->get_buffer() + offset, m_avc_nal_size_size);
+    offset        += m_avc_nal_size_size;
 
-  size_t i;
-  for (i = m_video_frames_read; i < m_max_video_frames; ++i) {
-    if (0 != AVI_frame_size(m_avi, i))
+    if ((offset + nalu_size) > size)
       break;
 
-    int dummy_key;
-    AVI_read_frame(m_avi, nullptr, &dummy_key);
-    ++dropped_frames_here;
-    ++m_video_frames_read;
-  }
+    memory_cptr nalu = memory_c::alloc(4 + nalu_size);
+    put_uint32_be(nalu->get_buffer(), NALU_START_CODE);
+    memcpy(nalu->get_buffer() + 4, frame->get_buffer() + offset, nalu_size);
+    offset += nalu_size;
 
-  int64_t timestamp       = static_cast<int64_t>(static_cast<int64_t>(old_video_frames_read)   * 1000000000ll / m_fps);
-  int64_t duration        = static_cast<int64_t>(static_cast<int64_t>(dropped_frames_here + 1) * 1000000000ll / m_fps);
+    PTZR(m_vptzr)->process(new packet_t(nalu, timestamp, duration, key ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
+  }
+}
 
-  m_dropped_video_frames += dropped_frames_here;
+/* The chunks of all tracks are read in the order they're stored in the
+   file regardless of which packetizer has requested data. This way the
+   file is read sequentially once instead of seeking back and forth
+   between the tracks' chunks.
 
-  // AVC with framed packets (without NALU start codes but with length fields)
-  // or non-AVC video track?
-  if (0 >= m_avc_nal_size_size)
-    PTZR(m_vptzr)->process(new packet_t(chunk, timestamp, duration, key ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
+   For badly interleaved files only the chunks of \c wanted_track are
+   read, starting at that track's own position in the index. */
+file_status_e
+avi_reader_c::read_next_chunk(int wanted_track) {
+  auto &chunk_idx = -1 == wanted_track ? m_chunk_idx : m_track_chunk_idx[wanted_track];
 
-  else {
-    // AVC video track without NALU start codes. Re-frame with NALU start codes.
-    int offset = 0;
+  while (chunk_idx < m_chunk_index.size()) {
+    auto idx   = chunk_idx++;
+    auto size  = m_chunk_index.get_size(idx);
+    auto track = m_chunk_index.get_track(idx);
 
-    while ((offset + m_avc_nal_size_size) < num_read) {
-      int nalu_size  = get_uint_be(chunk->get_buffer() + offset, m_avc_nal_size_size);
-      offset        += m_avc_nal_size_size;
+    if ((-1 != wanted_track) && (static_cast<unsigned int>(wanted_track) != track))
+      continue;
 
-      if ((offset + nalu_size) > num_read)
-        break;
+    if (!size) {
+      ++m_video_frames_read;
+      ++m_dropped_video_frames;
+      continue;
+    }
 
-      memory_cptr nalu = memory_c::alloc(4 + nalu_size);
-      put_uint32_be(nalu->get_buffer(), NALU_START_CODE);
-      memcpy(nalu->get_buffer() + 4, chunk->get_buffer() + offset, nalu_size);
-      offset += nalu_size;
+    auto chunk = read_chunk(idx);
+    if (!chunk)
+      break;
 
-      PTZR(m_vptzr)->process(new packet_t(nalu, timestamp, duration, key ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
+    if (0 != track) {
+      PTZR(m_audio_demuxers[track - 1].m_ptzr)->process(new packet_t(chunk));
+      return FILE_STATUS_MOREDATA;
     }
-  }
 
-  m_bytes_processed += num_read;
+    // The frame number of the first frame is 0 even if it is preceded
+    // by dropped frames. It is kept in m_pending_video_frame_number.
+    deliver_pending_video_frame(m_video_frames_read);
 
-  return m_video_frames_read >= m_max_video_frames ? flush_packetizer(m_vptzr) :  FILE_STATUS_MOREDATA;
-}
+    m_pending_video_frame = chunk;
+    m_pending_video_key   = m_chunk_index.is_keyframe(idx);
+    ++m_video_frames_read;
 
-file_status_e
-avi_reader_c::read_audio(avi_demuxer_t &demuxer) {
-  AVI_set_audio_track(m_avi, demuxer.m_aid);
+    return FILE_STATUS_MOREDATA;
+  }
 
-  while (true) {
-    int size = AVI_audio_size(m_avi, AVI_get_audio_position_index(m_avi));
+  if (chunk_idx < m_chunk_index.size())
+    mxwarn_fn(m_ti.m_fname, boost::format(Y("The data for the chunk at position %1% could not be read. The file is probably truncated.\n")) % m_chunk_index.get_position(chunk_idx - 1));
 
-    // -1 indicates the last chunk.
-    if (-1 == size)
-      return flush_packetizer(demuxer.m_ptzr);
+  chunk_idx = m_chunk_index.size();
 
-    // Sanity check. Ignore chunks with obvious wrong size information
-    // (> 10 MB). Also skip 0-sized blocks. Those are officially
-    // skipped.
-    if (!size || (size > AVI_MAX_AUDIO_CHUNK_SIZE)) {
-      AVI_set_audio_position_index(m_avi, AVI_get_audio_position_index(m_avi) + 1);
-      continue;
-    }
+  if (0 < wanted_track)
+    return flush_packetizer(m_audio_demuxers[wanted_track - 1].m_ptzr);
 
-    auto chunk = memory_c::alloc(size);
-    size       = AVI_read_audio_chunk(m_avi, reinterpret_cast<char *>(chunk->get_buffer()));
+  deliver_pending_video_frame(m_video_frames_read);
 
-    if (0 >= size)
-      continue;
+  if (-1 != m_vptzr)
+    flush_packetizer(m_vptzr);
 
-    PTZR(demuxer.m_ptzr)->process(new packet_t(chunk));
+  if (0 == wanted_track)
+    return FILE_STATUS_DONE;
 
-    m_bytes_processed += size;
+  for (auto &demuxer : m_audio_demuxers)
+    flush_packetizer(demuxer.m_ptzr);
 
-    return AVI_get_audio_position_index(m_avi) < AVI_max_audio_chunk(m_avi) ? FILE_STATUS_MOREDATA : flush_packetizer(demuxer.m_ptzr);
-  }
+  return FILE_STATUS_DONE;
 }
 
 file_status_e
@@ -786,36 +1186,46 @@ avi_reader_c::read_subtitles(avi_subs_demuxer_t &demuxer) {
 file_status_e
 avi_reader_c::read(generic_packetizer_c *ptzr,
                    bool) {
-  if ((-1 != m_vptzr) && (PTZR(m_vptzr) == ptzr))
-    return read_video();
-
-  for (auto &demuxer : m_audio_demuxers)
-    if ((-1 != demuxer.m_ptzr) && (PTZR(demuxer.m_ptzr) == ptzr))
-      return read_audio(demuxer);
-
   for (auto &subs_demuxer : m_subtitle_demuxers)
     if ((-1 != subs_demuxer.m_ptzr) && (PTZR(subs_demuxer.m_ptzr) == ptzr))
       return read_subtitles(subs_demuxer);
 
+  if (m_read_in_file_order)
+    return read_next_chunk();
+
+  if ((-1 != m_vptzr) && (PTZR(m_vptzr) == ptzr))
+    return read_next_chunk(0);
+
+  for (auto idx = 0u; idx < m_audio_demuxers.size(); ++idx)
+    if ((-1 != m_audio_demuxers[idx].m_ptzr) && (PTZR(m_audio_demuxers[idx].m_ptzr) == ptzr))
+      return read_next_chunk(idx + 1);
+
   return flush_packetizers();
 }
 
 int
 avi_reader_c::get_progress() {
-  return 0 == m_bytes_to_process ? 0 : 100 * m_bytes_processed / m_bytes_to_process;
+  if (m_chunk_index.empty())
+    return 0;
+
+  if (m_read_in_file_order)
+    return 100 * m_chunk_idx / m_chunk_index.size();
+
+  return 100 * boost::accumulate(m_track_chunk_idx, uint64_t{}) / (m_chunk_index.size() * m_track_chunk_idx.size());
 }
 
 void
 avi_reader_c::extended_identify_mpeg4_l2(std::vector<std::string> &extended_info) {
-  int size = AVI_frame_size(m_avi, 0);
-  if (0 >= size)
+  auto idx = find_chunk(0);
+  if ((idx >= m_chunk_index.size()) || (0 == m_chunk_index.get_size(idx)))
     return;
 
-  memory_cptr af_buffer = memory_c::alloc(size);
-  unsigned char *buffer = af_buffer->get_buffer();
-  int dummy_key;
+  memory_cptr af_buffer = read_chunk(idx);
+  if (!af_buffer)
+    return;
 
-  AVI_read_frame(m_avi, reinterpret_cast<char *>(buffer), &dummy_key);
+  unsigned char *buffer = af_buffer->get_buffer();
+  int size              = af_buffer->get_size();
 
   uint32_t par_num, par_den;
   if (mpeg4::p2::extract_par(buffer, size, par_num, par_den)) {
@@ -928,14 +1338,9 @@ avi_reader_c::add_available_track_ids() {
 
 void
 avi_reader_c::debug_dump_video_index() {
-  int num_video_frames = AVI_video_frames(m_avi), i;
-
-  mxinfo(boost::format("AVI video index dump: %1% entries; frame rate: %2%\n") % num_video_frames % m_fps);
-  for (i = 0; num_video_frames > i; ++i) {
-    int key = 0;
-    AVI_read_frame(m_avi, nullptr, &key);
-    mxinfo(boost::format("  %1%: %2% bytes; key: %3%\n") % i % AVI_frame_size(m_avi, i) % key);
-  }
+  auto frame_number = 0u;
 
-  AVI_set_video_position(m_avi, 0);
+  mxinfo(boost::format("AVI video index dump: %1% entries; frame rate: %2%\n") % m_max_video_frames % m_fps);
+  for (auto idx = find_chunk(0); idx < m_chunk_index.size(); idx = find_chunk(0, idx + 1))
+    mxinfo(boost::format("  %1%: %2% bytes; key: %3%\n") % frame_number++ % m_chunk_index.get_size(idx) % (m_chunk_index.is_keyframe(idx) ? 0x10 : 0));
 }
@@ -26,7 +26,6 @@
 struct avi_demuxer_t {
   int m_ptzr;
   int m_channels, m_bits_per_sample, m_samples_per_second, m_aid;
-  int64_t m_bytes_processed;
   codec_c m_codec;
 
   avi_demuxer_t()
@@ -35,7 +34,6 @@ struct avi_demuxer_t {
     , m_bits_per_sample(0)
     , m_samples_per_second(0)
     , m_aid(0)
-    , m_bytes_processed(0)
   {
   }
 };
@@ -58,8 +56,50 @@ struct avi_subs_demuxer_t {
   avi_subs_demuxer_t();
 };
 
+/* The positions and sizes of all chunks, sorted by their position in
+   the file. The chunks are grouped into blocks of consecutive entries
+   that store a 64-bit base position once and 32-bit offsets relative to
+   it. A chunk takes nine bytes in total compared to the 24 bytes of
+   avilib's per-frame index entries. */
+class avi_chunk_index_c {
+protected:
+  static size_t const ms_max_block_entries = 4096;
+  static uint8_t const ms_keyframe_flag    = 0x80;
+
+  std::vector<int64_t> m_block_positions;
+  std::vector<size_t> m_block_starts;
+  std::vector<uint32_t> m_offsets, m_sizes;
+  std::vector<uint8_t> m_tracks;
+
+public:
+  void add(int64_t position, uint32_t size, unsigned int track, bool keyframe);
+  void sort();
+  void clear();
+  void shrink_to_fit();
+
+  size_t size() const {
+    return m_sizes.size();
+  }
+  bool empty() const {
+    return m_sizes.empty();
+  }
+
+  int64_t get_position(size_t idx) const;
+  uint32_t get_size(size_t idx) const {
+    return m_sizes[idx];
+  }
+  unsigned int get_track(size_t idx) const {
+    return m_tracks[idx] & ~ms_keyframe_flag;
+  }
+  bool is_keyframe(size_t idx) const {
+    return m_tracks[idx] & ms_keyframe_flag;
+  }
+};
+
 class avi_reader_c: public generic_reader_c {
 private:
+  static int64_t const ms_max_interleaving_distance = 16 * 1024 * 1024;
+
   enum divx_type_e {
     DIVX_TYPE_NONE,
     DIVX_TYPE_V3,
@@ -74,9 +114,18 @@ private:
   unsigned int m_video_frames_read, m_max_video_frames, m_dropped_video_frames;
   int m_avc_nal_size_size;
 
-  uint64_t m_bytes_to_process, m_bytes_processed;
+  avi_chunk_index_c m_chunk_index;
+  size_t m_chunk_idx;
+  std::vector<size_t> m_track_chunk_idx;
+  bool m_read_in_file_order;
+  memory_cptr m_pending_video_frame;
+  unsigned int m_pending_video_frame_number;
+  bool m_pending_video_key;
+
   bool m_video_track_ok;
 
+  debugging_option_c m_debug_chunk_index;
+
 public:
   avi_reader_c(const track_info_c &ti, const mm_io_cptr &in);
   virtual ~avi_reader_c();
@@ -87,6 +136,9 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false);
+  virtual bool supports_pipelined_reading() const {
+    return false;
+  }
   virtual int get_progress();
   virtual void identify();
   virtual void create_packetizers();
@@ -97,8 +149,19 @@ public:
 
 protected:
   virtual void add_audio_demuxer(int aid);
-  virtual file_status_e read_video();
-  virtual file_status_e read_audio(avi_demuxer_t &demuxer);
+  virtual void build_chunk_index();
+  virtual bool add_chunks_from_odml_index();
+  virtual bool add_chunks_from_idx1();
+  virtual void add_chunks_by_scanning();
+  virtual int get_track_by_tag(unsigned char const *tag);
+  virtual void add_chunk(int64_t position, uint32_t size, unsigned int track, bool keyframe);
+  virtual void select_chunks();
+  virtual void determine_interleaving();
+  virtual size_t find_chunk(unsigned int track, size_t start_idx = 0);
+  virtual memory_cptr read_chunk(size_t idx);
+  virtual file_status_e read_next_chunk(int wanted_track = -1);
+  virtual void process_video_frame(memory_cptr const &frame, bool key, unsigned int frame_number, unsigned int num_frames);
+  virtual void deliver_pending_video_frame(unsigned int next_frame_number);
   virtual file_status_e read_subtitles(avi_subs_demuxer_t &demuxer);
 
   virtual generic_packetizer_c *create_aac_packetizer(int aid, avi_demuxer_t &demuxer);
@@ -51,12 +51,14 @@
 #include "common/hacks.h"
 #include "common/iso639.h"
 #include "common/ivf.h"
+#include "common/kax_cluster_index.h"
 #include "common/mm_io.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
 #include "common/strings/utf8.h"
 #include "common/tags/tags.h"
 #include "input/r_matroska.h"
+#include "merge/cluster_helper.h"
 #include "merge/file_status.h"
 #include "merge/input_x.h"
 #include "merge/output_control.h"
@@ -1197,6 +1199,9 @@ void
 kax_reader_c::read_headers() {
   if (!read_headers_internal())
     throw mtx::input::header_parsing_x();
+
+  m_in->set_access_pattern(mm_io_c::access_sequential);
+
   show_demuxer_info();
 }
 
@@ -1818,6 +1823,58 @@ kax_reader_c::create_packetizers() {
   }
 
   m_in->restore_pos();
+
+  if (m_ti.m_use_cluster_index)
+    seek_to_first_split_part();
+}
+
+/** \brief Skip the clusters before the first part in 'parts:' splitting mode
+
+   The cluster helper discards everything before the first part
+   anyway. Reading starts at the cluster containing the last key frame
+   before the part's start so that the packets the cluster helper uses
+   for calculating the new file's timecode offset are still seen.
+
+   This is only done if the packets' timecodes are not modified,
+   meaning that the source file's timecodes are the output timecodes.
+*/
+void
+kax_reader_c::seek_to_first_split_part() {
+  auto start = g_cluster_helper->get_first_part_start();
+
+  if (   (0 >= start)
+      || m_appending
+      || !m_ti.m_timecode_syncs.empty()
+      || !m_ti.m_reset_timecodes_specs.empty()
+      || !m_ti.m_all_ext_timecodes.empty())
+    return;
+
+  auto index = kax_cluster_index_c::load_or_build(m_ti.m_fname, *m_in, g_cluster_index_dir);
+  if (!index)
+    return;
+
+  // Use video tracks if there are any, audio tracks otherwise.
+  std::vector<uint64_t> track_numbers;
+  for (auto type : std::vector<char>{ 'v', 'a' }) {
+    for (auto &track : m_tracks)
+      if ((-1 != track->ptzr) && (type == track->type))
+        track_numbers.push_back(track->track_number);
+
+    if (!track_numbers.empty())
+      break;
+  }
+
+  if (track_numbers.empty())
+    return;
+
+  auto position = index->find_cluster_position(start - 1, track_numbers);
+  if (!position || (*position <= m_in->getFilePointer()))
+    return;
+
+  static debugging_option_c s_debug{"kax_reader|cluster_index"};
+  mxdebug_if(s_debug, boost::format("skipping to the cluster at %1% for the first part starting at %2%\n") % *position % format_timecode(start));
+
+  m_in->setFilePointer(*position, seek_beginning);
 }
 
 void
@@ -1937,20 +1994,27 @@ kax_reader_c::read_first_frames(kax_track_t *t,
   }
 }
 
+bool
+kax_reader_c::is_holding(generic_packetizer_c *requested_ptzr,
+                         int64_t num_queued_bytes)
+  const {
+  if (20 * 1024 * 1024 >= num_queued_bytes)
+    return false;
+
+  auto itr                  = m_ptzr_to_track_map.find(requested_ptzr);
+  auto requested_ptzr_track = itr != m_ptzr_to_track_map.end() ? itr->second : nullptr;
+
+  return !requested_ptzr_track || (('a' != requested_ptzr_track->type) && ('v' != requested_ptzr_track->type)) || (512 * 1024 * 1024 < num_queued_bytes);
+}
+
 file_status_e
 kax_reader_c::read(generic_packetizer_c *requested_ptzr,
                    bool force) {
   if (m_tracks.empty() || (FILE_STATUS_DONE == m_file_status))
     return FILE_STATUS_DONE;
 
-  if (!force) {
-    auto num_queued_bytes = get_queued_bytes();
-    if (20 * 1024 * 1024 < num_queued_bytes) {
-      kax_track_t *requested_ptzr_track = m_ptzr_to_track_map[requested_ptzr];
-      if (!requested_ptzr_track || (('a' != requested_ptzr_track->type) && ('v' != requested_ptzr_track->type)) || (512 * 1024 * 1024 < num_queued_bytes))
-        return FILE_STATUS_HOLDING;
-    }
-  }
+  if (!force && is_holding(requested_ptzr, get_queued_bytes()))
+    return FILE_STATUS_HOLDING;
 
   try {
     KaxCluster *cluster = m_in_file->read_next_cluster();
@@ -212,6 +212,7 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false);
+  virtual bool is_holding(generic_packetizer_c *requested_ptzr, int64_t num_queued_bytes) const;
 
   virtual int get_progress();
   virtual void set_headers();
@@ -245,6 +246,7 @@ protected:
   virtual void verify_subtitle_track(kax_track_t *t);
   virtual void verify_button_track(kax_track_t *t);
   virtual void verify_tracks();
+  virtual void seek_to_first_split_part();
 
   virtual bool packets_available();
   virtual void handle_attachments(mm_io_c *io, EbmlElement *l0, int64_t pos);
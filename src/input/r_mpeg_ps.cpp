@@ -1246,18 +1246,27 @@ mpeg_ps_reader_c::add_available_track_ids() {
   add_available_track_id_range(tracks.size());
 }
 
+bool
+mpeg_ps_reader_c::is_holding(generic_packetizer_c *requested_ptzr,
+                             int64_t num_queued_bytes)
+  const {
+  if (20 * 1024 * 1024 >= num_queued_bytes)
+    return false;
+
+  auto itr                  = m_ptzr_to_track_map.find(requested_ptzr);
+  auto requested_ptzr_track = itr != m_ptzr_to_track_map.end() ? itr->second : mpeg_ps_track_ptr{};
+
+  return !requested_ptzr_track || (('a' != requested_ptzr_track->type) && ('v' != requested_ptzr_track->type)) || (64 * 1024 * 1024 < num_queued_bytes);
+}
+
 file_status_e
 mpeg_ps_reader_c::read(generic_packetizer_c *requested_ptzr,
                        bool force) {
   if (file_done)
     return flush_packetizers();
 
-  auto num_queued_bytes = get_queued_bytes();
-  if (!force && (20 * 1024 * 1024 < num_queued_bytes)) {
-    mpeg_ps_track_ptr requested_ptzr_track = m_ptzr_to_track_map[requested_ptzr];
-    if (!requested_ptzr_track || (('a' != requested_ptzr_track->type) && ('v' != requested_ptzr_track->type)) || (64 * 1024 * 1024 < num_queued_bytes))
-      return FILE_STATUS_HOLDING;
-  }
+  if (!force && is_holding(requested_ptzr, get_queued_bytes()))
+    return FILE_STATUS_HOLDING;
 
   try {
     mpeg_ps_id_t new_id;
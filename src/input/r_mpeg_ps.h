@@ -216,6 +216,7 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *requested_ptzr, bool force = false);
+  virtual bool is_holding(generic_packetizer_c *requested_ptzr, int64_t num_queued_bytes) const;
   virtual void identify();
   virtual void create_packetizer(int64_t id);
   virtual void create_packetizers();
@@ -20,6 +20,7 @@
 #include "common/checksums/crc.h"
 #include "common/clpi.h"
 #include "common/endian.h"
+#include "common/fs_sys_helpers.h"
 #include "common/math.h"
 #include "common/mp3.h"
 #include "common/mm_mpls_multi_file_io.h"
@@ -51,6 +52,7 @@
 #define TS_PIDS_DETECT_SIZE    10 * 1024 * 1024
 #define TS_PACKET_SIZE         188
 #define TS_MAX_PACKET_SIZE     204
+#define TS_READ_BLOCK_PACKETS  1024
 
 int mpeg_ts_reader_c::potential_packet_sizes[] = { 188, 192, 204, 0 };
 
@@ -636,11 +638,20 @@ mpeg_ts_reader_c::mpeg_ts_reader_c(const track_info_c &ti,
   , m_debug_aac{              "mpeg_ts|mpeg_aac"}
   , m_debug_timecode_wrapping{"mpeg_ts|mpeg_ts_timecode_wrapping"}
   , m_debug_clpi{             "clpi"}
+  , m_debug_performance{      "mpeg_ts|mpeg_ts_performance"}
   , m_detected_packet_size{}
   , m_num_pat_crc_errors{}
   , m_num_pmt_crc_errors{}
   , m_validate_pat_crc{true}
   , m_validate_pmt_crc{true}
+  , m_read_buffer_position{}
+  , m_read_buffer_valid_size{}
+  , m_read_buffer_file_position{}
+  , m_pid_filter(0x2000, false)
+  , m_num_packets_read{}
+  , m_num_packets_skipped{}
+  , m_num_resyncs{}
+  , m_read_start_time{-1}
 {
   auto mpls_in = dynamic_cast<mm_mpls_multi_file_io_c *>(get_underlying_input());
   if (mpls_in)
@@ -741,6 +752,8 @@ mpeg_ts_reader_c::read_headers() {
       track->probed_ok = true;
   }
 
+  m_in->set_access_pattern(mm_io_c::access_sequential);
+
   show_demuxer_info();
 }
 
@@ -1217,7 +1230,7 @@ mpeg_ts_reader_c::parse_packet(unsigned char *buf) {
   if (!track->data_ready)
     return true;
 
-  mxdebug_if(m_debug_headers, boost::format("mpeg_ts_reader_c::parse_packet: Table/PES completed (%1%) for PID %2% at file position %3%\n") % track->pes_payload->get_size() % table_pid % m_in->getFilePointer());
+  mxdebug_if(m_debug_headers, boost::format("mpeg_ts_reader_c::parse_packet: Table/PES completed (%1%) for PID %2% at file position %3%\n") % track->pes_payload->get_size() % table_pid % get_packet_position(buf));
 
   if (m_probing)
     probe_packet_complete(track);
@@ -1556,6 +1569,10 @@ mpeg_ts_reader_c::create_packetizers() {
   mxdebug_if(m_debug_headers, boost::format("mpeg_ts_reader_c::create_packetizers: create packetizers...\n"));
   for (i = 0; i < tracks.size(); i++)
     create_packetizer(i);
+
+  for (auto const &track : tracks)
+    if (-1 != track->ptzr)
+      m_pid_filter[track->pid & 0x1fff] = true;
 }
 
 void
@@ -1580,34 +1597,53 @@ mpeg_ts_reader_c::finish() {
 
   file_done = true;
 
+  if (m_debug_performance) {
+    auto duration = std::max<int64_t>(mtx::sys::get_current_time_millis() - m_read_start_time, 1);
+    mxdebug(boost::format("mpeg_ts_reader_c::finish: %1% packets read in %2% ms (%3% packets/s); %4% skipped by the PID filter; %5% resyncs\n")
+            % m_num_packets_read % duration % (m_num_packets_read * 1000 / duration) % m_num_packets_skipped % m_num_resyncs);
+  }
+
   return flush_packetizers();
 }
 
+bool
+mpeg_ts_reader_c::is_holding(generic_packetizer_c *requested_ptzr,
+                             int64_t num_queued_bytes)
+  const {
+  if (20 * 1024 * 1024 >= num_queued_bytes)
+    return false;
+
+  auto itr                  = m_ptzr_to_track_map.find(requested_ptzr);
+  auto requested_ptzr_track = itr != m_ptzr_to_track_map.end() ? itr->second : mpeg_ts_track_ptr{};
+
+  return !requested_ptzr_track || ((ES_AUDIO_TYPE != requested_ptzr_track->type) && (ES_VIDEO_TYPE != requested_ptzr_track->type)) || (512 * 1024 * 1024 < num_queued_bytes);
+}
+
 file_status_e
 mpeg_ts_reader_c::read(generic_packetizer_c *requested_ptzr,
                        bool force) {
-  int64_t num_queued_bytes = get_queued_bytes();
-  if (!force && (20 * 1024 * 1024 < num_queued_bytes)) {
-    mpeg_ts_track_ptr requested_ptzr_track = m_ptzr_to_track_map[requested_ptzr];
-    if (!requested_ptzr_track || ((ES_AUDIO_TYPE != requested_ptzr_track->type) && (ES_VIDEO_TYPE != requested_ptzr_track->type)) || (512 * 1024 * 1024 < num_queued_bytes))
-      return FILE_STATUS_HOLDING;
-  }
-
-  unsigned char buf[TS_MAX_PACKET_SIZE + 1];
+  if (!force && is_holding(requested_ptzr, get_queued_bytes()))
+    return FILE_STATUS_HOLDING;
 
   track_buffer_ready = -1;
 
   if (file_done)
     return flush_packetizers();
 
+  if (-1 == m_read_start_time)
+    m_read_start_time = mtx::sys::get_current_time_millis();
+
   while (true) {
-    if (m_in->read(buf, m_detected_packet_size) != static_cast<unsigned int>(m_detected_packet_size))
+    if ((m_read_buffer_position >= m_read_buffer_valid_size) && !fill_read_buffer())
       return finish();
 
-    if (buf[0] != 0x47) {
-      if (resync(m_in->getFilePointer() - m_detected_packet_size))
-        continue;
-      return finish();
+    auto buf                = m_read_buffer->get_buffer() + m_read_buffer_position;
+    m_read_buffer_position += m_detected_packet_size;
+    ++m_num_packets_read;
+
+    if (!m_pid_filter[((buf[1] & 0x1f) << 8) | buf[2]]) {
+      ++m_num_packets_skipped;
+      continue;
     }
 
     parse_packet(buf);
@@ -1622,40 +1658,42 @@ mpeg_ts_reader_c::read(generic_packetizer_c *requested_ptzr,
   }
 }
 
-bfs::path
-mpeg_ts_reader_c::find_clip_info_file() {
+std::vector<bfs::path>
+mpeg_ts_reader_c::get_clip_info_file_candidates()
+  const {
   auto mpls_multi_in = dynamic_cast<mm_mpls_multi_file_io_c *>(get_underlying_input());
   auto clpi_file     = mpls_multi_in ? mpls_multi_in->get_file_names()[0] : bfs::path{m_ti.m_fname};
 
   clpi_file.replace_extension(".clpi");
 
-  mxdebug_if(m_debug_clpi, boost::format("mpeg_ts_reader_c::find_clip_info_file: Checking %1%\n") % clpi_file.string());
-
-  if (bfs::exists(clpi_file))
-    return clpi_file;
-
   bfs::path file_name(clpi_file.filename());
-  bfs::path path(clpi_file.remove_filename());
+  bfs::path path(bfs::path{clpi_file}.remove_filename());
 
-  // clpi_file = path / ".." / file_name;
-  // if (bfs::exists(clpi_file))
-  //   return clpi_file;
+  // path / ".." / file_name isn't checked.
 
-  clpi_file = path / ".." / "clipinf" / file_name;
-  mxdebug_if(m_debug_clpi, boost::format("mpeg_ts_reader_c::find_clip_info_file: Checking %1%\n") % clpi_file.string());
-  if (bfs::exists(clpi_file))
-    return clpi_file;
+  return std::vector<bfs::path>{ clpi_file, path / ".." / "clipinf" / file_name, path / ".." / "CLIPINF" / file_name };
+}
 
-  clpi_file = path / ".." / "CLIPINF" / file_name;
-  mxdebug_if(m_debug_clpi, boost::format("mpeg_ts_reader_c::find_clip_info_file: Checking %1%\n") % clpi_file.string());
-  if (bfs::exists(clpi_file))
-    return clpi_file;
+bfs::path
+mpeg_ts_reader_c::find_clip_info_file() {
+  for (auto const &clpi_file : get_clip_info_file_candidates()) {
+    mxdebug_if(m_debug_clpi, boost::format("mpeg_ts_reader_c::find_clip_info_file: Checking %1%\n") % clpi_file.string());
+
+    if (bfs::exists(clpi_file))
+      return clpi_file;
+  }
 
   mxdebug_if(m_debug_clpi, "mpeg_ts_reader_c::find_clip_info_file: CLPI not found\n");
 
   return bfs::path();
 }
 
+std::vector<bfs::path>
+mpeg_ts_reader_c::get_side_file_names()
+  const {
+  return get_clip_info_file_candidates();
+}
+
 void
 mpeg_ts_reader_c::parse_clip_info_file() {
   bfs::path clpi_file(find_clip_info_file());
@@ -1689,6 +1727,70 @@ mpeg_ts_reader_c::parse_clip_info_file() {
   }
 }
 
+/** \brief Read the next block of packets
+
+   If the block starts with an invalid sync byte then the reader
+   resyncs first. Returns \c false at the end of the file.
+*/
+bool
+mpeg_ts_reader_c::fill_read_buffer() {
+  auto const block_size = TS_READ_BLOCK_PACKETS * m_detected_packet_size;
+
+  if (!m_read_buffer)
+    m_read_buffer = memory_c::alloc(block_size);
+
+  auto buffer = m_read_buffer->get_buffer();
+
+  while (true) {
+    auto file_position = m_read_buffer_file_position + m_read_buffer_position;
+
+    // Continue after the last packet used, which is either the end of
+    // the previous block or a packet with an invalid sync byte. After
+    // resyncing the file pointer is already at the right position.
+    if (!m_read_buffer_valid_size)
+      file_position = m_in->getFilePointer();
+
+    else if (m_in->getFilePointer() != file_position)
+      m_in->setFilePointer(file_position);
+
+    m_read_buffer_file_position = file_position;
+    m_read_buffer_position      = 0;
+    m_read_buffer_valid_size    = 0;
+
+    auto num_packets = m_in->read(buffer, block_size) / m_detected_packet_size;
+    if (!num_packets)
+      return false;
+
+    auto num_valid = 0u;
+    while ((num_valid < num_packets) && (0x47 == buffer[num_valid * m_detected_packet_size]))
+      ++num_valid;
+
+    m_read_buffer_valid_size = num_valid * m_detected_packet_size;
+
+    if (num_valid)
+      return true;
+
+    ++m_num_resyncs;
+
+    if (!resync(file_position))
+      return false;
+  }
+}
+
+/** \brief Determine the file position of a packet
+
+   Packets are either parsed from the read buffer, which is filled a
+   whole block at a time, or have just been read on their own while
+   probing.
+*/
+int64_t
+mpeg_ts_reader_c::get_packet_position(unsigned char const *buf) {
+  if (m_read_buffer && (buf >= m_read_buffer->get_buffer()) && (buf < (m_read_buffer->get_buffer() + m_read_buffer_valid_size)))
+    return m_read_buffer_file_position + (buf - m_read_buffer->get_buffer());
+
+  return m_in->getFilePointer() - m_detected_packet_size;
+}
+
 bool
 mpeg_ts_reader_c::resync(int64_t start_at) {
   try {
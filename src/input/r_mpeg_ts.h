@@ -400,11 +400,24 @@ protected:
 
   std::vector<timecode_c> m_chapter_timecodes;
 
-  debugging_option_c m_dont_use_audio_pts, m_debug_resync, m_debug_pat_pmt, m_debug_headers, m_debug_packet, m_debug_aac, m_debug_timecode_wrapping, m_debug_clpi;
+  debugging_option_c m_dont_use_audio_pts, m_debug_resync, m_debug_pat_pmt, m_debug_headers, m_debug_packet, m_debug_aac, m_debug_timecode_wrapping, m_debug_clpi, m_debug_performance;
 
   unsigned int m_detected_packet_size, m_num_pat_crc_errors, m_num_pmt_crc_errors;
   bool m_validate_pat_crc, m_validate_pmt_crc;
 
+  // Packets are read in blocks. Only the packets before the first one
+  // with an invalid sync byte are used before resyncing.
+  memory_cptr m_read_buffer;
+  size_t m_read_buffer_position, m_read_buffer_valid_size;
+  uint64_t m_read_buffer_file_position;
+
+  // PIDs that belong to tracks with packetizers; all other packets are
+  // skipped without being parsed.
+  std::vector<bool> m_pid_filter;
+
+  uint64_t m_num_packets_read, m_num_packets_skipped, m_num_resyncs;
+  int64_t m_read_start_time;
+
 protected:
   static int potential_packet_sizes[];
 
@@ -420,10 +433,12 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *requested_ptzr, bool force = false);
+  virtual bool is_holding(generic_packetizer_c *requested_ptzr, int64_t num_queued_bytes) const;
   virtual void identify();
   virtual void create_packetizer(int64_t tid);
   virtual void create_packetizers();
   virtual void add_available_track_ids();
+  virtual std::vector<bfs::path> get_side_file_names() const;
 
   virtual bool parse_packet(unsigned char *buf);
 
@@ -449,12 +464,15 @@ private:
   void create_hdmv_pgs_subtitles_packetizer(mpeg_ts_track_ptr &track);
   void create_srt_subtitles_packetizer(mpeg_ts_track_ptr const &track);
 
+  std::vector<bfs::path> get_clip_info_file_candidates() const;
   bfs::path find_clip_info_file();
   void parse_clip_info_file();
 
   void process_chapter_entries();
 
   bool resync(int64_t start_at);
+  bool fill_read_buffer();
+  int64_t get_packet_position(unsigned char const *buf);
 
   uint32_t calculate_crc(void const *buffer, size_t size) const;
 
@@ -48,10 +48,8 @@
 #include "output/p_vorbis.h"
 #include "output/p_vpx.h"
 
-#define BUFFER_SIZE 4096
-
 struct ogm_frame_t {
-  memory_c *mem;
+  memory_cptr mem;
   int64_t duration;
   unsigned char flags;
 };
@@ -294,12 +292,14 @@ ogm_reader_c::probe_file(mm_io_c *in,
 }
 
 /*
-   Opens the file for processing, initializes an ogg_sync_state used for
-   reading from an OGG stream.
+   Opens the file for processing.
 */
 ogm_reader_c::ogm_reader_c(const track_info_c &ti,
                            const mm_io_cptr &in)
   : generic_reader_c(ti, in)
+  , m_block_pos(0)
+  , m_block_fill(0)
+  , m_page_lost(false)
 {
 }
 
@@ -308,8 +308,6 @@ ogm_reader_c::read_headers() {
   if (!ogm_reader_c::probe_file(m_in.get(), m_size))
     throw mtx::input::invalid_format_x();
 
-  ogg_sync_init(&oy);
-
   show_demuxer_info();
 
   if (read_headers_internal() <= 0)
@@ -318,7 +316,6 @@ ogm_reader_c::read_headers() {
 }
 
 ogm_reader_c::~ogm_reader_c() {
-  ogg_sync_clear(&oy);
 }
 
 ogm_demuxer_cptr
@@ -338,37 +335,121 @@ ogm_reader_c::find_demuxer(int serialno) {
 /*
    Reads an OGG page from the stream. Returns 0 if there are no more pages
    left, EMOREDATA otherwise.
+
+   The file is read in large blocks, and the pages are located within
+   them directly instead of being copied into libogg's sync buffer
+   first. The page returned points into the current block. A block is
+   never modified once it has been read so that packets can reference
+   it, too; see ogm_demuxer_c::get_packet_memory().
 */
 int
 ogm_reader_c::read_page(ogg_page *og) {
-  int np, done, nread;
-  unsigned char *buf;
+  while (true) {
+    auto buffer    = m_block ? m_block->get_buffer() : nullptr;
+    auto available = m_block_fill - m_block_pos;
+
+    // Look for the capture pattern. memchr() is vectorized by the
+    // common C libraries.
+    auto start     = 4 <= available ? static_cast<unsigned char *>(memchr(buffer + m_block_pos, 'O', available - 3)) : nullptr;
+    while (start && memcmp(start, "OggS", 4))
+      start = static_cast<unsigned char *>(memchr(start + 1, 'O', buffer + m_block_fill - 4 - start));
+
+    // Keep the last three bytes if the pattern hasn't been found. They
+    // might be the start of the next page.
+    auto page_pos  = start ? static_cast<size_t>(start - buffer) : std::max<size_t>(m_block_fill, 3) - 3;
+    if (page_pos > m_block_pos) {
+      if (!m_page_lost)
+        mxwarn_fn(m_ti.m_fname, Y("Could not find the next Ogg page. This indicates a damaged Ogg/Ogm file. Will try to continue.\n"));
+      m_page_lost  = true;
+      m_block_pos  = page_pos;
+    }
 
-  done = 0;
-  while (!done) {
-    np = ogg_sync_pageseek(&oy, og);
+    available      = m_block_fill - m_block_pos;
+    auto header    = buffer + m_block_pos;
 
-    // np == 0 means that there is not enough data for a complete page.
-    if (0 >= np) {
-      // np < 0 is the error case. Should not happen with local OGG files.
-      if (0 > np)
-        mxwarn_fn(m_ti.m_fname, Y("Could not find the next Ogg page. This indicates a damaged Ogg/Ogm file. Will try to continue.\n"));
+    if (   !start
+        || (27 > available)
+        || (static_cast<size_t>(27 + header[26]) > available)) {
+      if (!read_next_block())
+        return 0;
+      continue;
+    }
+
+    og->header     = header;
+    og->header_len = 27 + header[26];
+    og->body       = header + og->header_len;
+    og->body_len   = 0;
 
-      buf = (unsigned char *)ogg_sync_buffer(&oy, BUFFER_SIZE);
-      if (!buf)
-        mxerror_fn(m_ti.m_fname, Y("ogg_sync_buffer failed\n"));
+    for (auto idx = 0; idx < header[26]; ++idx)
+      og->body_len += header[27 + idx];
 
-      if (0 >= (nread = m_in->read(buf, BUFFER_SIZE)))
+    if (static_cast<size_t>(og->header_len + og->body_len) > available) {
+      if (!read_next_block())
         return 0;
+      continue;
+    }
 
-      ogg_sync_wrote(&oy, nread);
-    } else
-      // Alright, we have a page.
-      done = 1;
+    if ((0 != header[4]) || !is_page_valid(og)) {
+      if (!m_page_lost)
+        mxwarn_fn(m_ti.m_fname, Y("Could not find the next Ogg page. This indicates a damaged Ogg/Ogm file. Will try to continue.\n"));
+      m_page_lost  = true;
+      ++m_block_pos;
+      continue;
+    }
+
+    m_page_lost    = false;
+    m_block_pos   += og->header_len + og->body_len;
+
+    // Here EMOREDATA actually indicates success - a page has been read.
+    return FILE_STATUS_MOREDATA;
   }
+}
 
-  // Here EMOREDATA actually indicates success - a page has been read.
-  return FILE_STATUS_MOREDATA;
+/*
+   Continues reading at the end of the current block. The data not
+   processed yet is copied to the start of a new block; the current
+   block may still be referenced by packets.
+*/
+bool
+ogm_reader_c::read_next_block() {
+  auto remaining = m_block_fill - m_block_pos;
+  auto block     = memory_c::alloc(ms_block_size);
+
+  if (remaining)
+    memcpy(block->get_buffer(), m_block->get_buffer() + m_block_pos, remaining);
+
+  auto num_read  = m_in->read(block->get_buffer() + remaining, ms_block_size - remaining);
+
+  m_block        = block;
+  m_block_pos    = 0;
+  m_block_fill   = remaining + num_read;
+
+  return 0 < num_read;
+}
+
+bool
+ogm_reader_c::is_page_valid(ogg_page const *og) {
+  static unsigned char const s_zero_crc[4] = { 0, 0, 0, 0 };
+
+  // The checksum is calculated with the checksum field set to 0.
+  m_page_crc.set_initial_value(0);
+  m_page_crc
+    .add(og->header,      22)
+    .add(s_zero_crc,      4)
+    .add(og->header + 26, og->header_len - 26)
+    .add(og->body,        og->body_len);
+
+  // Ogg stores the checksum in little endian byte order whereas
+  // crc32_ieee_c returns it byte-swapped.
+  return m_page_crc.get_result_as_uint() == get_uint32_be(og->header + 22);
+}
+
+void
+ogm_reader_c::reset_page_reader() {
+  m_block.reset();
+  m_block_pos  = 0;
+  m_block_fill = 0;
+  m_page_lost  = false;
 }
 
 void
@@ -578,7 +659,9 @@ ogm_reader_c::process_page(ogg_page *og) {
 
   ogg_stream_pagein(&dmx->os, og);
 
+  dmx->set_current_page(og, m_block);
   dmx->process_page(granulepos);
+  dmx->set_current_page(nullptr, memory_cptr{});
 
   dmx->last_granulepos = granulepos;
 }
@@ -641,8 +724,7 @@ ogm_reader_c::read_headers_internal() {
   }
 
   m_in->setFilePointer(0, seek_beginning);
-  ogg_sync_clear(&oy);
-  ogg_sync_init(&oy);
+  reset_page_reader();
 
   return 1;
 }
@@ -650,12 +732,19 @@ ogm_reader_c::read_headers_internal() {
 /*
    General reader. Read a page and hand it over for processing.
 */
-file_status_e
-ogm_reader_c::read(generic_packetizer_c *,
-                   bool) {
+bool
+ogm_reader_c::is_holding(generic_packetizer_c *,
+                         int64_t num_queued_bytes)
+  const {
   // Some tracks may contain huge gaps. We don't want to suck in the complete
   // file.
-  if (get_queued_bytes() > 20 * 1024 * 1024)
+  return num_queued_bytes > 20 * 1024 * 1024;
+}
+
+file_status_e
+ogm_reader_c::read(generic_packetizer_c *requested_ptzr,
+                   bool force) {
+  if (!force && is_holding(requested_ptzr, get_queued_bytes()))
     return FILE_STATUS_HOLDING;
 
   ogg_page og;
@@ -878,6 +967,8 @@ ogm_demuxer_c::ogm_demuxer_c(ogm_reader_c *p_reader)
   , in_use(false)
   , display_width(0)
   , display_height(0)
+  , m_page(nullptr)
+  , m_page_packets_start(0)
 {
   memset(&os, 0, sizeof(ogg_stream_state));
 }
@@ -904,6 +995,60 @@ ogm_demuxer_c::get_duration_and_len(ogg_packet &op,
     duration = 0;
 }
 
+/*
+   Remembers the page that has just been handed over to libogg. libogg
+   copies the page's data into its own buffer, and the packets it
+   returns point into that buffer. Packets that have been read from the
+   current page entirely can be mapped back to it though.
+*/
+void
+ogm_demuxer_c::set_current_page(ogg_page *og,
+                                memory_cptr const &buffer) {
+  m_page               = og;
+  m_page_buffer        = buffer;
+  m_page_packets_start = 0;
+
+  if (!og || !ogg_page_continued(og))
+    return;
+
+  // The first packet on a continued page starts after the end of the
+  // packet continued from the previous page.
+  for (auto idx = 0; idx < og->header[26]; ++idx) {
+    m_page_packets_start += og->header[27 + idx];
+    if (255 > og->header[27 + idx])
+      break;
+  }
+}
+
+/*
+   Returns the packet's data starting at \c offset. If the packet has
+   been read from the current page entirely then the memory references
+   the block the page was read from, and the data isn't copied when
+   it's queued by the packetizers. Otherwise, or if the packet is much
+   smaller than a block, it references libogg's buffer and is copied
+   later on.
+
+   libogg appends each page's data to the end of its buffer. The data
+   of the current page therefore ends at os.body_fill; only its start
+   may have been skipped if a continued packet couldn't be assembled.
+*/
+memory_cptr
+ogm_demuxer_c::get_packet_memory(ogg_packet const &op,
+                                 size_t offset) {
+  auto packet = op.packet + offset;
+  auto size   = op.bytes  - offset;
+
+  if (m_page && m_page_buffer && (size >= ms_min_mapped_packet_size)) {
+    auto page_end  = os.body_data + os.body_fill;
+    auto page_body = page_end - m_page->body_len;
+
+    if ((op.packet >= (page_body + m_page_packets_start)) && ((op.packet + op.bytes) <= page_end))
+      return memory_c::view(m_page->body + (packet - page_body), size, m_page_buffer);
+  }
+
+  return std::make_shared<memory_c>(packet, size, false);
+}
+
 void
 ogm_demuxer_c::process_page(int64_t /* granulepos */) {
   ogg_packet op;
@@ -918,8 +1063,7 @@ ogm_demuxer_c::process_page(int64_t /* granulepos */) {
     int duration_len;
     get_duration_and_len(op, duration, duration_len);
 
-    memory_c *mem = new memory_c(&op.packet[duration_len + 1], op.bytes - 1 - duration_len, false);
-    reader->m_reader_packetizers[ptzr]->process(new packet_t(mem));
+    reader->m_reader_packetizers[ptzr]->process(new packet_t(get_packet_memory(op, duration_len + 1)));
     units_processed += op.bytes - 1;
   }
 }
@@ -1081,7 +1225,7 @@ ogm_a_vorbis_demuxer_c::process_page(int64_t /* granulepos */) {
     if (((*op.packet & 3) == PACKET_TYPE_HEADER) || ((*op.packet & 3) == PACKET_TYPE_COMMENT))
       continue;
 
-    reader->m_reader_packetizers[ptzr]->process(new packet_t(new memory_c(op.packet, op.bytes, false)));
+    reader->m_reader_packetizers[ptzr]->process(new packet_t(get_packet_memory(op)));
   }
 }
 
@@ -1117,7 +1261,7 @@ ogm_a_opus_demuxer_c::process_page(int64_t granulepos) {
     if ((4 <= op.bytes) && !memcmp(op.packet, "Opus", 4))
       continue;
 
-    auto packet                = std::make_shared<packet_t>(memory_c::clone(op.packet, op.bytes));
+    auto packet                = std::make_shared<packet_t>(get_packet_memory(op));
     auto toc                   = mtx::opus::toc_t::decode(packet->data);
     m_calculated_end_timecode += toc.packet_duration;
 
@@ -1166,8 +1310,7 @@ ogm_s_text_demuxer_c::process_page(int64_t granulepos) {
     get_duration_and_len(op, duration, duration_len);
 
     if (((op.bytes - 1 - duration_len) > 2) || ((op.packet[duration_len + 1] != ' ') && (op.packet[duration_len + 1] != 0) && !iscr(op.packet[duration_len + 1]))) {
-      memory_c *mem = new memory_c(&op.packet[duration_len + 1], op.bytes - 1 - duration_len, false);
-      reader->m_reader_packetizers[ptzr]->process(new packet_t(mem, granulepos * 1000000, (int64_t)duration * 1000000));
+      reader->m_reader_packetizers[ptzr]->process(new packet_t(get_packet_memory(op, duration_len + 1), granulepos * 1000000, (int64_t)duration * 1000000));
     }
   }
 }
@@ -1276,7 +1419,7 @@ ogm_v_mscomp_demuxer_c::process_page(int64_t granulepos) {
       duration = 1;
 
     ogm_frame_t frame = {
-      new memory_c(&op.packet[duration_len + 1], op.bytes - 1 - duration_len, false),
+      get_packet_memory(op, duration_len + 1),
       duration * default_duration,
       op.packet[0],
     };
@@ -1360,7 +1503,7 @@ ogm_v_theora_demuxer_c::process_page(int64_t granulepos) {
 
     ++units_processed;
 
-    reader->m_reader_packetizers[ptzr]->process(new packet_t(new memory_c(op.packet, op.bytes, false), timecode, duration, bref, VFT_NOBFRAME));
+    reader->m_reader_packetizers[ptzr]->process(new packet_t(get_packet_memory(op), timecode, duration, bref, VFT_NOBFRAME));
 
     mxverb(3,
            boost::format("Theora track %1% kfgshift %2% granulepos 0x%|3$08x| %|4$08x|%5%\n")
@@ -1462,7 +1605,7 @@ ogm_v_vp8_demuxer_c::process_page(int64_t granulepos) {
     ++units_processed;
     ++frames_since_granulepos_change;
 
-    reader->m_reader_packetizers[ptzr]->process(new packet_t(new memory_c(op.packet, op.bytes, false), timecode, default_duration, bref, VFT_NOBFRAME));
+    reader->m_reader_packetizers[ptzr]->process(new packet_t(get_packet_memory(op), timecode, default_duration, bref, VFT_NOBFRAME));
 
     mxverb(3,
            boost::format("VP8 track %1% size %10% #proc %11% frame# %12% fr_num %2% fr_den %3% granulepos 0x%|4$08x| %|5$08x| pts %6% inv_count %7% distance %8%%9%\n")
@@ -1514,7 +1657,7 @@ ogm_s_kate_demuxer_c::process_page(int64_t /* granulepos */) {
     if ((0 == op.bytes) || (0 != (op.packet[0] & 0x80)))
       continue;
 
-    reader->m_reader_packetizers[ptzr]->process(new packet_t(new memory_c(op.packet, op.bytes, false)));
+    reader->m_reader_packetizers[ptzr]->process(new packet_t(get_packet_memory(op)));
 
     ++units_processed;
 
@@ -18,6 +18,7 @@
 
 #include <ogg/ogg.h>
 
+#include "common/checksums/crc.h"
 #include "common/codec.h"
 #include "common/mm_io.h"
 #include "merge/generic_reader.h"
@@ -28,6 +29,10 @@ class ogm_reader_c;
 
 class ogm_demuxer_c {
 public:
+  // Smaller packets are not mapped back to the block their page was
+  // read from so that they don't keep a whole block alive.
+  static size_t const ms_min_mapped_packet_size = 16 * 1024;
+
   ogm_reader_c *reader;
   track_info_c &m_ti;
 
@@ -47,6 +52,10 @@ public:
 
   int display_width, display_height;
 
+  ogg_page *m_page;
+  memory_cptr m_page_buffer;
+  int m_page_packets_start;
+
 public:
   ogm_demuxer_c(ogm_reader_c *p_reader);
 
@@ -67,6 +76,9 @@ public:
   virtual void process_page(int64_t granulepos);
   virtual void process_header_page();
 
+  virtual void set_current_page(ogg_page *og, memory_cptr const &buffer);
+  virtual memory_cptr get_packet_memory(ogg_packet const &op, size_t offset = 0);
+
   virtual void get_duration_and_len(ogg_packet &op, int64_t &duration, int &duration_len);
   virtual bool is_header_packet(ogg_packet &op) {
     return op.packet[0] & 1;
@@ -76,11 +88,18 @@ public:
 using ogm_demuxer_cptr = std::shared_ptr<ogm_demuxer_c>;
 
 class ogm_reader_c: public generic_reader_c {
-private:
-  ogg_sync_state oy;
+protected:
+  // Must be larger than the largest possible page (65307 bytes).
+  static size_t const ms_block_size = 256 * 1024;
+
   std::vector<ogm_demuxer_cptr> sdemuxers;
   int bos_pages_read;
 
+  memory_cptr m_block;
+  size_t m_block_pos, m_block_fill;
+  bool m_page_lost;
+  mtx::checksum::crc32_ieee_c m_page_crc;
+
 public:
   ogm_reader_c(const track_info_c &ti, const mm_io_cptr &in);
   virtual ~ogm_reader_c();
@@ -91,6 +110,7 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false);
+  virtual bool is_holding(generic_packetizer_c *requested_ptzr, int64_t num_queued_bytes) const;
   virtual void identify();
   virtual void create_packetizers();
   virtual void create_packetizer(int64_t tid);
@@ -98,9 +118,12 @@ public:
 
   static int probe_file(mm_io_c *in, uint64_t size);
 
-private:
+protected:
   virtual ogm_demuxer_cptr find_demuxer(int serialno);
   virtual int read_page(ogg_page *);
+  virtual bool read_next_block();
+  virtual bool is_page_valid(ogg_page const *og);
+  virtual void reset_page_reader();
   virtual void handle_new_stream(ogg_page *);
   virtual void handle_new_stream_and_packets(ogg_page *);
   virtual void process_page(ogg_page *);
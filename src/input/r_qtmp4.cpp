@@ -53,6 +53,7 @@
 using namespace libmatroska;
 
 #define MAX_INTERLEAVING_BADNESS 0.4
+#define QTMP4_INDEX_WINDOW_SIZE  8192
 
 static std::string
 space(int num) {
@@ -150,6 +151,10 @@ qtmp4_reader_c::read_headers() {
 
     parse_headers();
 
+    // Chunks of different tracks are read in an order unrelated to their
+    // position in the file if there's more than one track.
+    m_in->set_access_pattern(1 < m_demuxers.size() ? mm_io_c::access_random : mm_io_c::access_sequential);
+
   } catch (mtx::mm_io::exception &) {
     throw mtx::input::open_x();
   }
@@ -1368,7 +1373,7 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
     if ((-1 == dmx->ptzr) || (PTZR(dmx->ptzr) != ptzr))
       continue;
 
-    if (dmx->pos < dmx->m_index.size())
+    if (dmx->pos < dmx->m_num_index_entries)
       break;
   }
 
@@ -1376,7 +1381,7 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
     return flush_packetizers();
 
   qtmp4_demuxer_cptr &dmx = m_demuxers[dmx_idx];
-  qt_index_t &index       = dmx->m_index[dmx->pos];
+  auto index              = dmx->get_index_entry(dmx->pos);
 
   m_in->setFilePointer(index.file_pos);
 
@@ -1393,20 +1398,27 @@ qtmp4_reader_c::read(generic_packetizer_c *ptzr,
 
     memcpy(buffer->get_buffer(), dmx->esds.decoder_config->get_buffer(), dmx->esds.decoder_config->get_size());
 
+    if (m_in->read(buffer->get_buffer() + buffer_offset, index.size) != index.size)
+      buffer.reset();
+
   } else {
-    buffer = memory_c::alloc(index.size);
+    // Let the input decide whether or not the data has to be copied.
+    try {
+      buffer = m_in->read(index.size);
+    } catch (mtx::mm_io::end_of_file_x &) {
+    }
   }
 
-  if (m_in->read(buffer->get_buffer() + buffer_offset, index.size) != index.size) {
+  if (!buffer) {
     mxwarn(boost::format(Y("Quicktime/MP4 reader: Could not read chunk number %1%/%2% with size %3% from position %4%. Aborting.\n"))
-           % dmx->pos % dmx->m_index.size() % index.size % index.file_pos);
+           % dmx->pos % dmx->m_num_index_entries % index.size % index.file_pos);
     return flush_packetizers();
   }
 
   PTZR(dmx->ptzr)->process(new packet_t(buffer, index.timecode, index.duration, index.is_keyframe ? VFT_IFRAME : VFT_PFRAMEAUTOMATIC, VFT_NOBFRAME));
   ++dmx->pos;
 
-  if (dmx->pos < dmx->m_index.size())
+  if (dmx->pos < dmx->m_num_index_entries)
     return FILE_STATUS_MOREDATA;
 
   return flush_packetizers();
@@ -1735,9 +1747,8 @@ qtmp4_reader_c::get_progress() {
     return 100;
 
   qtmp4_demuxer_cptr &dmx = m_demuxers[m_main_dmx];
-  unsigned int max_chunks = (0 == dmx->sample_size) ? dmx->sample_table.size() : dmx->chunk_table.size();
 
-  return 100 * dmx->pos / max_chunks;
+  return 0 == dmx->m_num_index_entries ? 100 : 100 * dmx->pos / dmx->m_num_index_entries;
 }
 
 void
@@ -1896,76 +1907,70 @@ qtmp4_demuxer_c::to_nsecs(int64_t value) {
 
 void
 qtmp4_demuxer_c::calculate_timecodes_constant_sample_size() {
-  auto frame = 0u;
-  for (auto &chunk : chunk_table) {
-    timecodes.push_back(to_nsecs(static_cast<uint64_t>(chunk.samples) * duration) + constant_editlist_offset_ns);
-    durations.push_back(to_nsecs(static_cast<uint64_t>(chunk.size)    * duration));
-    frame_indices.push_back(frame++);
+  for (auto frame = 0u; frame < m_num_index_entries; ++frame) {
+    auto timecode  = to_nsecs(static_cast<uint64_t>(chunk_table[frame].samples) * duration) + constant_editlist_offset_ns;
+    m_min_timecode = !frame ? timecode : std::min(m_min_timecode, timecode);
   }
 }
 
-void
-qtmp4_demuxer_c::calculate_timecodes_variable_sample_size() {
+qt_frame_timecode_t
+qtmp4_demuxer_c::calculate_frame_timecode_variable_sample_size(size_t frame) {
   auto const num_edits         = editlist_table.size();
   auto const num_frame_offsets = frame_offset_table.size();
   bool is_avc                  = codec.is(codec_c::type_e::V_MPEG4_P10);
   bool is_hevc                 = codec.is(codec_c::type_e::V_MPEGH_P2);
   int64_t v_dts_offset         = (is_avc || is_hevc) && num_frame_offsets ? to_nsecs(frame_offset_table[0]) : 0;
+  int64_t pts_offset           = 0;
+  auto real_frame              = frame;
 
-  std::vector<int64_t> timecodes_before_offsets;
-
-  for (unsigned int frame = 0, num_samples = sample_table.size(); num_samples > frame; ++frame) {
-    int64_t pts_offset = 0;
-    auto real_frame    = frame;
+  if (0 < num_edits) {
+    auto editlist_pos = 0u;
 
-    if (0 < num_edits) {
-      auto editlist_pos = 0u;
+    while (((num_edits - 1) > editlist_pos) && (static_cast<int64_t>(frame) >= editlist_table[editlist_pos + 1].start_frame))
+      ++editlist_pos;
 
-      while (((num_edits - 1) > editlist_pos) && (frame >= editlist_table[editlist_pos + 1].start_frame))
-        ++editlist_pos;
-
-      auto &edit = editlist_table[editlist_pos];
-      if ((edit.start_frame + edit.frames) > frame) {
-        // calc real frame index & assign pts_offset:
-        real_frame = real_frame - edit.start_frame + edit.start_sample;
-        pts_offset = edit.pts_offset;
-      }
+    auto &edit = editlist_table[editlist_pos];
+    if ((edit.start_frame + edit.frames) > static_cast<int64_t>(frame)) {
+      // calc real frame index & assign pts_offset:
+      real_frame = real_frame - edit.start_frame + edit.start_sample;
+      pts_offset = edit.pts_offset;
     }
+  }
 
-    int64_t timecode = to_nsecs(sample_table[real_frame].pts + pts_offset);
+  qt_frame_timecode_t result;
 
-    frame_indices.push_back(real_frame);
+  result.real_frame              = real_frame;
+  result.timecode_before_offsets = to_nsecs(sample_table[real_frame].pts + pts_offset);
+  result.timecode                = result.timecode_before_offsets;
 
-    timecodes_before_offsets.push_back(timecode);
+  if ((is_avc || is_hevc) && (num_frame_offsets > real_frame))
+     result.timecode += to_nsecs(frame_offset_table[real_frame]) - v_dts_offset;
 
-    if ((is_avc || is_hevc) && (num_frame_offsets > real_frame))
-       timecode += to_nsecs(frame_offset_table[real_frame]) - v_dts_offset;
+  result.timecode += constant_editlist_offset_ns;
 
-    timecodes.push_back(timecode + constant_editlist_offset_ns);
-  }
+  return result;
+}
 
-  int64_t avg_duration = 0, num_good_frames = 0;
+void
+qtmp4_demuxer_c::calculate_timecodes_variable_sample_size() {
+  int64_t total_duration = 0, num_good_frames = 0, previous_timecode = 0;
 
-  for (unsigned int frame = 0, num_timecodes_before_offsets = timecodes_before_offsets.size(); num_timecodes_before_offsets > (frame + 1); ++frame) {
-    int64_t diff = timecodes_before_offsets[frame + 1] - timecodes_before_offsets[frame];
+  for (auto frame = 0u; frame < m_num_index_entries; ++frame) {
+    auto frame_timecode = calculate_frame_timecode_variable_sample_size(frame);
+    m_min_timecode      = !frame ? frame_timecode.timecode : std::min(m_min_timecode, frame_timecode.timecode);
 
-    if (0 >= diff)
-      durations.push_back(0);
-    else {
-      ++num_good_frames;
-      avg_duration += diff;
-      durations.push_back(diff);
+    if (frame) {
+      auto diff = frame_timecode.timecode_before_offsets - previous_timecode;
+      if (0 < diff) {
+        ++num_good_frames;
+        total_duration += diff;
+      }
     }
-  }
-
-  durations.push_back(0);
 
-  if (num_good_frames) {
-    avg_duration /= num_good_frames;
-    for (auto &duration : durations)
-      if (!duration)
-        duration = avg_duration;
+    previous_timecode = frame_timecode.timecode_before_offsets;
   }
+
+  m_avg_duration = num_good_frames ? total_duration / num_good_frames : 0;
 }
 
 void
@@ -1973,20 +1978,19 @@ qtmp4_demuxer_c::calculate_timecodes() {
   if (m_timecodes_calculated)
     return;
 
+  m_num_index_entries = 0 != sample_size ? chunk_table.size() : sample_table.size();
+
   if (0 != sample_size)
     calculate_timecodes_constant_sample_size();
   else
     calculate_timecodes_variable_sample_size();
 
-  build_index();
-
   m_timecodes_calculated = true;
 }
 
 void
 qtmp4_demuxer_c::adjust_timecodes(int64_t delta) {
-  for (auto &timecode : timecodes)
-    timecode += delta;
+  m_timecode_adjustment += delta;
 
   for (auto &index : m_index)
     index.timecode += delta;
@@ -1995,7 +1999,7 @@ qtmp4_demuxer_c::adjust_timecodes(int64_t delta) {
 int64_t
 qtmp4_demuxer_c::min_timecode()
   const {
-  return timecodes.empty() ? 0 : *brng::min_element(timecodes);
+  return m_num_index_entries ? m_min_timecode + m_timecode_adjustment : 0;
 }
 
 bool
@@ -2186,70 +2190,92 @@ qtmp4_demuxer_c::update_editlist_table() {
   }
 }
 
-void
-qtmp4_demuxer_c::build_index() {
-  if (sample_size != 0)
-    build_index_constant_sample_size_mode();
-  else
-    build_index_chunk_mode();
+/** \brief Return an entry of the track's index
+
+   The index is created from the sample tables in windows of
+   QTMP4_INDEX_WINDOW_SIZE entries. Only the current window is kept in
+   memory so that the memory usage doesn't grow with the file's length.
+*/
+qt_index_t
+qtmp4_demuxer_c::get_index_entry(size_t idx) {
+  if ((idx < m_index_window_start) || (idx >= (m_index_window_start + m_index.size())))
+    fill_index_window(idx);
+
+  return m_index[idx - m_index_window_start];
 }
 
 void
-qtmp4_demuxer_c::build_index_constant_sample_size_mode() {
-  size_t keyframe_table_idx  = 0;
-  size_t keyframe_table_size = keyframe_table.size();
+qtmp4_demuxer_c::fill_index_window(size_t start) {
+  auto end = std::min<size_t>(start + QTMP4_INDEX_WINDOW_SIZE, m_num_index_entries);
 
-  size_t frame_idx;
-  for (frame_idx = 0; frame_idx < chunk_table.size(); ++frame_idx) {
-    uint64_t frame_size;
+  mxdebug_if(m_debug_tables, boost::format("Track ID %1%: creating index window for entries %2%–%3% of %4%\n") % id % start % end % m_num_index_entries);
 
-    if (1 != sample_size) {
-      frame_size = chunk_table[frame_idx].size * sample_size;
+  m_index.clear();
+  m_index.reserve(end - start);
+  m_index_window_start = start;
 
-    } else {
-      frame_size = chunk_table[frame_idx].size;
-
-      if ('a' == type) {
-        auto sound_stsd_atom = reinterpret_cast<sound_v1_stsd_atom_t *>(stsd->get_buffer());
-        if (get_uint16_be(&sound_stsd_atom->v0.version) == 1) {
-          frame_size *= get_uint32_be(&sound_stsd_atom->v1.bytes_per_frame);
-          frame_size /= get_uint32_be(&sound_stsd_atom->v1.samples_per_packet);
-        } else
-          frame_size  = frame_size * a_channels * get_uint16_be(&sound_stsd_atom->v0.sample_size) / 8;
-      }
-    }
+  if (sample_size != 0) {
+    for (auto frame_idx = start; frame_idx < end; ++frame_idx)
+      m_index.push_back(create_index_entry_constant_sample_size_mode(frame_idx));
+
+    return;
+  }
+
+  // The duration of a frame is the difference to the next frame's
+  // timecode, therefore one frame beyond the window is calculated.
+  auto current = start < end ? calculate_frame_timecode_variable_sample_size(start) : qt_frame_timecode_t{};
+
+  for (auto frame_idx = start; frame_idx < end; ++frame_idx) {
+    auto next           = qt_frame_timecode_t{};
+    auto frame_duration = m_avg_duration;
+
+    if ((frame_idx + 1) < m_num_index_entries) {
+      next      = calculate_frame_timecode_variable_sample_size(frame_idx + 1);
+      auto diff = next.timecode_before_offsets - current.timecode_before_offsets;
 
-    bool is_keyframe = false;
-    if (keyframe_table.empty())
-      is_keyframe = true;
-    else if ((keyframe_table_idx < keyframe_table_size) && ((frame_idx + 1) == keyframe_table[keyframe_table_idx])) {
-      is_keyframe = true;
-      ++keyframe_table_idx;
+      if (0 < diff)
+        frame_duration = diff;
     }
 
-    m_index.push_back(qt_index_t(chunk_table[frame_idx].pos, frame_size, timecodes[frame_idx], durations[frame_idx], is_keyframe));
+    auto &sample = sample_table[current.real_frame];
+    m_index.push_back(qt_index_t(sample.pos, sample.size, current.timecode + m_timecode_adjustment, frame_duration, is_keyframe(frame_idx)));
+
+    current = next;
   }
 }
 
-void
-qtmp4_demuxer_c::build_index_chunk_mode() {
-  size_t keyframe_table_idx  = 0;
-  size_t keyframe_table_size = keyframe_table.size();
+qt_index_t
+qtmp4_demuxer_c::create_index_entry_constant_sample_size_mode(size_t frame_idx) {
+  auto &chunk = chunk_table[frame_idx];
+  uint64_t frame_size;
 
-  size_t frame_idx;
-  for (frame_idx = 0; frame_idx < frame_indices.size(); ++frame_idx) {
-    int act_frame_idx = frame_indices[frame_idx];
+  if (1 != sample_size) {
+    frame_size = chunk.size * sample_size;
 
-    bool is_keyframe  = false;
-    if (keyframe_table.empty())
-      is_keyframe = true;
-    else if ((keyframe_table_idx < keyframe_table_size) && ((frame_idx + 1) == keyframe_table[keyframe_table_idx])) {
-      is_keyframe = true;
-      ++keyframe_table_idx;
+  } else {
+    frame_size = chunk.size;
+
+    if ('a' == type) {
+      auto sound_stsd_atom = reinterpret_cast<sound_v1_stsd_atom_t *>(stsd->get_buffer());
+      if (get_uint16_be(&sound_stsd_atom->v0.version) == 1) {
+        frame_size *= get_uint32_be(&sound_stsd_atom->v1.bytes_per_frame);
+        frame_size /= get_uint32_be(&sound_stsd_atom->v1.samples_per_packet);
+      } else
+        frame_size  = frame_size * a_channels * get_uint16_be(&sound_stsd_atom->v0.sample_size) / 8;
     }
-
-    m_index.push_back(qt_index_t(sample_table[act_frame_idx].pos, sample_table[act_frame_idx].size, timecodes[frame_idx], durations[frame_idx], is_keyframe));
   }
+
+  auto timecode       = to_nsecs(static_cast<uint64_t>(chunk.samples) * duration) + constant_editlist_offset_ns + m_timecode_adjustment;
+  auto frame_duration = to_nsecs(static_cast<uint64_t>(chunk.size)    * duration);
+
+  return qt_index_t(chunk.pos, frame_size, timecode, frame_duration, is_keyframe(frame_idx));
+}
+
+bool
+qtmp4_demuxer_c::is_keyframe(size_t frame_idx)
+  const {
+  // The keyframe table is sorted and contains one-based frame numbers.
+  return keyframe_table.empty() || brng::binary_search(keyframe_table, static_cast<uint32_t>(frame_idx + 1));
 }
 
 memory_cptr
@@ -2263,8 +2289,8 @@ qtmp4_demuxer_c::read_first_bytes(int num_bytes) {
   size_t buf_pos = 0;
   size_t idx_pos = 0;
 
-  while ((0 < num_bytes) && (idx_pos < m_index.size())) {
-    qt_index_t &index          = m_index[idx_pos];
+  while ((0 < num_bytes) && (idx_pos < m_num_index_entries)) {
+    auto index                 = get_index_entry(idx_pos);
     uint64_t num_bytes_to_read = std::min((int64_t)num_bytes, index.size);
 
     m_reader.m_in->setFilePointer(index.file_pos);
@@ -179,6 +179,18 @@ struct qt_index_t {
   }
 };
 
+struct qt_frame_timecode_t {
+  size_t real_frame;
+  int64_t timecode_before_offsets, timecode;
+
+  qt_frame_timecode_t()
+    : real_frame{}
+    , timecode_before_offsets{}
+    , timecode{}
+  {
+  }
+};
+
 struct qt_track_defaults_t {
   unsigned int sample_description_id, sample_duration, sample_size, sample_flags;
 
@@ -234,9 +246,12 @@ struct qtmp4_demuxer_c {
   std::vector<qt_frame_offset_t> raw_frame_offset_table;
   std::vector<int32_t> frame_offset_table;
 
-  std::vector<int64_t> timecodes, durations, frame_indices;
-
+  // Only a window of the index is kept in memory. It is re-created
+  // from the sample tables whenever an entry outside of it is needed.
   std::vector<qt_index_t> m_index;
+  size_t m_index_window_start{}, m_num_index_entries{};
+  int64_t m_min_timecode{}, m_timecode_adjustment{}, m_avg_duration{};
+
   std::vector<qt_fragment_t> m_fragments;
 
   double fps;
@@ -312,7 +327,7 @@ struct qtmp4_demuxer_c {
   bool update_tables();
   void update_editlist_table();
 
-  void build_index();
+  qt_index_t get_index_entry(size_t idx);
 
   memory_cptr read_first_bytes(int num_bytes);
 
@@ -351,11 +366,13 @@ struct qtmp4_demuxer_c {
   void determine_codec();
 
 private:
-  void build_index_chunk_mode();
-  void build_index_constant_sample_size_mode();
+  void fill_index_window(size_t start);
+  qt_index_t create_index_entry_constant_sample_size_mode(size_t frame_idx);
+  bool is_keyframe(size_t frame_idx) const;
 
   void calculate_timecodes_constant_sample_size();
   void calculate_timecodes_variable_sample_size();
+  qt_frame_timecode_t calculate_frame_timecode_variable_sample_size(size_t frame);
 
   bool parse_esds_atom(mm_mem_io_c &memio, int level);
   uint32_t read_esds_descr_len(mm_mem_io_c &memio);
@@ -446,6 +463,9 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false);
+  virtual bool supports_pipelined_reading() const {
+    return false;
+  }
   virtual int get_progress();
   virtual void identify();
   virtual void create_packetizers();
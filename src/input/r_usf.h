@@ -72,6 +72,9 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false);
+  virtual bool supports_pipelined_reading() const {
+    return false;
+  }
   virtual void identify();
   virtual void create_packetizer(int64_t tid);
   virtual void create_packetizers();
@@ -69,6 +69,23 @@ vobsub_reader_c::vobsub_reader_c(const track_info_c &ti,
 {
 }
 
+std::string
+vobsub_reader_c::get_sub_file_name()
+  const {
+  std::string sub_name = m_ti.m_fname;
+  size_t len           = sub_name.rfind(".");
+  if (std::string::npos != len)
+    sub_name.erase(len);
+
+  return sub_name + ".sub";
+}
+
+std::vector<bfs::path>
+vobsub_reader_c::get_side_file_names()
+  const {
+  return std::vector<bfs::path>{ bfs::path{get_sub_file_name()} };
+}
+
 void
 vobsub_reader_c::read_headers() {
   try {
@@ -77,20 +94,14 @@ vobsub_reader_c::read_headers() {
     throw mtx::input::open_x();
   }
 
-  std::string sub_name = m_ti.m_fname;
-  size_t len           = sub_name.rfind(".");
-  if (std::string::npos != len)
-    sub_name.erase(len);
-  sub_name += ".sub";
-
   try {
-    m_sub_file = mm_file_io_cptr(new mm_file_io_c(sub_name));
+    m_sub_file = mm_file_io_cptr(new mm_file_io_c(get_sub_file_name()));
   } catch (...) {
     throw mtx::input::extended_x(boost::format(Y("%1%: Could not open the sub file")) % get_format_name());
   }
 
   idx_data = "";
-  len      = id_string.length();
+  auto len = id_string.length();
 
   std::string line;
   if (!m_idx_file->getline2(line) || !balg::istarts_with(line, id_string) || (line.length() < (len + 1)))
@@ -75,10 +75,14 @@ public:
 
   virtual void read_headers();
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false);
+  virtual bool supports_pipelined_reading() const {
+    return false;
+  }
   virtual void identify();
   virtual void create_packetizers();
   virtual void create_packetizer(int64_t tid);
   virtual void add_available_track_ids();
+  virtual std::vector<bfs::path> get_side_file_names() const;
   virtual int get_progress();
   virtual bool is_simple_subtitle_container() {
     return true;
@@ -88,6 +92,7 @@ public:
 
 protected:
   virtual void parse_headers();
+  std::string get_sub_file_name() const;
   virtual file_status_e flush_packetizers();
   virtual int deliver_packet(unsigned char *buf, int size, int64_t timecode, int64_t default_duration, generic_packetizer_c *ptzr);
 
@@ -18,6 +18,7 @@
 #include "common/ebml.h"
 #include "common/hacks.h"
 #include "common/math.h"
+#include "common/profiling.h"
 #include "common/strings/formatting.h"
 #include "common/tags/tags.h"
 #include "merge/cluster_helper.h"
@@ -123,6 +124,28 @@ cluster_helper_c::discarding()
   return splitting() && m->discarding;
 }
 
+/** \brief Start of the first part kept in 'parts:' splitting mode
+
+   Everything before this timecode is discarded, and the first part is
+   written to a new file so that nothing from the discarded range ends up
+   in the output.
+
+   \return The timecode or -1 if not splitting by parts or if the first
+     part starts at the beginning.
+*/
+int64_t
+cluster_helper_c::get_first_part_start()
+  const {
+  if (   !discarding()
+      || (split_point_c::parts    != m->split_points.front().m_type)
+      || (m->split_points.end()   == m->current_split_point)
+      || m->current_split_point->m_discard
+      || !m->current_split_point->m_create_new_file)
+    return -1;
+
+  return m->current_split_point->m_point;
+}
+
 bool
 cluster_helper_c::is_splitting_and_processed_fully()
   const {
@@ -329,10 +352,21 @@ cluster_helper_c::set_output(mm_io_c *out) {
 
 void
 cluster_helper_c::set_duration(render_groups_c *rg) {
+  auto block_duration = calculate_block_duration(rg);
+  if (-1 != block_duration)
+    rg->m_groups.back()->set_block_duration(block_duration);
+}
+
+/** \brief The duration to store in a render group's last block
+
+   \return The duration rounded to the timecode scale or -1 if the
+     block doesn't need a duration.
+*/
+int64_t
+cluster_helper_c::calculate_block_duration(render_groups_c *rg) {
   if (rg->m_durations.empty())
-    return;
+    return -1;
 
-  kax_block_blob_c *group = rg->m_groups.back().get();
   int64_t def_duration    = rg->m_source->get_track_default_duration();
   int64_t block_duration  = 0;
 
@@ -347,13 +381,15 @@ cluster_helper_c::set_duration(render_groups_c *rg) {
     if (   (0 == block_duration)
         || (   (0 < block_duration)
             && (block_duration != (static_cast<int64_t>(rg->m_durations.size()) * def_duration))))
-      group->set_block_duration(RND_TIMECODE_SCALE(block_duration));
+      return RND_TIMECODE_SCALE(block_duration);
 
   } else if (   (   g_use_durations
                  || (0 < def_duration))
              && (0 < block_duration)
              && (RND_TIMECODE_SCALE(block_duration) != RND_TIMECODE_SCALE(rg->m_durations.size() * def_duration)))
-    group->set_block_duration(RND_TIMECODE_SCALE(block_duration));
+    return RND_TIMECODE_SCALE(block_duration);
+
+  return -1;
 }
 
 bool
@@ -391,6 +427,11 @@ cluster_helper_c::must_duration_be_set(render_groups_c *rg,
 
 int
 cluster_helper_c::render() {
+  profiling_timer_c timer{profiling_c::stage_rendering, 0, m->packets.size()};
+
+  if (can_render_directly())
+    return render_directly();
+
   std::vector<render_groups_cptr> render_groups;
   KaxCues cues;
   cues.SetGlobalTimecodeScale(g_timecode_scale);
@@ -405,6 +446,14 @@ cluster_helper_c::render() {
   int elements_in_cluster = 0;
   bool added_to_cues      = false;
 
+  // The positions of the blocks are only known once the cluster has
+  // been rendered. Remember the blobs in the order they're created
+  // so that the positions can be handed to the cues afterwards.
+  auto record_block_positions = g_write_cues && cues_c::get().needs_block_positions();
+  std::vector<std::pair<id_timecode_t, kax_block_blob_c *> > block_blobs;
+  if (record_block_positions)
+    block_blobs.reserve(m->packets.size());
+
   // Splitpoint stuff
   if ((-1 == m->header_overhead) && splitting())
     m->header_overhead = m->out->getFilePointer() + g_tags_size;
@@ -477,6 +526,9 @@ cluster_helper_c::render() {
       m->cluster->AddBlockBlob(new_block_group);
       new_block_group->SetParent(*m->cluster);
 
+      if (record_block_positions)
+        block_blobs.push_back({ id_timecode_t{ source->get_track_num(), pack->assigned_timecode - timecode_offset }, new_block_group });
+
       added_to_cues = false;
     }
 
@@ -565,6 +617,9 @@ cluster_helper_c::render() {
 
       m->previous_cluster_tc = m->cluster->GlobalTimecode();
 
+      for (auto const &block_blob : block_blobs)
+        cues_c::get().set_block_position_for_id_timecode(block_blob.first.first, block_blob.first.second, block_blob.second->get_element_position());
+
       cues_c::get().postprocess_cues(cues, *m->cluster);
 
     } else
@@ -579,6 +634,455 @@ cluster_helper_c::render() {
   return 1;
 }
 
+namespace {
+
+// The following functions produce exactly the same bytes that
+// libebml and libmatroska render for the elements of a cluster.
+
+unsigned int
+calculate_uint_size(uint64_t value) {
+  auto size = 1u;
+  while ((8 > size) && (value >> (size * 8)))
+    ++size;
+
+  return size;
+}
+
+unsigned int
+calculate_sint_size(int64_t value) {
+  auto size = 1u;
+  while ((8 > size) && ((value < -(int64_t{1} << (size * 8 - 1))) || (value >= (int64_t{1} << (size * 8 - 1)))))
+    ++size;
+
+  return size;
+}
+
+uint64_t
+calculate_element_size(EbmlId const &id,
+                       uint64_t content_size) {
+  return EBML_ID_LENGTH(id) + CodedSizeLength(content_size, 0) + content_size;
+}
+
+void
+put_element_head(unsigned char *&cursor,
+                 EbmlId const &id,
+                 uint64_t content_size) {
+  id.Fill(cursor);
+  cursor += EBML_ID_LENGTH(id);
+  cursor += CodedValueLength(content_size, CodedSizeLength(content_size, 0), cursor);
+}
+
+void
+put_integer(unsigned char *&cursor,
+            uint64_t value,
+            unsigned int size) {
+  for (auto shift = size * 8; 0 < shift; shift -= 8)
+    *cursor++ = (value >> (shift - 8)) & 0xff;
+}
+
+uint64_t
+frame_size(direct_block_t const &block,
+           size_t idx) {
+  return block.m_frames[idx]->data->get_size();
+}
+
+// Same decision as KaxInternalBlock::GetBestLacingType().
+LacingType
+get_best_lacing_type(direct_block_t const &block) {
+  auto same_size        = true;
+  auto xiph_lacing_size = uint64_t{1};
+  auto ebml_lacing_size = uint64_t{1} + CodedSizeLength(frame_size(block, 0), 0);
+
+  for (auto idx = 0u; (idx + 1) < block.m_num_frames; ++idx) {
+    if (frame_size(block, idx) != frame_size(block, idx + 1))
+      same_size = false;
+    xiph_lacing_size += frame_size(block, idx) / 0xff + 1;
+  }
+
+  for (auto idx = 1u; (idx + 1) < block.m_num_frames; ++idx)
+    ebml_lacing_size += CodedSizeLengthSigned(static_cast<int64_t>(frame_size(block, idx)) - static_cast<int64_t>(frame_size(block, idx - 1)), 0);
+
+  return same_size                            ? LACING_FIXED
+       : xiph_lacing_size < ebml_lacing_size ? LACING_XIPH
+       :                                       LACING_EBML;
+}
+
+LacingType
+get_lacing_type(direct_block_t const &block) {
+  return 1 == block.m_num_frames       ? LACING_NONE
+       : LACING_AUTO == block.m_lacing ? get_best_lacing_type(block)
+       :                                 block.m_lacing;
+}
+
+int64_t
+get_reference_value(direct_block_t const &block,
+                    int64_t referenced_timecode) {
+  return (referenced_timecode - static_cast<int64_t>(block.m_timecode)) / static_cast<int64_t>(block.m_track_entry->GlobalTimecodeScale());
+}
+
+uint64_t
+get_duration_value(direct_block_t const &block) {
+  return static_cast<uint64_t>(block.m_duration) / static_cast<uint64_t>(block.m_track_entry->GlobalTimecodeScale());
+}
+
+}
+
+namespace mtx { namespace direct_rendering {
+
+void
+calculate_sizes(direct_block_t &block) {
+  auto lacing        = get_lacing_type(block);
+  block.m_block_size = 4 + (LACING_NONE != lacing ? 1 : 0);
+
+  for (auto idx = 0u; block.m_num_frames > idx; ++idx) {
+    block.m_block_size += frame_size(block, idx);
+
+    if ((idx + 1) == block.m_num_frames)
+      break;
+
+    if (LACING_XIPH == lacing)
+      block.m_block_size += frame_size(block, idx) / 0xff + 1;
+
+    else if ((LACING_EBML == lacing) && !idx)
+      block.m_block_size += CodedSizeLength(frame_size(block, idx), 0);
+
+    else if (LACING_EBML == lacing)
+      block.m_block_size += CodedSizeLengthSigned(static_cast<int64_t>(frame_size(block, idx)) - static_cast<int64_t>(frame_size(block, idx - 1)), 0);
+  }
+
+  if (block.m_simple) {
+    block.m_element_size = calculate_element_size(EBML_ID(KaxSimpleBlock), block.m_block_size);
+    return;
+  }
+
+  auto group_size = calculate_element_size(EBML_ID(KaxBlock), block.m_block_size);
+
+  if (0 <= block.m_past_block)
+    group_size += calculate_element_size(EBML_ID(KaxReferenceBlock), calculate_sint_size(get_reference_value(block, block.m_past_block)));
+  if (0 <= block.m_forw_block)
+    group_size += calculate_element_size(EBML_ID(KaxReferenceBlock), calculate_sint_size(get_reference_value(block, block.m_forw_block)));
+  if (-1 != block.m_duration)
+    group_size += calculate_element_size(EBML_ID(KaxBlockDuration), calculate_uint_size(get_duration_value(block)));
+
+  block.m_group_size   = group_size;
+  block.m_element_size = calculate_element_size(EBML_ID(KaxBlockGroup), group_size);
+}
+
+// Writes a SimpleBlock or BlockGroup the way libmatroska renders it:
+// the group's children are the Block, the ReferenceBlocks and the
+// BlockDuration in that order. The headers and the frames are passed
+// to the output as spans so that the frames don't have to be copied.
+void
+write_block(mm_io_c &out,
+            KaxCluster &cluster,
+            direct_block_t const &block) {
+  unsigned char buffer[256], trailer[64], *cursor = buffer;
+  auto lacing = get_lacing_type(block);
+  auto spans  = std::vector<mm_io_c::span_t>{};
+
+  if (!block.m_simple) {
+    put_element_head(cursor, EBML_ID(KaxBlockGroup), block.m_group_size);
+    put_element_head(cursor, EBML_ID(KaxBlock),      block.m_block_size);
+  } else
+    put_element_head(cursor, EBML_ID(KaxSimpleBlock), block.m_block_size);
+
+  *cursor++ = 0x80 | block.m_track_num;
+  put_integer(cursor, static_cast<uint16_t>(cluster.GetBlockLocalTimecode(block.m_timecode)), 2);
+  *cursor++ = (block.m_simple && block.m_key_frame   ? 0x80 : 0x00)
+            | (block.m_simple && block.m_discardable ? 0x01 : 0x00)
+            | (LACING_XIPH  == lacing                ? 0x02 : 0x00)
+            | (LACING_FIXED == lacing                ? 0x04 : 0x00)
+            | (LACING_EBML  == lacing                ? 0x06 : 0x00);
+
+  if (LACING_NONE != lacing)
+    *cursor++ = block.m_num_frames - 1;
+
+  for (auto idx = 0u; (LACING_NONE != lacing) && ((idx + 1) < block.m_num_frames); ++idx) {
+    if (LACING_XIPH == lacing) {
+      auto size = frame_size(block, idx);
+      for (; 0xff <= size; size -= 0xff)
+        *cursor++ = 0xff;
+      *cursor++ = size;
+
+    } else if ((LACING_EBML == lacing) && !idx)
+      cursor += CodedValueLength(frame_size(block, idx), CodedSizeLength(frame_size(block, idx), 0), cursor);
+
+    else if (LACING_EBML == lacing) {
+      auto difference = static_cast<int64_t>(frame_size(block, idx)) - static_cast<int64_t>(frame_size(block, idx - 1));
+      cursor         += CodedValueLengthSigned(difference, CodedSizeLengthSigned(difference, 0), cursor);
+    }
+  }
+
+  spans.emplace_back(buffer, cursor - buffer);
+
+  for (auto idx = 0u; block.m_num_frames > idx; ++idx)
+    spans.emplace_back(block.m_frames[idx]->data->get_buffer(), frame_size(block, idx));
+
+  if (block.m_simple) {
+    out.write_spans(spans);
+    return;
+  }
+
+  cursor = trailer;
+
+  for (auto referenced_timecode : std::vector<int64_t>{ block.m_past_block, block.m_forw_block }) {
+    if (0 > referenced_timecode)
+      continue;
+
+    auto value = get_reference_value(block, referenced_timecode);
+    auto size  = calculate_sint_size(value);
+
+    put_element_head(cursor, EBML_ID(KaxReferenceBlock), size);
+    put_integer(cursor, static_cast<uint64_t>(value), size);
+  }
+
+  if (-1 != block.m_duration) {
+    auto value = get_duration_value(block);
+    auto size  = calculate_uint_size(value);
+
+    put_element_head(cursor, EBML_ID(KaxBlockDuration), size);
+    put_integer(cursor, value, size);
+  }
+
+  if (cursor != trailer)
+    spans.emplace_back(trailer, cursor - trailer);
+
+  out.write_spans(spans);
+}
+
+}}
+
+/** \brief Whether or not the current cluster can be written without libmatroska
+
+   Direct rendering handles SimpleBlocks and BlockGroups with lacing,
+   references and durations. Everything else, e.g. codec states,
+   BlockAdditions or silent tracks, is left to render().
+*/
+bool
+cluster_helper_c::can_render_directly()
+  const {
+  if (!hack_engaged(ENGAGE_DIRECT_CLUSTER_RENDERING) || m->packets.empty() || discarding())
+    return false;
+
+  for (auto const &pack : m->packets)
+    if (   pack->codec_state
+        || !pack->data_adds.empty()
+        || pack->has_discard_padding()
+        || (0 < pack->ref_priority)
+        || pack->source->contains_gap()
+        || (0x80 <= pack->source->get_track_num()))
+      return false;
+
+  return true;
+}
+
+/** \brief Write the current cluster straight from the packets
+
+   Creates the same blocks that render() creates with libmatroska's
+   block blobs, but only records which packets go into which block.
+   Sizes are calculated afterwards, and the cluster is written with
+   the packets' data being passed to the output directly.
+*/
+int
+cluster_helper_c::render_directly() {
+  auto use_simpleblock = !hack_engaged(ENGAGE_NO_SIMPLE_BLOCKS);
+  auto lacing_type     = hack_engaged(ENGAGE_LACING_XIPH) ? LACING_XIPH : hack_engaged(ENGAGE_LACING_EBML) ? LACING_EBML : LACING_AUTO;
+  auto min_cl_timecode = std::numeric_limits<int64_t>::max();
+  auto max_cl_timecode = int64_t{};
+  auto added_to_cues   = false;
+  auto &blocks         = m->direct_blocks;
+
+  blocks.clear();
+
+  for (auto &pair : m->direct_render_groups) {
+    pair.second.m_durations.clear();
+    pair.second.m_more_data          = false;
+    pair.second.m_duration_mandatory = false;
+  }
+
+  if ((-1 == m->header_overhead) && splitting())
+    m->header_overhead = m->out->getFilePointer() + g_tags_size;
+
+  m->timecode_offset   = boost::accumulate(m->packets, m->timecode_offset, [](int64_t a, const packet_cptr &p) { return std::min(a, p->assigned_timecode); });
+  auto timecode_offset = m->timecode_offset + get_discarded_duration();
+
+  for (auto &pack : m->packets) {
+    auto source = pack->source;
+
+    if (g_video_packetizer == source)
+      m->max_video_timecode_rendered = std::max(pack->assigned_timecode + pack->get_duration(), m->max_video_timecode_rendered);
+
+    auto render_group_itr = m->direct_render_groups.find(source);
+    if (m->direct_render_groups.end() == render_group_itr)
+      render_group_itr = m->direct_render_groups.insert({ source, render_groups_c{source} }).first;
+
+    auto &render_group = render_group_itr->second;
+    auto &track_entry  = static_cast<KaxTrackEntry &>(*source->get_track_entry());
+    auto timecode      = pack->assigned_timecode - timecode_offset;
+    auto past_block    = pack->has_bref() ? pack->bref - timecode_offset : -1;
+    auto forw_block    = pack->has_fref() ? pack->fref - timecode_offset : -1;
+
+    min_cl_timecode    = std::min(pack->assigned_timecode, min_cl_timecode);
+    max_cl_timecode    = std::max(pack->assigned_timecode, max_cl_timecode);
+
+    if (!render_group.m_more_data || !pack->is_key_frame() || source->is_lacing_prevented()) {
+      auto block_duration = calculate_block_duration(&render_group);
+      if ((-1 != block_duration) && !blocks[render_group.m_last_direct_block].m_simple)
+        blocks[render_group.m_last_direct_block].m_duration = block_duration;
+
+      render_group.m_durations.clear();
+      render_group.m_duration_mandatory = false;
+
+      blocks.push_back(direct_block_t{});
+
+      auto &new_block         = blocks.back();
+      new_block.m_track_entry = &track_entry;
+      new_block.m_track_num   = source->get_track_num();
+      new_block.m_timecode    = timecode;
+      new_block.m_past_block  = -1;
+      new_block.m_forw_block  = -1;
+      new_block.m_duration    = -1;
+      new_block.m_lacing      = lacing_type;
+      new_block.m_simple      = use_simpleblock && !must_duration_be_set(&render_group, pack);
+
+      render_group.m_last_direct_block = blocks.size() - 1;
+      added_to_cues                    = false;
+    }
+
+    // Now put the packet into the block. The decisions mirror
+    // kax_block_blob_c::add_frame_auto() and KaxInternalBlock::AddFrame().
+    auto &block = blocks[render_group.m_last_direct_block];
+    assert(8 > block.m_num_frames);
+
+    block.m_frames[block.m_num_frames++] = pack.get();
+    render_group.m_more_data             = (8 > block.m_num_frames) && (6 * 0xff > pack->data->get_size());
+
+    if (!block.m_simple) {
+      if (0 <= past_block)
+        block.m_past_block = past_block;
+      if (0 <= forw_block)
+        block.m_forw_block = forw_block;
+
+    } else {
+      block.m_key_frame   = (-1 == past_block) && (-1 == forw_block);
+      block.m_discardable = !block.m_key_frame
+                         && !(   ((-1 == forw_block) || (forw_block <= timecode))
+                              && ((-1 == past_block) || (past_block <= timecode)));
+    }
+
+    if (-1 == m->first_timecode_in_file)
+      m->first_timecode_in_file = pack->assigned_timecode;
+    if (-1 == m->first_timecode_in_part)
+      m->first_timecode_in_part = pack->assigned_timecode;
+
+    m->min_timecode_in_file      = std::min(timecode_c::ns(pack->assigned_timecode),        m->min_timecode_in_file.value_or_max());
+    m->max_timecode_in_file      = std::max(pack->assigned_timecode,                        m->max_timecode_in_file);
+    m->max_timecode_and_duration = std::max(pack->assigned_timecode + pack->get_duration(), m->max_timecode_and_duration);
+
+    if (!pack->is_key_frame() || !track_entry.LacingEnabled())
+      render_group.m_more_data = false;
+
+    render_group.m_durations.push_back(pack->get_unmodified_duration());
+    render_group.m_duration_mandatory |= pack->duration_mandatory;
+
+    cues_c::get().set_duration_for_id_timecode(source->get_track_num(), timecode, pack->get_duration());
+
+    if (g_write_cues && !added_to_cues) {
+      added_to_cues = add_to_cues_maybe(pack);
+      if (added_to_cues)
+        block.m_add_to_cues = true;
+    }
+
+    pack->group = nullptr;
+
+    m->track_statistics[ source->get_uid() ].process(*pack);
+
+    source->after_packet_rendered(*pack);
+  }
+
+  for (auto &pair : m->direct_render_groups) {
+    auto block_duration = calculate_block_duration(&pair.second);
+    if ((-1 != block_duration) && !blocks[pair.second.m_last_direct_block].m_simple)
+      blocks[pair.second.m_last_direct_block].m_duration = block_duration;
+  }
+
+  m->cluster->SetPreviousTimecode(min_cl_timecode - timecode_offset - 1, (int64_t)g_timecode_scale);
+  m->cluster->set_min_timecode(min_cl_timecode - timecode_offset);
+  m->cluster->set_max_timecode(max_cl_timecode - timecode_offset);
+
+  // Calculate all sizes so that the cluster's head can be written
+  // before its content.
+  auto cluster_timecode      = m->cluster->GlobalTimecode() / m->cluster->GlobalTimecodeScale();
+  auto cluster_timecode_size = calculate_uint_size(cluster_timecode);
+  auto cluster_content_size  = calculate_element_size(EBML_ID(KaxClusterTimecode), cluster_timecode_size);
+
+  for (auto &block : blocks) {
+    mtx::direct_rendering::calculate_sizes(block);
+    cluster_content_size += block.m_element_size;
+  }
+
+  unsigned char buffer[32], *cursor = buffer;
+  auto cluster_position = m->out->getFilePointer();
+
+  put_element_head(cursor, EBML_ID(KaxCluster), cluster_content_size);
+  auto cluster_head_size = cursor - buffer;
+
+  put_element_head(cursor, EBML_ID(KaxClusterTimecode), cluster_timecode_size);
+  put_integer(cursor, cluster_timecode, cluster_timecode_size);
+
+  m->out->write(buffer, cursor - buffer);
+
+  auto &cues          = cues_c::get();
+  auto block_position = cluster_position + (cursor - buffer);
+  auto record_cues    = g_write_cues && cues.needs_block_positions();
+
+  for (auto const &block : blocks) {
+    mtx::direct_rendering::write_block(*m->out, *m->cluster, block);
+
+    if (record_cues)
+      cues.set_block_position_for_id_timecode(block.m_track_num, block.m_timecode, block_position);
+
+    block_position += block.m_element_size;
+  }
+
+  assert(m->out->getFilePointer() == (cluster_position + cluster_head_size + cluster_content_size));
+
+  m->bytes_in_file += cluster_head_size + cluster_content_size;
+
+  if (g_kax_sh_cues) {
+    // Same as KaxSeekHead::IndexThis() for the cluster.
+    auto &seek = AddNewChild<KaxSeek>(*g_kax_sh_cues);
+    binary id[4];
+
+    EBML_ID(KaxCluster).Fill(id);
+    GetChild<KaxSeekPosition>(seek).SetValue(g_kax_segment->GetRelativePosition(cluster_position));
+    GetChild<KaxSeekID>(seek).CopyBuffer(id, EBML_ID_LENGTH(EBML_ID(KaxCluster)));
+  }
+
+  m->previous_cluster_tc = m->cluster->GlobalTimecode();
+
+  // The cue points are created in the same order as libmatroska's
+  // KaxCues::PositionSet() creates them: in the order of the blocks.
+  for (auto const &block : blocks) {
+    if (!block.m_add_to_cues)
+      continue;
+
+    uint64_t cue_time = block.m_timecode / static_cast<uint64_t>(g_timecode_scale);
+    uint64_t timecode = cue_time * g_timecode_scale;
+
+    cues.add(cue_point_t{ timecode, 0, g_kax_segment->GetRelativePosition(cluster_position), static_cast<uint32_t>(block.m_track_num), 0 });
+  }
+
+  cues.postprocess_cues(cluster_position + cluster_head_size);
+
+  m->min_timecode_in_cluster = -1;
+  m->max_timecode_in_cluster = -1;
+
+  m->cluster->delete_non_blocks();
+
+  return 1;
+}
+
 bool
 cluster_helper_c::add_to_cues_maybe(packet_cptr &pack) {
   auto &source  = *pack->source;
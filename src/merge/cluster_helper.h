@@ -61,6 +61,7 @@ public:
   bool split_mode_produces_many_files() const;
 
   bool discarding() const;
+  int64_t get_first_part_start() const;
 
   int get_packet_count() const;
 
@@ -71,8 +72,12 @@ public:
 
 private:
   void set_duration(render_groups_c *rg);
+  int64_t calculate_block_duration(render_groups_c *rg);
   bool must_duration_be_set(render_groups_c *rg, packet_cptr &new_packet);
 
+  bool can_render_directly() const;
+  int render_directly();
+
   void render_before_adding_if_necessary(packet_cptr &packet);
   void render_after_adding_if_necessary(packet_cptr &packet);
   void split_if_necessary(packet_cptr &packet);
@@ -18,6 +18,7 @@
 #include "common/fs_sys_helpers.h"
 #include "common/hacks.h"
 #include "common/math.h"
+#include "common/profiling.h"
 #include "merge/cluster_helper.h"
 #include "merge/cues.h"
 #include "merge/generic_packetizer.h"
@@ -26,10 +27,40 @@
 
 cues_cptr cues_c::s_cues;
 
+namespace {
+
+bool
+id_timecode_less(id_timecode_value_t const &a,
+                 id_timecode_value_t const &b) {
+  return a.id_timecode < b.id_timecode;
+}
+
+// Both the values and the cue points are sorted by their ID/timecode
+// pair. Each call hands out the next value for the pair so that the
+// n-th cue point for a pair gets the n-th value recorded for it.
+id_timecode_value_t const *
+next_value_for(id_timecode_t const &id_timecode,
+               std::vector<id_timecode_value_t>::const_iterator &itr,
+               std::vector<id_timecode_value_t>::const_iterator const &end) {
+  while ((itr != end) && (itr->id_timecode < id_timecode))
+    ++itr;
+
+  if ((itr == end) || (itr->id_timecode != id_timecode))
+    return nullptr;
+
+  return &*itr++;
+}
+
+}
+
 cues_c::cues_c()
   : m_num_cue_points_postprocessed{}
+  , m_num_cue_points_sized{}
+  , m_size_of_sized_points{}
+  , m_reserved_space{}
   , m_no_cue_duration{hack_engaged(ENGAGE_NO_CUE_DURATION)}
   , m_no_cue_relative_position{hack_engaged(ENGAGE_NO_CUE_RELATIVE_POSITION)}
+  , m_reserved_space_exceeded{}
   , m_debug_cue_duration{         "cues|cues_cue_duration"}
   , m_debug_cue_relative_position{"cues|cues_cue_relative_position"}
 {
@@ -40,7 +71,32 @@ cues_c::set_duration_for_id_timecode(uint64_t id,
                                      uint64_t timecode,
                                      uint64_t duration) {
   if (!m_no_cue_duration)
-    m_id_timecode_duration_multimap.insert({ id_timecode_t{id, timecode}, duration });
+    m_durations.push_back({ id_timecode_t{id, timecode}, duration });
+}
+
+void
+cues_c::set_block_position_for_id_timecode(uint64_t id,
+                                           uint64_t timecode,
+                                           uint64_t position) {
+  if (!m_no_cue_relative_position)
+    m_block_positions.push_back({ id_timecode_t{id, timecode}, position });
+}
+
+bool
+cues_c::needs_block_positions()
+  const {
+  return !m_no_cue_relative_position;
+}
+
+/** \brief Sets the size of the space reserved in front of the clusters
+
+   Called whenever a new placeholder is written and whenever the track
+   headers have taken part of the placeholder's space.
+*/
+void
+cues_c::set_reserved_space(uint64_t size) {
+  m_reserved_space = size;
+  check_reserved_space();
 }
 
 void
@@ -72,12 +128,22 @@ cues_c::add(KaxCuePoint &point) {
   }
 }
 
+void
+cues_c::add(cue_point_t const &point) {
+  m_points.push_back(point);
+}
+
 void
 cues_c::write(mm_io_c &out,
               KaxSeekHead &seek_head) {
+  // The next file starts with a new placeholder.
+  m_reserved_space_exceeded = false;
+
   if (!m_points.size() || !g_cue_writing_requested)
     return;
 
+  profiling_timer_c timer{profiling_c::stage_cues};
+
   // auto start = mtx::sys::get_current_time_millis();
   sort();
   // auto end_sort = mtx::sys::get_current_time_millis();
@@ -125,6 +191,8 @@ cues_c::write(mm_io_c &out,
   m_points.clear();
   m_codec_state_position_map.clear();
   m_num_cue_points_postprocessed = 0;
+  m_num_cue_points_sized         = 0;
+  m_size_of_sized_points         = 0;
 
   // auto end_all = mtx::sys::get_current_time_millis();
   // mxinfo(boost::format("dur sort %1% write %2% total %3%\n") % (end_sort - start) % (end_all - end_sort) % (end_all - start));
@@ -145,61 +213,52 @@ cues_c::sort() {
     });
 }
 
-std::multimap<id_timecode_t, uint64_t>
-cues_c::calculate_block_positions(KaxCluster &cluster)
-  const {
-
-  std::multimap<id_timecode_t, uint64_t> positions;
-
-  for (auto child : cluster) {
-    auto simple_block = dynamic_cast<KaxSimpleBlock *>(child);
-    if (simple_block) {
-      simple_block->SetParent(cluster);
-      positions.insert({ id_timecode_t{ simple_block->TrackNum(), simple_block->GlobalTimecode()}, simple_block->GetElementPosition() });
-      continue;
-    }
-
-    auto block_group = dynamic_cast<KaxBlockGroup *>(child);
-    if (!block_group)
-      continue;
-
-    auto block = FindChild<KaxBlock>(block_group);
-    if (!block)
-      continue;
-
-    block->SetParent(cluster);
-    positions.insert({ id_timecode_t{ block->TrackNum(), block->GlobalTimecode()}, block_group->GetElementPosition() });
-  }
-
-  return positions;
-}
-
 void
 cues_c::postprocess_cues(KaxCues &cues,
                          KaxCluster &cluster) {
+  profiling_timer_c timer{profiling_c::stage_cues};
+
   add(cues);
+  postprocess_cues(cluster.GetElementPosition() + cluster.HeadSize());
+}
 
-  if (m_no_cue_duration && m_no_cue_relative_position)
+void
+cues_c::postprocess_cues(uint64_t cluster_data_start_pos) {
+  profiling_timer_c timer{profiling_c::stage_cues};
+
+  if ((m_no_cue_duration && m_no_cue_relative_position) || (m_points.size() == m_num_cue_points_postprocessed)) {
+    m_num_cue_points_postprocessed = m_points.size();
+    m_durations.clear();
+    m_block_positions.clear();
+    check_reserved_space();
     return;
+  }
 
-  auto cluster_data_start_pos = cluster.GetElementPosition() + cluster.HeadSize();
-  auto block_positions        = calculate_block_positions(cluster);
-  std::map<id_timecode_t, size_t> nblocks_processed; //# blocks processed so far with given track #/timecode
+  // The values are recorded in the order the blocks are rendered;
+  // stable sorting keeps that order for identical ID/timecode pairs.
+  // The cue points themselves are visited in sorted order via indexes
+  // so that their order in m_points isn't changed.
+  m_new_point_indexes.clear();
+  for (auto idx = m_num_cue_points_postprocessed, end = m_points.size(); idx < end; ++idx)
+    m_new_point_indexes.push_back(idx);
 
-  for (auto point = m_points.begin() + m_num_cue_points_postprocessed, end = m_points.end(); point != end; ++point) {
-    nblocks_processed[id_timecode_t{ point->track_num, point->timecode }]++;
+  std::stable_sort(m_new_point_indexes.begin(), m_new_point_indexes.end(), [this](size_t a, size_t b) {
+    return id_timecode_t{ m_points[a].track_num, m_points[a].timecode } < id_timecode_t{ m_points[b].track_num, m_points[b].timecode };
+  });
+  std::stable_sort(m_durations.begin(),       m_durations.end(),       id_timecode_less);
+  std::stable_sort(m_block_positions.begin(), m_block_positions.end(), id_timecode_less);
 
-    // Set CueRelativePosition for all cues.
-    if (!m_no_cue_relative_position) {
-      auto pair          = block_positions.equal_range({ point->track_num, point->timecode });
-      auto position_itr  = pair.first;
-      auto pos_end       = pair.second;
-      auto num_processed = nblocks_processed[id_timecode_t{ point->track_num, point->timecode }];
+  auto position_itr = m_block_positions.cbegin();
+  auto duration_itr = m_durations.cbegin();
 
-      for (auto i = 0u; ((i + 1) < num_processed) && (position_itr != pos_end); ++i)
-        position_itr++;
+  for (auto idx : m_new_point_indexes) {
+    auto point       = &m_points[idx];
+    auto id_timecode = id_timecode_t{ point->track_num, point->timecode };
 
-      auto relative_position = block_positions.end() != position_itr ? std::max(position_itr->second, cluster_data_start_pos) - cluster_data_start_pos : 0ull;
+    // Set CueRelativePosition for all cues.
+    if (!m_no_cue_relative_position) {
+      auto position          = next_value_for(id_timecode, position_itr, m_block_positions.cend());
+      auto relative_position = position ? std::max(position->value, cluster_data_start_pos) - cluster_data_start_pos : 0ull;
 
       assert(relative_position <= static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()));
 
@@ -214,30 +273,65 @@ cues_c::postprocess_cues(KaxCues &cues,
     if (m_no_cue_duration)
       continue;
 
-    auto pair          = m_id_timecode_duration_multimap.equal_range({ point->track_num, point->timecode });
-    auto duration_itr  = pair.first;
-    auto dur_end       = pair.second;
-    auto num_processed = nblocks_processed[id_timecode_t{ point->track_num, point->timecode }];
-
-    for (auto i = 0u; ((i + 1) < num_processed) && (duration_itr != dur_end); ++i)
-      duration_itr++;
-
-    auto ptzr         = g_packetizers_by_track_num[point->track_num];
+    auto duration = next_value_for(id_timecode, duration_itr, m_durations.cend());
+    auto ptzr     = g_packetizers_by_track_num[point->track_num];
 
     if (!ptzr || !ptzr->wants_cue_duration())
       continue;
 
-    if (m_id_timecode_duration_multimap.end() != duration_itr)
-      point->duration = duration_itr->second;
+    if (duration)
+      point->duration = duration->value;
 
     mxdebug_if(m_debug_cue_duration,
                boost::format("cue_duration: looking for <%1%:%2%>: %3%\n")
-               % point->track_num % point->timecode % (duration_itr == m_id_timecode_duration_multimap.end() ? static_cast<int64_t>(-1) : duration_itr->second));
+               % point->track_num % point->timecode % (duration ? static_cast<int64_t>(duration->value) : static_cast<int64_t>(-1)));
   }
 
   m_num_cue_points_postprocessed = m_points.size();
 
-  m_id_timecode_duration_multimap.clear();
+  m_durations.clear();
+  m_block_positions.clear();
+
+  check_reserved_space();
+}
+
+/** \brief Size of the whole KaxCues element as it would be written now
+
+   The sizes of cue points that have been post-processed don't change
+   anymore. They're only calculated once so that this function can be
+   called after each cluster. Returns 0 if no cues would be written.
+*/
+uint64_t
+cues_c::calculate_element_size() {
+  if (m_points.empty() || !g_cue_writing_requested)
+    return 0;
+
+  for (auto end = m_num_cue_points_postprocessed; m_num_cue_points_sized < end; ++m_num_cue_points_sized)
+    m_size_of_sized_points += calculate_point_size(m_points[m_num_cue_points_sized]);
+
+  auto content_size = m_size_of_sized_points;
+  for (auto idx = m_num_cue_points_sized, end = m_points.size(); idx < end; ++idx)
+    content_size += calculate_point_size(m_points[idx]);
+
+  return EBML_ID_LENGTH(EBML_ID(KaxCues)) + CodedSizeLength(content_size, 0) + content_size;
+}
+
+void
+cues_c::check_reserved_space() {
+  if (!m_reserved_space || m_reserved_space_exceeded)
+    return;
+
+  // Whatever isn't used of the reserved space must be filled with an
+  // EbmlVoid element which is at least two bytes long.
+  auto size = calculate_element_size();
+  if ((size == m_reserved_space) || ((size + 2) <= m_reserved_space))
+    return;
+
+  m_reserved_space_exceeded = true;
+
+  mxwarn(boost::format(Y("The cues have grown larger than the %1% bytes reserved for them. They will be written after the clusters instead. "
+                         "Use a larger value for '--reserve-space-for-cues' in order to place them in front of the clusters.\n"))
+         % m_reserved_space);
 }
 
 uint64_t
@@ -29,17 +29,24 @@ struct cue_point_t {
   uint32_t track_num, relative_position;
 };
 
+struct id_timecode_value_t {
+  id_timecode_t id_timecode;
+  uint64_t value;
+};
+
 class cues_c;
 using cues_cptr = std::shared_ptr<cues_c>;
 
 class cues_c {
 protected:
   std::vector<cue_point_t> m_points;
-  std::multimap<id_timecode_t, uint64_t> m_id_timecode_duration_multimap;
+  std::vector<id_timecode_value_t> m_durations, m_block_positions;
+  std::vector<size_t> m_new_point_indexes;
   std::map<id_timecode_t, uint64_t> m_codec_state_position_map;
 
-  size_t m_num_cue_points_postprocessed;
-  bool m_no_cue_duration, m_no_cue_relative_position;
+  size_t m_num_cue_points_postprocessed, m_num_cue_points_sized;
+  uint64_t m_size_of_sized_points, m_reserved_space;
+  bool m_no_cue_duration, m_no_cue_relative_position, m_reserved_space_exceeded;
   debugging_option_c m_debug_cue_duration, m_debug_cue_relative_position;
 
 protected:
@@ -50,16 +57,22 @@ public:
 
   void add(KaxCues &cues);
   void add(KaxCuePoint &point);
+  void add(cue_point_t const &point);
   void write(mm_io_c &out, KaxSeekHead &seek_head);
   void postprocess_cues(KaxCues &cues, KaxCluster &cluster);
+  void postprocess_cues(uint64_t cluster_data_start_pos);
   void set_duration_for_id_timecode(uint64_t id, uint64_t timecode, uint64_t duration);
+  void set_block_position_for_id_timecode(uint64_t id, uint64_t timecode, uint64_t position);
+  bool needs_block_positions() const;
+  void set_reserved_space(uint64_t size);
+  uint64_t calculate_element_size();
 
 public:
   static cues_c &get();
 
 protected:
   void sort();
-  std::multimap<id_timecode_t, uint64_t> calculate_block_positions(KaxCluster &cluster) const;
+  void check_reserved_space();
   uint64_t calculate_total_size() const;
   uint64_t calculate_point_size(cue_point_t const &point) const;
   uint64_t calculate_bytes_for_uint(uint64_t value) const;
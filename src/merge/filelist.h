@@ -18,6 +18,7 @@
 
 #include "common/file_types.h"
 #include "merge/output_control.h"
+#include "merge/reader_thread.h"
 
 class generic_reader_c;
 class track_info_c;
@@ -38,6 +39,7 @@ struct filelist_t {
   packet_cptr pack;
 
   std::unique_ptr<generic_reader_c> reader;
+  reader_thread_cptr reader_thread;
 
   std::unique_ptr<track_info_c> ti;
   bool appending{}, appended_to{}, done{};
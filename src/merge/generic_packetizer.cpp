@@ -28,6 +28,7 @@
 #include "common/container.h"
 #include "common/ebml.h"
 #include "common/hacks.h"
+#include "common/profiling.h"
 #include "common/strings/formatting.h"
 #include "common/unique_numbers.h"
 #include "common/xml/ebml_tags_converter.h"
@@ -285,8 +286,10 @@ generic_packetizer_c::set_uid(uint64_t uid) {
 
   add_unique_number(uid, UNIQUE_TRACK_IDS);
   m_huid = uid;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxTrackUID>(m_track_entry).SetValue(m_huid);
+  }
 
   return true;
 }
@@ -331,15 +334,19 @@ generic_packetizer_c::set_track_type(int type,
 void
 generic_packetizer_c::set_track_name(const std::string &name) {
   m_ti.m_track_name = name;
-  if (m_track_entry && !name.empty())
+  if (m_track_entry && !name.empty()) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxTrackName>(m_track_entry).SetValueUTF8(m_ti.m_track_name);
+  }
 }
 
 void
 generic_packetizer_c::set_codec_id(const std::string &id) {
   m_hcodec_id = id;
-  if (m_track_entry && !id.empty())
+  if (m_track_entry && !id.empty()) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxCodecID>(m_track_entry).SetValue(m_hcodec_id);
+  }
 }
 
 void
@@ -347,8 +354,10 @@ generic_packetizer_c::set_codec_private(memory_cptr const &buffer) {
   if (buffer && buffer->get_size()) {
     m_hcodec_private = buffer->clone();
 
-    if (m_track_entry)
+    if (m_track_entry) {
+      std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
       GetChild<KaxCodecPrivate>(*m_track_entry).CopyBuffer(static_cast<binary *>(m_hcodec_private->get_buffer()), m_hcodec_private->get_size());
+    }
 
   } else
     m_hcodec_private.reset();
@@ -357,15 +366,19 @@ generic_packetizer_c::set_codec_private(memory_cptr const &buffer) {
 void
 generic_packetizer_c::set_track_min_cache(int min_cache) {
   m_htrack_min_cache = min_cache;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxTrackMinCache>(m_track_entry).SetValue(min_cache);
+  }
 }
 
 void
 generic_packetizer_c::set_track_max_cache(int max_cache) {
   m_htrack_max_cache = max_cache;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxTrackMaxCache>(m_track_entry).SetValue(max_cache);
+  }
 }
 
 void
@@ -375,15 +388,19 @@ generic_packetizer_c::set_track_default_duration(int64_t def_dur) {
 
   m_htrack_default_duration = (int64_t)(def_dur * m_ti.m_tcsync.numerator / m_ti.m_tcsync.denominator);
 
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxTrackDefaultDuration>(m_track_entry).SetValue(m_htrack_default_duration);
+  }
 }
 
 void
 generic_packetizer_c::set_track_max_additionals(int max_add_block_ids) {
   m_htrack_max_add_block_ids = max_add_block_ids;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxMaxBlockAdditionID>(m_track_entry).SetValue(max_add_block_ids);
+  }
 }
 
 int64_t
@@ -395,22 +412,28 @@ generic_packetizer_c::get_track_default_duration()
 void
 generic_packetizer_c::set_track_forced_flag(bool forced_track) {
   m_ti.m_forced_track = forced_track;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxTrackFlagForced>(m_track_entry).SetValue(forced_track ? 1 : 0);
+  }
 }
 
 void
 generic_packetizer_c::set_track_enabled_flag(bool enabled_track) {
   m_ti.m_enabled_track = enabled_track;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxTrackFlagEnabled>(m_track_entry).SetValue(enabled_track ? 1 : 0);
+  }
 }
 
 void
 generic_packetizer_c::set_track_seek_pre_roll(timecode_c const &seek_pre_roll) {
   m_seek_pre_roll = seek_pre_roll;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxSeekPreRoll>(m_track_entry).SetValue(seek_pre_roll.to_ns());
+  }
 
   set_required_matroska_version(4);
 }
@@ -418,8 +441,10 @@ generic_packetizer_c::set_track_seek_pre_roll(timecode_c const &seek_pre_roll) {
 void
 generic_packetizer_c::set_codec_delay(timecode_c const &codec_delay) {
   m_codec_delay = codec_delay;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxCodecDelay>(m_track_entry).SetValue(codec_delay.to_ns());
+  }
 
   set_required_matroska_version(4);
 }
@@ -427,50 +452,64 @@ generic_packetizer_c::set_codec_delay(timecode_c const &codec_delay) {
 void
 generic_packetizer_c::set_audio_sampling_freq(float freq) {
   m_haudio_sampling_freq = freq;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxAudioSamplingFreq>(GetChild<KaxTrackAudio>(m_track_entry)).SetValue(m_haudio_sampling_freq);
+  }
 }
 
 void
 generic_packetizer_c::set_audio_output_sampling_freq(float freq) {
   m_haudio_output_sampling_freq = freq;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxAudioOutputSamplingFreq>(GetChild<KaxTrackAudio>(m_track_entry)).SetValue(m_haudio_output_sampling_freq);
+  }
 }
 
 void
 generic_packetizer_c::set_audio_channels(int channels) {
   m_haudio_channels = channels;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxAudioChannels>(GetChild<KaxTrackAudio>(*m_track_entry)).SetValue(m_haudio_channels);
+  }
 }
 
 void
 generic_packetizer_c::set_audio_bit_depth(int bit_depth) {
   m_haudio_bit_depth = bit_depth;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxAudioBitDepth>(GetChild<KaxTrackAudio>(*m_track_entry)).SetValue(m_haudio_bit_depth);
+  }
 }
 
 void
 generic_packetizer_c::set_video_interlaced_flag(bool interlaced) {
   m_hvideo_interlaced_flag = interlaced ? 1 : 0;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxVideoFlagInterlaced>(GetChild<KaxTrackVideo>(*m_track_entry)).SetValue(m_hvideo_interlaced_flag);
+  }
 }
 
 void
 generic_packetizer_c::set_video_pixel_width(int width) {
   m_hvideo_pixel_width = width;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxVideoPixelWidth>(GetChild<KaxTrackVideo>(*m_track_entry)).SetValue(m_hvideo_pixel_width);
+  }
 }
 
 void
 generic_packetizer_c::set_video_pixel_height(int height) {
   m_hvideo_pixel_height = height;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxVideoPixelHeight>(GetChild<KaxTrackVideo>(*m_track_entry)).SetValue(m_hvideo_pixel_height);
+  }
 }
 
 void
@@ -483,15 +522,19 @@ generic_packetizer_c::set_video_pixel_dimensions(int width,
 void
 generic_packetizer_c::set_video_display_width(int width) {
   m_hvideo_display_width = width;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxVideoDisplayWidth>(GetChild<KaxTrackVideo>(*m_track_entry)).SetValue(m_hvideo_display_width);
+  }
 }
 
 void
 generic_packetizer_c::set_video_display_height(int height) {
   m_hvideo_display_height = height;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxVideoDisplayHeight>(GetChild<KaxTrackVideo>(*m_track_entry)).SetValue(m_hvideo_display_height);
+  }
 }
 
 void
@@ -545,8 +588,10 @@ generic_packetizer_c::set_as_default_track(int type,
 void
 generic_packetizer_c::set_language(const std::string &language) {
   m_ti.m_language = language;
-  if (m_track_entry)
+  if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     GetChild<KaxTrackLanguage>(m_track_entry).SetValue(m_ti.m_language);
+  }
 }
 
 void
@@ -558,6 +603,8 @@ generic_packetizer_c::set_video_pixel_cropping(int left,
   m_ti.m_pixel_cropping.set(pixel_crop_t{left, top, right, bottom}, source);
 
   if (m_track_entry) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
+
     KaxTrackVideo &video = GetChild<KaxTrackVideo>(m_track_entry);
     auto crop            = m_ti.m_pixel_cropping.get();
 
@@ -579,8 +626,10 @@ generic_packetizer_c::set_video_stereo_mode(stereo_mode_c::mode stereo_mode,
                                             option_source_e source) {
   m_ti.m_stereo_mode.set(stereo_mode, source);
 
-  if (m_track_entry && (stereo_mode_c::unspecified != m_ti.m_stereo_mode.get()))
+  if (m_track_entry && (stereo_mode_c::unspecified != m_ti.m_stereo_mode.get())) {
+    std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
     set_video_stereo_mode_impl(GetChild<KaxTrackVideo>(*m_track_entry), m_ti.m_stereo_mode.get());
+  }
 }
 
 void
@@ -797,8 +846,13 @@ generic_packetizer_c::add_packet(packet_cptr pack) {
       && (pack->data_adds.size()  > static_cast<size_t>(m_htrack_max_add_block_ids)))
     pack->data_adds.resize(m_htrack_max_add_block_ids);
 
-  if (m_compressor) {
+  if (m_compressor && g_compression_workers && m_compressor->supports_parallel_compression())
+    compress_in_background(*pack);
+
+  else if (m_compressor) {
     try {
+      profiling_timer_c timer{profiling_c::stage_compression, pack->data->get_size(), 1};
+
       pack->data = m_compressor->compress(pack->data);
       size_t i;
       for (i = 0; pack->data_adds.size() > i; ++i)
@@ -826,6 +880,36 @@ generic_packetizer_c::add_packet(packet_cptr pack) {
     m_deferred_packets.push_back(pack);
 }
 
+/** \brief Hands the compression of a packet's data over to the worker threads
+
+   The packet keeps its uncompressed data until the main loop replaces
+   it with the compressed data right before the packet is added to a
+   cluster; see packet_t::wait_for_compression(). All decisions made
+   before that point are therefore based on the uncompressed size and
+   don't depend on how fast the workers are.
+*/
+void
+generic_packetizer_c::compress_in_background(packet_t &pack) {
+  // The workers must not access buffers still owned by the reader.
+  pack.data->grab();
+  for (auto &data_add : pack.data_adds)
+    data_add->grab();
+
+  auto compressor = m_compressor;
+  auto data       = pack.data;
+  auto data_adds  = pack.data_adds;
+
+  pack.pending_compression = g_compression_workers->submit([compressor, data, data_adds]() -> memories_c {
+    profiling_timer_c timer{profiling_c::stage_compression, data->get_size(), 1};
+
+    auto compressed = memories_c{ compressor->compress(data) };
+    for (auto &data_add : data_adds)
+      compressed.push_back(compressor->compress(data_add));
+
+    return compressed;
+  }).share();
+}
+
 #define ADJUST_TIMECODE(x) (int64_t)((x + m_correction_timecode_offset + m_append_timecode_offset) * m_ti.m_tcsync.numerator / m_ti.m_tcsync.denominator) + m_ti.m_tcsync.displacement
 
 void
@@ -1192,9 +1276,18 @@ generic_packetizer_c::create_track_number() {
 
 file_status_e
 generic_packetizer_c::read() {
+  profiling_timer_c timer{profiling_c::stage_reading};
+
   return m_reader->read(this);
 }
 
+int
+generic_packetizer_c::process(packet_cptr packet) {
+  profiling_timer_c timer{profiling_c::stage_packetizing, packet->data ? packet->data->get_size() : 0, 1};
+
+  return process_impl(packet);
+}
+
 void
 generic_packetizer_c::prevent_lacing() {
   m_prevent_lacing = true;
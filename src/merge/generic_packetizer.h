@@ -137,7 +137,8 @@ public:
   inline int process(packet_t *packet) {
     return process(packet_cptr(packet));
   }
-  virtual int process(packet_cptr packet) = 0;
+  int process(packet_cptr packet);
+  virtual int process_impl(packet_cptr packet) = 0;
 
   virtual void set_cue_creation(cue_strategy_e create_cue_data) {
     m_ti.m_cues = create_cue_data;
@@ -263,6 +264,8 @@ protected:
   };
 
   virtual void show_experimental_status_version(std::string const &codec_id);
+
+  void compress_in_background(packet_t &pack);
 };
 
 extern std::vector<generic_packetizer_c *> ptzrs_in_header_order;
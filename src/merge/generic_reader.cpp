@@ -95,6 +95,13 @@ generic_reader_c::read_all() {
       ;
 }
 
+bool
+generic_reader_c::is_holding(generic_packetizer_c *,
+                             int64_t)
+  const {
+  return false;
+}
+
 bool
 generic_reader_c::demuxing_requested(char type,
                                      int64_t id,
@@ -412,6 +419,18 @@ generic_reader_c::get_progress() {
   return 100 * m_in->getFilePointer() / m_size;
 }
 
+/** \brief Other files the reader reads or looks for apart from its input
+
+   E.g. the .sub file belonging to a VobSub .idx file. Files that are
+   only looked for are included as well as their appearance would
+   change the result.
+*/
+std::vector<bfs::path>
+generic_reader_c::get_side_file_names()
+  const {
+  return std::vector<bfs::path>{};
+}
+
 mm_io_c *
 generic_reader_c::get_underlying_input()
   const {
@@ -83,6 +83,10 @@ public:
   virtual void read_headers() = 0;
   virtual file_status_e read(generic_packetizer_c *ptzr, bool force = false) = 0;
   virtual void read_all();
+  virtual bool is_holding(generic_packetizer_c *requested_ptzr, int64_t num_queued_bytes) const;
+  virtual bool supports_pipelined_reading() const {
+    return true;
+  }
   virtual int get_progress();
   virtual void set_headers();
   virtual void set_headers_for_track(int64_t tid);
@@ -122,6 +126,9 @@ public:
 
   virtual void display_identification_results();
 
+  virtual mm_io_c *get_underlying_input() const;
+  virtual std::vector<bfs::path> get_side_file_names() const;
+
 protected:
   virtual bool demuxing_requested(char type, int64_t id, std::string const &language = "");
 
@@ -135,8 +142,6 @@ protected:
   virtual void id_result_tags(int64_t track_id, int num_entries);
 
   virtual std::string id_escape_string(const std::string &s);
-
-  virtual mm_io_c *get_underlying_input() const;
 };
 
 #endif  // MTX_MERGE_GENERIC_READER_H
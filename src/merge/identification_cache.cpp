@@ -0,0 +1,244 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the persistent cache of identification results
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#if !defined(SYS_WINDOWS)
+# include <sys/stat.h>
+#endif
+
+#include "common/checksums/base.h"
+#include "common/mm_io_x.h"
+#include "common/strings/formatting.h"
+#include "merge/identification_cache.h"
+
+namespace {
+
+char const s_magic[]          = "mtxidc02";
+size_t const s_magic_size     = 8;
+std::string const s_extension = ".mtxidc";
+
+struct file_properties_t {
+  std::string m_name;
+  uint64_t m_size, m_time, m_inode;
+};
+
+file_properties_t
+get_file_properties(bfs::path const &file_name) {
+  auto properties = file_properties_t{ bfs::system_complete(file_name).string(), 0, 0, 0 };
+
+  boost::system::error_code ec;
+  properties.m_size = bfs::file_size(file_name, ec);
+  if (ec)
+    properties.m_size = 0;
+
+  properties.m_time = bfs::last_write_time(file_name, ec);
+  if (ec)
+    properties.m_time = 0;
+
+#if !defined(SYS_WINDOWS)
+  struct stat st;
+  if (!stat(file_name.string().c_str(), &st))
+    properties.m_inode = st.st_ino;
+#endif
+
+  return properties;
+}
+
+void
+write_string(mm_io_c &out,
+             std::string const &s) {
+  out.write_uint64_be(s.size());
+  out.write(s.c_str(), s.size());
+}
+
+std::string
+read_string(mm_io_c &in) {
+  auto size = in.read_uint64_be();
+  if (size > static_cast<uint64_t>(in.get_size()))
+    throw mtx::mm_io::end_of_file_x{};
+
+  auto buffer = in.read(size);
+  return std::string{reinterpret_cast<char const *>(buffer->get_buffer()), static_cast<std::string::size_type>(size)};
+}
+
+}
+
+identification_cache_c::identification_cache_c(std::string const &cache_dir)
+  : m_cache_dir{cache_dir}
+  , m_debug{"identification_cache"}
+{
+}
+
+std::string
+identification_cache_c::get_entry_file_name(std::string const &file_name,
+                                            std::string const &variant)
+  const {
+  auto key  = bfs::system_complete(bfs::path{file_name}).string() + '\0' + variant;
+  auto hash = to_hex(mtx::checksum::calculate(mtx::checksum::algorithm_e::md5, key.c_str(), key.length()), true);
+
+  return (bfs::path{m_cache_dir} / (hash + s_extension)).string();
+}
+
+/** \brief Look up the identification result for a file
+
+   \return The cached result of the identification or nothing if there's
+     no entry or if one of the files the entry depends on has changed.
+*/
+boost::optional<identification_cache_c::entry_t>
+identification_cache_c::lookup(std::string const &file_name,
+                               std::string const &variant) {
+  auto entry_file_name = get_entry_file_name(file_name, variant);
+  auto entry           = entry_t{};
+
+  try {
+    mm_file_io_c in{entry_file_name};
+
+    auto magic = in.read(s_magic_size);
+    if (std::string{reinterpret_cast<char const *>(magic->get_buffer()), s_magic_size} != std::string{s_magic, s_magic_size})
+      return boost::optional<entry_t>{};
+
+    // Guard against hash collisions.
+    if (   (read_string(in) != bfs::system_complete(bfs::path{file_name}).string())
+        || (read_string(in) != variant))
+      return boost::optional<entry_t>{};
+
+    auto num_files = in.read_uint64_be();
+    for (auto idx = 0u; idx < num_files; ++idx) {
+      auto name       = read_string(in);
+      auto size       = in.read_uint64_be();
+      auto time       = in.read_uint64_be();
+      auto inode      = in.read_uint64_be();
+      auto properties = get_file_properties(bfs::path{name});
+
+      if ((properties.m_size != size) || (properties.m_time != time) || (properties.m_inode != inode)) {
+        mxdebug_if(m_debug, boost::format("lookup: entry for %1% is outdated: %2% has changed\n") % file_name % name);
+        return boost::optional<entry_t>{};
+      }
+    }
+
+    entry.m_result = read_string(in);
+
+    auto num_warnings = in.read_uint64_be();
+    for (auto idx = 0u; idx < num_warnings; ++idx)
+      entry.m_warnings.push_back(read_string(in));
+
+    entry.m_exit_code = in.read_uint32_be();
+
+  } catch (mtx::mm_io::exception &) {
+    return boost::optional<entry_t>{};
+  }
+
+  // Keep recently used entries when pruning.
+  boost::system::error_code ec;
+  bfs::last_write_time(bfs::path{entry_file_name}, std::time(nullptr), ec);
+
+  mxdebug_if(m_debug, boost::format("lookup: hit for %1% in %2%\n") % file_name % entry_file_name);
+
+  return entry;
+}
+
+/** \brief Store the identification result for a file
+
+   \c dependencies are all the files the result depends on apart from
+   \c file_name itself. Failures are ignored as the cache is only an
+   optimization.
+*/
+void
+identification_cache_c::store(std::string const &file_name,
+                              std::string const &variant,
+                              std::vector<bfs::path> const &dependencies,
+                              entry_t const &entry) {
+  auto entry_file_name = get_entry_file_name(file_name, variant);
+  auto files           = std::vector<file_properties_t>{ get_file_properties(bfs::path{file_name}) };
+
+  for (auto const &dependency : dependencies)
+    files.push_back(get_file_properties(dependency));
+
+  boost::system::error_code ec;
+  if (!bfs::is_directory(bfs::path{m_cache_dir}))
+    bfs::create_directories(bfs::path{m_cache_dir}, ec);
+
+  try {
+    mm_file_io_c out{entry_file_name, MODE_CREATE};
+
+    out.write(s_magic, s_magic_size);
+    write_string(out, files.front().m_name);
+    write_string(out, variant);
+
+    out.write_uint64_be(files.size());
+    for (auto const &file : files) {
+      write_string(out, file.m_name);
+      out.write_uint64_be(file.m_size);
+      out.write_uint64_be(file.m_time);
+      out.write_uint64_be(file.m_inode);
+    }
+
+    write_string(out, entry.m_result);
+
+    out.write_uint64_be(entry.m_warnings.size());
+    for (auto const &warning : entry.m_warnings)
+      write_string(out, warning);
+
+    out.write_uint32_be(entry.m_exit_code);
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxdebug_if(m_debug, boost::format("store: writing %1% failed: %2%\n") % entry_file_name % ex);
+    bfs::remove(bfs::path{entry_file_name}, ec);
+    return;
+  }
+
+  prune();
+}
+
+void
+identification_cache_c::prune() {
+  struct entry_t {
+    bfs::path m_name;
+    std::time_t m_time;
+    uintmax_t m_size;
+  };
+
+  auto entries    = std::vector<entry_t>{};
+  auto total_size = uintmax_t{};
+
+  boost::system::error_code ec;
+  for (auto it = bfs::directory_iterator{bfs::path{m_cache_dir}, ec}, end = bfs::directory_iterator{}; !ec && (it != end); it.increment(ec)) {
+    if (it->path().extension().string() != s_extension)
+      continue;
+
+    auto entry = entry_t{ it->path(), bfs::last_write_time(it->path(), ec), bfs::file_size(it->path(), ec) };
+    if (ec)
+      continue;
+
+    entries.push_back(entry);
+    total_size += entry.m_size;
+  }
+
+  if (total_size <= ms_max_cache_size)
+    return;
+
+  // Remove the least recently used entries until a quarter of the
+  // cache is free again so that this doesn't happen on each run.
+  brng::sort(entries, [](entry_t const &a, entry_t const &b) { return a.m_time < b.m_time; });
+
+  for (auto const &entry : entries) {
+    if (total_size <= (ms_max_cache_size / 4 * 3))
+      break;
+
+    mxdebug_if(m_debug, boost::format("prune: removing %1%\n") % entry.m_name.string());
+
+    bfs::remove(entry.m_name, ec);
+    total_size -= entry.m_size;
+  }
+}
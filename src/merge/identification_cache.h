@@ -0,0 +1,61 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the persistent cache of identification results
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_IDENTIFICATION_CACHE_H
+#define MTX_MERGE_IDENTIFICATION_CACHE_H
+
+#include "common/common_pch.h"
+
+#include <boost/optional.hpp>
+
+/* Stores the output of '--identify' and its variants in a directory so
+   that identifying the same file again doesn't require probing and
+   parsing it. Each entry is a file of its own named after a hash of the
+   file's absolute name and the identification variant (the mode, the
+   program version, the UI language and the engaged hacks).
+
+   An entry is only used as long as the size, the modification time and
+   the inode of all the files it depends on (e.g. the files referenced by
+   a playlist) haven't changed. The least recently used entries are
+   removed once the cache grows beyond a fixed size.
+
+   Apart from the output an entry contains the warnings issued and the
+   exit code so that a cache hit behaves exactly like identifying the
+   file again.
+*/
+class identification_cache_c {
+public:
+  struct entry_t {
+    std::string m_result;
+    std::vector<std::string> m_warnings;
+    int m_exit_code;
+  };
+
+protected:
+  std::string m_cache_dir;
+  debugging_option_c m_debug;
+
+  static size_t const ms_max_cache_size = 16 * 1024 * 1024;
+
+public:
+  identification_cache_c(std::string const &cache_dir);
+
+  boost::optional<entry_t> lookup(std::string const &file_name, std::string const &variant);
+  void store(std::string const &file_name, std::string const &variant, std::vector<bfs::path> const &dependencies, entry_t const &entry);
+
+protected:
+  std::string get_entry_file_name(std::string const &file_name, std::string const &variant) const;
+  void prune();
+};
+
+#endif  // MTX_MERGE_IDENTIFICATION_CACHE_H
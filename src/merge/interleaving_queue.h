@@ -0,0 +1,72 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the packet interleaving queue
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_INTERLEAVING_QUEUE_H
+#define MTX_MERGE_INTERLEAVING_QUEUE_H
+
+#include "common/common_pch.h"
+
+#include <queue>
+
+#include "common/timecode.h"
+
+/* Keeps track of the next packet of each packetizer that has one and
+   hands out the packetizer whose packet has to be output next.
+
+   Packetizers are identified by their index. The packet with the
+   lowest timecode wins; if several packets have the same timecode then
+   the one from the packetizer with the lowest index wins. This is the
+   same order a linear scan over all packetizers would produce. */
+class interleaving_queue_c {
+protected:
+  struct entry_t {
+    timecode_c m_timecode;
+    size_t m_idx;
+
+    entry_t(timecode_c const &timecode, size_t idx)
+      : m_timecode{timecode}
+      , m_idx{idx}
+    {
+    }
+
+    bool operator >(entry_t const &other) const {
+      return (other.m_timecode < m_timecode)
+          || (!(m_timecode < other.m_timecode) && (m_idx > other.m_idx));
+    }
+  };
+
+  std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> m_queue;
+
+public:
+  void push(size_t idx, timecode_c const &timecode) {
+    m_queue.emplace(timecode, idx);
+  }
+
+  bool empty() const {
+    return m_queue.empty();
+  }
+
+  size_t size() const {
+    return m_queue.size();
+  }
+
+  size_t top() const {
+    return m_queue.top().m_idx;
+  }
+
+  void pop() {
+    m_queue.pop();
+  }
+};
+
+#endif  // MTX_MERGE_INTERLEAVING_QUEUE_H
@@ -140,6 +140,13 @@ kax_block_blob_c::set_block_duration(uint64_t time_length) {
     Block.group->SetBlockDuration(time_length);
 }
 
+// Only valid after the cluster containing the blob has been rendered.
+uint64_t
+kax_block_blob_c::get_element_position()
+  const {
+  return bUseSimpleBlock ? Block.simpleblock->GetElementPosition() : Block.group->GetElementPosition();
+}
+
 // The kax_block_group_c objects are stored in std::shared_ptrs outside of
 // the cluster structure as well. KaxSimpleBlock objects are deleted
 // when they're replaced with kax_block_group_c. All other object
@@ -77,6 +77,7 @@ public:
   bool add_frame_auto(const KaxTrackEntry &track, uint64 timecode, DataBuffer &buffer, LacingType lacing, int64_t past_block, int64_t forw_block);
   void set_block_duration(uint64_t time_length);
   bool replace_simple_by_group();
+  uint64_t get_element_position() const;
 };
 using kax_block_blob_cptr = std::shared_ptr<kax_block_blob_c>;
 
@@ -46,12 +46,16 @@
 #include "common/extern_data.h"
 #include "common/file_types.h"
 #include "common/fs_sys_helpers.h"
+#include "common/hacks.h"
 #include "common/iso639.h"
 #include "common/mm_io.h"
+#include "common/mm_mpls_multi_file_io.h"
+#include "common/mm_multi_file_io.h"
 #include "common/segmentinfo.h"
 #include "common/split_arg_parsing.h"
 #include "common/strings/formatting.h"
 #include "common/strings/parsing.h"
+#include "common/translation.h"
 #include "common/unique_numbers.h"
 #include "common/version.h"
 #include "common/webm.h"
@@ -60,6 +64,7 @@
 #include "merge/cluster_helper.h"
 #include "merge/filelist.h"
 #include "merge/generic_reader.h"
+#include "merge/identification_cache.h"
 #include "merge/output_control.h"
 #include "merge/reader_detection_and_creation.h"
 #include "merge/track_info.h"
@@ -109,11 +114,27 @@ set_usage() {
                   "                           cluster.\n");
   usage_text += Y("  --no-cues                Do not write the cue data (the index).\n");
   usage_text += Y("  --clusters-in-meta-seek  Write meta seek data for clusters.\n");
+  usage_text += Y("  --reserve-space-for-cues <n>\n"
+                  "                           Reserve n KB in front of the clusters and\n"
+                  "                           write the cues there if they fit.\n");
   usage_text += Y("  --disable-lacing         Do not Use lacing.\n");
   usage_text += Y("  --enable-durations       Enable block durations for all blocks.\n");
   usage_text += Y("  --timecode-scale <n>     Force the timecode scale factor to n.\n");
   usage_text += Y("  --disable-track-statistics-tags\n"
                   "                           Do not write tags with track statistics.\n");
+  usage_text += Y("  --pipelined-reading      Demux and packetize source files on separate\n"
+                  "                           threads.\n");
+  usage_text += Y("  --read-ahead <n>         Keep the next n MB of each source file ready\n"
+                  "                           by reading them on a separate thread.\n");
+  usage_text += Y("  --write-buffers <n>      Use n buffers for writing the output file. With\n"
+                  "                           more than one buffer they are written by a\n"
+                  "                           separate thread.\n");
+  usage_text += Y("  --write-buffer-size <n>  Use write buffers of n KB each.\n");
+  usage_text += Y("  --compression-threads <n>\n"
+                  "                           Compress packets on n worker threads.\n");
+  usage_text += Y("  --cluster-index-dir <dir>\n"
+                  "                           Store cluster index files in this directory\n"
+                  "                           instead of next to the source files.\n");
   usage_text +=   "\n";
   usage_text += Y(" File splitting, linking, appending and concatenating (more global options):\n");
   usage_text += Y("  --split <d[K,M,G]|HH:MM:SS|s>\n"
@@ -196,6 +217,10 @@ set_usage() {
   usage_text += Y("  -T, --no-track-tags      Don't copy tags for tracks from the source file.\n");
   usage_text += Y("  --no-global-tags         Don't keep global tags from the source file.\n");
   usage_text += Y("  --no-chapters            Don't keep chapters from the source file.\n");
+  usage_text += Y("  --memory-mapped-reading  Map the source file into memory instead of\n"
+                  "                           reading it with system calls.\n");
+  usage_text += Y("  --cluster-index          Use a cluster index for skipping the data\n"
+                  "                           before the first part when splitting by parts.\n");
   usage_text += Y("  -y, --sync <TID:d[,o[/p]]>\n"
                   "                           Synchronize, adjust the track's timecodes with\n"
                   "                           the id TID by 'd' ms.\n"
@@ -265,6 +290,10 @@ set_usage() {
   usage_text +=   "\n\n";
   usage_text += Y(" Other options:\n");
   usage_text += Y("  -i, --identify <file>    Print information about the source file.\n");
+  usage_text += Y("  --identification-cache <directory>\n"
+                  "                           Store the results of '--identify' in this\n"
+                  "                           directory and re-use them as long as the\n"
+                  "                           file hasn't changed.\n");
   usage_text += Y("  -l, --list-types         Lists supported input file types.\n");
   usage_text += Y("  --list-languages         Lists all ISO639 languages and their\n"
                   "                           ISO639-2 codes.\n");
@@ -278,6 +307,10 @@ set_usage() {
                   "                           Redirects all messages into this file.\n");
   usage_text += Y("  --debug <topic>          Turns on debugging output for 'topic'.\n");
   usage_text += Y("  --engage <feature>       Turns on experimental feature 'feature'.\n");
+  usage_text += Y("  --profile                Outputs the time spent in and the amount of\n"
+                  "                           data processed by each stage at the end.\n");
+  usage_text += Y("  --profile-json <file>    Writes the same information to 'file' in\n"
+                  "                           JSON format.\n");
   usage_text += Y("  @optionsfile             Reads additional command line options from\n"
                   "                           the specified file (see man page).\n");
   usage_text += Y("  -h, --help               Show this help.\n");
@@ -360,14 +393,50 @@ list_file_types() {
     mxinfo(boost::format("  %1% [%2%]\n") % file_type.title % file_type.extensions);
 }
 
+/** \brief Everything the output of the identification depends on apart
+   from the file's content
+*/
+static std::string
+get_identification_variant(bool disable_multi_file) {
+  auto mode    = g_identify_for_mmg ? "mmg" : g_identify_verbose ? "verbose" : "normal";
+  auto variant = (boost::format("%1%|%2%|%3%|%4%|") % get_version_info("mkvmerge", vif_full) % translation_c::get_active_translation().get_locale() % mode % disable_multi_file).str();
+
+  for (auto id = 0u; id <= ENGAGE_MAX_IDX; ++id)
+    variant += hack_engaged(id) ? '1' : '0';
+
+  return variant;
+}
+
+/** \brief The files other than the source file the reader has read or
+   looked for
+*/
+static std::vector<bfs::path>
+get_identification_dependencies(filelist_t const &file) {
+  auto dependencies = std::vector<bfs::path>{};
+  auto multi_in     = dynamic_cast<mm_multi_file_io_c *>(file.reader->get_underlying_input());
+
+  if (file.playlist_mpls_in)
+    dependencies = file.playlist_mpls_in->get_file_names();
+  else if (multi_in)
+    dependencies = multi_in->get_file_names();
+
+  brng::copy(file.reader->get_side_file_names(), std::back_inserter(dependencies));
+
+  return dependencies;
+}
+
 /** \brief Identify a file type and its contents
 
    This function called for \c --identify. It sets up dummy track info
    data for the reader, probes the input file, creates the file reader
    and calls its identify function.
+
+   If a cache directory is given then the results are looked up in and
+   stored in the identification cache.
 */
 static void
-identify(std::string &filename) {
+identify(std::string &filename,
+         std::string const &cache_dir) {
   g_files.emplace_back(new filelist_t);
   auto &file = *g_files.back();
   file.ti    = std::make_unique<track_info_c>();
@@ -384,6 +453,35 @@ identify(std::string &filename) {
   file.name           = filename;
   file.all_names.push_back(filename);
 
+  auto cache   = cache_dir.empty() ? std::shared_ptr<identification_cache_c>{} : std::make_shared<identification_cache_c>(cache_dir);
+  auto variant = get_identification_variant(file.ti->m_disable_multi_file);
+
+  if (cache) {
+    auto entry = cache->lookup(filename, variant);
+    if (entry) {
+      for (auto const &warning : entry->m_warnings)
+        mxwarn(warning);
+      if (entry->m_exit_code)
+        g_warning_issued = true;
+
+      mxinfo(entry->m_result);
+      g_files.clear();
+      return;
+    }
+  }
+
+  // Remember the warnings for the cache entry in addition to
+  // outputting them as usual.
+  auto entry           = identification_cache_c::entry_t{};
+  auto info_handler    = get_mxmsg_handler(MXMSG_INFO);
+  auto warning_handler = get_mxmsg_handler(MXMSG_WARNING);
+
+  if (cache)
+    set_mxmsg_handler(MXMSG_WARNING, [&entry, warning_handler](unsigned int level, std::string const &warning) {
+      entry.m_warnings.push_back(warning);
+      warning_handler(level, warning);
+    });
+
   get_file_type(file);
 
   if (FILE_TYPE_IS_UNKNOWN == file.type)
@@ -394,7 +492,22 @@ identify(std::string &filename) {
   create_readers();
 
   file.reader->identify();
+
+  if (!cache) {
+    file.reader->display_identification_results();
+    g_files.clear();
+    return;
+  }
+
+  set_mxmsg_handler(MXMSG_INFO, [&entry](unsigned int, std::string const &info) { entry.m_result += info; });
   file.reader->display_identification_results();
+  set_mxmsg_handler(MXMSG_INFO,    info_handler);
+  set_mxmsg_handler(MXMSG_WARNING, warning_handler);
+
+  entry.m_exit_code = g_warning_issued ? 1 : 0;
+
+  cache->store(filename, variant, get_identification_dependencies(file), entry);
+  mxinfo(entry.m_result);
 
   g_files.clear();
 }
@@ -1781,6 +1894,19 @@ parse_common_args(std::vector<std::string> args) {
 
 static void
 parse_args(std::vector<std::string> args) {
+  // The identification cache is only used together with --identify and
+  // must therefore be removed before checking for it.
+  auto identification_cache_dir = std::string{};
+  for (auto idx = 0u; idx < args.size(); ++idx)
+    if (args[idx] == "--identification-cache") {
+      if ((idx + 1) == args.size())
+        mxerror(Y("'--identification-cache' lacks the directory name.\n"));
+
+      identification_cache_dir = args[idx + 1];
+      args.erase(args.begin() + idx, args.begin() + idx + 2);
+      break;
+    }
+
   // Check if only information about the file is wanted. In this mode only
   // two parameters are allowed: the --identify switch and the file.
   if ((   (2 == args.size())
@@ -1801,10 +1927,13 @@ parse_args(std::vector<std::string> args) {
     if (3 == args.size())
       verbose = 3;
 
-    identify(args[1]);
+    identify(args[1], identification_cache_dir);
     mxexit();
   }
 
+  if (!identification_cache_dir.empty())
+    mxerror(Y("'--identification-cache' can only be used together with '--identify'.\n"));
+
   // First parse options that either just print some infos and then exit.
   for (auto sit = args.cbegin(), sit_end = args.cend(); sit != sit_end; sit++) {
     auto const &this_arg = *sit;
@@ -1962,6 +2091,18 @@ parse_args(std::vector<std::string> args) {
     else if (this_arg == "--clusters-in-meta-seek")
       g_write_meta_seek_for_clusters = true;
 
+    else if (this_arg == "--reserve-space-for-cues") {
+      if (no_next_arg)
+        mxerror(Y("'--reserve-space-for-cues' lacks the size.\n"));
+
+      size_t size_in_kb = 0;
+      if (!parse_number(next_arg, size_in_kb) || !size_in_kb || ((1024 * 1024) < size_in_kb))
+        mxerror(boost::format(Y("Invalid size in '--reserve-space-for-cues %1%'.\n")) % next_arg);
+
+      g_reserved_space_for_cues = size_in_kb * 1024;
+      sit++;
+    }
+
     else if (this_arg == "--disable-lacing")
       g_no_lacing = true;
 
@@ -1971,6 +2112,57 @@ parse_args(std::vector<std::string> args) {
     else if (this_arg == "--disable-track-statistics-tags")
       g_no_track_statistics_tags = true;
 
+    else if (this_arg == "--pipelined-reading")
+      g_pipelined_reading = true;
+
+    else if (this_arg == "--read-ahead") {
+      if (no_next_arg)
+        mxerror(Y("'--read-ahead' lacks the size.\n"));
+
+      size_t size_in_mb = 0;
+      if (!parse_number(next_arg, size_in_mb) || (1024 < size_in_mb))
+        mxerror(boost::format(Y("Invalid read-ahead size in '--read-ahead %1%'.\n")) % next_arg);
+
+      g_read_ahead_size = size_in_mb * 1024 * 1024;
+      sit++;
+
+    } else if (this_arg == "--write-buffers") {
+      if (no_next_arg)
+        mxerror(Y("'--write-buffers' lacks the number of buffers.\n"));
+
+      if (!parse_number(next_arg, g_num_write_buffers) || !g_num_write_buffers || (256 < g_num_write_buffers))
+        mxerror(boost::format(Y("Invalid number of write buffers in '--write-buffers %1%'.\n")) % next_arg);
+
+      sit++;
+
+    } else if (this_arg == "--write-buffer-size") {
+      if (no_next_arg)
+        mxerror(Y("'--write-buffer-size' lacks the size.\n"));
+
+      size_t size_in_kb = 0;
+      if (!parse_number(next_arg, size_in_kb) || (4 > size_in_kb) || ((1024 * 1024) < size_in_kb))
+        mxerror(boost::format(Y("Invalid write buffer size in '--write-buffer-size %1%'.\n")) % next_arg);
+
+      g_write_buffer_size = size_in_kb * 1024;
+      sit++;
+
+    } else if (this_arg == "--compression-threads") {
+      if (no_next_arg)
+        mxerror(Y("'--compression-threads' lacks the number of threads.\n"));
+
+      if (!parse_number(next_arg, g_num_compression_threads) || (256 < g_num_compression_threads))
+        mxerror(boost::format(Y("Invalid number of threads in '--compression-threads %1%'.\n")) % next_arg);
+
+      sit++;
+
+    } else if (this_arg == "--cluster-index-dir") {
+      if (no_next_arg)
+        mxerror(Y("'--cluster-index-dir' lacks the directory.\n"));
+
+      g_cluster_index_dir = next_arg;
+      sit++;
+    }
+
     else if (this_arg == "--attachment-description") {
       if (no_next_arg)
         mxerror(Y("'--attachment-description' lacks the description.\n"));
@@ -2076,6 +2268,12 @@ parse_args(std::vector<std::string> args) {
     } else if (this_arg == "--no-global-tags")
       ti->m_no_global_tags = true;
 
+    else if (this_arg == "--memory-mapped-reading")
+      ti->m_memory_mapped_reading = true;
+
+    else if (this_arg == "--cluster-index")
+      ti->m_use_cluster_index = true;
+
     else if (this_arg == "--meta-seek-size") {
       mxwarn(Y("The option '--meta-seek-size' is no longer supported. Please read mkvmerge's documentation, especially the section about the MATROSKA FILE LAYOUT.\n"));
       sit++;
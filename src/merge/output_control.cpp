@@ -18,6 +18,7 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <cmath>
 #include <iostream>
+#include <set>
 #include <typeinfo>
 
 #include <ebml/EbmlHead.h>
@@ -65,7 +66,9 @@
 #include "merge/filelist.h"
 #include "merge/generic_packetizer.h"
 #include "merge/generic_reader.h"
+#include "merge/interleaving_queue.h"
 #include "merge/output_control.h"
+#include "merge/reader_thread.h"
 #include "merge/webm.h"
 
 using namespace libmatroska;
@@ -106,6 +109,15 @@ bool g_no_lacing                            = false;
 bool g_no_linking                           = true;
 bool g_use_durations                        = false;
 bool g_no_track_statistics_tags             = false;
+bool g_pipelined_reading                    = false;
+std::string g_cluster_index_dir;
+
+size_t g_write_buffer_size                  = 20 * 1024 * 1024;
+size_t g_num_write_buffers                  = 1;
+size_t g_num_compression_threads            = 0;
+size_t g_reserved_space_for_cues            = 0;
+size_t g_read_ahead_size                    = 0;
+worker_pool_cptr g_compression_workers;
 
 double g_timecode_scale                     = TIMECODE_SCALE;
 timecode_scale_mode_e g_timecode_scale_mode = TIMECODE_SCALE_MODE_NORMAL;
@@ -156,18 +168,28 @@ bitvalue_cptr g_seguid_link_previous;
 bitvalue_cptr g_seguid_link_next;
 std::deque<bitvalue_cptr> g_forced_seguids;
 
+// Serializes access to the output file and to the track headers
+// between the main loop and the reader threads.
+std::recursive_mutex g_output_mutex;
+
 std::unique_ptr<KaxInfo> s_kax_infos;
 static KaxMyDuration *s_kax_duration;
 
 static std::unique_ptr<KaxTags> s_kax_tags;
 static kax_chapters_cptr s_chapters_in_this_file;
 
+// The main loop only asks packetizers for data that don't have a
+// packet waiting already; those are kept in the interleaving queue.
+static interleaving_queue_c s_interleaving_queue;
+static std::set<size_t> s_packetizers_to_pull;
+
 static std::unique_ptr<KaxAttachments> s_kax_as;
 
 static std::unique_ptr<EbmlVoid> s_kax_sh_void;
 static std::unique_ptr<EbmlVoid> s_kax_chapters_void;
 static int64_t s_max_chapter_size           = 0;
 static std::unique_ptr<EbmlVoid> s_void_after_track_headers;
+static std::unique_ptr<EbmlVoid> s_kax_cues_void;
 
 static mm_io_cptr s_out;
 
@@ -286,6 +308,15 @@ determine_display_reader() {
   return winner->reader.get();
 }
 
+static int
+get_reader_progress(generic_reader_c &reader) {
+  for (auto const &file : g_files)
+    if ((file->reader.get() == &reader) && file->reader_thread)
+      return file->reader_thread->get_progress();
+
+  return reader.get_progress();
+}
+
 /** \brief Selects a reader for displaying its progress information
 */
 static void
@@ -309,7 +340,7 @@ display_progress(bool is_100percent = false) {
     s_display_reader = determine_display_reader();
 
   bool display_progress  = false;
-  int current_percentage = (s_display_reader->get_progress() + s_display_files_done * 100) / s_display_path_length;
+  int current_percentage = (get_reader_progress(*s_display_reader) + s_display_files_done * 100) / s_display_path_length;
   int64_t current_time   = mtx::sys::get_current_time_millis();
 
   if (   (-1 == s_previous_percentage)
@@ -441,6 +472,8 @@ set_timecode_scale() {
 
 bool
 set_required_matroska_version(unsigned int required_version) {
+  std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
+
   auto previous               = s_required_matroska_version;
   s_required_matroska_version = std::max(s_required_matroska_version, required_version);
   auto version_changed        = s_required_matroska_version != previous;
@@ -453,6 +486,8 @@ set_required_matroska_version(unsigned int required_version) {
 
 bool
 set_required_matroska_read_version(unsigned int required_read_version) {
+  std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
+
   auto previous                    = s_required_matroska_read_version;
   s_required_matroska_read_version = std::max(s_required_matroska_read_version, required_read_version);
 
@@ -485,6 +520,8 @@ render_ebml_head(mm_io_c *out) {
 
 void
 rerender_ebml_head() {
+  std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
+
   mm_io_c *out = g_cluster_helper->get_output();
 
   if (!out || !s_head)
@@ -705,22 +742,55 @@ adjust_cue_and_seekhead_positions(int64_t original_offset,
 }
 
 static void
-render_void(int64_t new_size) {
+render_void(std::unique_ptr<EbmlVoid> &void_element,
+            int64_t new_size) {
   auto actual_size = new_size;
 
-  s_void_after_track_headers = std::make_unique<EbmlVoid>();
-  s_void_after_track_headers->SetSize(new_size);
-  s_void_after_track_headers->UpdateSize();
+  void_element = std::make_unique<EbmlVoid>();
+  void_element->SetSize(new_size);
+  void_element->UpdateSize();
 
-  while (static_cast<int64_t>(s_void_after_track_headers->ElementSize()) > new_size)
-    s_void_after_track_headers->SetSize(--actual_size);
+  while (static_cast<int64_t>(void_element->ElementSize()) > new_size)
+    void_element->SetSize(--actual_size);
 
-  if (static_cast<int64_t>(s_void_after_track_headers->ElementSize()) < new_size)
-    s_void_after_track_headers->SetSizeLength(new_size - actual_size - 1);
+  if (static_cast<int64_t>(void_element->ElementSize()) < new_size)
+    void_element->SetSizeLength(new_size - actual_size - 1);
 
   mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] render_void new_size %1% actual_size %2% size_length %3%\n") % new_size % actual_size % (new_size - actual_size - 1));
 
-  s_void_after_track_headers->Render(*s_out);
+  void_element->Render(*s_out);
+}
+
+/** \brief Writes the cues into the space reserved for them
+
+   Falls back to writing them at the current position, meaning after
+   the clusters, if no space has been reserved or if the cues don't fit
+   into it. Whatever is left of the reserved space is turned into a
+   smaller EbmlVoid element. A single byte cannot be filled that way.
+*/
+static void
+render_cues() {
+  auto &cues = cues_c::get();
+
+  if (s_kax_cues_void) {
+    auto reserved_size = static_cast<int64_t>(s_kax_cues_void->ElementSize());
+    auto cues_size     = static_cast<int64_t>(cues.calculate_element_size());
+    auto remaining     = reserved_size - cues_size;
+
+    if ((0 == remaining) || (2 <= remaining)) {
+      s_out->save_pos(s_kax_cues_void->GetElementPosition());
+      cues.write(*s_out, *g_kax_sh_main);
+      if (remaining)
+        render_void(s_kax_cues_void, remaining);
+      s_out->restore_pos();
+
+      return;
+    }
+
+    // The user has already been warned by cues_c while muxing.
+  }
+
+  cues.write(*s_out, *g_kax_sh_main);
 }
 
 /** \brief Overwrites the track headers with current values
@@ -730,6 +800,8 @@ render_void(int64_t new_size) {
 */
 void
 rerender_track_headers() {
+  std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
+
   g_kax_tracks->UpdateSize(false);
 
   int64_t new_void_size       = s_void_after_track_headers->GetElementPosition() + s_void_after_track_headers->ElementSize() - g_kax_tracks->GetElementPosition() - g_kax_tracks->ElementSize();
@@ -741,7 +813,7 @@ rerender_track_headers() {
     s_out->save_pos(g_kax_tracks->GetElementPosition());
 
     g_kax_tracks->Render(*s_out, false);
-    render_void(new_void_size);
+    render_void(s_void_after_track_headers, new_void_size);
 
     s_out->restore_pos();
 
@@ -760,6 +832,29 @@ rerender_track_headers() {
     return;
   }
 
+  // The cues placeholder directly follows the track headers' void if
+  // neither attachments nor chapters have been written. Instead of
+  // moving everything behind it the track headers can grow into it.
+  if (s_kax_cues_void && (s_kax_cues_void->GetElementPosition() == (s_void_after_track_headers->GetElementPosition() + s_void_after_track_headers->ElementSize()))) {
+    int64_t new_cues_void_size = s_kax_cues_void->GetElementPosition() + s_kax_cues_void->ElementSize() - projected_new_void_pos - 4;
+
+    if (2 <= new_cues_void_size) {
+      s_out->save_pos(g_kax_tracks->GetElementPosition());
+
+      g_kax_tracks->Render(*s_out, false);
+      render_void(s_void_after_track_headers, 4);
+      render_void(s_kax_cues_void, new_cues_void_size);
+
+      s_out->restore_pos();
+
+      cues_c::get().set_reserved_space(new_cues_void_size);
+
+      mxdebug_if(s_debug_rerender_track_headers, boost::format("[rerender] Taking space from the cues placeholder; its new size is %1%\n") % new_cues_void_size);
+
+      return;
+    }
+  }
+
   auto current_pos       = s_out->getFilePointer();
   int64_t data_start_pos = s_void_after_track_headers->GetElementPosition() + s_void_after_track_headers->ElementSize(true);
   int64_t data_size      = s_out->get_size() - data_start_pos;
@@ -781,7 +876,7 @@ rerender_track_headers() {
   s_out->setFilePointer(g_kax_tracks->GetElementPosition());
   g_kax_tracks->Render(*s_out, false);
 
-  render_void(1024);
+  render_void(s_void_after_track_headers, 1024);
 
   int64_t new_data_start_pos = s_out->getFilePointer();
 
@@ -1225,6 +1320,23 @@ render_chapter_void_placeholder() {
   s_kax_chapters_void->Render(*s_out);
 }
 
+/** \brief Reserve space for the cues in front of the clusters
+
+    If the user has requested it then an EbmlVoid element of that size
+    is written right before the first cluster. If the cues fit into it
+    during \c finish_file() then they're written there instead of after
+    the clusters. Players can then use the index without having to read
+    the whole file first, e.g. during progressive downloads.
+ */
+static void
+render_cues_void_placeholder() {
+  if (!g_write_cues || !g_reserved_space_for_cues)
+    return;
+
+  render_void(s_kax_cues_void, g_reserved_space_for_cues);
+  cues_c::get().set_reserved_space(g_reserved_space_for_cues);
+}
+
 /** \brief Prepare tag elements for rendering
 
     Adds missing mandatory elements to the tag structures and sorts
@@ -1267,7 +1379,7 @@ create_next_output_file() {
 
   // Open the output file.
   try {
-    s_out = !g_cluster_helper->discarding() ? mm_write_buffer_io_c::open(this_outfile, 20 * 1024 * 1024) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
+    s_out = !g_cluster_helper->discarding() ? mm_write_buffer_io_c::open(this_outfile, g_write_buffer_size, g_num_write_buffers) : mm_io_cptr{ new mm_null_io_c{this_outfile} };
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("The file '%1%' could not be opened for writing: %2%.\n")) % this_outfile % ex);
   }
@@ -1280,6 +1392,7 @@ create_next_output_file() {
   render_headers(s_out.get());
   render_attachments(s_out.get());
   render_chapter_void_placeholder();
+  render_cues_void_placeholder();
   add_tags_from_cue_chapters();
   prepare_tags_for_rendering();
 
@@ -1393,7 +1506,7 @@ finish_file(bool last_file,
   if (g_write_cues && g_cue_writing_requested) {
     if (do_output)
       mxinfo(Y("The cue entries (the index) are being written...\n"));
-    cues_c::get().write(*s_out, *g_kax_sh_main);
+    render_cues();
   }
 
   // Now re-render the s_kax_duration and fill in the biggest timecode
@@ -1512,12 +1625,20 @@ finish_file(bool last_file,
   if (g_kax_segment->ForceSize(final_file_size - g_kax_segment->GetElementPosition() - g_kax_segment->HeadSize()))
     g_kax_segment->OverwriteHead(*s_out);
 
+  auto wb_out = dynamic_cast<mm_write_buffer_io_c *>(s_out.get());
+  if (wb_out && wb_out->is_asynchronous()) {
+    wb_out->flush();
+    if (do_output)
+      mxinfo(boost::format(Y("Time spent waiting for the output file to be written: %1%.\n")) % format_timecode(wb_out->get_blocked_time(), 3));
+  }
+
   s_out.reset();
 
   g_kax_segment.reset();
   s_kax_sh_void.reset();
   g_kax_sh_main.reset();
   s_void_after_track_headers.reset();
+  s_kax_cues_void.reset();
   g_kax_sh_cues.reset();
   s_head.reset();
 }
@@ -1673,6 +1794,8 @@ append_track(packetizer_t &ptzr,
   ptzr.file                            = amap.src_file_id;
   ptzr.status                          = FILE_STATUS_MOREDATA;
 
+  s_packetizers_to_pull.insert(&ptzr - &g_packetizers[0]);
+
   // If we're dealing with a subtitle track or if the appending file contains
   // chapters then we have to do some magic. During splitting timecodes are
   // offset by a certain amount. This amount is NOT the duration of the
@@ -1801,25 +1924,87 @@ establish_deferred_connections(filelist_t &file) {
   // \todo Select a new file that the subs will defer to.
 }
 
+/** \brief Start reader threads if pipelined reading is enabled
+
+   Each eligible reader is run on its own thread. Files that take part
+   in appending are excluded as the connections between their
+   packetizers change while muxing, and so is splitting as new output
+   files re-render the track headers at arbitrary times.
+*/
+static void
+start_reader_threads() {
+  if (!g_pipelined_reading || g_cluster_helper->splitting())
+    return;
+
+  for (auto &file : g_files) {
+    if (   file->appending
+        || file->appended_to
+        || file->is_playlist
+        || !file->reader->get_num_packetizers()
+        || !file->reader->supports_pipelined_reading())
+      continue;
+
+    file->reader_thread = std::make_shared<reader_thread_c>(*file->reader);
+    file->reader_thread->start();
+  }
+}
+
+static void
+stop_reader_threads() {
+  for (auto &file : g_files)
+    if (file->reader_thread) {
+      file->reader_thread->stop();
+      file->reader_thread.reset();
+    }
+}
+
+/** \brief Request packets from packetizers that don't have one
+
+   Only packetizers without a packet that aren't done yet are asked
+   for data: the one whose packet has been output last, the ones that
+   were holding and the ones that have been appended to. They're asked
+   in the order of their index, which results in the same sequence of
+   read() calls as asking all packetizers would.
+*/
 static void
 pull_packetizers_for_packets() {
-  for (auto &ptzr : g_packetizers) {
+  for (auto itr = s_packetizers_to_pull.begin(); itr != s_packetizers_to_pull.end();) {
+    auto idx   = *itr;
+    auto &ptzr = g_packetizers[idx];
+
     if (FILE_STATUS_HOLDING == ptzr.status)
       ptzr.status = FILE_STATUS_MOREDATA;
 
     ptzr.old_status = ptzr.status;
 
-    while (   !ptzr.pack
-           && (FILE_STATUS_MOREDATA == ptzr.status)
-           && !ptzr.packetizer->packet_available())
-      ptzr.status = ptzr.packetizer->read();
+    auto thread = g_files[ptzr.file]->reader_thread.get();
+
+    if (thread) {
+      while (   !ptzr.pack
+             && (FILE_STATUS_MOREDATA == ptzr.status)
+             && !thread->packet_available(ptzr.packetizer))
+        ptzr.status = thread->read(ptzr.packetizer);
+
+      if (   (FILE_STATUS_MOREDATA != ptzr.status)
+          && (FILE_STATUS_MOREDATA == ptzr.old_status))
+        thread->force_duration_on_last_packet(ptzr.packetizer);
 
-    if (   (FILE_STATUS_MOREDATA != ptzr.status)
-           && (FILE_STATUS_MOREDATA == ptzr.old_status))
-      ptzr.packetizer->force_duration_on_last_packet();
+      if (!ptzr.pack)
+        ptzr.pack = thread->get_packet(ptzr.packetizer);
 
-    if (!ptzr.pack)
-      ptzr.pack = ptzr.packetizer->get_packet();
+    } else {
+      while (   !ptzr.pack
+             && (FILE_STATUS_MOREDATA == ptzr.status)
+             && !ptzr.packetizer->packet_available())
+        ptzr.status = ptzr.packetizer->read();
+
+      if (   (FILE_STATUS_MOREDATA != ptzr.status)
+             && (FILE_STATUS_MOREDATA == ptzr.old_status))
+        ptzr.packetizer->force_duration_on_last_packet();
+
+      if (!ptzr.pack)
+        ptzr.pack = ptzr.packetizer->get_packet();
+    }
 
     if (!ptzr.pack && (FILE_STATUS_DONE == ptzr.status))
       ptzr.status = FILE_STATUS_DONE_AND_DRY;
@@ -1840,25 +2025,24 @@ pull_packetizers_for_packets() {
       }
       file.old_num_unfinished_packetizers = file.num_unfinished_packetizers;
     }
+
+    // Packetizers that are holding have to be asked again next time.
+    if (ptzr.pack)
+      s_interleaving_queue.push(idx, ptzr.pack->output_order_timecode);
+
+    if (ptzr.pack || (FILE_STATUS_DONE_AND_DRY == ptzr.status))
+      itr = s_packetizers_to_pull.erase(itr);
+    else
+      ++itr;
   }
 }
 
 static packetizer_t *
 select_winning_packetizer() {
-  packetizer_t *winner = nullptr;
-
-  for (auto &ptzr : g_packetizers) {
-    if (!ptzr.pack)
-      continue;
-
-    if (!winner || !winner->pack)
-      winner = &ptzr;
+  if (s_interleaving_queue.empty())
+    return nullptr;
 
-    else if (ptzr.pack && (ptzr.pack->output_order_timecode < winner->pack->output_order_timecode))
-      winner = &ptzr;
-  }
-
-  return winner;
+  return &g_packetizers[s_interleaving_queue.top()];
 }
 
 static void
@@ -1877,6 +2061,14 @@ discard_queued_packets() {
 */
 void
 main_loop() {
+  if (g_num_compression_threads)
+    g_compression_workers = std::make_shared<worker_pool_c>(g_num_compression_threads);
+
+  start_reader_threads();
+
+  for (auto idx = 0u; idx < g_packetizers.size(); ++idx)
+    s_packetizers_to_pull.insert(idx);
+
   // Let's go!
   while (1) {
     // Step 1: Make sure a packet is available for each output
@@ -1895,9 +2087,16 @@ main_loop() {
 
       // Step 3: Add the winning packet to a cluster. Full clusters will be
       // rendered automatically.
-      g_cluster_helper->add_packet(pack);
+      pack->wait_for_compression();
+
+      {
+        std::lock_guard<std::recursive_mutex> lock{g_output_mutex};
+        g_cluster_helper->add_packet(pack);
+      }
 
       winner->pack.reset();
+      s_interleaving_queue.pop();
+      s_packetizers_to_pull.insert(winner - &g_packetizers[0]);
 
       // If splitting by parts is active and the last part has been
       // processed fully then we can finish up.
@@ -1914,6 +2113,9 @@ main_loop() {
       break;
   }
 
+  stop_reader_threads();
+  g_compression_workers.reset();
+
   // Render all remaining packets (if there are any).
   if (g_cluster_helper && (0 < g_cluster_helper->get_packet_count()))
     g_cluster_helper->render();
@@ -18,12 +18,14 @@
 #include "common/common_pch.h"
 
 #include <deque>
+#include <mutex>
 #include <unordered_map>
 
 #include "common/bitvalue.h"
 #include "common/chapters/chapters.h"
 #include "common/mm_mpls_multi_file_io.h"
 #include "common/segmentinfo.h"
+#include "common/worker_pool.h"
 #include "merge/file_status.h"
 #include "merge/packet.h"
 
@@ -180,6 +182,15 @@ extern generic_packetizer_c *g_video_packetizer;
 
 extern bool g_write_cues, g_cue_writing_requested;
 extern bool g_no_lacing, g_no_linking, g_use_durations, g_no_track_statistics_tags;
+extern bool g_pipelined_reading;
+extern std::string g_cluster_index_dir;
+extern size_t g_write_buffer_size, g_num_write_buffers;
+extern size_t g_num_compression_threads;
+extern size_t g_reserved_space_for_cues;
+extern size_t g_read_ahead_size;
+extern worker_pool_cptr g_compression_workers;
+
+extern std::recursive_mutex g_output_mutex;
 
 extern bool g_identifying, g_identify_verbose, g_identify_for_mmg;
 
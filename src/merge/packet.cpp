@@ -13,8 +13,10 @@
 
 #include "common/common_pch.h"
 
+#include "common/compression.h"
 #include "common/math.h"
 #include "merge/cluster_helper.h"
+#include "merge/generic_packetizer.h"
 #include "merge/output_control.h"
 #include "merge/packet.h"
 
@@ -32,3 +34,21 @@ packet_t::normalize_timecodes() {
   if (has_fref())
     fref                       = RND_TIMECODE_SCALE(fref);
 }
+
+void
+packet_t::wait_for_compression() {
+  if (!pending_compression.valid())
+    return;
+
+  try {
+    auto compressed     = pending_compression.get();
+    pending_compression = std::shared_future<memories_c>{};
+
+    data = compressed[0];
+    for (auto idx = 0u; idx < data_adds.size(); ++idx)
+      data_adds[idx] = compressed[idx + 1];
+
+  } catch (mtx::compression_x &e) {
+    mxerror_tid(source->m_ti.m_fname, source->m_ti.m_id, boost::format(Y("Compression failed: %1%\n")) % e.error());
+  }
+}
@@ -16,6 +16,8 @@
 
 #include "common/common_pch.h"
 
+#include <future>
+
 #include "common/timecode.h"
 
 namespace libmatroska {
@@ -64,6 +66,10 @@ struct packet_t {
 
   std::vector<packet_extension_cptr> extensions;
 
+  // Compressed versions of data and data_adds if they're being
+  // compressed on a worker thread; see wait_for_compression().
+  std::shared_future<memories_c> pending_compression;
+
   packet_t()
     : group{}
     , block{}
@@ -217,6 +223,7 @@ struct packet_t {
   }
 
   void normalize_timecodes();
+  void wait_for_compression();
 };
 using packet_cptr = std::shared_ptr<packet_t>;
 
@@ -23,16 +23,40 @@ public:
   std::vector<int64_t> m_durations;
   generic_packetizer_c *m_source;
   bool m_more_data, m_duration_mandatory;
+  size_t m_last_direct_block;
 
   render_groups_c(generic_packetizer_c *source)
     : m_source(source)
     , m_more_data(false)
     , m_duration_mandatory(false)
+    , m_last_direct_block{}
   {
   }
 };
 using render_groups_cptr = std::shared_ptr<render_groups_c>;
 
+// A SimpleBlock or BlockGroup written by cluster_helper_c::render_directly().
+// libmatroska never puts more than eight frames into a lace.
+struct direct_block_t {
+  packet_t *m_frames[8];
+  size_t m_num_frames;
+  KaxTrackEntry *m_track_entry;
+  uint64_t m_track_num, m_timecode;
+  int64_t m_past_block, m_forw_block, m_duration;
+  LacingType m_lacing;
+  bool m_simple, m_key_frame, m_discardable, m_add_to_cues;
+
+  // Calculated right before the cluster is written.
+  uint64_t m_block_size, m_group_size, m_element_size;
+};
+
+namespace mtx { namespace direct_rendering {
+
+void calculate_sizes(direct_block_t &block);
+void write_block(mm_io_c &out, KaxCluster &cluster, direct_block_t const &block);
+
+}}
+
 struct cluster_helper_c::impl_t {
 public:
   kax_cluster_c *cluster;
@@ -56,6 +80,9 @@ public:
 
   std::unordered_map<uint64_t, track_statistics_c> track_statistics;
 
+  std::vector<direct_block_t> direct_blocks;
+  std::unordered_map<generic_packetizer_c *, render_groups_c> direct_render_groups;
+
 public:
   impl_t();
   ~impl_t();
@@ -12,8 +12,11 @@
 
 #include "common/common_pch.h"
 
+#include "common/mm_head_cache_io.h"
+#include "common/mm_mmap_io.h"
 #include "common/mm_mpls_multi_file_io.h"
 #include "common/mm_read_buffer_io.h"
+#include "common/mm_readahead_io.h"
 #include "common/strings/formatting.h"
 #include "common/xml/xml.h"
 #include "input/r_aac.h"
@@ -54,6 +57,7 @@
 #include "input/r_wavpack.h"
 #include "merge/filelist.h"
 #include "merge/input_x.h"
+#include "merge/output_control.h"
 #include "merge/reader_detection_and_creation.h"
 
 static std::vector<bfs::path>
@@ -67,15 +71,33 @@ file_names_to_paths(const std::vector<std::string> &file_names) {
 
 static mm_io_cptr
 open_input_file(filelist_t &file) {
+  static debugging_option_c s_debug{"mmap_io"};
+
   try {
+    if ((file.all_names.size() == 1) && file.ti && file.ti->m_memory_mapped_reading) {
+      // Memory-mapped files don't need additional buffering. Fall back
+      // to regular reading if the file cannot be mapped.
+      try {
+        return mm_mmap_io_c::open(file.name);
+      } catch (mtx::mm_io::open_x &) {
+        mxdebug_if(s_debug, boost::format("open_input_file: mapping '%1%' failed; falling back to regular reading\n") % file.name);
+      }
+    }
+
+    mm_io_c *in;
     if (file.all_names.size() == 1)
-      return mm_io_cptr(new mm_read_buffer_io_c(new mm_file_io_c(file.name), 1 << 17));
+      in = new mm_file_io_c(file.name);
 
     else {
       std::vector<bfs::path> paths = file_names_to_paths(file.all_names);
-      return mm_io_cptr(new mm_read_buffer_io_c(new mm_multi_file_io_c(paths, file.name), 1 << 17));
+      in = new mm_multi_file_io_c(paths, file.name);
     }
 
+    if (g_read_ahead_size)
+      in = new mm_readahead_io_c(in, g_read_ahead_size);
+
+    return mm_io_cptr(new mm_read_buffer_io_c(in, 1 << 17));
+
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % file.name % ex);
     return mm_io_cptr{};
@@ -100,10 +122,11 @@ open_playlist_file(filelist_t &file,
 }
 
 static file_type_e
-detect_text_file_formats(filelist_t const &file) {
+detect_text_file_formats(filelist_t const &file,
+                         mm_io_c *io) {
   auto text_io = mm_text_io_cptr{};
   try {
-    text_io        = std::make_shared<mm_text_io_c>(new mm_file_io_c(file.name));
+    text_io        = std::make_shared<mm_text_io_c>(io, false);
     auto text_size = text_io->get_size();
 
     if (srt_reader_c::probe_file(text_io.get(), text_size))
@@ -129,13 +152,103 @@ detect_text_file_formats(filelist_t const &file) {
   return FILE_TYPE_IS_UNKNOWN;
 }
 
+static bool
+has_magic(memory_c const &head,
+          size_t offset,
+          std::string const &magic) {
+  return (head.get_size() >= (offset + magic.size()))
+      && !memcmp(head.get_buffer() + offset, magic.c_str(), magic.size());
+}
+
+/** \brief Guess the file type from the magic number at the file's start
+
+   Only file types whose magic numbers are unambiguous are considered.
+*/
+static file_type_e
+guess_file_type_by_signature(memory_c const &head) {
+  if (has_magic(head, 0, "ADIF"))
+    return FILE_TYPE_AAC;       // only ADIF, see probe_guessed_file_type()
+  if (has_magic(head, 0, std::string{"\x30\x26\xb2\x75\x8e\x66\xcf\x11", 8}))
+    return FILE_TYPE_ASF;
+  if (has_magic(head, 0, "FLV"))
+    return FILE_TYPE_FLV;
+  if (has_magic(head, 0, "\x1a\x45\xdf\xa3"))
+    return FILE_TYPE_MATROSKA;
+  if (has_magic(head, 0, "OggS"))
+    return FILE_TYPE_OGM;
+  if (has_magic(head, 0, "fLaC"))
+    return FILE_TYPE_FLAC;
+  if (has_magic(head, 0, ".RMF"))
+    return FILE_TYPE_REAL;
+  if (has_magic(head, 0, "TTA1"))
+    return FILE_TYPE_TTA;
+  if (has_magic(head, 0, "wvpk"))
+    return FILE_TYPE_WAVPACK4;
+  if (has_magic(head, 0, "DKIF"))
+    return FILE_TYPE_IVF;
+  if (has_magic(head, 0, "caff"))
+    return FILE_TYPE_COREAUDIO;
+
+  if (has_magic(head, 0, "RIFF")) {
+    if (has_magic(head, 8, "AVI "))
+      return FILE_TYPE_AVI;
+    if (has_magic(head, 8, "WAVE"))
+      return FILE_TYPE_WAV;
+    if (has_magic(head, 8, "CDXA"))
+      return FILE_TYPE_CDXA;
+  }
+
+  for (auto const &atom : std::vector<std::string>{ "moov", "ftyp", "mdat", "pnot", "wide", "skip" })
+    if (has_magic(head, 4, atom))
+      return FILE_TYPE_QTMP4;
+
+  return FILE_TYPE_IS_UNKNOWN;
+}
+
+/** \brief Runs the probe of the reader for a guessed file type
+
+   A matching magic number alone is not enough; the reader still has
+   to accept the file.
+*/
+static bool
+probe_guessed_file_type(file_type_e type,
+                        mm_io_c *io,
+                        int64_t size) {
+  switch (type) {
+    case FILE_TYPE_AAC:       return aac_adif_reader_c::probe_file(io, size);
+    case FILE_TYPE_ASF:       return asf_reader_c::probe_file(io, size);
+    case FILE_TYPE_AVI:       return avi_reader_c::probe_file(io, size);
+    case FILE_TYPE_CDXA:      return cdxa_reader_c::probe_file(io, size);
+    case FILE_TYPE_COREAUDIO: return coreaudio_reader_c::probe_file(io, size);
+    case FILE_TYPE_FLAC:      return flac_reader_c::probe_file(io, size);
+    case FILE_TYPE_FLV:       return flv_reader_c::probe_file(io, size);
+    case FILE_TYPE_IVF:       return ivf_reader_c::probe_file(io, size);
+    case FILE_TYPE_MATROSKA:  return kax_reader_c::probe_file(io, size);
+    case FILE_TYPE_OGM:       return ogm_reader_c::probe_file(io, size);
+    case FILE_TYPE_QTMP4:     return qtmp4_reader_c::probe_file(io, size);
+    case FILE_TYPE_REAL:      return real_reader_c::probe_file(io, size);
+    case FILE_TYPE_TTA:       return tta_reader_c::probe_file(io, size);
+    case FILE_TYPE_WAV:       return wav_reader_c::probe_file(io, size);
+    case FILE_TYPE_WAVPACK4:  return wavpack_reader_c::probe_file(io, size);
+    default:                  return false;
+  }
+}
+
 /** \brief Probe the file type
 
    Opens the input file and calls the \c probe_file function for each known
    file reader class. Uses \c mm_text_io_c for subtitle probing.
+
+   The file's head is read only once and kept in memory as most probes
+   seek back to the start of the file. File types with unambiguous magic
+   numbers are tried first; see \c guess_file_type_by_signature().
 */
 static std::pair<file_type_e, int64_t>
 get_file_type_internal(filelist_t &file) {
+  // Same size as the input file's read buffer so that reading the head
+  // doesn't cause additional I/O.
+  static size_t const s_probe_head_size = 1 << 17;
+
   mm_io_cptr af_io = open_input_file(file);
   mm_io_c *io      = af_io.get();
   int64_t size     = std::min(io->get_size(), static_cast<int64_t>(1 << 25));
@@ -144,10 +257,20 @@ get_file_type_internal(filelist_t &file) {
   if (is_playlist)
     io = file.playlist_mpls_in.get();
 
-  file_type_e type = FILE_TYPE_IS_UNKNOWN;
+  auto head_io = std::make_shared<mm_head_cache_io_c>(io, s_probe_head_size, false);
+  io           = head_io.get();
+
+  // Try the reader matching the file's magic number first. The full
+  // chain of probes is only run if that fails.
+  file_type_e type = guess_file_type_by_signature(head_io->get_head());
+  if (!probe_guessed_file_type(type, io, size))
+    type = FILE_TYPE_IS_UNKNOWN;
+
+  if (FILE_TYPE_IS_UNKNOWN != type)
+    ;                           // detected by its magic number
 
   // File types that can be detected unambiguously but are not supported
-  if (aac_adif_reader_c::probe_file(io, size))
+  else if (aac_adif_reader_c::probe_file(io, size))
     type = FILE_TYPE_AAC;
   else if (asf_reader_c::probe_file(io, size))
     type = FILE_TYPE_ASF;
@@ -190,7 +313,7 @@ get_file_type_internal(filelist_t &file) {
 
   // All text file types (subtitles).
   else
-    type = detect_text_file_formats(file);
+    type = detect_text_file_formats(file, io);
 
   if (FILE_TYPE_IS_UNKNOWN != type)
     ;                           // intentional fall-through
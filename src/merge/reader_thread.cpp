@@ -0,0 +1,215 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   the pipelined reader thread
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/profiling.h"
+#include "common/strings/formatting.h"
+#include "merge/generic_packetizer.h"
+#include "merge/generic_reader.h"
+#include "merge/reader_thread.h"
+
+reader_thread_c::reader_thread_c(generic_reader_c &reader)
+  : m_reader(reader)
+  , m_num_queued_bytes{}
+  , m_stop{}
+  , m_finished{}
+  , m_progress{}
+  , m_max_queued_results{1024}
+  , m_max_queued_bytes{16 * 1024 * 1024}
+  , m_num_available_bytes{}
+  , m_num_pending_bytes{}
+  , m_done{}
+  , m_debug{"reader_thread"}
+{
+}
+
+reader_thread_c::~reader_thread_c() {
+  stop();
+}
+
+void
+reader_thread_c::start() {
+  m_thread = std::thread{[this]() { run(); }};
+}
+
+void
+reader_thread_c::stop() {
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+
+  m_space_available.notify_all();
+
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+reader_thread_c::read_result_t
+reader_thread_c::read_one() {
+  auto result = read_result_t{};
+
+  // All packetizers of a pipelined reader are fed no matter which one
+  // requests data. Holding back is decided by the main thread in
+  // read() based on the packets it has actually consumed.
+  {
+    profiling_timer_c timer{profiling_c::stage_reading};
+    result.m_status = m_reader.read(m_reader.m_reader_packetizers.front(), true);
+  }
+
+  // Only take packets that are complete, meaning that the packetizer
+  // has already assigned their final timecodes. This is exactly what
+  // the serial main loop would be able to retrieve after this call.
+  for (auto ptzr : m_reader.m_reader_packetizers)
+    while (ptzr->packet_available()) {
+      auto packet         = ptzr->get_packet();
+      result.m_num_bytes += packet->data->get_size();
+      result.m_packets.emplace_back(ptzr, packet);
+    }
+
+  result.m_num_pending_bytes = m_reader.get_queued_bytes();
+
+  return result;
+}
+
+void
+reader_thread_c::run() {
+  mxdebug_if(m_debug, boost::format("reader thread for %1%: starting\n") % m_reader.m_ti.m_fname);
+
+  auto num_reads = 0u;
+
+  try {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_space_available.wait(lock, [this]() {
+          return m_stop || ((m_results.size() < m_max_queued_results) && (m_num_queued_bytes < m_max_queued_bytes));
+        });
+
+        if (m_stop)
+          break;
+      }
+
+      auto result = read_one();
+      auto status = result.m_status;
+      m_progress  = m_reader.get_progress();
+      ++num_reads;
+
+      {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_num_queued_bytes += result.m_num_bytes;
+        m_results.push_back(std::move(result));
+      }
+
+      m_result_available.notify_one();
+
+      if (FILE_STATUS_DONE == status)
+        break;
+    }
+
+  } catch (...) {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_exception = std::current_exception();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_finished = true;
+  }
+
+  m_result_available.notify_one();
+
+  mxdebug_if(m_debug, boost::format("reader thread for %1%: finished after %2% reads\n") % m_reader.m_ti.m_fname % num_reads);
+}
+
+file_status_e
+reader_thread_c::read(generic_packetizer_c *ptzr) {
+  if (m_done)
+    return FILE_STATUS_DONE;
+
+  // Emulate the reader's own decision whether or not to read more
+  // data. The number of queued bytes is what the serial mode would see:
+  // packets that have been read but not fetched yet.
+  if (m_reader.is_holding(ptzr, m_num_available_bytes + m_num_pending_bytes))
+    return FILE_STATUS_HOLDING;
+
+  auto result = read_result_t{};
+
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_result_available.wait(lock, [this]() { return !m_results.empty() || m_finished; });
+
+    if (m_results.empty()) {
+      if (m_exception)
+        std::rethrow_exception(m_exception);
+      return FILE_STATUS_DONE;
+    }
+
+    result              = std::move(m_results.front());
+    m_num_queued_bytes -= result.m_num_bytes;
+    m_results.pop_front();
+  }
+
+  m_space_available.notify_one();
+
+  for (auto &ptzr_and_packet : result.m_packets)
+    m_available_packets[ptzr_and_packet.first].push_back(ptzr_and_packet.second);
+
+  m_num_available_bytes += result.m_num_bytes;
+  m_num_pending_bytes    = result.m_num_pending_bytes;
+  m_done                 = FILE_STATUS_DONE == result.m_status;
+
+  return result.m_status;
+}
+
+bool
+reader_thread_c::packet_available(generic_packetizer_c *ptzr)
+  const {
+  auto itr = m_available_packets.find(ptzr);
+  return (itr != m_available_packets.end()) && !itr->second.empty();
+}
+
+packet_cptr
+reader_thread_c::get_packet(generic_packetizer_c *ptzr) {
+  auto itr = m_available_packets.find(ptzr);
+  if ((itr == m_available_packets.end()) || itr->second.empty())
+    return packet_cptr{};
+
+  auto packet = itr->second.front();
+  itr->second.pop_front();
+
+  m_num_available_bytes -= packet->data->get_size();
+
+  return packet;
+}
+
+void
+reader_thread_c::force_duration_on_last_packet(generic_packetizer_c *ptzr) {
+  auto itr = m_available_packets.find(ptzr);
+  if ((itr == m_available_packets.end()) || itr->second.empty()) {
+    mxverb_tid(3, ptzr->m_ti.m_fname, ptzr->m_ti.m_id, "force_duration_on_last_packet: packet queue is empty\n");
+    return;
+  }
+
+  auto &packet               = itr->second.back();
+  packet->duration_mandatory = true;
+  mxverb_tid(3, ptzr->m_ti.m_fname, ptzr->m_ti.m_id,
+             boost::format("force_duration_on_last_packet: forcing at %1% with %|2$.3f|ms\n") % format_timecode(packet->timecode) % (packet->duration / 1000.0));
+}
+
+int
+reader_thread_c::get_progress()
+  const {
+  return m_progress;
+}
@@ -0,0 +1,98 @@
+/*
+   mkvmerge -- utility for splicing together matroska files
+   from component media subtypes
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   class definition for the pipelined reader thread
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_MERGE_READER_THREAD_H
+#define MTX_MERGE_READER_THREAD_H
+
+#include "common/common_pch.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "merge/file_status.h"
+#include "merge/packet.h"
+
+class generic_packetizer_c;
+class generic_reader_c;
+
+/* Demuxes and packetizes the packets of one reader on a worker
+   thread.
+
+   The worker calls the reader's read() function ahead of time and
+   records the outcome of each call: the packets that became available
+   and the status returned. The main loop replays these results in
+   order whenever the serial code would have called read() itself. The
+   packets therefore become visible to the interleaving stage at exactly
+   the same points as in serial mode, and the output does not depend on
+   how far the worker has gotten.
+
+   This only works for readers whose read() produces the same data no
+   matter which packetizer requested it; see
+   generic_reader_c::supports_pipelined_reading().
+*/
+class reader_thread_c {
+protected:
+  struct read_result_t {
+    file_status_e m_status;
+    std::vector<std::pair<generic_packetizer_c *, packet_cptr>> m_packets;
+    int64_t m_num_bytes, m_num_pending_bytes;
+  };
+
+  generic_reader_c &m_reader;
+  std::thread m_thread;
+
+  // Shared between the worker and the main thread; protected by m_mutex.
+  std::mutex m_mutex;
+  std::condition_variable m_result_available, m_space_available;
+  std::deque<read_result_t> m_results;
+  int64_t m_num_queued_bytes;
+  bool m_stop, m_finished;
+  std::exception_ptr m_exception;
+  std::atomic<int> m_progress;
+
+  size_t m_max_queued_results;
+  int64_t m_max_queued_bytes;
+
+  // Only accessed by the main thread.
+  std::unordered_map<generic_packetizer_c *, std::deque<packet_cptr>> m_available_packets;
+  int64_t m_num_available_bytes, m_num_pending_bytes;
+  bool m_done;
+
+  debugging_option_c m_debug;
+
+public:
+  reader_thread_c(generic_reader_c &reader);
+  virtual ~reader_thread_c();
+
+  void start();
+  void stop();
+
+  file_status_e read(generic_packetizer_c *ptzr);
+  bool packet_available(generic_packetizer_c *ptzr) const;
+  packet_cptr get_packet(generic_packetizer_c *ptzr);
+  void force_duration_on_last_packet(generic_packetizer_c *ptzr);
+
+  int get_progress() const;
+
+protected:
+  void run();
+  read_result_t read_one();
+};
+using reader_thread_cptr = std::shared_ptr<reader_thread_c>;
+
+#endif  // MTX_MERGE_READER_THREAD_H
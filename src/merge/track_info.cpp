@@ -38,6 +38,8 @@ track_info_c::track_info_c()
   , m_nalu_size_length{}
   , m_no_chapters{}
   , m_no_global_tags{}
+  , m_memory_mapped_reading{}
+  , m_use_cluster_index{}
   , m_avi_audio_sync_enabled{}
 {
 }
@@ -123,6 +125,9 @@ track_info_c::operator =(const track_info_c &src) {
   m_no_chapters                = src.m_no_chapters;
   m_no_global_tags             = src.m_no_global_tags;
 
+  m_memory_mapped_reading      = src.m_memory_mapped_reading;
+  m_use_cluster_index          = src.m_use_cluster_index;
+
   m_chapter_charset            = src.m_chapter_charset;
   m_chapter_language           = src.m_chapter_language;
 
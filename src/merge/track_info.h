@@ -188,6 +188,8 @@ public:
 
   bool m_no_chapters, m_no_global_tags;
 
+  bool m_memory_mapped_reading, m_use_cluster_index;
+
   // Some file formats can contain chapters, but for some the charset
   // cannot be identified unambiguously (*cough* OGM *cough*).
   std::string m_chapter_charset, m_chapter_language;
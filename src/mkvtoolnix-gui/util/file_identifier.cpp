@@ -39,6 +39,9 @@ FileIdentifier::identify() {
   if (cfg.m_defaultAdditionalMergeOptions.contains(Q("keep_last_chapter_in_mpls")))
     args << "--engage" << "keep_last_chapter_in_mpls";
 
+  if (cfg.m_cacheIdentificationResults && !cfg.identificationCacheDir().isEmpty())
+    args << "--identification-cache" << cfg.identificationCacheDir();
+
   auto process  = Process::execute(cfg.actualMkvmergeExe(), args);
   auto exitCode = process->process().exitCode();
 
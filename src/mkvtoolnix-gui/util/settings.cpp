@@ -61,6 +61,7 @@ Settings::load() {
   m_clearMergeSettings                 = static_cast<ClearMergeSettingsAction>(reg.value("clearMergeSettings", static_cast<int>(ClearMergeSettingsAction::None)).toInt());
   m_disableCompressionForAllTrackTypes = reg.value("disableCompressionForAllTrackTypes", false).toBool();
   m_mergeAlwaysAddDroppedFiles         = reg.value("mergeAlwaysAddDroppedFiles", true).toBool();
+  m_cacheIdentificationResults         = reg.value("cacheIdentificationResults", false).toBool();
 
   m_uniqueOutputFileNames              = reg.value("uniqueOutputFileNames",     true).toBool();
   m_outputFileNamePolicy               = static_cast<OutputFileNamePolicy>(reg.value("outputFileNamePolicy", static_cast<int>(ToSameAsFirstInputFile)).toInt());
@@ -124,6 +125,13 @@ Settings::actualMkvmergeExe()
   return exeWithPath(Q("mkvmerge"));
 }
 
+QString
+Settings::identificationCacheDir()
+  const {
+  auto folder = mtx::sys::get_application_data_folder();
+  return folder.empty() ? QString{} : Q((folder / "identification-cache").string());
+}
+
 void
 Settings::save()
   const {
@@ -148,6 +156,7 @@ Settings::save()
   reg.setValue("clearMergeSettings",                 static_cast<int>(m_clearMergeSettings));
   reg.setValue("disableCompressionForAllTrackTypes", m_disableCompressionForAllTrackTypes);
   reg.setValue("mergeAlwaysAddDroppedFiles",         m_mergeAlwaysAddDroppedFiles);
+  reg.setValue("cacheIdentificationResults",         m_cacheIdentificationResults);
 
   reg.setValue("outputFileNamePolicy",               static_cast<int>(m_outputFileNamePolicy));
   reg.setValue("relativeOutputDir",                  m_relativeOutputDir.path());
@@ -55,7 +55,7 @@ public:
   QStringList m_oftenUsedLanguages, m_oftenUsedCountries, m_oftenUsedCharacterSets;
   ProcessPriority m_priority;
   QDir m_lastOpenDir, m_lastOutputDir, m_lastConfigDir;
-  bool m_setAudioDelayFromFileName, m_autoSetFileTitle, m_disableCompressionForAllTrackTypes, m_mergeAlwaysAddDroppedFiles;
+  bool m_setAudioDelayFromFileName, m_autoSetFileTitle, m_disableCompressionForAllTrackTypes, m_mergeAlwaysAddDroppedFiles, m_cacheIdentificationResults;
   ClearMergeSettingsAction m_clearMergeSettings;
 
   OutputFileNamePolicy m_outputFileNamePolicy;
@@ -84,6 +84,7 @@ public:
 
   QString priorityAsString() const;
   QString actualMkvmergeExe() const;
+  QString identificationCacheDir() const;
 
   void setValue(QString const &group, QString const &key, QVariant const &value);
   QVariant value(QString const &group, QString const &key, QVariant const &defaultValue = QVariant{}) const;
@@ -101,6 +101,17 @@ public:
       return m_buf[i - bbw];
   }
 
+  //How many bytes starting at position i can be accessed without wrapping?
+  uint32_t GetContiguousLength(uint32_t i){
+    if(i >= bytes_in_buf)
+      return 0;
+    uint32_t bbw = bytes_before_wrap_read();
+    if(i < bbw)
+      return std::min(bbw, bytes_in_buf) - i;
+    else
+      return bytes_in_buf - i;
+  }
+
   int32_t Read(binary* dest, uint32_t numBytes);
   int32_t Skip(uint32_t numBytes);
   int32_t Write(binary* data, uint32_t numBytes);
@@ -22,6 +22,7 @@
 
 #include "common/common_pch.h"
 
+#include "common/mpeg.h"
 #include "MPEGVideoBuffer.h"
 #include <cstring>
 
@@ -37,6 +38,12 @@ MPEG2PictureHeader::MPEG2PictureHeader() {
   memset(this, 0, sizeof(*this));
 }
 
+static bool IsWantedStartCode(binary code){
+  return (code == MPEG_VIDEO_SEQUENCE_START_CODE)
+      || (code == MPEG_VIDEO_GOP_START_CODE)
+      || (code == MPEG_VIDEO_PICTURE_START_CODE);
+}
+
 int32_t MPEGVideoBuffer::FindStartCode(uint32_t startPos){
   //How many bytes can we look through?
   uint32_t window = myBuffer->GetLength() - startPos;
@@ -44,23 +51,35 @@ int32_t MPEGVideoBuffer::FindStartCode(uint32_t startPos){
   if(window < 4) //Make sure we have enough bytes to search.
     return -1;
 
-  for(unsigned int i = startPos; i < (window - 3); i++){
-    CircBuffer& buf = *myBuffer;
-    binary a,b,c,d;
-    a = buf[i];
-    b = buf[i+1];
-    c = buf[i+2];
-    d = buf[i+3];
-    if((a == 0x00) && (b == 0x00) && (c == 0x01)){
-      switch(d){
-        case MPEG_VIDEO_SEQUENCE_START_CODE:
-        case MPEG_VIDEO_GOP_START_CODE:
-        case MPEG_VIDEO_PICTURE_START_CODE:
-          return i;  //Return our position if we found
-          //one of the codes we want
+  CircBuffer& buf = *myBuffer;
+  uint32_t end = window - 3;
+  uint32_t i = startPos;
+
+  while(i < end){
+    //Scan whole contiguous runs of the ring buffer at once. All four
+    //bytes of a start code at position p < end must be inside the run.
+    uint32_t length = std::min(buf.GetContiguousLength(i), end + 3 - i);
 
+    if(length >= 4){
+      const binary* run = &buf[i];
+      size_t pos = mtx::mpeg::find_next_start_code(run, length - 1);
+
+      if(pos >= (length - 1)){
+        i += length - 3;
+        continue;
       }
+
+      if(IsWantedStartCode(run[pos + 3]))
+        return i + pos;  //Return our position if we found
+                         //one of the codes we want
+      i += pos + 1;
+      continue;
     }
+
+    //Start codes crossing the buffer's wrap point are checked bytewise.
+    if((buf[i] == 0x00) && (buf[i+1] == 0x00) && (buf[i+2] == 0x01) && IsWantedStartCode(buf[i+3]))
+      return i;
+    i++;
   }
 
   //If we get here we have no _wanted_ start code found.
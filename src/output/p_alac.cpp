@@ -45,7 +45,7 @@ alac_packetizer_c::~alac_packetizer_c() {
 }
 
 int
-alac_packetizer_c::process(packet_cptr packet) {
+alac_packetizer_c::process_impl(packet_cptr packet) {
   add_packet(packet);
   return FILE_STATUS_MOREDATA;
 }
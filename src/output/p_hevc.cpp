@@ -72,7 +72,7 @@ hevc_video_packetizer_c::extract_aspect_ratio() {
 }
 
 int
-hevc_video_packetizer_c::process(packet_cptr packet) {
+hevc_video_packetizer_c::process_impl(packet_cptr packet) {
   if (VFT_PFRAMEAUTOMATIC == packet->bref) {
     packet->fref = -1;
     packet->bref = m_ref_timecode;
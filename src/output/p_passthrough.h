@@ -22,7 +22,7 @@ class passthrough_packetizer_c: public generic_packetizer_c {
 public:
   passthrough_packetizer_c(generic_reader_c *p_reader, track_info_c &p_ti);
 
-  virtual int process(packet_cptr packet);
+  virtual int process_impl(packet_cptr packet);
   virtual void set_headers();
 
   virtual translatable_string_c get_format_name() const {
@@ -86,7 +86,7 @@ vorbis_packetizer_c::set_headers() {
 }
 
 int
-vorbis_packetizer_c::process(packet_cptr packet) {
+vorbis_packetizer_c::process_impl(packet_cptr packet) {
   ogg_packet op;
 
   // Remember the very first timecode we received.
@@ -0,0 +1,237 @@
+/*
+   mkvpropedit -- utility for editing properties of existing Matroska files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+#include "common/mm_io_x.h"
+#include "common/strings/editing.h"
+#include "common/worker_pool.h"
+#include "propedit/batch_runner.h"
+#include "propedit/propedit_cli_parser.h"
+
+/** \class batch_runner_c
+   \brief Processes the jobs listed in a job file on several threads
+
+   Each line of the job file contains the arguments for one file just
+   like they would be given on the command line. They're separated by
+   spaces and escaped like the values output by 'mkvmerge
+   --identify-verbose'. Empty lines and lines starting with '#' are
+   ignored.
+
+   While the jobs are running messages are re-routed: informational
+   output of the jobs is dropped, warnings are collected per job, and
+   errors abort the current job only instead of the whole program. The
+   handlers stay installed until the program exits. The result of each
+   job is output as a single line in job file order.
+
+   All jobs' arguments are parsed on the calling thread before the
+   first job is started. Options that exit the program or change
+   global settings are rejected. The expensive parts, analyzing a file
+   and writing the changes, run in parallel. Applying a job's changes
+   to the elements read is serialized as it uses global state like the
+   property tables and the list of unique numbers.
+*/
+
+batch_runner_c::batch_runner_c(size_t num_threads)
+  : m_num_threads{num_threads ? num_threads : std::max<size_t>(std::thread::hardware_concurrency(), 1)}
+{
+}
+
+batch_runner_c::~batch_runner_c() {
+}
+
+void
+batch_runner_c::read_jobs(std::string const &file_name) {
+  std::unique_ptr<mm_text_io_c> in;
+
+  try {
+    in = std::make_unique<mm_text_io_c>(new mm_file_io_c(file_name));
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format(Y("The file '%1%' could not be opened for reading: %2%.\n")) % file_name % ex);
+  }
+
+  read_jobs(*in);
+}
+
+void
+batch_runner_c::read_jobs(mm_text_io_c &in) {
+  auto line_number = 0u;
+  std::string line;
+
+  while (in.getline2(line)) {
+    ++line_number;
+    strip(line);
+
+    if (line.empty() || (line[0] == '#'))
+      continue;
+
+    auto job          = job_t{};
+    job.m_line_number = line_number;
+
+    for (auto const &arg : split(line, " "))
+      if (!arg.empty())
+        job.m_args.push_back(unescape(arg));
+
+    m_jobs.push_back(job);
+  }
+}
+
+int
+batch_runner_c::run() {
+  install_message_handlers();
+
+  for (auto &job : m_jobs)
+    parse_job(job);
+
+  auto results = std::vector<std::future<void>>{};
+  worker_pool_c workers{std::min(m_num_threads, std::max<size_t>(m_jobs.size(), 1))};
+
+  for (auto &job : m_jobs)
+    if (job.m_options)
+      results.push_back(workers.submit([this, &job]() { run_job(job); }));
+
+  for (auto &result : results)
+    result.get();
+
+  auto exit_code = 0;
+  for (auto const &job : m_jobs)
+    exit_code = std::max(exit_code, report(job));
+
+  return exit_code;
+}
+
+void
+batch_runner_c::parse_job(job_t &job) {
+  // These would output something and exit the program or change
+  // settings for all jobs.
+  static std::vector<std::string> const s_rejected_args{
+    "-l", "--list-property-names", "-h", "-?", "--help", "-V", "--version", "--check-for-updates",
+    "--ui-language", "-r", "--redirect-output", "--output-charset", "--debug", "--engage", "--profile", "--profile-json",
+    "--batch", "--batch-threads",
+  };
+
+  set_current_job(&job);
+
+  try {
+    for (auto const &arg : job.m_args)
+      if (brng::find(s_rejected_args, arg) != s_rejected_args.end())
+        mxerror(boost::format(Y("The option '%1%' cannot be used inside a job file.\n")) % arg);
+
+    auto options = propedit_cli_parser_c(job.m_args).run();
+
+    job.m_file_name = options->m_file_name;
+    job.m_options   = options;
+
+  } catch (mtx::exception &ex) {
+    job.m_error = ex.error();
+  } catch (std::exception &ex) {
+    job.m_error = ex.what();
+  }
+
+  set_current_job(nullptr);
+}
+
+void
+batch_runner_c::run_job(job_t &job) {
+  set_current_job(&job);
+
+  try {
+    process_file(job.m_options);
+
+  } catch (mtx::exception &ex) {
+    job.m_error = ex.error();
+  } catch (std::exception &ex) {
+    job.m_error = ex.what();
+  } catch (...) {
+    job.m_error = Y("An unknown error occured.");
+  }
+
+  job.m_options.reset();
+
+  set_current_job(nullptr);
+}
+
+void
+batch_runner_c::set_current_job(job_t *job) {
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  if (job)
+    m_jobs_by_thread[std::this_thread::get_id()] = job;
+  else
+    m_jobs_by_thread.erase(std::this_thread::get_id());
+}
+
+batch_runner_c::job_t *
+batch_runner_c::get_current_job() {
+  std::lock_guard<std::mutex> lock{m_mutex};
+
+  auto itr = m_jobs_by_thread.find(std::this_thread::get_id());
+  return itr != m_jobs_by_thread.end() ? itr->second : nullptr;
+}
+
+void
+batch_runner_c::install_message_handlers() {
+  set_mxmsg_handler(MXMSG_INFO, [this](unsigned int level, std::string const &message) {
+    if (!get_current_job())
+      mxmsg(level, message);
+  });
+
+  set_mxmsg_handler(MXMSG_WARNING, [this](unsigned int level, std::string const &message) {
+    auto job = get_current_job();
+    if (job)
+      job->m_warnings.push_back(message);
+
+    else if (!g_suppress_warnings)
+      mxmsg(level, message);
+  });
+
+  set_mxmsg_handler(MXMSG_ERROR, [this](unsigned int level, std::string const &message) {
+    if (get_current_job())
+      throw job_failed_x{message};
+
+    mxmsg(level, message);
+    mxexit(2);
+  });
+}
+
+std::string
+batch_runner_c::format_message(std::string message) {
+  balg::replace_all(message, "\n", " ");
+  strip(message);
+
+  return escape(message);
+}
+
+/** Outputs one line with the result of a job: "line:<n>
+    result:<ok|warning|error> file:<name>", followed by one
+    "message:<text>" field for the error or each warning. All values
+    are escaped the same way the job file is.
+
+    \return The exit code for this job.
+*/
+int
+batch_runner_c::report(job_t const &job) {
+  auto status = !job.m_error.empty()    ? std::make_pair("error",   2)
+              : !job.m_warnings.empty() ? std::make_pair("warning", 1)
+              :                           std::make_pair("ok",      0);
+
+  auto line = (boost::format("line:%1% result:%2% file:%3%") % job.m_line_number % status.first % escape(job.m_file_name)).str();
+
+  if (!job.m_error.empty())
+    line += " message:" + format_message(job.m_error);
+  else
+    for (auto const &warning : job.m_warnings)
+      line += " message:" + format_message(warning);
+
+  mxinfo(line + "\n");
+
+  return status.second;
+}
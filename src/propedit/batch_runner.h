@@ -0,0 +1,75 @@
+/*
+   mkvpropedit -- utility for editing properties of existing Matroska files
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#ifndef MTX_PROPEDIT_BATCH_RUNNER_H
+#define MTX_PROPEDIT_BATCH_RUNNER_H
+
+#include "common/common_pch.h"
+
+#include <mutex>
+#include <thread>
+
+#include "common/error.h"
+#include "propedit/options.h"
+
+class mm_text_io_c;
+
+class batch_runner_c {
+protected:
+  class job_failed_x: public mtx::exception {
+  protected:
+    std::string m_message;
+
+  public:
+    job_failed_x(std::string const &message)
+      : m_message{message}
+    {
+    }
+
+    virtual const char *what() const throw() {
+      return m_message.c_str();
+    }
+  };
+
+  struct job_t {
+    unsigned int m_line_number;
+    std::vector<std::string> m_args;
+    std::string m_file_name, m_error;
+    std::vector<std::string> m_warnings;
+    options_cptr m_options;
+  };
+
+  std::vector<job_t> m_jobs;
+  std::mutex m_mutex, m_serialization_mutex;
+  std::map<std::thread::id, job_t *> m_jobs_by_thread;
+  size_t m_num_threads;
+
+public:
+  batch_runner_c(size_t num_threads);
+  virtual ~batch_runner_c();
+
+  void read_jobs(std::string const &file_name);
+  void read_jobs(mm_text_io_c &in);
+  int run();
+
+protected:
+  virtual void process_file(options_cptr &options) = 0;
+
+  void parse_job(job_t &job);
+  void run_job(job_t &job);
+  void set_current_job(job_t *job);
+  job_t *get_current_job();
+  void install_message_handlers();
+  int report(job_t const &job);
+
+  static std::string format_message(std::string message);
+};
+
+#endif // MTX_PROPEDIT_BATCH_RUNNER_H
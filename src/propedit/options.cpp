@@ -14,6 +14,7 @@
 #include <matroska/KaxTag.h>
 #include <matroska/KaxTags.h>
 
+#include "common/strings/parsing.h"
 #include "propedit/chapter_target.h"
 #include "propedit/options.h"
 #include "propedit/propedit.h"
@@ -24,11 +25,18 @@
 options_c::options_c()
   : m_show_progress(false)
   , m_parse_mode(kax_analyzer_c::parse_mode_fast)
+  , m_num_batch_threads(0)
 {
 }
 
 void
 options_c::validate() {
+  if (!m_batch_file_name.empty()) {
+    if (!m_file_name.empty() || has_changes())
+      mxerror(Y("In batch mode neither a file name nor actions can be given on the command line. They have to be listed in the job file instead.\n"));
+    return;
+  }
+
   if (m_file_name.empty())
     mxerror(Y("No file name given.\n"));
 
@@ -111,10 +119,24 @@ options_c::set_parse_mode(const std::string &parse_mode) {
   else if (parse_mode == "fast")
     m_parse_mode = kax_analyzer_c::parse_mode_fast;
 
+  else if (parse_mode == "meta-seek")
+    m_parse_mode = kax_analyzer_c::parse_mode_meta_seek;
+
   else
     throw false;
 }
 
+void
+options_c::set_batch_file_name(const std::string &file_name) {
+  m_batch_file_name = file_name;
+}
+
+void
+options_c::set_num_batch_threads(const std::string &num_threads) {
+  if (!parse_number(num_threads, m_num_batch_threads) || !m_num_batch_threads || (256 < m_num_batch_threads))
+    throw false;
+}
+
 void
 options_c::dump_info()
   const
@@ -122,10 +144,14 @@ options_c::dump_info()
   mxinfo(boost::format("options:\n"
                        "  file_name:     %1%\n"
                        "  show_progress: %2%\n"
-                       "  parse_mode:    %3%\n")
+                       "  parse_mode:    %3%\n"
+                       "  batch_file:    %4%\n"
+                       "  batch_threads: %5%\n")
          % m_file_name
          % m_show_progress
-         % static_cast<int>(m_parse_mode));
+         % static_cast<int>(m_parse_mode)
+         % m_batch_file_name
+         % m_num_batch_threads);
 
   for (auto &target : m_targets)
     target->dump_info();
@@ -21,10 +21,11 @@
 
 class options_c {
 public:
-  std::string m_file_name;
+  std::string m_file_name, m_batch_file_name;
   std::vector<target_cptr> m_targets;
   bool m_show_progress;
   kax_analyzer_c::parse_mode_e m_parse_mode;
+  size_t m_num_batch_threads;
 
 public:
   options_c();
@@ -38,6 +39,8 @@ public:
   void add_attachment_command(attachment_target_c::command_e command, std::string const &spec, attachment_target_c::options_t const &options);
   void set_file_name(const std::string &file_name);
   void set_parse_mode(const std::string &parse_mode);
+  void set_batch_file_name(const std::string &file_name);
+  void set_num_batch_threads(const std::string &num_threads);
   void dump_info() const;
   bool has_changes() const;
 
@@ -16,9 +16,11 @@
 #include <matroska/KaxTracks.h>
 
 #include "common/command_line.h"
+#include "common/error.h"
 #include "common/mm_io_x.h"
 #include "common/unique_numbers.h"
 #include "common/version.h"
+#include "propedit/batch_runner.h"
 #include "propedit/propedit_cli_parser.h"
 
 static void
@@ -78,8 +80,8 @@ write_changes(options_cptr &options,
   }
 }
 
-static void
-run(options_cptr &options) {
+static console_kax_analyzer_cptr
+analyze_file(options_cptr &options) {
   console_kax_analyzer_cptr analyzer;
 
   try {
@@ -100,12 +102,21 @@ run(options_cptr &options) {
     ok = analyzer->process(options->m_parse_mode, MODE_WRITE, true);
   } catch (mtx::mm_io::exception &ex) {
     mxerror(boost::format(Y("The file '%1%' could not be opened for reading and writing, or a read/write operation on it failed: %2%.\n")) % options->m_file_name % ex);
+  } catch (mtx::kax_analyzer_x &ex) {
+    mxerror(boost::format(Y("The file '%1%' could not be analyzed: %2%.\n")) % options->m_file_name % ex.error());
   } catch (...) {
   }
 
   if (!ok)
     mxerror(Y("This file could not be opened or parsed.\n"));
 
+  return analyzer;
+}
+
+static void
+run(options_cptr &options) {
+  auto analyzer = analyze_file(options);
+
   options->find_elements(analyzer.get());
   options->validate();
 
@@ -125,6 +136,33 @@ run(options_cptr &options) {
   mxexit();
 }
 
+// Batch mode: analyzing and writing run in parallel; applying the
+// changes uses global state and is serialized.
+class file_batch_runner_c: public batch_runner_c {
+public:
+  file_batch_runner_c(options_cptr const &options)
+    : batch_runner_c{options->m_num_batch_threads}
+  {
+    read_jobs(options->m_batch_file_name);
+  }
+
+protected:
+  virtual void
+  process_file(options_cptr &options) {
+    auto analyzer = analyze_file(options);
+
+    {
+      std::lock_guard<std::mutex> lock{m_serialization_mutex};
+
+      options->find_elements(analyzer.get());
+      options->validate();
+      options->execute();
+    }
+
+    write_changes(options, analyzer.get());
+  }
+};
+
 static
 void setup(char **argv) {
   mtx_common_init("mkvpropedit", argv[0]);
@@ -150,6 +188,9 @@ main(int argc,
     options->dump_info();
   }
 
+  if (!options->m_batch_file_name.empty())
+    mxexit(file_batch_runner_c{options}.run());
+
   run(options);
 
   mxexit();
@@ -34,6 +34,20 @@ propedit_cli_parser_c::set_parse_mode() {
   }
 }
 
+void
+propedit_cli_parser_c::set_batch_file_name() {
+  m_options->set_batch_file_name(m_next_arg);
+}
+
+void
+propedit_cli_parser_c::set_num_batch_threads() {
+  try {
+    m_options->set_num_batch_threads(m_next_arg);
+  } catch (...) {
+    mxerror(boost::format(Y("Invalid number of threads in '%1% %2%'.\n")) % m_current_arg % m_next_arg);
+  }
+}
+
 void
 propedit_cli_parser_c::add_target() {
   try {
@@ -189,8 +203,10 @@ propedit_cli_parser_c::init_parser() {
   add_information(YT("mkvpropedit [options] <file> <actions>"));
 
   add_section_header(YT("Options"));
-  OPT("l|list-property-names",      list_property_names, YT("List all valid property names and exit"));
-  OPT("p|parse-mode=<mode>",        set_parse_mode,      YT("Sets the Matroska parser mode to 'fast' (default) or 'full'"));
+  OPT("l|list-property-names",      list_property_names,   YT("List all valid property names and exit"));
+  OPT("p|parse-mode=<mode>",        set_parse_mode,        YT("Sets the Matroska parser mode to 'fast' (default), 'full' or 'meta-seek'"));
+  OPT("batch=<job-file>",           set_batch_file_name,   YT("Processes all jobs listed in 'job-file' instead of a single file (see man page for syntax)"));
+  OPT("batch-threads=<n>",          set_num_batch_threads, YT("Processes up to n jobs in parallel in batch mode (default: number of CPU cores)"));
 
   add_section_header(YT("Actions for handling properties"));
   OPT("e|edit=<selector>",          add_target,          YT("Sets the Matroska file section that all following add/set/delete "
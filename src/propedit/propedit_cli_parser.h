@@ -38,6 +38,8 @@ protected:
   void add_chapters();
   void set_parse_mode();
   void set_file_name();
+  void set_batch_file_name();
+  void set_num_batch_threads();
 
   void set_attachment_name();
   void set_attachment_description();
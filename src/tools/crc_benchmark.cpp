@@ -0,0 +1,193 @@
+/*
+   crc_benchmark - A tool for benchmarking the CRC implementations
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <chrono>
+
+#include "common/checksums/crc.h"
+#include "common/command_line.h"
+#include "common/strings/parsing.h"
+
+using implementation_e = mtx::checksum::crc_base_c::implementation_e;
+
+class cli_options_c {
+public:
+  size_t m_size_mb, m_num_runs, m_chunk_size;
+
+  cli_options_c()
+    : m_size_mb{64}
+    , m_num_runs{5}
+    , m_chunk_size{}
+  {
+  }
+};
+
+static void
+show_help() {
+  mxinfo("crc_benchmark [options]\n"
+         "\n"
+         "Measures the throughput of the byte-wise, slicing-by-8 and PCLMULQDQ\n"
+         "implementations of all CRC variants for random data and verifies that\n"
+         "they calculate the same CRCs. Implementations the CPU or the CRC\n"
+         "variant doesn't support are skipped.\n"
+         "\n"
+         "Benchmark options:\n"
+         "\n"
+         "  --size number          Size of the data in MB (default: 64)\n"
+         "  --runs number          Number of runs per implementation; the fastest\n"
+         "                         run is reported (default: 5)\n"
+         "  --chunk-size number    Calculate a new CRC for each chunk of this many\n"
+         "                         bytes; 0 means all in one (default: 0)\n"
+         "\n"
+         "General options:\n"
+         "\n"
+         "  -h, --help             This help text\n"
+         "  -V, --version          Print version information\n");
+  mxexit();
+}
+
+static void
+show_version() {
+  mxinfo("crc_benchmark v" PACKAGE_VERSION "\n");
+  mxexit();
+}
+
+static cli_options_c
+parse_args(std::vector<std::string> &args) {
+  auto options = cli_options_c{};
+
+  for (auto current = args.begin(), end = args.end(); current != end; ++current) {
+    auto arg      = *current;
+    auto next     = current + 1;
+    auto next_arg = next != end ? *next : "";
+
+    if ((arg == "-h") || (arg == "--help"))
+      show_help();
+
+    else if ((arg == "-V") || (arg == "--version"))
+      show_version();
+
+    else if ((arg == "--size") || (arg == "--runs") || (arg == "--chunk-size")) {
+      if (next_arg.empty())
+        mxerror(boost::format("Missing argument to %1%\n") % arg);
+
+      auto &value = arg == "--size" ? options.m_size_mb : arg == "--runs" ? options.m_num_runs : options.m_chunk_size;
+      if (!parse_number(next_arg, value) || (!value && (arg != "--chunk-size")))
+        mxerror(boost::format("Invalid argument to %1%: %2%\n") % arg % next_arg);
+
+      ++current;
+
+    } else
+      mxerror(boost::format("Unknown argument: %1%\n") % arg);
+  }
+
+  return options;
+}
+
+static memory_cptr
+generate_data(size_t size) {
+  auto data   = memory_c::alloc(size);
+  auto buffer = data->get_buffer();
+  auto state  = uint32_t{4711};
+
+  for (auto idx = 0u; idx < size; ++idx) {
+    state       = state * 1103515245u + 12345u;
+    buffer[idx] = state >> 24;
+  }
+
+  return data;
+}
+
+static uint64_t
+calculate(mtx::checksum::algorithm_e algorithm,
+          implementation_e implementation,
+          memory_c const &data,
+          size_t chunk_size) {
+  auto buffer = data.get_buffer();
+  auto size   = data.get_size();
+  auto result = uint64_t{};
+
+  for (auto position = size_t{}; position < size; position += chunk_size) {
+    auto worker = mtx::checksum::for_algorithm(algorithm, 0xffffffff);
+    auto &crc   = dynamic_cast<mtx::checksum::crc_base_c &>(*worker);
+
+    crc.set_implementation(implementation);
+    crc.add(buffer + position, std::min(chunk_size, size - position));
+
+    result ^= crc.get_result_as_uint();
+  }
+
+  return result;
+}
+
+static void
+run_benchmark(cli_options_c const &options) {
+  auto data       = generate_data(options.m_size_mb * 1024 * 1024);
+  auto chunk_size = options.m_chunk_size ? options.m_chunk_size : data->get_size();
+
+  auto algorithms = std::vector<std::pair<mtx::checksum::algorithm_e, std::string> >{
+    { mtx::checksum::algorithm_e::crc8_atm,      "CRC-8 ATM"        },
+    { mtx::checksum::algorithm_e::crc16_ansi,    "CRC-16 ANSI"      },
+    { mtx::checksum::algorithm_e::crc16_ccitt,   "CRC-16 CCITT"     },
+    { mtx::checksum::algorithm_e::crc32_ieee,    "CRC-32 IEEE"      },
+    { mtx::checksum::algorithm_e::crc32_ieee_le, "CRC-32 IEEE (LE)" },
+  };
+
+  mxinfo(boost::format("%|1$-17s| %|2$-14s| %|3$10s| %|4$8s|\n") % "algorithm" % "implementation" % "MB/s" % "speedup");
+
+  for (auto const &algorithm : algorithms) {
+    auto reference      = uint64_t{};
+    auto byte_wise_mbps = 0.0;
+
+    for (auto implementation : std::vector<implementation_e>{ implementation_e::byte_wise, implementation_e::slicing_by_8, implementation_e::clmul }) {
+      if (!dynamic_cast<mtx::checksum::crc_base_c &>(*mtx::checksum::for_algorithm(algorithm.first)).is_implementation_supported(implementation))
+        continue;
+
+      auto result        = uint64_t{};
+      auto best_duration = 0.0;
+
+      for (auto run = 0u; run < options.m_num_runs; ++run) {
+        auto start    = std::chrono::steady_clock::now();
+        result        = calculate(algorithm.first, implementation, *data, chunk_size);
+        auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!run || (duration < best_duration))
+          best_duration = duration;
+      }
+
+      auto mbps = best_duration > 0 ? data->get_size() / best_duration / 1048576.0 : 0.0;
+
+      if (implementation_e::byte_wise == implementation) {
+        reference      = result;
+        byte_wise_mbps = mbps;
+
+      } else if (result != reference)
+        mxerror(boost::format("The %1% implementation of %2% calculated a different CRC.\n") % mtx::checksum::crc_base_c::get_implementation_name(implementation) % algorithm.second);
+
+      mxinfo(boost::format("%|1$-17s| %|2$-14s| %|3$10.0f| %|4$7.2f|x\n")
+             % algorithm.second % mtx::checksum::crc_base_c::get_implementation_name(implementation) % mbps % (byte_wise_mbps > 0 ? mbps / byte_wise_mbps : 0));
+    }
+  }
+}
+
+int
+main(int argc,
+     char **argv) {
+  mtx_common_init("crc_benchmark", argv[0]);
+
+  auto args = command_line_utf8(argc, argv);
+  while (handle_common_cli_args(args, "-r"))
+    ;
+
+  run_benchmark(parse_args(args));
+
+  mxexit();
+}
@@ -0,0 +1,220 @@
+/*
+   interleaving_benchmark - A tool for benchmarking mkvmerge's packet interleaving
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <chrono>
+
+#include "common/command_line.h"
+#include "common/strings/parsing.h"
+#include "merge/interleaving_queue.h"
+
+class cli_options_c {
+public:
+  size_t m_num_packets, m_max_num_tracks;
+
+  cli_options_c()
+    : m_num_packets{1000000}
+    , m_max_num_tracks{64}
+  {
+  }
+};
+
+static void
+show_help() {
+  mxinfo("interleaving_benchmark [options]\n"
+         "\n"
+         "Measures how many packets per second mkvmerge's interleaving stage can\n"
+         "select for different numbers of tracks. Compares the interleaving queue\n"
+         "with a linear scan over all tracks and verifies that both result in the\n"
+         "same packet order.\n"
+         "\n"
+         "Benchmark options:\n"
+         "\n"
+         "  --packets number       Number of packets to interleave per run\n"
+         "                         (default: 1000000)\n"
+         "  --max-tracks number    Double the number of tracks starting at 1 up to\n"
+         "                         this number (default: 64)\n"
+         "\n"
+         "General options:\n"
+         "\n"
+         "  -h, --help             This help text\n"
+         "  -V, --version          Print version information\n");
+  mxexit();
+}
+
+static void
+show_version() {
+  mxinfo("interleaving_benchmark v" PACKAGE_VERSION "\n");
+  mxexit();
+}
+
+static cli_options_c
+parse_args(std::vector<std::string> &args) {
+  auto options = cli_options_c{};
+
+  for (auto current = args.begin(), end = args.end(); current != end; ++current) {
+    auto arg      = *current;
+    auto next     = current + 1;
+    auto next_arg = next != end ? *next : "";
+
+    if ((arg == "-h") || (arg == "--help"))
+      show_help();
+
+    else if ((arg == "-V") || (arg == "--version"))
+      show_version();
+
+    else if ((arg == "--packets") || (arg == "--max-tracks")) {
+      if (next_arg.empty())
+        mxerror(boost::format("Missing argument to %1%\n") % arg);
+
+      auto &value = arg == "--packets" ? options.m_num_packets : options.m_max_num_tracks;
+      if (!parse_number(next_arg, value) || !value)
+        mxerror(boost::format("Invalid argument to %1%: %2%\n") % arg % next_arg);
+
+      ++current;
+
+    } else
+      mxerror(boost::format("Unknown argument: %1%\n") % arg);
+  }
+
+  return options;
+}
+
+// A mix of track types similar to a Blu-ray remux: one video track
+// followed by audio tracks with differing frame durations and sparse
+// subtitle tracks. Several tracks share the same durations so that
+// ties have to be broken by the track index.
+static std::vector<int64_t>
+create_packet_durations(size_t num_tracks) {
+  auto durations = std::vector<int64_t>{};
+
+  for (auto idx = 0u; idx < num_tracks; ++idx)
+    durations.push_back(  !idx           ? 41708333ll
+                        : (idx % 3) == 0 ? 2000000000ll
+                        : (idx % 3) == 1 ? 32000000ll
+                        :                  21333333ll);
+
+  return durations;
+}
+
+struct track_t {
+  timecode_c m_next_timecode;
+  int64_t m_duration;
+  bool m_has_packet;
+
+  track_t(int64_t duration)
+    : m_next_timecode{timecode_c::ns(0)}
+    , m_duration{duration}
+    , m_has_packet{}
+  {
+  }
+
+  void create_packet() {
+    m_has_packet     = true;
+    m_next_timecode += timecode_c::ns(m_duration);
+  }
+};
+
+// Mirrors the previous main loop: all tracks are visited for
+// requesting packets and for selecting the winner.
+static std::vector<size_t>
+run_linear_scan(std::vector<int64_t> const &durations,
+                size_t num_packets) {
+  auto tracks = std::vector<track_t>(durations.begin(), durations.end());
+  auto order  = std::vector<size_t>{};
+  order.reserve(num_packets);
+
+  while (order.size() < num_packets) {
+    for (auto &track : tracks)
+      if (!track.m_has_packet)
+        track.create_packet();
+
+    track_t *winner = nullptr;
+    for (auto &track : tracks)
+      if (track.m_has_packet && (!winner || (track.m_next_timecode < winner->m_next_timecode)))
+        winner = &track;
+
+    order.push_back(winner - &tracks[0]);
+    winner->m_has_packet = false;
+  }
+
+  return order;
+}
+
+// Only the track whose packet has been output is asked for a new one.
+static std::vector<size_t>
+run_interleaving_queue(std::vector<int64_t> const &durations,
+                       size_t num_packets) {
+  auto tracks = std::vector<track_t>(durations.begin(), durations.end());
+  auto order  = std::vector<size_t>{};
+  auto queue  = interleaving_queue_c{};
+  order.reserve(num_packets);
+
+  for (auto idx = 0u; idx < tracks.size(); ++idx) {
+    tracks[idx].create_packet();
+    queue.push(idx, tracks[idx].m_next_timecode);
+  }
+
+  while (order.size() < num_packets) {
+    auto winner = queue.top();
+    queue.pop();
+
+    order.push_back(winner);
+    tracks[winner].create_packet();
+    queue.push(winner, tracks[winner].m_next_timecode);
+  }
+
+  return order;
+}
+
+template<typename Tfunc>
+static double
+measure_packets_per_second(Tfunc const &func,
+                           std::vector<size_t> &order) {
+  auto start    = std::chrono::steady_clock::now();
+  order         = func();
+  auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return duration > 0 ? order.size() / duration : 0;
+}
+
+static void
+run_benchmark(cli_options_c const &options) {
+  mxinfo(boost::format("%|1$6s| %|2$15s| %|3$15s| %|4$8s|\n") % "tracks" % "linear pkt/s" % "queue pkt/s" % "speedup");
+
+  for (auto num_tracks = 1u; num_tracks <= options.m_max_num_tracks; num_tracks *= 2) {
+    auto durations = create_packet_durations(num_tracks);
+    auto linear    = std::vector<size_t>{};
+    auto queued    = std::vector<size_t>{};
+
+    auto linear_pps = measure_packets_per_second([&]() { return run_linear_scan(durations, options.m_num_packets);        }, linear);
+    auto queue_pps  = measure_packets_per_second([&]() { return run_interleaving_queue(durations, options.m_num_packets); }, queued);
+
+    if (linear != queued)
+      mxerror(boost::format("The packet order differs for %1% tracks.\n") % num_tracks);
+
+    mxinfo(boost::format("%|1$6d| %|2$15.0f| %|3$15.0f| %|4$7.2f|x\n") % num_tracks % linear_pps % queue_pps % (linear_pps > 0 ? queue_pps / linear_pps : 0));
+  }
+}
+
+int
+main(int argc,
+     char **argv) {
+  mtx_common_init("interleaving_benchmark", argv[0]);
+
+  auto args = command_line_utf8(argc, argv);
+  while (handle_common_cli_args(args, "-r"))
+    ;
+
+  run_benchmark(parse_args(args));
+
+  mxexit();
+}
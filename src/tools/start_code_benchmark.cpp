@@ -0,0 +1,212 @@
+/*
+   start_code_benchmark - A tool for benchmarking the start code scanners used by the elementary stream parsers
+
+   Distributed under the GPL v2
+   see the file COPYING for details
+   or visit http://www.gnu.org/copyleft/gpl.html
+
+   Written by Moritz Bunkus <moritz@bunkus.org>.
+*/
+
+#include "common/common_pch.h"
+
+#include <chrono>
+
+#include "common/command_line.h"
+#include "common/mm_io.h"
+#include "common/mm_io_x.h"
+#include "common/mpeg.h"
+#include "common/strings/parsing.h"
+
+class cli_options_c {
+public:
+  std::string m_file_name;
+  size_t m_size_mb, m_num_runs;
+
+  cli_options_c()
+    : m_size_mb{256}
+    , m_num_runs{5}
+  {
+  }
+};
+
+static void
+show_help() {
+  mxinfo("start_code_benchmark [options] [file]\n"
+         "\n"
+         "Measures how fast the start code scanners shared by the AVC, HEVC,\n"
+         "MPEG-1/2 and VC-1 parsers search an elementary stream for 00 00 01\n"
+         "sequences. All scanners the CPU supports are run, and the number of\n"
+         "start codes they find is compared. If no file is given then a stream\n"
+         "with NALU-like structure is generated.\n"
+         "\n"
+         "Benchmark options:\n"
+         "\n"
+         "  --size number          Size of the generated stream in MB (default: 256)\n"
+         "  --runs number          Number of runs per scanner; the fastest run\n"
+         "                         is reported (default: 5)\n"
+         "\n"
+         "General options:\n"
+         "\n"
+         "  -h, --help             This help text\n"
+         "  -V, --version          Print version information\n");
+  mxexit();
+}
+
+static void
+show_version() {
+  mxinfo("start_code_benchmark v" PACKAGE_VERSION "\n");
+  mxexit();
+}
+
+static cli_options_c
+parse_args(std::vector<std::string> &args) {
+  auto options = cli_options_c{};
+
+  for (auto current = args.begin(), end = args.end(); current != end; ++current) {
+    auto arg      = *current;
+    auto next     = current + 1;
+    auto next_arg = next != end ? *next : "";
+
+    if ((arg == "-h") || (arg == "--help"))
+      show_help();
+
+    else if ((arg == "-V") || (arg == "--version"))
+      show_version();
+
+    else if ((arg == "--size") || (arg == "--runs")) {
+      if (next_arg.empty())
+        mxerror(boost::format("Missing argument to %1%\n") % arg);
+
+      auto &value = arg == "--size" ? options.m_size_mb : options.m_num_runs;
+      if (!parse_number(next_arg, value) || !value)
+        mxerror(boost::format("Invalid argument to %1%: %2%\n") % arg % next_arg);
+
+      ++current;
+
+    } else if (options.m_file_name.empty() && !balg::starts_with(arg, "-"))
+      options.m_file_name = arg;
+
+    else
+      mxerror(boost::format("Unknown argument: %1%\n") % arg);
+  }
+
+  return options;
+}
+
+// Slice data is mostly high entropy with the occasional run of zero
+// bytes, e.g. from emulation prevention or padding. NALUs are a few
+// hundred bytes up to about 64 KB large.
+static memory_cptr
+generate_stream(size_t size) {
+  auto stream = memory_c::alloc(size);
+  auto buffer = stream->get_buffer();
+  auto state  = uint32_t{4711};
+  auto next   = [&state]() -> uint32_t {
+    state = state * 1103515245u + 12345u;
+    return state >> 8;
+  };
+
+  auto position = size_t{};
+  while (position < size) {
+    auto nalu_end = std::min<size_t>(position + 3 + 200 + next() % 65536, size);
+
+    for (auto idx = position; (idx < (position + 3)) && (idx < size); ++idx)
+      buffer[idx] = idx == (position + 2) ? 0x01 : 0x00;
+
+    for (auto idx = position + 3; idx < nalu_end; ++idx) {
+      auto value  = next();
+      buffer[idx] = !(value & 0x3ff) ? 0x00 : (value >> 10) & 0xff;
+    }
+
+    position = nalu_end;
+  }
+
+  return stream;
+}
+
+static memory_cptr
+read_stream(std::string const &file_name) {
+  try {
+    mm_file_io_c in{file_name};
+    return in.read(in.get_size());
+
+  } catch (mtx::mm_io::exception &ex) {
+    mxerror(boost::format("The file '%1%' could not be read: %2%\n") % file_name % ex.what());
+  }
+
+  return memory_cptr{};
+}
+
+static size_t
+count_start_codes(memory_c const &stream,
+                  mtx::mpeg::scanner_e scanner) {
+  auto buffer    = stream.get_buffer();
+  auto size      = stream.get_size();
+  auto position  = size_t{};
+  auto num_found = size_t{};
+
+  while (position < size) {
+    position += mtx::mpeg::find_next_start_code(buffer + position, size - position, scanner);
+    if (position >= size)
+      break;
+
+    ++num_found;
+    position += 3;
+  }
+
+  return num_found;
+}
+
+static void
+run_benchmark(cli_options_c const &options) {
+  auto stream = options.m_file_name.empty() ? generate_stream(options.m_size_mb * 1024 * 1024) : read_stream(options.m_file_name);
+
+  mxinfo(boost::format("%|1$-8s| %|2$12s| %|3$10s| %|4$8s|\n") % "scanner" % "start codes" % "GB/s" % "speedup");
+
+  auto scalar_gbps        = 0.0;
+  auto scalar_num_found   = size_t{};
+  auto const best_scanner = mtx::mpeg::get_best_scanner();
+
+  for (auto scanner : std::vector<mtx::mpeg::scanner_e>{ mtx::mpeg::scanner_e::scalar, mtx::mpeg::scanner_e::sse2, mtx::mpeg::scanner_e::avx2 }) {
+    if (scanner > best_scanner)
+      break;
+
+    auto num_found     = size_t{};
+    auto best_duration = 0.0;
+
+    for (auto run = 0u; run < options.m_num_runs; ++run) {
+      auto start    = std::chrono::steady_clock::now();
+      num_found     = count_start_codes(*stream, scanner);
+      auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      if (!run || (duration < best_duration))
+        best_duration = duration;
+    }
+
+    auto gbps = best_duration > 0 ? stream->get_size() / best_duration / 1000000000.0 : 0.0;
+
+    if (mtx::mpeg::scanner_e::scalar == scanner) {
+      scalar_gbps      = gbps;
+      scalar_num_found = num_found;
+
+    } else if (num_found != scalar_num_found)
+      mxerror(boost::format("The %1% scanner found %2% start codes instead of %3%.\n") % mtx::mpeg::get_scanner_name(scanner) % num_found % scalar_num_found);
+
+    mxinfo(boost::format("%|1$-8s| %|2$12d| %|3$10.2f| %|4$7.2f|x\n") % mtx::mpeg::get_scanner_name(scanner) % num_found % gbps % (scalar_gbps > 0 ? gbps / scalar_gbps : 0));
+  }
+}
+
+int
+main(int argc,
+     char **argv) {
+  mtx_common_init("start_code_benchmark", argv[0]);
+
+  auto args = command_line_utf8(argc, argv);
+  while (handle_common_cli_args(args, "-r"))
+    ;
+
+  run_benchmark(parse_args(args));
+
+  mxexit();
+}
@@ -3,6 +3,7 @@
 #include "gtest/gtest.h"
 
 #include "common/checksums/base.h"
+#include "common/checksums/crc.h"
 #include "common/mm_io.h"
 #include "tests/unit/util.h"
 
@@ -134,4 +135,47 @@ TEST_F(ChecksumTest, FileChunked1000) {
   EXPECT_EQ(*m_data_md5, *calculate_bin(mtx::checksum::algorithm_e::md5,                       1000));
 }
 
+TEST_F(ChecksumTest, CrcImplementationsAgree) {
+  using implementation_e = mtx::checksum::crc_base_c::implementation_e;
+
+  auto state  = 4711u;
+  auto buffer = std::vector<unsigned char>(70000);
+  for (auto &byte : buffer) {
+    state = state * 1103515245u + 12345u;
+    byte  = (state >> 16) & 0xff;
+  }
+
+  auto algorithms = std::vector<mtx::checksum::algorithm_e>{
+    mtx::checksum::algorithm_e::crc8_atm,   mtx::checksum::algorithm_e::crc16_ansi, mtx::checksum::algorithm_e::crc16_ccitt,
+    mtx::checksum::algorithm_e::crc32_ieee, mtx::checksum::algorithm_e::crc32_ieee_le,
+  };
+
+  auto calculate = [&buffer](mtx::checksum::algorithm_e algorithm, implementation_e implementation, size_t offset, size_t size, size_t chunk_size) -> uint64_t {
+    auto worker = mtx::checksum::for_algorithm(algorithm, 0xffffffff);
+    auto &crc   = dynamic_cast<mtx::checksum::crc_base_c &>(*worker);
+
+    crc.set_implementation(implementation);
+
+    for (auto position = offset, end = offset + size; position < end; position += chunk_size)
+      crc.add(&buffer[position], std::min(chunk_size, end - position));
+
+    return crc.get_result_as_uint();
+  };
+
+  for (auto algorithm : algorithms)
+    for (auto implementation : std::vector<implementation_e>{ implementation_e::slicing_by_8, implementation_e::clmul }) {
+      if (!dynamic_cast<mtx::checksum::crc_base_c &>(*mtx::checksum::for_algorithm(algorithm)).is_implementation_supported(implementation))
+        continue;
+
+      for (auto size = 0u; size <= 300; ++size)
+        for (auto offset = 0u; offset < 3; ++offset)
+          EXPECT_EQ(calculate(algorithm, implementation_e::byte_wise, offset, size, size + 1), calculate(algorithm, implementation, offset, size, size + 1))
+            << "algorithm " << static_cast<int>(algorithm) << " implementation " << mtx::checksum::crc_base_c::get_implementation_name(implementation) << " size " << size << " offset " << offset;
+
+      for (auto chunk_size : std::vector<size_t>{ 17, 64, 100, 4096, buffer.size() })
+        EXPECT_EQ(calculate(algorithm, implementation_e::byte_wise, 1, buffer.size() - 1, chunk_size), calculate(algorithm, implementation, 1, buffer.size() - 1, chunk_size))
+          << "algorithm " << static_cast<int>(algorithm) << " implementation " << mtx::checksum::crc_base_c::get_implementation_name(implementation) << " chunk size " << chunk_size;
+    }
+}
+
 }
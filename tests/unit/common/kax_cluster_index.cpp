@@ -0,0 +1,183 @@
+#include "common/common_pch.h"
+
+#include "common/kax_cluster_index.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string
+id(uint32_t value) {
+  auto result = std::string{};
+  for (auto shift = 24; 0 <= shift; shift -= 8)
+    if (!result.empty() || ((value >> shift) & 0xff))
+      result += static_cast<char>((value >> shift) & 0xff);
+  return result;
+}
+
+std::string
+element(uint32_t element_id,
+        std::string const &content,
+        bool unknown_size = false) {
+  auto size = std::string{"\x01", 1};
+  for (auto shift = 48; 0 <= shift; shift -= 8)
+    size += static_cast<char>(unknown_size ? 0xff : (content.size() >> shift) & 0xff);
+
+  return id(element_id) + size + content;
+}
+
+std::string
+uint_element(uint32_t element_id,
+             uint64_t value) {
+  auto content = std::string{};
+  for (auto shift = 56; 0 <= shift; shift -= 8)
+    content += static_cast<char>((value >> shift) & 0xff);
+
+  return element(element_id, content);
+}
+
+std::string
+block(unsigned int track,
+      int16_t relative_timecode,
+      unsigned char flags) {
+  auto content = std::string{};
+  content     += static_cast<char>(0x80 | track);
+  content     += static_cast<char>((relative_timecode >> 8) & 0xff);
+  content     += static_cast<char>(relative_timecode & 0xff);
+  content     += static_cast<char>(flags);
+  content     += "data";
+  return content;
+}
+
+std::string
+simple_block(unsigned int track,
+             int16_t relative_timecode,
+             bool key) {
+  return element(0xa3, block(track, relative_timecode, key ? 0x80 : 0x00));
+}
+
+std::string
+block_group(unsigned int track,
+            int16_t relative_timecode,
+            bool key) {
+  return element(0xa0, element(0xa1, block(track, relative_timecode, 0)) + (key ? std::string{} : uint_element(0xfb, 1)));
+}
+
+std::vector<std::string>
+clusters(bool unknown_size) {
+  return std::vector<std::string>{
+    element(0x1f43b675, uint_element(0xe7, 0)    + simple_block(1, 0, true) + simple_block(2, 0, true) + simple_block(1, 40, false), unknown_size),
+    element(0x1f43b675, uint_element(0xe7, 1000) + simple_block(1, 0, true) + block_group(2, 10, true),                              unknown_size),
+    element(0x1f43b675, uint_element(0xe7, 2000) + block_group(1, 0, false) + simple_block(2, 5, true),                              unknown_size),
+  };
+}
+
+std::string
+ebml_head() {
+  return element(0x1a45dfa3, uint_element(0x4286, 1));
+}
+
+std::string
+info() {
+  return element(0x1549a966, uint_element(0x2ad7b1, 1000000));
+}
+
+kax_cluster_index_c
+build_index(std::string const &file) {
+  mm_mem_io_c in{reinterpret_cast<unsigned char const *>(file.c_str()), file.size()};
+  kax_cluster_index_c index;
+
+  EXPECT_TRUE(index.build(in));
+
+  return index;
+}
+
+TEST(KaxClusterIndex, ScanningBlocks) {
+  auto cls     = clusters(false);
+  auto segment = info() + cls[0] + cls[1] + cls[2];
+  auto head    = ebml_head();
+  auto index   = build_index(head + element(0x18538067, segment));
+  auto start   = head.size() + 12 + info().size();
+
+  EXPECT_FALSE(index.is_from_cues());
+
+  ASSERT_EQ(3u, index.get_clusters().size());
+  EXPECT_EQ(start,                                  index.get_clusters()[0].m_position);
+  EXPECT_EQ(start + cls[0].size(),                  index.get_clusters()[1].m_position);
+  EXPECT_EQ(start + cls[0].size() + cls[1].size(), index.get_clusters()[2].m_position);
+  EXPECT_EQ(2000000000ll,                           index.get_clusters()[2].m_timecode);
+
+  ASSERT_EQ(2u, index.get_keyframes(1).size());
+  EXPECT_EQ(1000000000ll, index.get_keyframes(1)[1].m_timecode);
+
+  ASSERT_EQ(3u, index.get_keyframes(2).size());
+  EXPECT_EQ(1010000000ll, index.get_keyframes(2)[1].m_timecode);
+  EXPECT_EQ(2005000000ll, index.get_keyframes(2)[2].m_timecode);
+
+  EXPECT_TRUE(index.get_keyframes(3).empty());
+
+  auto &clusters = index.get_clusters();
+  EXPECT_EQ(clusters[1].m_position, *index.find_cluster_position(1500000000ll, { 1 }));
+  EXPECT_EQ(clusters[2].m_position, *index.find_cluster_position(2500000000ll, { 2 }));
+  EXPECT_EQ(clusters[1].m_position, *index.find_cluster_position(2500000000ll, { 1, 2 }));
+  EXPECT_EQ(clusters[0].m_position, *index.find_cluster_position(0,            { 1, 2 }));
+  EXPECT_FALSE(!!index.find_cluster_position(-1,                                { 1 }));
+  EXPECT_FALSE(!!index.find_cluster_position(1500000000ll,                      { 1, 3 }));
+}
+
+TEST(KaxClusterIndex, UnknownSizeClusters) {
+  auto cls   = clusters(true);
+  auto index = build_index(ebml_head() + element(0x18538067, info() + cls[0] + cls[1] + cls[2], true));
+
+  ASSERT_EQ(3u, index.get_clusters().size());
+  EXPECT_EQ(1000000000ll, index.get_clusters()[1].m_timecode);
+  EXPECT_EQ(2u, index.get_keyframes(1).size());
+  EXPECT_EQ(3u, index.get_keyframes(2).size());
+}
+
+TEST(KaxClusterIndex, ReadingCues) {
+  auto cls           = clusters(false);
+  auto seek_head     = element(0x114d9b74, element(0x4dbb, element(0x53ab, id(0x1c53bb6b)) + uint_element(0x53ac, 0)));
+  auto clusters_pos  = seek_head.size() + info().size();
+  auto cues_pos      = clusters_pos + cls[0].size() + cls[1].size() + cls[2].size();
+  seek_head          = element(0x114d9b74, element(0x4dbb, element(0x53ab, id(0x1c53bb6b)) + uint_element(0x53ac, cues_pos)));
+
+  auto cue_point     = [](uint64_t timecode, uint64_t track, uint64_t position) {
+    return element(0xbb, uint_element(0xb3, timecode) + element(0xb7, uint_element(0xf7, track) + uint_element(0xf1, position)));
+  };
+  auto cues          = element(0x1c53bb6b, cue_point(0, 1, clusters_pos) + cue_point(1000, 1, clusters_pos + cls[0].size()));
+
+  auto head          = ebml_head();
+  auto index         = build_index(head + element(0x18538067, seek_head + info() + cls[0] + cls[1] + cls[2] + cues));
+  auto segment_start = head.size() + 12;
+
+  EXPECT_TRUE(index.is_from_cues());
+  EXPECT_EQ(3u, index.get_clusters().size());
+
+  ASSERT_EQ(2u, index.get_keyframes(1).size());
+  EXPECT_EQ(segment_start + clusters_pos + cls[0].size(), index.get_keyframes(1)[1].m_cluster_position);
+  EXPECT_TRUE(index.get_keyframes(2).empty());
+}
+
+TEST(KaxClusterIndex, SavingAndLoading) {
+  auto cls        = clusters(false);
+  auto index      = build_index(ebml_head() + element(0x18538067, info() + cls[0] + cls[1] + cls[2]));
+  auto file_name  = (bfs::temp_directory_path() / bfs::unique_path()).string();
+
+  index.set_file_properties(4711, 42);
+  ASSERT_TRUE(index.save(file_name));
+
+  kax_cluster_index_c loaded;
+  EXPECT_FALSE(loaded.load(file_name, 4712, 42));
+  EXPECT_FALSE(loaded.load(file_name, 4711, 43));
+  ASSERT_TRUE(loaded.load(file_name, 4711, 42));
+
+  EXPECT_EQ(3u, loaded.get_clusters().size());
+  EXPECT_EQ(index.get_clusters()[2].m_position, loaded.get_clusters()[2].m_position);
+  EXPECT_EQ(3u, loaded.get_keyframes(2).size());
+  EXPECT_EQ(index.get_keyframes(2)[2].m_timecode, loaded.get_keyframes(2)[2].m_timecode);
+
+  bfs::remove(file_name);
+}
+
+}
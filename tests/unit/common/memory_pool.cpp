@@ -0,0 +1,62 @@
+#include "common/common_pch.h"
+
+#include "common/memory_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(MemoryPool, SizeClasses) {
+  size_t capacity;
+
+  auto buffer = memory_pool_c::allocate(1, capacity);
+  EXPECT_EQ(32u, capacity);
+  memory_pool_c::release(buffer, capacity);
+
+  buffer = memory_pool_c::allocate(1000, capacity);
+  EXPECT_EQ(1024u, capacity);
+  memory_pool_c::release(buffer, capacity);
+
+  buffer = memory_pool_c::allocate(1024 * 1024 + 1, capacity);
+  EXPECT_EQ(0u, capacity);
+  memory_pool_c::release(buffer, capacity);
+}
+
+TEST(MemoryPool, Recycling) {
+  size_t capacity;
+
+  auto buffer = memory_pool_c::allocate(3000, capacity);
+  memory_pool_c::release(buffer, capacity);
+
+  EXPECT_EQ(buffer, memory_pool_c::allocate(2500, capacity));
+  memory_pool_c::release(buffer, capacity);
+}
+
+TEST(MemoryPool, MemoryC) {
+  auto mem    = memory_c::alloc(100);
+  auto buffer = mem->get_buffer();
+
+  mem->resize(120);
+  EXPECT_EQ(buffer, mem->get_buffer());
+  EXPECT_EQ(120u, mem->get_size());
+
+  memset(mem->get_buffer(), 42, 120);
+  auto copy = mem->clone();
+  EXPECT_TRUE(*mem == *copy);
+
+  mem->resize(10000);
+  EXPECT_EQ(10000u, mem->get_size());
+  EXPECT_EQ(42, mem->get_buffer()[119]);
+
+  mem.reset();
+  copy.reset();
+
+  // Taking over ownership must not return the buffer to the pool.
+  mem    = memory_c::alloc(100);
+  buffer = mem->get_buffer();
+  mem->lock();
+  mem.reset();
+  free(buffer);
+}
+
+}
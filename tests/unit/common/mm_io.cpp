@@ -3,7 +3,12 @@
 #include "gtest/gtest.h"
 #include "tests/unit/util.h"
 
+#include "common/mm_head_cache_io.h"
 #include "common/mm_io_x.h"
+#include "common/mm_mmap_io.h"
+#include "common/mm_read_buffer_io.h"
+#include "common/mm_readahead_io.h"
+#include "common/mm_write_buffer_io.h"
 
 namespace {
 
@@ -16,4 +21,143 @@ TEST(MmIo, Slurp) {
   ASSERT_THROW(mm_file_io_c::slurp("doesnotexist"), mtx::mm_io::exception);
 }
 
+#if !defined(SYS_WINDOWS)
+TEST(MmIo, MmapReading) {
+  memory_cptr m;
+
+  {
+    mm_mmap_io_c in{"tests/unit/data/text/chunky_bacon.txt"};
+
+    EXPECT_EQ(13, in.get_size());
+
+    in.setFilePointer(7);
+    ASSERT_NO_THROW(m = in.read(5));
+    EXPECT_EQ(12u, in.getFilePointer());
+    EXPECT_FALSE(in.eof());
+
+    unsigned char buffer[10];
+    EXPECT_EQ(1u, in.read(buffer, 10));
+    EXPECT_TRUE(in.eof());
+
+    in.setFilePointer(10);
+    EXPECT_THROW(in.read(5), mtx::mm_io::end_of_file_x);
+  }
+
+  // The buffer remains valid after the file has been closed.
+  EXPECT_EQ(std::string{"Bacon"}, *m);
+
+  ASSERT_THROW(mm_mmap_io_c{"doesnotexist"}, mtx::mm_io::open_x);
+}
+#endif
+
+TEST(MmIo, HeadCacheReading) {
+  mm_head_cache_io_c in{new mm_file_io_c{"tests/unit/data/text/chunky_bacon.txt"}, 4};
+
+  EXPECT_EQ(13, in.get_size());
+  EXPECT_EQ(std::string{"Chun"}, std::string(reinterpret_cast<char const *>(in.get_head().get_buffer()), in.get_head().get_size()));
+
+  // Reads spanning the cached head and the rest of the file
+  memory_cptr m;
+  in.setFilePointer(2);
+  ASSERT_NO_THROW(m = in.read(8));
+  EXPECT_EQ(std::string{"unky Bac"}, *m);
+  EXPECT_EQ(10u, in.getFilePointer());
+
+  in.setFilePointer(1);
+  ASSERT_NO_THROW(m = in.read(3));
+  EXPECT_EQ(std::string{"hun"}, *m);
+
+  unsigned char buffer[10];
+  in.setFilePointer(-3, seek_end);
+  EXPECT_EQ(3u, in.read(buffer, 10));
+  EXPECT_TRUE(in.eof());
+
+  in.setFilePointer(0);
+  EXPECT_FALSE(in.eof());
+
+  ASSERT_NO_THROW(in.setFilePointer(100));
+  EXPECT_EQ(13u, in.getFilePointer());
+  EXPECT_EQ(0u, in.read(buffer, 10));
+  EXPECT_TRUE(in.eof());
+  EXPECT_THROW(in.setFilePointer(-1), mtx::mm_io::seek_x);
+}
+
+TEST(MmIo, ReadaheadReading) {
+  auto data = memory_c::alloc(3 * 1024 * 1024 + 17);
+  for (auto idx = 0u; idx < data->get_size(); ++idx)
+    data->get_buffer()[idx] = idx % 251;
+
+  auto size = static_cast<int64_t>(data->get_size());
+  mm_readahead_io_c in{new mm_mem_io_c{*data}, 2 * 1024 * 1024};
+
+  EXPECT_EQ(size, in.get_size());
+
+  // Sequential reads crossing the blocks read in the background
+  auto expect_at = [&data](memory_cptr const &m, size_t pos) {
+    return 0 == memcmp(m->get_buffer(), data->get_buffer() + pos, m->get_size());
+  };
+
+  memory_cptr m;
+  ASSERT_NO_THROW(m = in.read(1024 * 1024 + 5));
+  EXPECT_TRUE(expect_at(m, 0));
+  EXPECT_EQ(1024u * 1024u + 5u, in.getFilePointer());
+
+  // Skipping data that has already been read ahead
+  in.setFilePointer(100, seek_current);
+  ASSERT_NO_THROW(m = in.read(10));
+  EXPECT_TRUE(expect_at(m, 1024 * 1024 + 105));
+
+  // Seeking backwards discards what has been read ahead.
+  in.setFilePointer(3);
+  ASSERT_NO_THROW(m = in.read(2 * 1024 * 1024));
+  EXPECT_TRUE(expect_at(m, 3));
+
+  unsigned char buffer[100];
+  in.setFilePointer(-20, seek_end);
+  EXPECT_EQ(20u, in.read(buffer, 100));
+  EXPECT_TRUE(in.eof());
+  EXPECT_EQ(0, memcmp(buffer, data->get_buffer() + size - 20, 20));
+
+  in.setFilePointer(size + 10);
+  EXPECT_FALSE(in.eof());
+  EXPECT_EQ(0u, in.read(buffer, 100));
+  EXPECT_TRUE(in.eof());
+}
+
+TEST(MmIo, WriteSpans) {
+  std::string large(100000, 'x');
+  large[0] = large[large.size() - 1] = 'L';
+
+  mm_mem_io_c out{nullptr, 0, 1024};
+  mm_write_buffer_io_c buffered{&out, 16, false};
+
+  buffered.write("ab", 2);
+  EXPECT_EQ(2u + large.size() + 2u, buffered.write_spans({ { "cd", 2 }, { large.c_str(), large.size() }, { "ef", 2 } }));
+  EXPECT_EQ(2u + 2u + large.size() + 2u, buffered.getFilePointer());
+
+  buffered.write(large.c_str(), large.size());
+  buffered.write("gh", 2);
+  buffered.flush();
+
+  auto expected = std::string{"abcd"} + large + "ef" + large + "gh";
+  ASSERT_EQ(expected.size(), out.getFilePointer());
+  EXPECT_EQ(expected, std::string(reinterpret_cast<char const *>(out.get_buffer()), expected.size()));
+}
+
+TEST(MmIo, WriteSpansToReadOnlyProxies) {
+  auto content = std::string(100, 'x');
+  mm_mem_io_c in{nullptr, 0, 1024};
+  in.write(content.c_str(), content.size());
+  in.setFilePointer(0);
+
+  mm_read_buffer_io_c read_buffer{&in, 16, false};
+  mm_readahead_io_c readahead{&in, 16, false};
+  mm_head_cache_io_c head_cache{&in, 16, false};
+
+  for (mm_io_c *proxy : std::vector<mm_io_c *>{ &read_buffer, &readahead, &head_cache }) {
+    EXPECT_THROW(proxy->write_spans({ { "ab", 2 }, { "cd", 2 } }), mtx::mm_io::wrong_read_write_access_x);
+    EXPECT_EQ(content, in.get_content());
+  }
+}
+
 }
@@ -0,0 +1,63 @@
+#include "common/common_pch.h"
+
+#include "common/mm_write_buffer_io.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string
+write_test_data(size_t num_buffers) {
+  mm_mem_io_c mem{nullptr, 0, 1024};
+  mm_write_buffer_io_c out{&mem, 16, false, num_buffers};
+
+  unsigned char data[100];
+  for (auto idx = 0u; idx < sizeof(data); ++idx)
+    data[idx] = idx;
+
+  out.write(data, 5);
+  out.write(data, 30);
+  out.write(data, 16);
+  EXPECT_EQ(51u, out.getFilePointer());
+
+  out.setFilePointer(10);
+  out.write("overwritten", 11);
+  EXPECT_EQ(21u, out.getFilePointer());
+
+  out.setFilePointer(0, seek_end);
+  EXPECT_EQ(51u, out.getFilePointer());
+
+  out.write(data, 100);
+  out.setFilePointer(-7, seek_current);
+  out.write("end", 3);
+  out.close();
+
+  return mem.get_content();
+}
+
+TEST(MmWriteBufferIo, AsynchronousWritingMatchesSynchronousWriting) {
+  auto synchronous = write_test_data(1);
+
+  EXPECT_EQ(151u, synchronous.size());
+  EXPECT_EQ(std::string{"overwritten"}, synchronous.substr(10, 11));
+  EXPECT_EQ(std::string{"end"}, synchronous.substr(144, 3));
+
+  EXPECT_EQ(synchronous, write_test_data(2));
+  EXPECT_EQ(synchronous, write_test_data(4));
+}
+
+TEST(MmWriteBufferIo, BlockedTime) {
+  mm_mem_io_c mem{nullptr, 0, 1024};
+  mm_write_buffer_io_c out{&mem, 16, false, 3};
+
+  EXPECT_TRUE(out.is_asynchronous());
+  EXPECT_TRUE(out.get_blocked_time().valid());
+
+  out.write(std::string(1000, 'x'));
+  out.flush();
+
+  EXPECT_EQ(1000u, mem.get_content().size());
+  EXPECT_LE(0, out.get_blocked_time().to_ns());
+}
+
+}
@@ -0,0 +1,74 @@
+#include "common/common_pch.h"
+
+#include "common/mpeg.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+size_t
+find_reference(std::vector<unsigned char> const &buffer,
+               size_t position) {
+  for (auto idx = position; (idx + 2) < buffer.size(); ++idx)
+    if (!buffer[idx] && !buffer[idx + 1] && (1 == buffer[idx + 2]))
+      return idx;
+
+  return buffer.size();
+}
+
+std::vector<mtx::mpeg::scanner_e>
+supported_scanners() {
+  auto scanners = std::vector<mtx::mpeg::scanner_e>{ mtx::mpeg::scanner_e::scalar };
+
+  if (mtx::mpeg::scanner_e::sse2 <= mtx::mpeg::get_best_scanner())
+    scanners.push_back(mtx::mpeg::scanner_e::sse2);
+  if (mtx::mpeg::scanner_e::avx2 <= mtx::mpeg::get_best_scanner())
+    scanners.push_back(mtx::mpeg::scanner_e::avx2);
+
+  return scanners;
+}
+
+TEST(Mpeg, FindNextStartCodeSimple) {
+  unsigned char const data[] = { 0x42, 0x00, 0x00, 0x00, 0x01, 0x65, 0x00, 0x00, 0x02, 0x00, 0x00, 0x01 };
+
+  EXPECT_EQ(2u,  mtx::mpeg::find_next_start_code(data,      sizeof(data)));
+  EXPECT_EQ(6u,  mtx::mpeg::find_next_start_code(data + 3,  sizeof(data) - 3));
+  EXPECT_EQ(8u,  mtx::mpeg::find_next_start_code(data + 3,  sizeof(data) - 4));
+  EXPECT_EQ(0u,  mtx::mpeg::find_next_start_code(data + 9,  3));
+  EXPECT_EQ(2u,  mtx::mpeg::find_next_start_code(data + 9,  2));
+  EXPECT_EQ(0u,  mtx::mpeg::find_next_start_code(data,      0));
+}
+
+TEST(Mpeg, FindNextStartCodeAllScannersAgree) {
+  auto state = 4711u;
+
+  for (auto size : std::vector<size_t>{ 0, 1, 2, 3, 17, 18, 33, 34, 35, 100, 1000, 4099 }) {
+    std::vector<unsigned char> buffer(size);
+
+    // Mostly zeros and ones so that there are lots of partial matches.
+    for (auto &byte : buffer) {
+      state      = state * 1103515245u + 12345u;
+      auto value = (state >> 16) % 10;
+      byte       = value < 5 ? 0 : value < 7 ? 1 : 0x80 + value;
+    }
+
+    for (auto scanner : supported_scanners())
+      for (auto position = size_t{}; position <= size; ++position)
+        EXPECT_EQ(find_reference(buffer, position) - position, mtx::mpeg::find_next_start_code(buffer.data() + position, size - position, scanner))
+          << "scanner " << mtx::mpeg::get_scanner_name(scanner) << " size " << size << " position " << position;
+  }
+}
+
+TEST(Mpeg, FindNextStartCodeWithoutStartCodes) {
+  std::vector<unsigned char> buffer(1000, 0x00);
+
+  for (auto scanner : supported_scanners()) {
+    EXPECT_EQ(1000u, mtx::mpeg::find_next_start_code(buffer.data(), buffer.size(), scanner));
+
+    buffer[997] = 0x01;
+    EXPECT_EQ(995u, mtx::mpeg::find_next_start_code(buffer.data(), buffer.size(), scanner));
+    buffer[997] = 0x00;
+  }
+}
+
+}
@@ -0,0 +1,42 @@
+#include "common/common_pch.h"
+
+#include "common/worker_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(WorkerPool, Results) {
+  worker_pool_c pool{4};
+
+  EXPECT_EQ(4u, pool.get_num_threads());
+
+  auto results = std::vector<std::future<int>>{};
+  for (auto idx = 0; idx < 100; ++idx)
+    results.push_back(pool.submit([idx]() { return idx * idx; }));
+
+  for (auto idx = 0; idx < 100; ++idx)
+    EXPECT_EQ(idx * idx, results[idx].get());
+}
+
+TEST(WorkerPool, Exceptions) {
+  worker_pool_c pool{2};
+
+  auto result = pool.submit([]() -> memory_cptr { throw mtx::exception{}; });
+
+  EXPECT_THROW(result.get(), mtx::exception);
+}
+
+TEST(WorkerPool, DestructionFinishesQueuedJobs) {
+  std::atomic<int> num_run{0};
+
+  {
+    worker_pool_c pool{1};
+    for (auto idx = 0; idx < 10; ++idx)
+      pool.submit([&num_run]() { ++num_run; });
+  }
+
+  EXPECT_EQ(10, num_run);
+}
+
+}
@@ -37,11 +37,16 @@ mtxut::init_suite(char const *argv0) {
   clear_list_of_unique_numbers(UNIQUE_ALL_IDS);
   mtx_common_init("UNITTESTS", argv0);
 
+  install_message_handlers();
+
+  engage_hack(ENGAGE_NO_VARIABLE_DATA);
+}
+
+void
+mtxut::install_message_handlers() {
   set_mxmsg_handler(MXMSG_INFO,    mxmsg_handler);
   set_mxmsg_handler(MXMSG_WARNING, mxmsg_handler);
   set_mxmsg_handler(MXMSG_ERROR,   mxmsg_handler);
-
-  engage_hack(ENGAGE_NO_VARIABLE_DATA);
 }
 
 void
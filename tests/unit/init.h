@@ -46,6 +46,7 @@ public:
 
 void init_suite(char const *argv0);
 void init_case();
+void install_message_handlers();
 
 }
 
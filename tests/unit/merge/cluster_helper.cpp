@@ -0,0 +1,147 @@
+#include "common/common_pch.h"
+
+#include <matroska/KaxBlock.h>
+#include <matroska/KaxTracks.h>
+
+#include "common/mm_io.h"
+#include "merge/cluster_helper.h"
+#include "merge/libmatroska_extensions.h"
+#include "merge/packet.h"
+#include "merge/private/cluster_helper.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+int64_t const s_timecode_scale = 1000000;
+
+class DirectRendering: public ::testing::Test {
+protected:
+  KaxTrackEntry m_track_entry;
+  kax_cluster_c m_cluster;
+  std::vector<packet_cptr> m_packets;
+
+  virtual void SetUp() {
+    GetChild<KaxTrackNumber>(m_track_entry).SetValue(2);
+    m_track_entry.SetGlobalTimecodeScale(s_timecode_scale);
+
+    m_cluster.SetPreviousTimecode(99 * s_timecode_scale, s_timecode_scale);
+    m_cluster.set_min_timecode(100 * s_timecode_scale);
+    m_cluster.set_max_timecode(200 * s_timecode_scale);
+  }
+
+  void add_packets(std::vector<size_t> const &sizes) {
+    m_packets.clear();
+
+    for (auto size : sizes) {
+      auto data = memory_c::alloc(size);
+      for (auto idx = 0u; size > idx; ++idx)
+        data->get_buffer()[idx] = (idx + size) & 0xff;
+      m_packets.emplace_back(std::make_shared<packet_t>(data));
+    }
+  }
+
+  std::string render_with_libmatroska(BlockBlobType type,
+                                      LacingType lacing,
+                                      uint64_t timecode,
+                                      int64_t past_block,
+                                      int64_t forw_block,
+                                      int64_t duration) {
+    kax_block_blob_c blob{type};
+    blob.SetParent(m_cluster);
+
+    for (auto const &packet : m_packets)
+      blob.add_frame_auto(m_track_entry, timecode, *new DataBuffer(packet->data->get_buffer(), packet->data->get_size()), lacing, past_block, forw_block);
+
+    if (-1 != duration)
+      blob.set_block_duration(duration);
+
+    mm_mem_io_c out{nullptr, 0, 1024};
+    if (BLOCK_BLOB_ALWAYS_SIMPLE == type)
+      static_cast<KaxSimpleBlock &>(blob).Render(out);
+    else
+      static_cast<KaxBlockGroup &>(blob).Render(out);
+
+    return out.get_content();
+  }
+
+  std::string render_directly(bool simple,
+                              LacingType lacing,
+                              uint64_t timecode,
+                              int64_t past_block,
+                              int64_t forw_block,
+                              int64_t duration) {
+    auto block          = direct_block_t{};
+    block.m_track_entry = &m_track_entry;
+    block.m_track_num   = 2;
+    block.m_timecode    = timecode;
+    block.m_past_block  = past_block;
+    block.m_forw_block  = forw_block;
+    block.m_duration    = duration;
+    block.m_lacing      = lacing;
+    block.m_simple      = simple;
+    block.m_key_frame   = (-1 == past_block) && (-1 == forw_block);
+    block.m_discardable = !block.m_key_frame
+                       && !(   ((-1 == forw_block) || (forw_block <= static_cast<int64_t>(timecode)))
+                            && ((-1 == past_block) || (past_block <= static_cast<int64_t>(timecode))));
+
+    for (auto const &packet : m_packets)
+      block.m_frames[block.m_num_frames++] = packet.get();
+
+    mtx::direct_rendering::calculate_sizes(block);
+
+    mm_mem_io_c out{nullptr, 0, 1024};
+    mtx::direct_rendering::write_block(out, m_cluster, block);
+
+    EXPECT_EQ(block.m_element_size, out.getFilePointer());
+
+    return out.get_content();
+  }
+};
+
+TEST_F(DirectRendering, SimpleBlocks) {
+  add_packets({ 100, 100, 100 });
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_ALWAYS_SIMPLE, LACING_AUTO, 120 * s_timecode_scale, -1, -1, -1),
+            render_directly(true, LACING_AUTO, 120 * s_timecode_scale, -1, -1, -1));
+
+  add_packets({ 300, 17, 1000, 4 });
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_ALWAYS_SIMPLE, LACING_XIPH, 120 * s_timecode_scale, -1, -1, -1),
+            render_directly(true, LACING_XIPH, 120 * s_timecode_scale, -1, -1, -1));
+
+  add_packets({ 1200 });
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_ALWAYS_SIMPLE, LACING_AUTO, 150 * s_timecode_scale, 110 * s_timecode_scale, 190 * s_timecode_scale, -1),
+            render_directly(true, LACING_AUTO, 150 * s_timecode_scale, 110 * s_timecode_scale, 190 * s_timecode_scale, -1));
+}
+
+TEST_F(DirectRendering, LacedBlockGroupsWithDurations) {
+  add_packets({ 300, 17, 1000, 4 });
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_NO_SIMPLE, LACING_AUTO, 120 * s_timecode_scale, -1, -1, 160 * s_timecode_scale),
+            render_directly(false, LACING_AUTO, 120 * s_timecode_scale, -1, -1, 160 * s_timecode_scale));
+
+  add_packets({ 300, 17, 1000, 4 });
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_NO_SIMPLE, LACING_EBML, 120 * s_timecode_scale, -1, -1, 40 * s_timecode_scale),
+            render_directly(false, LACING_EBML, 120 * s_timecode_scale, -1, -1, 40 * s_timecode_scale));
+}
+
+TEST_F(DirectRendering, BlockGroupsWithReferences) {
+  add_packets({ 500 });
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_NO_SIMPLE, LACING_AUTO, 150 * s_timecode_scale, 110 * s_timecode_scale, 190 * s_timecode_scale, 20 * s_timecode_scale),
+            render_directly(false, LACING_AUTO, 150 * s_timecode_scale, 110 * s_timecode_scale, 190 * s_timecode_scale, 20 * s_timecode_scale));
+
+  add_packets({ 200, 200 });
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_NO_SIMPLE, LACING_AUTO, 150 * s_timecode_scale, 0, -1, -1),
+            render_directly(false, LACING_AUTO, 150 * s_timecode_scale, 0, -1, -1));
+}
+
+TEST_F(DirectRendering, NegativeReferencesAreIgnored) {
+  // References to frames before the timecode offset end up negative;
+  // libmatroska's block groups don't write ReferenceBlocks for them.
+  add_packets({ 500 });
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_NO_SIMPLE, LACING_AUTO, 150 * s_timecode_scale, -20 * s_timecode_scale, 190 * s_timecode_scale, 20 * s_timecode_scale),
+            render_directly(false, LACING_AUTO, 150 * s_timecode_scale, -20 * s_timecode_scale, 190 * s_timecode_scale, 20 * s_timecode_scale));
+
+  EXPECT_EQ(render_with_libmatroska(BLOCK_BLOB_NO_SIMPLE, LACING_AUTO, 150 * s_timecode_scale, -20 * s_timecode_scale, -5 * s_timecode_scale, -1),
+            render_directly(false, LACING_AUTO, 150 * s_timecode_scale, -20 * s_timecode_scale, -5 * s_timecode_scale, -1));
+}
+
+}
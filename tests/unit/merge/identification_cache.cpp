@@ -0,0 +1,130 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+#include "merge/identification_cache.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class IdentificationCache: public ::testing::Test {
+protected:
+  bfs::path m_dir;
+
+  virtual void SetUp() {
+    m_dir = bfs::temp_directory_path() / bfs::unique_path();
+    bfs::create_directories(m_dir);
+  }
+
+  virtual void TearDown() {
+    boost::system::error_code ec;
+    bfs::remove_all(m_dir, ec);
+  }
+
+  std::string
+  create_file(std::string const &name,
+              std::string const &content) {
+    auto file_name = (m_dir / name).string();
+    mm_file_io_c out{file_name, MODE_CREATE};
+    out.puts(content);
+
+    return file_name;
+  }
+
+  std::string
+  cache_dir() const {
+    return (m_dir / "cache").string();
+  }
+
+  identification_cache_c::entry_t
+  make_entry() const {
+    return identification_cache_c::entry_t{ "File 'a.ts': container: MPEG transport stream\n", { "The first warning.\n", "The second warning.\n" }, 1 };
+  }
+};
+
+TEST_F(IdentificationCache, Roundtrip) {
+  auto file_name = create_file("a.ts", "content");
+  auto cache     = identification_cache_c{cache_dir()};
+
+  EXPECT_FALSE(!!cache.lookup(file_name, "variant"));
+
+  cache.store(file_name, "variant", {}, make_entry());
+
+  auto entry = cache.lookup(file_name, "variant");
+  ASSERT_TRUE(!!entry);
+  EXPECT_EQ(make_entry().m_result,   entry->m_result);
+  EXPECT_EQ(make_entry().m_warnings, entry->m_warnings);
+  EXPECT_EQ(1,                       entry->m_exit_code);
+
+  EXPECT_TRUE(!!identification_cache_c{cache_dir()}.lookup(file_name, "variant"));
+}
+
+TEST_F(IdentificationCache, DifferentVariants) {
+  auto file_name = create_file("a.ts", "content");
+  auto cache     = identification_cache_c{cache_dir()};
+
+  cache.store(file_name, "variant", {}, make_entry());
+
+  EXPECT_TRUE(!!cache.lookup(file_name, "variant"));
+  EXPECT_FALSE(!!cache.lookup(file_name, "other variant"));
+  EXPECT_FALSE(!!cache.lookup(create_file("b.ts", "content"), "variant"));
+}
+
+TEST_F(IdentificationCache, ChangedSourceFile) {
+  auto file_name = create_file("a.ts", "content");
+  auto cache     = identification_cache_c{cache_dir()};
+
+  cache.store(file_name, "variant", {}, make_entry());
+  create_file("a.ts", "changed content");
+
+  EXPECT_FALSE(!!cache.lookup(file_name, "variant"));
+}
+
+TEST_F(IdentificationCache, ChangedDependency) {
+  auto file_name  = create_file("a.idx", "content");
+  auto dependency = create_file("a.sub", "content");
+  auto cache      = identification_cache_c{cache_dir()};
+
+  cache.store(file_name, "variant", { bfs::path{dependency} }, make_entry());
+  EXPECT_TRUE(!!cache.lookup(file_name, "variant"));
+
+  create_file("a.sub", "changed content");
+  EXPECT_FALSE(!!cache.lookup(file_name, "variant"));
+}
+
+TEST_F(IdentificationCache, RemovedDependency) {
+  auto file_name  = create_file("a.idx", "content");
+  auto dependency = create_file("a.sub", "content");
+  auto cache      = identification_cache_c{cache_dir()};
+
+  cache.store(file_name, "variant", { bfs::path{dependency} }, make_entry());
+  bfs::remove(bfs::path{dependency});
+
+  EXPECT_FALSE(!!cache.lookup(file_name, "variant"));
+}
+
+TEST_F(IdentificationCache, DependencyAppearing) {
+  auto file_name = create_file("a.ts", "content");
+  auto clpi_name = (m_dir / "a.clpi").string();
+  auto cache     = identification_cache_c{cache_dir()};
+
+  cache.store(file_name, "variant", { bfs::path{clpi_name} }, make_entry());
+  EXPECT_TRUE(!!cache.lookup(file_name, "variant"));
+
+  create_file("a.clpi", "content");
+  EXPECT_FALSE(!!cache.lookup(file_name, "variant"));
+}
+
+TEST_F(IdentificationCache, CorruptEntry) {
+  auto file_name = create_file("a.ts", "content");
+  auto cache     = identification_cache_c{cache_dir()};
+
+  cache.store(file_name, "variant", {}, make_entry());
+
+  for (auto it = bfs::directory_iterator{bfs::path{cache_dir()}}, end = bfs::directory_iterator{}; it != end; ++it)
+    bfs::resize_file(it->path(), bfs::file_size(it->path()) - 2);
+
+  EXPECT_FALSE(!!cache.lookup(file_name, "variant"));
+}
+
+}
@@ -0,0 +1,270 @@
+#include "common/common_pch.h"
+
+#include <ogg/ogg.h>
+
+#include "common/mm_io.h"
+#include "input/r_ogm.h"
+#include "merge/track_info.h"
+
+#include "gtest/gtest.h"
+#include "tests/unit/init.h"
+
+namespace {
+
+class test_ogm_reader_c: public ogm_reader_c {
+public:
+  test_ogm_reader_c(mm_io_cptr const &in)
+    : ogm_reader_c{track_info_c{}, in}
+  {
+  }
+
+  using ogm_reader_c::read_page;
+  using ogm_reader_c::is_page_valid;
+  using ogm_reader_c::ms_block_size;
+
+  memory_cptr const &
+  block() const {
+    return m_block;
+  }
+};
+
+class ogg_writer_c {
+protected:
+  ogg_stream_state m_os;
+  int64_t m_packet_number;
+
+public:
+  std::vector<std::string> m_pages;
+
+public:
+  ogg_writer_c()
+    : m_packet_number{}
+  {
+    ogg_stream_init(&m_os, 1);
+  }
+
+  ~ogg_writer_c() {
+    ogg_stream_clear(&m_os);
+  }
+
+  void
+  add_packet(std::string const &data) {
+    ogg_packet op;
+
+    op.packet     = reinterpret_cast<unsigned char *>(const_cast<char *>(data.c_str()));
+    op.bytes      = data.size();
+    op.b_o_s      = 0 == m_packet_number ? 1 : 0;
+    op.e_o_s      = 0;
+    op.granulepos = m_packet_number;
+    op.packetno   = m_packet_number++;
+
+    ogg_stream_packetin(&m_os, &op);
+  }
+
+  // Each flush writes up to 255 segments into one page.
+  void
+  flush() {
+    ogg_page og;
+
+    while (ogg_stream_flush(&m_os, &og))
+      m_pages.emplace_back(std::string{reinterpret_cast<char *>(og.header), static_cast<size_t>(og.header_len)} + std::string{reinterpret_cast<char *>(og.body), static_cast<size_t>(og.body_len)});
+  }
+};
+
+// The content never contains the capture pattern "OggS".
+std::string
+make_packet(size_t size,
+            unsigned int seed) {
+  auto packet = std::string(size, '\0');
+  for (auto idx = 0u; idx < size; ++idx)
+    packet[idx] = static_cast<char>((idx * 7 + seed) & 0xff);
+
+  return packet;
+}
+
+std::string
+to_string(ogg_page const &og) {
+  return std::string{reinterpret_cast<char *>(og.header), static_cast<size_t>(og.header_len)} + std::string{reinterpret_cast<char *>(og.body), static_cast<size_t>(og.body_len)};
+}
+
+std::string
+to_string(memory_cptr const &mem) {
+  return std::string{reinterpret_cast<char *>(mem->get_buffer()), mem->get_size()};
+}
+
+bool
+is_inside(memory_cptr const &mem,
+          memory_cptr const &block) {
+  return (mem->get_buffer() >= block->get_buffer()) && ((mem->get_buffer() + mem->get_size()) <= (block->get_buffer() + block->get_size()));
+}
+
+class OgmReader: public ::testing::Test {
+protected:
+  std::string m_content;
+  std::unique_ptr<test_ogm_reader_c> m_reader;
+  unsigned int m_num_warnings;
+
+  virtual void SetUp() {
+    m_num_warnings = 0;
+    set_mxmsg_handler(MXMSG_WARNING, [this](unsigned int, std::string const &) { ++m_num_warnings; });
+  }
+
+  virtual void TearDown() {
+    m_reader.reset();
+    mtxut::install_message_handlers();
+  }
+
+  void
+  open() {
+    m_reader = std::make_unique<test_ogm_reader_c>(std::make_shared<mm_mem_io_c>(reinterpret_cast<unsigned char const *>(m_content.c_str()), m_content.size()));
+  }
+
+  std::vector<std::string>
+  read_all_pages() {
+    auto pages = std::vector<std::string>{};
+    ogg_page og;
+
+    while (m_reader->read_page(&og)) {
+      EXPECT_TRUE(m_reader->is_page_valid(&og));
+      EXPECT_TRUE((og.header >= m_reader->block()->get_buffer()) && ((og.body + og.body_len) <= (m_reader->block()->get_buffer() + m_reader->block()->get_size())));
+
+      pages.push_back(to_string(og));
+    }
+
+    EXPECT_EQ(0, m_reader->read_page(&og));
+
+    return pages;
+  }
+};
+
+TEST_F(OgmReader, PagesSpanningBlockBoundaries) {
+  ogg_writer_c writer;
+
+  for (auto idx = 0u; idx < 60; ++idx) {
+    writer.add_packet(make_packet(30000 + idx * 97, idx));
+    writer.flush();
+  }
+
+  for (auto const &page : writer.m_pages)
+    m_content += page;
+
+  ASSERT_LT(3 * test_ogm_reader_c::ms_block_size, m_content.size());
+
+  open();
+
+  EXPECT_EQ(writer.m_pages, read_all_pages());
+  EXPECT_EQ(0u, m_num_warnings);
+}
+
+TEST_F(OgmReader, ResynchronizesAfterGarbageAndDamagedPages) {
+  ogg_writer_c writer;
+
+  for (auto idx = 0u; idx < 10; ++idx) {
+    writer.add_packet(make_packet(5000, idx));
+    writer.flush();
+  }
+
+  auto &pages   = writer.m_pages;
+  auto damaged  = pages[2];
+  damaged[100] ^= 0x55;
+
+  // Garbage including a capture pattern that isn't followed by a
+  // valid header, directly followed by a page with a wrong checksum.
+  m_content = pages[0] + pages[1] + std::string{"garbage OggS\x01 no page", 21} + damaged;
+  for (auto idx = 3u; idx < 7; ++idx)
+    m_content += pages[idx];
+  m_content += "more garbage";
+  for (auto idx = 7u; idx < 10; ++idx)
+    m_content += pages[idx];
+
+  open();
+
+  auto expected = pages;
+  expected.erase(expected.begin() + 2);
+
+  EXPECT_EQ(expected, read_all_pages());
+  EXPECT_EQ(2u, m_num_warnings);
+}
+
+TEST_F(OgmReader, TruncatedFile) {
+  ogg_writer_c writer;
+
+  for (auto idx = 0u; idx < 4; ++idx) {
+    writer.add_packet(make_packet(1000, idx));
+    writer.flush();
+  }
+
+  auto expected = std::vector<std::string>{ writer.m_pages[0], writer.m_pages[1], writer.m_pages[2] };
+  auto start    = writer.m_pages[0] + writer.m_pages[1] + writer.m_pages[2];
+
+  // Less than a page header, a page header without its segment table
+  // and a page without all of its body.
+  for (auto tail_size : std::vector<size_t>{ 2, 20, 40 }) {
+    m_content = start + writer.m_pages[3].substr(0, tail_size);
+    open();
+
+    EXPECT_EQ(expected, read_all_pages());
+  }
+
+  EXPECT_EQ(0u, m_num_warnings);
+}
+
+TEST_F(OgmReader, PacketsMappedToBlocks) {
+  ogg_writer_c writer;
+  auto packets = std::vector<std::string>{
+    make_packet(20000, 1),
+    make_packet(80000, 2),      // continued on the next page
+    make_packet(30000, 3),      // starts after the continued packet
+    make_packet(1000,  4),      // too small to be mapped
+  };
+
+  writer.add_packet(packets[0]);
+  writer.flush();
+  writer.add_packet(packets[1]);
+  writer.add_packet(packets[2]);
+  writer.flush();
+  writer.add_packet(packets[3]);
+  writer.flush();
+
+  ASSERT_EQ(4u, writer.m_pages.size());
+
+  for (auto const &page : writer.m_pages)
+    m_content += page;
+
+  open();
+
+  ogm_demuxer_c demuxer{m_reader.get()};
+  ogg_stream_init(&demuxer.os, 1);
+
+  auto mapped   = std::vector<bool>{};
+  auto memories = std::vector<memory_cptr>{};
+  ogg_page og;
+
+  while (m_reader->read_page(&og)) {
+    ogg_stream_pagein(&demuxer.os, &og);
+    demuxer.set_current_page(&og, m_reader->block());
+
+    ogg_packet op;
+    while (1 == ogg_stream_packetout(&demuxer.os, &op)) {
+      ASSERT_GT(packets.size(), memories.size());
+
+      auto mem = demuxer.get_packet_memory(op);
+      EXPECT_EQ(packets[memories.size()], to_string(mem));
+      EXPECT_EQ(packets[memories.size()].substr(10), to_string(demuxer.get_packet_memory(op, 10)));
+
+      mapped.push_back(is_inside(mem, m_reader->block()));
+      memories.push_back(mem);
+    }
+
+    demuxer.set_current_page(nullptr, memory_cptr{});
+  }
+
+  ASSERT_EQ(packets.size(), memories.size());
+  EXPECT_EQ((std::vector<bool>{ true, false, true, false }), mapped);
+
+  // The mapped packets keep referencing the blocks.
+  EXPECT_EQ(packets[0], to_string(memories[0]));
+  EXPECT_EQ(packets[2], to_string(memories[2]));
+}
+
+}
@@ -0,0 +1,124 @@
+#include "common/common_pch.h"
+
+#include "common/mm_io.h"
+#include "propedit/batch_runner.h"
+
+#include "gtest/gtest.h"
+#include "tests/unit/init.h"
+
+namespace {
+
+class test_batch_runner_c: public batch_runner_c {
+public:
+  test_batch_runner_c()
+    : batch_runner_c{2}
+  {
+  }
+
+  virtual ~test_batch_runner_c() {
+    mtxut::install_message_handlers();
+  }
+
+  void
+  read(std::string const &content) {
+    mm_text_io_c in{new mm_mem_io_c{reinterpret_cast<unsigned char const *>(content.c_str()), content.size()}};
+    read_jobs(in);
+  }
+
+  size_t
+  num_jobs() const {
+    return m_jobs.size();
+  }
+
+  unsigned int
+  line_number(size_t idx) const {
+    return m_jobs[idx].m_line_number;
+  }
+
+  std::vector<std::string> const &
+  args(size_t idx) const {
+    return m_jobs[idx].m_args;
+  }
+
+  std::string const &
+  error(size_t idx) const {
+    return m_jobs[idx].m_error;
+  }
+
+  size_t
+  num_warnings(size_t idx) const {
+    return m_jobs[idx].m_warnings.size();
+  }
+
+protected:
+  virtual void
+  process_file(options_cptr &options) {
+    if (options->m_file_name == "warning.mkv")
+      mxwarn("Something is fishy.\n");
+
+    else if (options->m_file_name == "error.mkv")
+      mxerror("This is broken.\n");
+
+    else if (options->m_file_name == "unknown.mkv")
+      throw 42;
+  }
+};
+
+TEST(BatchRunner, JobFileFormat) {
+  test_batch_runner_c runner;
+
+  runner.read("# A comment\n"
+              "\n"
+              "--delete-attachment 1 first.mkv\n"
+              "   \n"
+              "  --delete-attachment   2   file\\swith\\sspaces.mkv  \n"
+              "#--delete-attachment 3 ignored.mkv\n"
+              "--set title=a\\cb\\hc file\\\\name.mkv\n");
+
+  ASSERT_EQ(3u, runner.num_jobs());
+
+  EXPECT_EQ(3u, runner.line_number(0));
+  EXPECT_EQ((std::vector<std::string>{ "--delete-attachment", "1", "first.mkv" }), runner.args(0));
+
+  EXPECT_EQ(5u, runner.line_number(1));
+  EXPECT_EQ((std::vector<std::string>{ "--delete-attachment", "2", "file with spaces.mkv" }), runner.args(1));
+
+  EXPECT_EQ(7u, runner.line_number(2));
+  EXPECT_EQ((std::vector<std::string>{ "--set", "title=a:b#c", "file\\name.mkv" }), runner.args(2));
+}
+
+TEST(BatchRunner, FailuresOnlyAffectTheirJob) {
+  test_batch_runner_c runner;
+
+  runner.read("--delete-attachment 1 ok.mkv\n"
+              "--delete-attachment 1 warning.mkv\n"
+              "--delete-attachment 1 error.mkv\n"
+              "--delete-attachment 1 unknown.mkv\n"
+              "--list-property-names\n"
+              "--delete-attachment 1 --version ok.mkv\n"
+              "--help\n"
+              "--batch other_jobs.txt\n"
+              "--no-such-option ok.mkv\n"
+              "nothing_to_do.mkv\n"
+              "--delete-attachment 1 also_ok.mkv\n");
+
+  ASSERT_EQ(11u, runner.num_jobs());
+
+  EXPECT_EQ(2, runner.run());
+
+  EXPECT_TRUE(runner.error(0).empty());
+  EXPECT_EQ(0u, runner.num_warnings(0));
+
+  EXPECT_TRUE(runner.error(1).empty());
+  EXPECT_EQ(1u, runner.num_warnings(1));
+
+  EXPECT_EQ(std::string{"This is broken.\n"}, runner.error(2));
+
+  for (auto idx = 3u; 9u >= idx; ++idx)
+    EXPECT_FALSE(runner.error(idx).empty());
+
+  EXPECT_TRUE(runner.error(10).empty());
+  EXPECT_EQ(0u, runner.num_warnings(10));
+}
+
+}